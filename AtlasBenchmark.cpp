@@ -0,0 +1,213 @@
+// Packing and filling texture atlas pages for thousands of small images: packAtlas (probeImages
+// and SkylinePacker) over a generated directory of PNG icons of many sizes plus texture1.jpg and
+// texture2.jpg, then every page decoded the way TextureAtlas does it, each image straight into
+// the page (decodeAtlasImage), on one thread and on a ThreadPool, against stbi_load of every image
+// and a copy into the page, best of 3. Every region is compared with stbi_load and its padding checked,
+// and an icon grown after packing must be rejected without a write to its page.
+// usage: AtlasBenchmark [images] [threads] [page size]
+//   5000 images by default, threads 0 is std::thread::hardware_concurrency(), 2048 pages; Linux only
+// build with TextureAtlas.cpp, ImageProbe.cpp, TestImages.cpp, ImageWriter.cpp, StbImage.cpp,
+// ScratchArena.cpp, MappedFile.cpp, ThreadPool.cpp and glad.c
+
+#include <stb_image/stb_image.h>
+#include "TestImages.h"
+#include "TextureAtlas.h"
+#include "ThreadPool.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char* directory = "AtlasBenchmark.files";
+
+    // an RGBA icon in stored (uncompressed) deflate blocks: a gradient tinted by its number, with a
+    // one texel frame, so every icon and its edges can be told apart
+    std::vector<unsigned char> iconPng(int width, int height, int seed)
+    {
+        PngOptions options;
+        options.compressed = false;
+        options.idatBytes = 0;
+        return encodePng(width, height, [&](int y, unsigned char* row)
+        {
+            for (int x = 0; x < width; x++, row += 4)
+            {
+                const bool frame = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+                row[0] = static_cast<unsigned char>(frame ? 255 : x * 255 / width);
+                row[1] = static_cast<unsigned char>(frame ? seed * 37 : y * 255 / height);
+                row[2] = static_cast<unsigned char>(seed * 11);
+                row[3] = static_cast<unsigned char>(frame ? 255 : 128 + seed % 128);
+            }
+        }, options);
+    }
+
+    // icons of 16 to 128 texels a side, not all square, and the two textures as hard links
+    std::vector<std::string> generate(int count)
+    {
+        mkdir(directory, 0755);
+        std::vector<std::string> paths;
+        for (int i = 0; i < count; i++)
+        {
+            std::string path = std::string(directory) + "/" + std::to_string(i);
+            bool written;
+            if (i < 2)
+            {
+                path += ".jpg";
+                unlink(path.c_str());
+                written = link(i ? "texture2.jpg" : "texture1.jpg", path.c_str()) == 0;
+            }
+            else
+            {
+                path += ".png";
+                const int width = 16 + (i * 7919) % 113, height = i % 3 ? width : 16 + (i * 104729) % 113;
+                written = writeFile(path, iconPng(width, height, i));
+            }
+            if (!written)
+            {
+                std::printf("cannot write %s\n", path.c_str());
+                return {};
+            }
+            paths.push_back(path);
+        }
+        return paths;
+    }
+
+    // every region against stbi_load (flipped), and every padding texel against the edge next to it
+    bool verify(const AtlasLayout& layout, const std::vector<std::vector<unsigned char>>& pages)
+    {
+        stbi_set_flip_vertically_on_load(true);
+        const int size = layout.pageSize, padding = layout.padding;
+        for (size_t image = 0; image < layout.paths.size(); image++)
+        {
+            const AtlasRegion& region = layout.regions[image];
+            if (region.page < 0)
+                return false;
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(layout.paths[image].c_str(), &width, &height, &channels, 4);
+            if (!pixels)
+                return false;
+            const unsigned char* page = pages[region.page].data();
+            bool same = true;
+            for (int y = -padding; y < height + padding && same; y++)
+                for (int x = -padding; x < width + padding && same; x++)
+                {
+                    const int sx = std::min(std::max(x, 0), width - 1), sy = std::min(std::max(y, 0), height - 1);
+                    same = std::memcmp(page + ((static_cast<size_t>(region.y) + y) * size + region.x + x) * 4,
+                        pixels + (static_cast<size_t>(sy) * width + sx) * 4, 4) == 0;
+                }
+            stbi_image_free(pixels);
+            if (!same)
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? std::max(2, std::atoi(argv[1])) : 5000;
+    ThreadPool pool(argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0);
+    const int pageSize = argc > 3 ? std::atoi(argv[3]) : 2048;
+
+    const std::vector<std::string> paths = generate(count);
+    if (paths.empty())
+        return 1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const AtlasLayout layout = packAtlas(paths, pageSize, 2, &pool);
+    const double packSeconds = secondsSince(start);
+    long long packed = 0;
+    for (const AtlasRegion& region : layout.regions)
+        packed += static_cast<long long>(region.width + 2 * layout.padding) * (region.height + 2 * layout.padding);
+    std::printf("%d images into %zu pages of %dx%d, %.1f%% occupied, probed and packed in %.1f ms\n", count, layout.pages.size(),
+        pageSize, pageSize, 100.0 * packed / (static_cast<double>(pageSize) * pageSize * layout.pages.size()), packSeconds * 1000.0);
+
+    bool identical = true;
+    std::printf("%36s %10s %12s %10s\n", "fill every page", "ms", "images/s", "identical");
+    const size_t pageBytes = static_cast<size_t>(pageSize) * pageSize * 4;
+    for (int method = 0; method < 3; method++)
+    {
+        ThreadPool* fillPool = method == 2 ? &pool : NULL;
+        if (fillPool && pool.size() < 2)
+            continue;
+        std::vector<std::vector<unsigned char>> pages(layout.pages.size(), std::vector<unsigned char>(pageBytes, 0));
+        std::vector<int> images(paths.size());
+        for (size_t i = 0; i < images.size(); i++)
+            images[i] = static_cast<int>(i);
+        bool decoded = true;
+        auto fill = [&](int index, unsigned)
+        {
+            const AtlasRegion& region = layout.regions[images[index]];
+            unsigned char* page = pages[region.page].data();
+            if (method > 0)
+            {
+                std::string error;
+                if (!decodeAtlasImage(layout, images[index], true, page, error))
+                    decoded = false;
+                return;
+            }
+            // stbi_load, then a copy of the rows and the padding into the page
+            int width, height, channels;
+            stbi_set_flip_vertically_on_load_thread(1);
+            unsigned char* pixels = stbi_load(layout.paths[images[index]].c_str(), &width, &height, &channels, 4);
+            if (!pixels)
+            {
+                decoded = false;
+                return;
+            }
+            const int padding = layout.padding;
+            for (int y = -padding; y < height + padding; y++)
+            {
+                const int sy = std::min(std::max(y, 0), height - 1);
+                unsigned char* row = page + ((static_cast<size_t>(region.y) + y) * pageSize + region.x) * 4;
+                std::memcpy(row, pixels + static_cast<size_t>(sy) * width * 4, static_cast<size_t>(width) * 4);
+                for (int x = 1; x <= padding; x++)
+                {
+                    std::memcpy(row - x * 4, row, 4);
+                    std::memcpy(row + (width - 1 + x) * 4, row + (width - 1) * 4, 4);
+                }
+            }
+            stbi_image_free(pixels);
+        };
+        // every pass writes every texel of the regions again
+        double seconds = 1e9;
+        for (int repeat = 0; repeat < 3; repeat++)
+        {
+            start = std::chrono::steady_clock::now();
+            if (fillPool)
+                fillPool->parallelFor(static_cast<int>(images.size()), fill);
+            else
+                for (size_t i = 0; i < images.size(); i++)
+                    fill(static_cast<int>(i), 0);
+            seconds = std::min(seconds, secondsSince(start));
+        }
+        const bool same = decoded && verify(layout, pages);
+        identical = identical && same;
+        const std::string name = method == 0 ? "stbi_load + copy, 1 thread" :
+            "decodeAtlasImage, " + std::to_string(fillPool ? fillPool->size() : 1) + " thread(s)";
+        std::printf("%36s %10.1f %12.0f %10s\n", name.c_str(), seconds * 1000.0, count / seconds, same ? "yes" : "NO");
+    }
+
+    // an icon replaced by a larger one after packing must fail before anything lands in the shared page
+    const AtlasRegion& resized = layout.regions[2];
+    std::vector<unsigned char> page(pageBytes, 0);
+    std::string error;
+    const bool rejected = writeFile(paths[2], iconPng(resized.width + 8, resized.height + 8, 2)) &&
+        !decodeAtlasImage(layout, 2, true, page.data(), error) &&
+        std::count(page.begin(), page.end(), 0) == static_cast<long>(page.size());
+    identical = identical && rejected;
+    std::printf("%36s %10s\n", "resized image, page untouched", rejected ? "yes" : "NO");
+
+    for (const std::string& path : paths)
+        unlink(path.c_str());
+    rmdir(directory);
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+#include "BatchTransform.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define BT_TARGET_SSE2
+#define BT_TARGET_AVX
+#else
+#define BT_TARGET_SSE2 __attribute__((target("sse2")))
+#define BT_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace
+{
+    // objects per parallelFor job, a multiple of the AVX width
+    const int chunkSize = 4096;
+
+#ifdef BT_X86
+    // x, y, z, w hold one column of four consecutive matrices, lane i belongs to matrix i
+    BT_TARGET_SSE2 inline void storeColumn(char* out, size_t stride, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+    {
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(reinterpret_cast<float*>(out) + column * 4, x);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + stride) + column * 4, y);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + 2 * stride) + column * 4, z);
+        _mm_storeu_ps(reinterpret_cast<float*>(out + 3 * stride) + column * 4, w);
+    }
+
+    // the same for eight matrices, lanes 0-3 and 4-7 are transposed separately
+    BT_TARGET_AVX inline void storeColumns(char* out, size_t stride, int column, __m256 x, __m256 y, __m256 z, __m256 w)
+    {
+        storeColumn(out, stride, column, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+            _mm256_castps256_ps128(z), _mm256_castps256_ps128(w));
+        storeColumn(out + 4 * stride, stride, column, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+            _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1));
+    }
+#endif
+}
+
+BatchTransform::BatchTransform(unsigned threads)
+    : selected(Kernel::Scalar), composeRange(&BatchTransform::composeScalar), pool(new ThreadPool(threads))
+{
+    setKernel(Kernel::AVX);
+}
+
+void BatchTransform::setThreadCount(unsigned threads)
+{
+    pool.reset(new ThreadPool(threads));
+}
+
+unsigned BatchTransform::threadCount() const
+{
+    return pool->size();
+}
+
+bool BatchTransform::kernelSupported(Kernel candidate)
+{
+    switch (candidate)
+    {
+#ifdef BT_X86
+    case Kernel::SSE2:
+        return true;
+    case Kernel::AVX:
+        return cpuHasAvx();
+#endif
+    case Kernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* BatchTransform::kernelName(Kernel candidate)
+{
+    switch (candidate)
+    {
+    case Kernel::SSE2: return "SSE2";
+    case Kernel::AVX: return "AVX";
+    default: return "scalar";
+    }
+}
+
+void BatchTransform::setKernel(Kernel wanted)
+{
+    if (!kernelSupported(wanted))
+        wanted = kernelSupported(Kernel::AVX) ? Kernel::AVX :
+            kernelSupported(Kernel::SSE2) ? Kernel::SSE2 : Kernel::Scalar;
+
+    selected = wanted;
+    switch (selected)
+    {
+    case Kernel::SSE2: composeRange = &BatchTransform::composeSse2; break;
+    case Kernel::AVX: composeRange = &BatchTransform::composeAvx; break;
+    default: composeRange = &BatchTransform::composeScalar; break;
+    }
+}
+
+void BatchTransform::compose(const TransformBatch& batch, int count, glm::mat4* out, size_t stride)
+{
+    char* bytes = reinterpret_cast<char*>(out);
+    const int chunks = (count + chunkSize - 1) / chunkSize;
+    if (chunks < 2 || pool->size() < 2)
+    {
+        composeRange(batch, 0, count, bytes, stride);
+        return;
+    }
+
+    const ComposeKernel kernelRange = composeRange;
+    pool->parallelFor(chunks, [&](int chunk, unsigned) {
+        const int begin = chunk * chunkSize;
+        kernelRange(batch, begin, std::min(count, begin + chunkSize), bytes, stride);
+    });
+}
+
+// The SIMD kernels evaluate exactly these expressions in the same order, lane by lane.
+void BatchTransform::composeScalar(const TransformBatch& batch, int begin, int end, char* out, size_t stride)
+{
+    for (int i = begin; i < end; i++)
+    {
+        const float qx = batch.rotation[0][i], qy = batch.rotation[1][i], qz = batch.rotation[2][i], qw = batch.rotation[3][i];
+        const float x2 = qx + qx, y2 = qy + qy, z2 = qz + qz;
+        const float xx = qx * x2, yy = qy * y2, zz = qz * z2;
+        const float xy = qx * y2, xz = qx * z2, yz = qy * z2;
+        const float wx = qw * x2, wy = qw * y2, wz = qw * z2;
+        const float sx = batch.scale[0][i], sy = batch.scale[1][i], sz = batch.scale[2][i];
+
+        float* m = reinterpret_cast<float*>(out + i * stride);
+        m[0] = (1.0f - (yy + zz)) * sx;
+        m[1] = (xy + wz) * sx;
+        m[2] = (xz - wy) * sx;
+        m[3] = 0.0f;
+        m[4] = (xy - wz) * sy;
+        m[5] = (1.0f - (xx + zz)) * sy;
+        m[6] = (yz + wx) * sy;
+        m[7] = 0.0f;
+        m[8] = (xz + wy) * sz;
+        m[9] = (yz - wx) * sz;
+        m[10] = (1.0f - (xx + yy)) * sz;
+        m[11] = 0.0f;
+        m[12] = batch.translation[0][i];
+        m[13] = batch.translation[1][i];
+        m[14] = batch.translation[2][i];
+        m[15] = 1.0f;
+    }
+}
+
+#ifdef BT_X86
+
+BT_TARGET_SSE2 void BatchTransform::composeSse2(const TransformBatch& batch, int begin, int end, char* out, size_t stride)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 qx = _mm_loadu_ps(batch.rotation[0] + i);
+        const __m128 qy = _mm_loadu_ps(batch.rotation[1] + i);
+        const __m128 qz = _mm_loadu_ps(batch.rotation[2] + i);
+        const __m128 qw = _mm_loadu_ps(batch.rotation[3] + i);
+        const __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+        const __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+        const __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+        const __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+        const __m128 sx = _mm_loadu_ps(batch.scale[0] + i);
+        const __m128 sy = _mm_loadu_ps(batch.scale[1] + i);
+        const __m128 sz = _mm_loadu_ps(batch.scale[2] + i);
+
+        char* m = out + i * stride;
+        storeColumn(m, stride, 0,
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+            _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+            _mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero);
+        storeColumn(m, stride, 1,
+            _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+            _mm_mul_ps(_mm_add_ps(yz, wx), sy), zero);
+        storeColumn(m, stride, 2,
+            _mm_mul_ps(_mm_add_ps(xz, wy), sz),
+            _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero);
+        storeColumn(m, stride, 3,
+            _mm_loadu_ps(batch.translation[0] + i),
+            _mm_loadu_ps(batch.translation[1] + i),
+            _mm_loadu_ps(batch.translation[2] + i), one);
+    }
+    composeScalar(batch, i, end, out, stride);
+}
+
+BT_TARGET_AVX void BatchTransform::composeAvx(const TransformBatch& batch, int begin, int end, char* out, size_t stride)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 qx = _mm256_loadu_ps(batch.rotation[0] + i);
+        const __m256 qy = _mm256_loadu_ps(batch.rotation[1] + i);
+        const __m256 qz = _mm256_loadu_ps(batch.rotation[2] + i);
+        const __m256 qw = _mm256_loadu_ps(batch.rotation[3] + i);
+        const __m256 x2 = _mm256_add_ps(qx, qx), y2 = _mm256_add_ps(qy, qy), z2 = _mm256_add_ps(qz, qz);
+        const __m256 xx = _mm256_mul_ps(qx, x2), yy = _mm256_mul_ps(qy, y2), zz = _mm256_mul_ps(qz, z2);
+        const __m256 xy = _mm256_mul_ps(qx, y2), xz = _mm256_mul_ps(qx, z2), yz = _mm256_mul_ps(qy, z2);
+        const __m256 wx = _mm256_mul_ps(qw, x2), wy = _mm256_mul_ps(qw, y2), wz = _mm256_mul_ps(qw, z2);
+        const __m256 sx = _mm256_loadu_ps(batch.scale[0] + i);
+        const __m256 sy = _mm256_loadu_ps(batch.scale[1] + i);
+        const __m256 sz = _mm256_loadu_ps(batch.scale[2] + i);
+
+        char* m = out + i * stride;
+        const __m256 zero = _mm256_setzero_ps();
+        storeColumns(m, stride, 0,
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+            _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+            _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), zero);
+        storeColumns(m, stride, 1,
+            _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+            _mm256_mul_ps(_mm256_add_ps(yz, wx), sy), zero);
+        storeColumns(m, stride, 2,
+            _mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+            _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), zero);
+        storeColumns(m, stride, 3,
+            _mm256_loadu_ps(batch.translation[0] + i),
+            _mm256_loadu_ps(batch.translation[1] + i),
+            _mm256_loadu_ps(batch.translation[2] + i), one);
+    }
+    // leave the upper halves clean, otherwise the SSE code that follows (glm, libm) pays for the transition
+    _mm256_zeroupper();
+    composeScalar(batch, i, end, out, stride);
+}
+
+#else
+
+void BatchTransform::composeSse2(const TransformBatch& batch, int begin, int end, char* out, size_t stride)
+{
+    composeScalar(batch, begin, end, out, stride);
+}
+
+void BatchTransform::composeAvx(const TransformBatch& batch, int begin, int end, char* out, size_t stride)
+{
+    composeScalar(batch, begin, end, out, stride);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+
+// Structure of arrays describing count objects, one float per object in every array.
+// Arrays that are the same for all objects (e.g. z = 0) may point at a shared buffer.
+struct TransformBatch
+{
+    const float* translation[3];    // x, y, z
+    const float* rotation[4];       // unit quaternion x, y, z, w (glm::angleAxis)
+    const float* scale[3];          // x, y, z
+};
+
+// Model matrices for many objects at once,
+//   model[i] = translate(translation[i]) * mat4_cast(rotation[i]) * scale(scale[i])
+// i.e. the glm::translate -> glm::rotate -> glm::scale chain of the exercises.
+// The SIMD kernels build 4 (SSE2) or 8 (AVX) matrices per step straight from the arrays;
+// large batches are split across a ThreadPool.
+class BatchTransform
+{
+public:
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX
+    };
+
+    // threads == 0 uses std::thread::hardware_concurrency()
+    explicit BatchTransform(unsigned threads = 0);
+
+    void setThreadCount(unsigned threads);
+    unsigned threadCount() const;
+
+    // the best kernel supported by the CPU is picked in the constructor;
+    // asking for an unsupported one falls back to the best supported
+    void setKernel(Kernel kernel);
+    Kernel kernel() const { return selected; }
+    static bool kernelSupported(Kernel candidate);
+    static const char* kernelName(Kernel candidate);
+
+    // writes count matrices, stride bytes apart, so they can go straight into an
+    // interleaved instance array; the kernels give bit-identical results
+    void compose(const TransformBatch& batch, int count, glm::mat4* out, size_t stride = sizeof(glm::mat4));
+
+private:
+    typedef void (*ComposeKernel)(const TransformBatch& batch, int begin, int end, char* out, size_t stride);
+
+    static void composeScalar(const TransformBatch& batch, int begin, int end, char* out, size_t stride);
+    static void composeSse2(const TransformBatch& batch, int begin, int end, char* out, size_t stride);
+    static void composeAvx(const TransformBatch& batch, int begin, int end, char* out, size_t stride);
+
+    Kernel selected;
+    ComposeKernel composeRange;
+    std::unique_ptr<ThreadPool> pool;
+};
@@ -0,0 +1,34 @@
+#include "CameraBuffer.h"
+
+#include <cstddef>
+#include <cstring>
+
+CameraBuffer::CameraBuffer()
+    : valid(false), buffer(0)
+{
+    static_assert(sizeof(Block) == 144, "Camera block has to match the std140 layout");
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+void CameraBuffer::update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+{
+    const Block block = { view, projection, glm::vec4(position, 1.0f) };
+    if (valid && memcmp(&block, &last, sizeof(block)) == 0)
+        return;
+    last = block;
+    valid = true;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+}
+
+void CameraBuffer::destroy()
+{
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// GLSL side of the camera uniform block, for concatenating into shader sources:
+//
+//   "#version 330 core\n"
+//   CAMERA_UNIFORM_BLOCK
+//   "void main() ..."
+#define CAMERA_UNIFORM_BLOCK \
+    "layout(std140) uniform Camera\n" \
+    "{\n" \
+    "    mat4 view;\n" \
+    "    mat4 projection;\n" \
+    "    vec3 viewPos;\n" \
+    "};\n"
+
+// Per-frame camera matrices in one uniform buffer bound to a fixed binding point, shared
+// by every program that declares CAMERA_UNIFORM_BLOCK (see ShaderProgram::bindUniformBlock).
+// update() writes the whole block with a single glBufferSubData, however many programs
+// and objects read it, and nothing at all while the camera does not move.
+class CameraBuffer
+{
+public:
+    static const GLuint binding = 0;
+
+    // call once GL is loaded
+    CameraBuffer();
+    CameraBuffer(const CameraBuffer&) = delete;
+    CameraBuffer& operator=(const CameraBuffer&) = delete;
+
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position);
+    // deletes the buffer, call while the context is still alive
+    void destroy();
+
+private:
+    // std140: mat4 is four vec4 columns, vec3 is aligned (and padded) to 16 bytes
+    struct Block
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 position;
+    };
+
+    Block last;
+    bool valid;
+    GLuint buffer;
+};
@@ -0,0 +1,82 @@
+#include "CircleTessellation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const GLfloat twoPi = 2.0f * 3.14159265f;
+}
+
+CircleTessellation::CircleTessellation(int maxSegments, GLfloat radius)
+    : maximum(std::max(maxSegments, 1)), current(0), uploaded(0), radius(radius),
+    resident(maximum + 1, false), staging((maximum + 2) * 3), VAO(0), VBO(0), EBO(0)
+{
+    // fan n uses the first n triangles: (0, 1, 2), (0, 2, 3), ... (0, n, n + 1)
+    std::vector<GLuint> indices(maximum * 3);
+    for (int i = 0; i < maximum; i++)
+    {
+        indices[i * 3] = 0;
+        indices[i * 3 + 1] = i + 1;
+        indices[i * 3 + 2] = i + 2;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, baseVertex(maximum + 1) * 3 * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+GLint CircleTessellation::baseVertex(int segments)
+{
+    // fans 1 .. segments - 1 come first, fan k has k + 2 vertices
+    return (segments - 1) * segments / 2 + 2 * (segments - 1);
+}
+
+void CircleTessellation::setSegments(int segments)
+{
+    current = std::min(std::max(segments, 0), maximum);
+    if (current == 0 || resident[current])
+        return;
+
+    // center, ring vertices at i * 2pi / n for i = 1 .. n, then ring vertex 1 closing the fan
+    const int n = current;
+    staging[0] = 0.0f;
+    staging[1] = 0.0f;
+    staging[2] = 0.0f;
+    for (int i = 1; i <= n; i++)
+    {
+        staging[i * 3] = radius * std::cos(i * twoPi / n);
+        staging[i * 3 + 1] = radius * std::sin(i * twoPi / n);
+        staging[i * 3 + 2] = 0.0f;
+    }
+    std::copy(staging.begin() + 3, staging.begin() + 6, staging.begin() + (n + 1) * 3);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, baseVertex(n) * 3 * sizeof(GLfloat), (n + 2) * 3 * sizeof(GLfloat), staging.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    resident[n] = true;
+    uploaded++;
+}
+
+void CircleTessellation::draw() const
+{
+    glBindVertexArray(VAO);
+    if (current > 0)
+        glDrawElementsBaseVertex(GL_TRIANGLES, current * 3, GL_UNSIGNED_INT, 0, baseVertex(current));
+}
+
+void CircleTessellation::destroy()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Triangle fans approximating a circle of a fixed radius, for 1 to maxSegments triangles.
+// One vertex buffer sized for every segment count up front holds each count's fan in its own
+// range; the fan is computed and written (glBufferSubData) the first time its count is used.
+// Fan n is the center, the n ring vertices and the first ring vertex again, so all counts
+// share a single index buffer (0, i, i + 1) and are drawn with glDrawElementsBaseVertex.
+// Switching to a count seen before only changes the base vertex; nothing is allocated
+// after the constructor. There is no separate unit-circle table: the ring of n segments sits at
+// multiples of 2pi / n, which one table of angles only serves when n divides its size, and each
+// count's cos/sin run once anyway, so the buffer's ranges are the table.
+class CircleTessellation
+{
+public:
+    // call once GL is loaded; leaves the VAO unbound
+    CircleTessellation(int maxSegments, GLfloat radius);
+    CircleTessellation(const CircleTessellation&) = delete;
+    CircleTessellation& operator=(const CircleTessellation&) = delete;
+
+    // clamped to 0..maxSegments, 0 draws nothing
+    void setSegments(int segments);
+    int segments() const { return current; }
+    int maxSegments() const { return maximum; }
+    // fans computed and uploaded so far
+    int uploads() const { return uploaded; }
+
+    // binds the VAO and leaves it bound
+    void draw() const;
+    // deletes the GL objects, call while the context is still alive
+    void destroy();
+
+private:
+    // first vertex of the fan with the given number of segments
+    static GLint baseVertex(int segments);
+
+    int maximum;
+    int current;
+    int uploaded;
+    GLfloat radius;
+    std::vector<bool> resident;
+    std::vector<GLfloat> staging;   // one fan, reused for every upload
+    GLuint VAO, VBO, EBO;
+};
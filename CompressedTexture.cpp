@@ -0,0 +1,1145 @@
+#include "CompressedTexture.h"
+#include "CpuFeatures.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define CT_TARGET_SSE2
+#define CT_TARGET_AVX2
+#else
+#define CT_TARGET_SSE2 __attribute__((target("sse2")))
+#define CT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    // blocks per parallelFor job
+    const int blocksPerJob = 512;
+
+    // BC7 4-bit index weights, out of 64
+    const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // the 16 texels of a block, one channel after another, for the index search
+    struct Texels
+    {
+        int16_t channel[4][16];
+    };
+
+    // the nearest of count palette entries (by squared RGBA distance, the lower index on a tie)
+    // for every texel, into indices; returns the summed squared error
+    typedef uint32_t (*SelectKernel)(const Texels& texels, const int16_t (*palette)[4], int count, unsigned char* indices);
+
+    // The SIMD kernels compute the same integer distances and keep the same entries.
+    uint32_t selectScalar(const Texels& texels, const int16_t (*palette)[4], int count, unsigned char* indices)
+    {
+        uint32_t total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = INT_MAX, index = 0;
+            for (int e = 0; e < count; e++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    const int d = texels.channel[c][i] - palette[e][c];
+                    distance += d * d;
+                }
+                if (distance < best)
+                {
+                    best = distance;
+                    index = e;
+                }
+            }
+            indices[i] = static_cast<unsigned char>(index);
+            total += best;
+        }
+        return total;
+    }
+
+#ifdef CT_X86
+    // eight texels per register; madd over interleaved channel pairs gives r*r + g*g and b*b + a*a
+    // of four texels as 32-bit sums
+    CT_TARGET_SSE2 uint32_t selectSse2(const Texels& texels, const int16_t (*palette)[4], int count, unsigned char* indices)
+    {
+        uint32_t total = 0;
+        for (int half = 0; half < 2; half++)
+        {
+            const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels.channel[0] + half * 8));
+            const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels.channel[1] + half * 8));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels.channel[2] + half * 8));
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels.channel[3] + half * 8));
+            __m128i bestLow = _mm_set1_epi32(INT_MAX), bestHigh = bestLow;
+            __m128i indexLow = _mm_setzero_si128(), indexHigh = indexLow;
+            for (int e = 0; e < count; e++)
+            {
+                const __m128i dr = _mm_sub_epi16(r, _mm_set1_epi16(palette[e][0]));
+                const __m128i dg = _mm_sub_epi16(g, _mm_set1_epi16(palette[e][1]));
+                const __m128i db = _mm_sub_epi16(b, _mm_set1_epi16(palette[e][2]));
+                const __m128i da = _mm_sub_epi16(a, _mm_set1_epi16(palette[e][3]));
+                const __m128i rgLow = _mm_unpacklo_epi16(dr, dg), baLow = _mm_unpacklo_epi16(db, da);
+                const __m128i rgHigh = _mm_unpackhi_epi16(dr, dg), baHigh = _mm_unpackhi_epi16(db, da);
+                const __m128i low = _mm_add_epi32(_mm_madd_epi16(rgLow, rgLow), _mm_madd_epi16(baLow, baLow));
+                const __m128i high = _mm_add_epi32(_mm_madd_epi16(rgHigh, rgHigh), _mm_madd_epi16(baHigh, baHigh));
+                const __m128i entry = _mm_set1_epi32(e);
+                const __m128i lessLow = _mm_cmplt_epi32(low, bestLow), lessHigh = _mm_cmplt_epi32(high, bestHigh);
+                bestLow = _mm_or_si128(_mm_and_si128(lessLow, low), _mm_andnot_si128(lessLow, bestLow));
+                bestHigh = _mm_or_si128(_mm_and_si128(lessHigh, high), _mm_andnot_si128(lessHigh, bestHigh));
+                indexLow = _mm_or_si128(_mm_and_si128(lessLow, entry), _mm_andnot_si128(lessLow, indexLow));
+                indexHigh = _mm_or_si128(_mm_and_si128(lessHigh, entry), _mm_andnot_si128(lessHigh, indexHigh));
+            }
+            int32_t best[8], index[8];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(best), bestLow);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(best + 4), bestHigh);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(index), indexLow);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(index + 4), indexHigh);
+            for (int i = 0; i < 8; i++)
+            {
+                indices[half * 8 + i] = static_cast<unsigned char>(index[i]);
+                total += best[i];
+            }
+        }
+        return total;
+    }
+
+    // all 16 texels in one register per channel; the 256-bit unpacks work per 128-bit lane, so
+    // the low sums hold texels 0-3 and 8-11, the high ones 4-7 and 12-15
+    CT_TARGET_AVX2 uint32_t selectAvx2(const Texels& texels, const int16_t (*palette)[4], int count, unsigned char* indices)
+    {
+        const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(texels.channel[0]));
+        const __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(texels.channel[1]));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(texels.channel[2]));
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(texels.channel[3]));
+        __m256i bestLow = _mm256_set1_epi32(INT_MAX), bestHigh = bestLow;
+        __m256i indexLow = _mm256_setzero_si256(), indexHigh = indexLow;
+        for (int e = 0; e < count; e++)
+        {
+            const __m256i dr = _mm256_sub_epi16(r, _mm256_set1_epi16(palette[e][0]));
+            const __m256i dg = _mm256_sub_epi16(g, _mm256_set1_epi16(palette[e][1]));
+            const __m256i db = _mm256_sub_epi16(b, _mm256_set1_epi16(palette[e][2]));
+            const __m256i da = _mm256_sub_epi16(a, _mm256_set1_epi16(palette[e][3]));
+            const __m256i rgLow = _mm256_unpacklo_epi16(dr, dg), baLow = _mm256_unpacklo_epi16(db, da);
+            const __m256i rgHigh = _mm256_unpackhi_epi16(dr, dg), baHigh = _mm256_unpackhi_epi16(db, da);
+            const __m256i low = _mm256_add_epi32(_mm256_madd_epi16(rgLow, rgLow), _mm256_madd_epi16(baLow, baLow));
+            const __m256i high = _mm256_add_epi32(_mm256_madd_epi16(rgHigh, rgHigh), _mm256_madd_epi16(baHigh, baHigh));
+            const __m256i entry = _mm256_set1_epi32(e);
+            const __m256i lessLow = _mm256_cmpgt_epi32(bestLow, low), lessHigh = _mm256_cmpgt_epi32(bestHigh, high);
+            bestLow = _mm256_blendv_epi8(bestLow, low, lessLow);
+            bestHigh = _mm256_blendv_epi8(bestHigh, high, lessHigh);
+            indexLow = _mm256_blendv_epi8(indexLow, entry, lessLow);
+            indexHigh = _mm256_blendv_epi8(indexHigh, entry, lessHigh);
+        }
+        int32_t best[16], index[16];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(best), bestLow);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(best + 8), bestHigh);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(index), indexLow);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(index + 8), indexHigh);
+        static const int texelOf[16] = { 0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15 };
+        uint32_t total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            indices[texelOf[i]] = static_cast<unsigned char>(index[i]);
+            total += best[i];
+        }
+        return total;
+    }
+#endif
+
+    // the line through the block's texels along their principal axis (power iteration on the
+    // covariance of the first channels), cut at the outermost projections
+    void fitLine(const unsigned char (*texels)[4], int channels, float* low, float* high)
+    {
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < channels; c++)
+                mean[c] += texels[i][c];
+        for (int c = 0; c < channels; c++)
+            mean[c] /= 16.0f;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < channels; c++)
+                for (int d = c; d < channels; d++)
+                    covariance[c][d] += (texels[i][c] - mean[c]) * (texels[i][d] - mean[d]);
+        for (int c = 0; c < channels; c++)
+            for (int d = 0; d < c; d++)
+                covariance[c][d] = covariance[d][c];
+
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, length = 0.0f;
+            for (int c = 0; c < channels; c++)
+            {
+                for (int d = 0; d < channels; d++)
+                    next[c] += covariance[c][d] * axis[d];
+                length = std::max(length, std::fabs(next[c]));
+            }
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < channels; c++)
+                axis[c] = next[c] / length;
+        }
+        float norm = 0.0f;
+        for (int c = 0; c < channels; c++)
+            norm += axis[c] * axis[c];
+        norm = std::sqrt(norm);
+
+        float minimum = 0.0f, maximum = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channels; c++)
+                t += (texels[i][c] - mean[c]) * axis[c] / norm;
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            low[c] = std::min(std::max(mean[c] + minimum * axis[c] / norm, 0.0f), 255.0f);
+            high[c] = std::min(std::max(mean[c] + maximum * axis[c] / norm, 0.0f), 255.0f);
+        }
+    }
+
+    // the endpoints minimizing the squared error of texel i = (1 - weight[i]) * low + weight[i] * high;
+    // false when all weights are equal
+    bool leastSquares(const unsigned char (*texels)[4], int channels, const float* weights, float* low, float* high)
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f, lowSum[4] = {}, highSum[4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            const float w = weights[i], v = 1.0f - w;
+            a += v * v;
+            b += v * w;
+            c += w * w;
+            for (int k = 0; k < channels; k++)
+            {
+                lowSum[k] += v * texels[i][k];
+                highSum[k] += w * texels[i][k];
+            }
+        }
+        const float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int k = 0; k < channels; k++)
+        {
+            low[k] = std::min(std::max((c * lowSum[k] - b * highSum[k]) / determinant, 0.0f), 255.0f);
+            high[k] = std::min(std::max((a * highSum[k] - b * lowSum[k]) / determinant, 0.0f), 255.0f);
+        }
+        return true;
+    }
+
+    Texels texelsOf(const unsigned char (*rgba)[4], bool alpha)
+    {
+        Texels texels;
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                texels.channel[c][i] = c < 3 || alpha ? rgba[i][c] : 0;
+        return texels;
+    }
+
+    // --- BC1 color ---
+
+    uint16_t pack565(const float* color)
+    {
+        const int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+        const int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+        const int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpack565(uint16_t color, int16_t* rgb)
+    {
+        const int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+        rgb[0] = static_cast<int16_t>((r << 3) | (r >> 2));
+        rgb[1] = static_cast<int16_t>((g << 2) | (g >> 4));
+        rgb[2] = static_cast<int16_t>((b << 3) | (b >> 2));
+    }
+
+    // the four-color palette: color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+    void colorPalette(uint16_t color0, uint16_t color1, bool fourColors, int16_t (*palette)[4])
+    {
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            const int a = palette[0][c], b = palette[1][c];
+            palette[2][c] = static_cast<int16_t>(fourColors ? (2 * a + b) / 3 : (a + b) / 2);
+            palette[3][c] = static_cast<int16_t>(fourColors ? (a + 2 * b) / 3 : 0);
+        }
+        for (int e = 0; e < 4; e++)
+            palette[e][3] = 0;
+    }
+
+    void encodeColor(const unsigned char (*rgba)[4], SelectKernel select, unsigned char* out)
+    {
+        static const float weightOf[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        const Texels texels = texelsOf(rgba, false);
+        float low[4], high[4];
+        fitLine(rgba, 3, low, high);
+        uint16_t color0 = pack565(high), color1 = pack565(low);
+        int16_t palette[4][4];
+        unsigned char indices[16], candidate[16];
+        colorPalette(color0, color1, true, palette);
+        uint32_t error = select(texels, palette, 4, indices);
+
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+            weights[i] = weightOf[indices[i]];
+        if (error > 0 && leastSquares(rgba, 3, weights, high, low))
+        {
+            const uint16_t refined0 = pack565(high), refined1 = pack565(low);
+            colorPalette(refined0, refined1, true, palette);
+            const uint32_t refinedError = select(texels, palette, 4, candidate);
+            if (refinedError < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                std::memcpy(indices, candidate, 16);
+            }
+        }
+
+        // color0 > color1 selects the four-color palette; swapping the endpoints swaps 0-1 and 2-3
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            for (int i = 0; i < 16; i++)
+                indices[i] ^= 1;
+        }
+        else if (color0 == color1)
+            std::memset(indices, 0, 16);
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++)
+            bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+        const unsigned char block[8] = {
+            static_cast<unsigned char>(color0), static_cast<unsigned char>(color0 >> 8),
+            static_cast<unsigned char>(color1), static_cast<unsigned char>(color1 >> 8),
+            static_cast<unsigned char>(bits), static_cast<unsigned char>(bits >> 8),
+            static_cast<unsigned char>(bits >> 16), static_cast<unsigned char>(bits >> 24) };
+        std::memcpy(out, block, 8);
+    }
+
+    void decodeColor(const unsigned char* block, bool alwaysFourColors, unsigned char (*rgba)[4])
+    {
+        const uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+        const uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+        const bool fourColors = alwaysFourColors || color0 > color1;
+        int16_t palette[4][4];
+        colorPalette(color0, color1, fourColors, palette);
+        const uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            const int index = (bits >> (2 * i)) & 3;
+            for (int c = 0; c < 3; c++)
+                rgba[i][c] = static_cast<unsigned char>(palette[index][c]);
+            // the three-color palette's last entry is transparent black
+            rgba[i][3] = fourColors || index != 3 ? 255 : 0;
+        }
+    }
+
+    // --- BC3 alpha ---
+
+    void alphaPalette(int alpha0, int alpha1, int* palette)
+    {
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        if (alpha0 > alpha1)
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+        else
+        {
+            for (int i = 2; i < 6; i++)
+                palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // the eight-value palette between the block's extremes; one value repeated needs no indices
+    void encodeAlpha(const unsigned char (*rgba)[4], unsigned char* out)
+    {
+        int minimum = 255, maximum = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minimum = std::min(minimum, static_cast<int>(rgba[i][3]));
+            maximum = std::max(maximum, static_cast<int>(rgba[i][3]));
+        }
+        std::memset(out, 0, 8);
+        out[0] = static_cast<unsigned char>(maximum);
+        out[1] = static_cast<unsigned char>(minimum);
+        if (minimum == maximum)
+            return;
+        int palette[8];
+        alphaPalette(maximum, minimum, palette);
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = INT_MAX, index = 0;
+            for (int e = 0; e < 8; e++)
+            {
+                const int distance = std::abs(rgba[i][3] - palette[e]);
+                if (distance < best)
+                {
+                    best = distance;
+                    index = e;
+                }
+            }
+            bits |= static_cast<uint64_t>(index) << (3 * i);
+        }
+        for (int k = 0; k < 6; k++)
+            out[2 + k] = static_cast<unsigned char>(bits >> (8 * k));
+    }
+
+    void decodeAlpha(const unsigned char* block, unsigned char (*rgba)[4])
+    {
+        int palette[8];
+        alphaPalette(block[0], block[1], palette);
+        uint64_t bits = 0;
+        for (int k = 0; k < 6; k++)
+            bits |= static_cast<uint64_t>(block[2 + k]) << (8 * k);
+        for (int i = 0; i < 16; i++)
+            rgba[i][3] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+    }
+
+    // --- BC7 mode 6 ---
+
+    // 128 bits, least significant first
+    struct BitWriter
+    {
+        unsigned char* out;
+        int position;
+
+        void put(uint32_t value, int count)
+        {
+            for (int i = 0; i < count; i++, position++)
+                if ((value >> i) & 1)
+                    out[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+        }
+    };
+
+    struct BitReader
+    {
+        const unsigned char* in;
+        int position;
+
+        uint32_t get(int count)
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < count; i++, position++)
+                value |= static_cast<uint32_t>((in[position >> 3] >> (position & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    struct Bc7Endpoints
+    {
+        int quantized[2][4];    // 7 bits
+        int pbit[2];
+    };
+
+    int16_t bc7Endpoint(const Bc7Endpoints& endpoints, int which, int c)
+    {
+        return static_cast<int16_t>((endpoints.quantized[which][c] << 1) | endpoints.pbit[which]);
+    }
+
+    void bc7Palette(const Bc7Endpoints& endpoints, int16_t (*palette)[4])
+    {
+        for (int e = 0; e < 16; e++)
+            for (int c = 0; c < 4; c++)
+                palette[e][c] = static_cast<int16_t>(((64 - bc7Weights[e]) * bc7Endpoint(endpoints, 0, c) +
+                    bc7Weights[e] * bc7Endpoint(endpoints, 1, c) + 32) >> 6);
+    }
+
+    // the best of the four p-bit pairs for these endpoints
+    uint32_t bc7Quantize(const Texels& texels, const float* low, const float* high, SelectKernel select,
+        Bc7Endpoints& best, unsigned char* indices)
+    {
+        uint32_t bestError = UINT_MAX;
+        for (int pbits = 0; pbits < 4; pbits++)
+        {
+            Bc7Endpoints endpoints;
+            endpoints.pbit[0] = pbits & 1;
+            endpoints.pbit[1] = pbits >> 1;
+            for (int c = 0; c < 4; c++)
+            {
+                endpoints.quantized[0][c] = std::min(std::max(static_cast<int>((low[c] - endpoints.pbit[0]) / 2.0f + 0.5f), 0), 127);
+                endpoints.quantized[1][c] = std::min(std::max(static_cast<int>((high[c] - endpoints.pbit[1]) / 2.0f + 0.5f), 0), 127);
+            }
+            int16_t palette[16][4];
+            bc7Palette(endpoints, palette);
+            unsigned char candidate[16];
+            const uint32_t error = select(texels, palette, 16, candidate);
+            if (error < bestError)
+            {
+                bestError = error;
+                best = endpoints;
+                std::memcpy(indices, candidate, 16);
+            }
+        }
+        return bestError;
+    }
+
+    void encodeBc7(const unsigned char (*rgba)[4], SelectKernel select, unsigned char* out)
+    {
+        const Texels texels = texelsOf(rgba, true);
+        float low[4], high[4];
+        fitLine(rgba, 4, low, high);
+        Bc7Endpoints endpoints;
+        unsigned char indices[16];
+        const uint32_t error = bc7Quantize(texels, low, high, select, endpoints, indices);
+
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+            weights[i] = bc7Weights[indices[i]] / 64.0f;
+        if (error > 0 && leastSquares(rgba, 4, weights, low, high))
+        {
+            Bc7Endpoints refined;
+            unsigned char candidate[16];
+            if (bc7Quantize(texels, low, high, select, refined, candidate) < error)
+            {
+                endpoints = refined;
+                std::memcpy(indices, candidate, 16);
+            }
+        }
+
+        // texel 0's index loses its top bit, swapping the endpoints mirrors all indices
+        if (indices[0] >= 8)
+        {
+            std::swap(endpoints.quantized[0], endpoints.quantized[1]);
+            std::swap(endpoints.pbit[0], endpoints.pbit[1]);
+            for (int i = 0; i < 16; i++)
+                indices[i] = static_cast<unsigned char>(15 - indices[i]);
+        }
+        std::memset(out, 0, 16);
+        BitWriter writer = { out, 0 };
+        writer.put(1 << 6, 7);
+        for (int c = 0; c < 4; c++)
+        {
+            writer.put(endpoints.quantized[0][c], 7);
+            writer.put(endpoints.quantized[1][c], 7);
+        }
+        writer.put(endpoints.pbit[0], 1);
+        writer.put(endpoints.pbit[1], 1);
+        for (int i = 0; i < 16; i++)
+            writer.put(indices[i], i == 0 ? 3 : 4);
+    }
+
+    bool decodeBc7(const unsigned char* block, unsigned char (*rgba)[4])
+    {
+        if ((block[0] & 0x7f) != 0x40)
+            return false;
+        BitReader reader = { block, 7 };
+        Bc7Endpoints endpoints;
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints.quantized[0][c] = static_cast<int>(reader.get(7));
+            endpoints.quantized[1][c] = static_cast<int>(reader.get(7));
+        }
+        endpoints.pbit[0] = static_cast<int>(reader.get(1));
+        endpoints.pbit[1] = static_cast<int>(reader.get(1));
+        int16_t palette[16][4];
+        bc7Palette(endpoints, palette);
+        for (int i = 0; i < 16; i++)
+        {
+            const uint32_t index = reader.get(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; c++)
+                rgba[i][c] = static_cast<unsigned char>(palette[index][c]);
+        }
+        return true;
+    }
+
+    bool decodeBlock(BlockFormat format, const unsigned char* block, unsigned char (*rgba)[4])
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            decodeColor(block, false, rgba);
+            return true;
+        case BlockFormat::BC3:
+            decodeColor(block + 8, true, rgba);
+            decodeAlpha(block, rgba);
+            return true;
+        default:
+            return decodeBc7(block, rgba);
+        }
+    }
+
+    std::vector<CompressedTexture::Level> levelsFor(BlockFormat format, int width, int height, int count)
+    {
+        std::vector<CompressedTexture::Level> levels;
+        size_t offset = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const size_t bytes = CompressedTexture::levelBytes(format, width, height);
+            levels.push_back({ width, height, offset, bytes, 0 });
+            offset += bytes;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return levels;
+    }
+
+    int fullChainLevels(int width, int height)
+    {
+        int count = 1;
+        while (width > 1 || height > 1)
+        {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            count++;
+        }
+        return count;
+    }
+
+    // --- containers ---
+
+    const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const char* orientationKey = "KTXorientation";
+
+    // VkFormat values
+    uint32_t vkFormatOf(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return srgb ? 132 : 131;     // VK_FORMAT_BC1_RGB_*_BLOCK
+        case BlockFormat::BC3: return srgb ? 138 : 137;     // VK_FORMAT_BC3_*_BLOCK
+        default: return srgb ? 146 : 145;                   // VK_FORMAT_BC7_*_BLOCK
+        }
+    }
+
+    bool formatOfVk(uint32_t vkFormat, BlockFormat& format, bool& srgb)
+    {
+        switch (vkFormat)
+        {
+        case 131: case 132: case 133: case 134: format = BlockFormat::BC1; srgb = vkFormat % 2 == 0; return true;
+        case 137: case 138: format = BlockFormat::BC3; srgb = vkFormat == 138; return true;
+        case 145: case 146: format = BlockFormat::BC7; srgb = vkFormat == 146; return true;
+        default: return false;
+        }
+    }
+
+    // DXGI_FORMAT values, for the DX10 header
+    uint32_t dxgiFormatOf(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return srgb ? 72 : 71;
+        case BlockFormat::BC3: return srgb ? 78 : 77;
+        default: return srgb ? 99 : 98;
+        }
+    }
+
+    bool formatOfDxgi(uint32_t dxgiFormat, BlockFormat& format, bool& srgb)
+    {
+        switch (dxgiFormat)
+        {
+        case 71: case 72: format = BlockFormat::BC1; srgb = dxgiFormat == 72; return true;
+        case 77: case 78: format = BlockFormat::BC3; srgb = dxgiFormat == 78; return true;
+        case 98: case 99: format = BlockFormat::BC7; srgb = dxgiFormat == 99; return true;
+        default: return false;
+        }
+    }
+
+    uint32_t fourCC(const char* code)
+    {
+        return static_cast<uint32_t>(code[0]) | (code[1] << 8) | (code[2] << 16) | (static_cast<uint32_t>(code[3]) << 24);
+    }
+
+    void put32(std::vector<unsigned char>& out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+
+    uint32_t get32(const unsigned char* in)
+    {
+        return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+
+    uint64_t get64(const unsigned char* in)
+    {
+        return get32(in) | (static_cast<uint64_t>(get32(in + 4)) << 32);
+    }
+
+    void set64(std::vector<unsigned char>& out, size_t at, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+            out[at + i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    // the Khronos basic data format descriptor of a BC format, one sample per 64-bit half
+    void putDataFormatDescriptor(std::vector<unsigned char>& out, BlockFormat format, bool srgb)
+    {
+        const uint32_t colorModel = format == BlockFormat::BC1 ? 128 : format == BlockFormat::BC3 ? 130 : 134;
+        const int samples = format == BlockFormat::BC3 ? 2 : 1;
+        const uint32_t blockSize = 24 + 16 * samples;
+        put32(out, 4 + blockSize);
+        put32(out, 0);                                  // vendor Khronos, basic descriptor
+        put32(out, 2 | (blockSize << 16));              // version 2
+        put32(out, colorModel | (1 << 8) | ((srgb ? 2u : 1u) << 16));   // BT.709 primaries, straight alpha
+        put32(out, 3 | (3 << 8));                       // 4x4 texel blocks
+        put32(out, static_cast<uint32_t>(CompressedTexture::blockBytes(format)));
+        put32(out, 0);
+        for (int s = 0; s < samples; s++)
+        {
+            // BC3's first half is its alpha (channel 15), every other half is color (channel 0)
+            const uint32_t channel = format == BlockFormat::BC3 && s == 0 ? 15 : 0;
+            const uint32_t bits = format == BlockFormat::BC7 ? 128 : 64;
+            put32(out, (s * 64) | ((bits - 1) << 16) | (channel << 24));
+            put32(out, 0);
+            put32(out, 0);
+            put32(out, 0xffffffffu);
+        }
+    }
+
+    bool writeFile(const std::string& path, const std::vector<unsigned char>& header, const CompressedTexture& texture,
+        const std::vector<size_t>& order, const std::vector<size_t>& positions)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = fwrite(header.data(), 1, header.size(), file) == header.size();
+        size_t position = header.size();
+        static const unsigned char zeros[16] = {};
+        for (size_t i = 0; i < order.size() && written; i++)
+        {
+            const CompressedTexture::Level& level = texture.levels[order[i]];
+            written = fwrite(zeros, 1, positions[i] - position, file) == positions[i] - position &&
+                fwrite(texture.level(order[i]), 1, level.bytes, file) == level.bytes;
+            position = positions[i] + level.bytes;
+        }
+        written = fclose(file) == 0 && written;
+        if (!written)
+            remove(path.c_str());
+        return written;
+    }
+
+    bool saveKtx2(const std::string& path, const CompressedTexture& texture)
+    {
+        const uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+        std::vector<unsigned char> header(ktx2Identifier, ktx2Identifier + 12);
+        put32(header, vkFormatOf(texture.format, texture.srgb));
+        put32(header, 1);                               // typeSize of block formats
+        put32(header, texture.levels[0].width);
+        put32(header, texture.levels[0].height);
+        put32(header, 0);                               // depth, layers: a plain 2D texture
+        put32(header, 0);
+        put32(header, 1);                               // faces
+        put32(header, levelCount);
+        put32(header, 0);                               // no supercompression
+        const size_t indexAt = header.size();
+        header.resize(header.size() + 4 * 4 + 8 * 2 + 24 * levelCount, 0);
+
+        const uint32_t dfdOffset = static_cast<uint32_t>(header.size());
+        putDataFormatDescriptor(header, texture.format, texture.srgb);
+        const uint32_t kvdOffset = static_cast<uint32_t>(header.size());
+        const std::string value = texture.bottomUp ? "ru" : "rd";
+        put32(header, static_cast<uint32_t>(std::strlen(orientationKey) + 1 + value.size() + 1));
+        header.insert(header.end(), orientationKey, orientationKey + std::strlen(orientationKey) + 1);
+        header.insert(header.end(), value.c_str(), value.c_str() + value.size() + 1);
+        while (header.size() % 4)
+            header.push_back(0);
+        const uint32_t kvdLength = static_cast<uint32_t>(header.size()) - kvdOffset;
+
+        for (int i = 0; i < 4; i++)
+        {
+            const uint32_t field = i == 0 ? dfdOffset : i == 1 ? kvdOffset - dfdOffset : i == 2 ? kvdOffset : kvdLength;
+            for (int k = 0; k < 4; k++)
+                header[indexAt + 4 * i + k] = static_cast<unsigned char>(field >> (8 * k));
+        }
+        // the levels go smallest first, each on a block boundary
+        const size_t alignment = CompressedTexture::blockBytes(texture.format);
+        std::vector<size_t> order, positions;
+        size_t position = header.size();
+        for (size_t i = levelCount; i-- > 0;)
+        {
+            position = (position + alignment - 1) / alignment * alignment;
+            order.push_back(i);
+            positions.push_back(position);
+            const size_t entry = indexAt + 32 + 24 * i;
+            set64(header, entry, position);
+            set64(header, entry + 8, texture.levels[i].bytes);
+            set64(header, entry + 16, texture.levels[i].bytes);
+            position += texture.levels[i].bytes;
+        }
+        return writeFile(path, header, texture, order, positions);
+    }
+
+    bool saveDds(const std::string& path, const CompressedTexture& texture)
+    {
+        const bool dx10 = texture.format == BlockFormat::BC7 || texture.srgb;
+        std::vector<unsigned char> header;
+        put32(header, fourCC("DDS "));
+        put32(header, 124);
+        put32(header, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000);   // caps, size, pixel format, mip count, linear size
+        put32(header, texture.levels[0].height);
+        put32(header, texture.levels[0].width);
+        put32(header, static_cast<uint32_t>(texture.levels[0].bytes));
+        put32(header, 0);
+        put32(header, static_cast<uint32_t>(texture.levels.size()));
+        header.resize(header.size() + 11 * 4, 0);
+        put32(header, 32);                              // pixel format: a four-character code
+        put32(header, 0x4);
+        put32(header, fourCC(dx10 ? "DX10" : texture.format == BlockFormat::BC1 ? "DXT1" : "DXT5"));
+        header.resize(header.size() + 5 * 4, 0);
+        put32(header, 0x1000 | 0x400000 | 0x8);         // texture, mipmap, complex
+        header.resize(header.size() + 4 * 4, 0);
+        if (dx10)
+        {
+            put32(header, dxgiFormatOf(texture.format, texture.srgb));
+            put32(header, 3);                           // 2D
+            put32(header, 0);
+            put32(header, 1);                           // array size
+            put32(header, 0);
+        }
+        std::vector<size_t> order, positions;
+        size_t position = header.size();
+        for (size_t i = 0; i < texture.levels.size(); i++)
+        {
+            order.push_back(i);
+            positions.push_back(position);
+            position += texture.levels[i].bytes;
+        }
+        return writeFile(path, header, texture, order, positions);
+    }
+
+    bool parseKtx2(const unsigned char* file, size_t size, CompressedTexture& texture, std::string& error)
+    {
+        if (size < 80)
+        {
+            error = "KTX2 header cut short";
+            return false;
+        }
+        if (!formatOfVk(get32(file + 12), texture.format, texture.srgb))
+        {
+            error = "KTX2 format is not BC1, BC3 or BC7";
+            return false;
+        }
+        const uint32_t width = get32(file + 20), height = get32(file + 24), depth = get32(file + 28);
+        const uint32_t layers = get32(file + 32), faces = get32(file + 36), supercompression = get32(file + 44);
+        const uint32_t levelCount = std::max(get32(file + 40), 1u);
+        if (width == 0 || height == 0 || width > (1u << 16) || height > (1u << 16) || depth != 0 || layers > 1 || faces != 1)
+        {
+            error = "KTX2 file is not a single 2D texture";
+            return false;
+        }
+        if (supercompression != 0)
+        {
+            error = "KTX2 supercompression is not supported";
+            return false;
+        }
+        // unsigned, so a count above INT_MAX cannot pass as negative
+        if (levelCount > static_cast<uint32_t>(fullChainLevels(width, height)) || size < 80 + 24 * static_cast<size_t>(levelCount))
+        {
+            error = "KTX2 level index is invalid";
+            return false;
+        }
+        texture.levels = levelsFor(texture.format, width, height, static_cast<int>(levelCount));
+        if (texture.levels.empty())
+        {
+            error = "KTX2 file has no levels";
+            return false;
+        }
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            const unsigned char* entry = file + 80 + 24 * i;
+            const uint64_t offset = get64(entry), length = get64(entry + 8);
+            if (length != texture.levels[i].bytes || offset > size || length > size - offset)
+            {
+                error = "KTX2 level " + std::to_string(i) + " is cut short or has the wrong size";
+                return false;
+            }
+            texture.levels[i].source = static_cast<size_t>(offset);
+        }
+
+        // top-down unless KTXorientation says the rows go up
+        texture.bottomUp = false;
+        const uint32_t kvdOffset = get32(file + 56), kvdLength = get32(file + 60);
+        if (kvdOffset <= size && kvdLength <= size - kvdOffset)
+        {
+            const unsigned char* entry = file + kvdOffset;
+            const unsigned char* end = entry + kvdLength;
+            while (end - entry >= 4)
+            {
+                const uint32_t length = get32(entry);
+                if (length > static_cast<size_t>(end - entry - 4))
+                    break;
+                const char* key = reinterpret_cast<const char*>(entry + 4);
+                const size_t keyLength = strnlen(key, length);
+                if (keyLength == std::strlen(orientationKey) && std::memcmp(key, orientationKey, keyLength) == 0 && length >= keyLength + 3)
+                    texture.bottomUp = key[keyLength + 2] == 'u';
+                entry += 4 + (length + 3) / 4 * 4;
+            }
+        }
+        return true;
+    }
+
+    bool parseDds(const unsigned char* file, size_t size, CompressedTexture& texture, std::string& error)
+    {
+        if (size < 128 || get32(file + 4) != 124)
+        {
+            error = "DDS header cut short";
+            return false;
+        }
+        const uint32_t flags = get32(file + 8), height = get32(file + 12), width = get32(file + 16);
+        const uint32_t mipCount = flags & 0x20000 ? std::max(get32(file + 28), 1u) : 1;
+        const uint32_t pixelFlags = get32(file + 80), code = get32(file + 84), caps2 = get32(file + 112);
+        size_t position = 128;
+        texture.srgb = false;
+        if (!(pixelFlags & 0x4))
+        {
+            error = "DDS file is not block compressed";
+            return false;
+        }
+        if (code == fourCC("DXT1"))
+            texture.format = BlockFormat::BC1;
+        else if (code == fourCC("DXT5"))
+            texture.format = BlockFormat::BC3;
+        else if (code == fourCC("DX10"))
+        {
+            if (size < 148 || !formatOfDxgi(get32(file + 128), texture.format, texture.srgb))
+            {
+                error = "DDS format is not BC1, BC3 or BC7";
+                return false;
+            }
+            if (get32(file + 132) != 3 || get32(file + 140) != 1)
+            {
+                error = "DDS file is not a single 2D texture";
+                return false;
+            }
+            position = 148;
+        }
+        else
+        {
+            error = "DDS format is not BC1, BC3 or BC7";
+            return false;
+        }
+        if (width == 0 || height == 0 || width > (1u << 16) || height > (1u << 16) || (caps2 & 0x200) ||
+            mipCount > static_cast<uint32_t>(fullChainLevels(width, height)))
+        {
+            error = "DDS file is not a single 2D texture";
+            return false;
+        }
+        texture.levels = levelsFor(texture.format, width, height, static_cast<int>(mipCount));
+        if (texture.levels.empty())
+        {
+            error = "DDS file has no levels";
+            return false;
+        }
+        for (CompressedTexture::Level& level : texture.levels)
+        {
+            if (level.bytes > size - position)
+            {
+                error = "DDS file cut short";
+                return false;
+            }
+            level.source = position;
+            position += level.bytes;
+        }
+        texture.bottomUp = false;
+        return true;
+    }
+}
+
+BlockCompressor::BlockCompressor(ThreadPool* pool)
+    : selected(Kernel::Scalar), pool(pool)
+{
+    setKernel(Kernel::AVX2);
+}
+
+bool BlockCompressor::kernelSupported(Kernel candidate)
+{
+    switch (candidate)
+    {
+#ifdef CT_X86
+    case Kernel::SSE2:
+        return true;
+    case Kernel::AVX2:
+        return cpuHasAvx2();
+#endif
+    case Kernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* BlockCompressor::kernelName(Kernel candidate)
+{
+    switch (candidate)
+    {
+    case Kernel::SSE2: return "SSE2";
+    case Kernel::AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+void BlockCompressor::setKernel(Kernel wanted)
+{
+    if (!kernelSupported(wanted))
+        wanted = kernelSupported(Kernel::AVX2) ? Kernel::AVX2 :
+            kernelSupported(Kernel::SSE2) ? Kernel::SSE2 : Kernel::Scalar;
+    selected = wanted;
+}
+
+void BlockCompressor::compress(const MipChain& chain, BlockFormat format, CompressedTexture& texture) const
+{
+    texture.format = format;
+    texture.levels = levelsFor(format, chain.levels[0].width, chain.levels[0].height, static_cast<int>(chain.levels.size()));
+    texture.blocks.resize(texture.bytes());
+
+    SelectKernel select = selectScalar;
+#ifdef CT_X86
+    if (selected == Kernel::SSE2)
+        select = selectSse2;
+    else if (selected == Kernel::AVX2)
+        select = selectAvx2;
+#endif
+
+    // runs of whole block rows, never across levels
+    struct Job
+    {
+        size_t level;
+        int firstRow, rows;
+    };
+    std::vector<Job> jobs;
+    for (size_t level = 0; level < texture.levels.size(); level++)
+    {
+        const int blocksWide = (texture.levels[level].width + 3) / 4, blocksHigh = (texture.levels[level].height + 3) / 4;
+        const int rowsPerJob = std::max(1, blocksPerJob / blocksWide);
+        for (int row = 0; row < blocksHigh; row += rowsPerJob)
+            jobs.push_back({ level, row, std::min(rowsPerJob, blocksHigh - row) });
+    }
+
+    const int channels = chain.channels;
+    const size_t blockSize = CompressedTexture::blockBytes(format);
+    auto job = [&](int index, unsigned)
+    {
+        const Job& run = jobs[index];
+        const MipChain::Level& source = chain.levels[run.level];
+        const int blocksWide = (source.width + 3) / 4;
+        unsigned char* out = texture.blocks.data() + texture.levels[run.level].offset + static_cast<size_t>(run.firstRow) * blocksWide * blockSize;
+        for (int by = run.firstRow; by < run.firstRow + run.rows; by++)
+            for (int bx = 0; bx < blocksWide; bx++, out += blockSize)
+            {
+                // texels past the level's edge repeat the last row or column
+                unsigned char rgba[16][4];
+                for (int i = 0; i < 16; i++)
+                {
+                    const int x = std::min(bx * 4 + (i & 3), source.width - 1), y = std::min(by * 4 + (i >> 2), source.height - 1);
+                    const unsigned char* texel = chain.level(run.level) + (static_cast<size_t>(y) * source.width + x) * channels;
+                    rgba[i][0] = texel[0];
+                    rgba[i][1] = texel[channels >= 3 ? 1 : 0];
+                    rgba[i][2] = texel[channels >= 3 ? 2 : 0];
+                    rgba[i][3] = channels == 2 || channels == 4 ? texel[channels - 1] : 255;
+                }
+                if (format == BlockFormat::BC1)
+                    encodeColor(rgba, select, out);
+                else if (format == BlockFormat::BC3)
+                {
+                    encodeAlpha(rgba, out);
+                    encodeColor(rgba, select, out + 8);
+                }
+                else
+                    encodeBc7(rgba, select, out);
+            }
+    };
+    const int count = static_cast<int>(jobs.size());
+    if (pool && pool->size() > 1 && count > 1)
+        pool->parallelFor(count, job);
+    else
+        for (int i = 0; i < count; i++)
+            job(i, 0);
+}
+
+bool decompressTexture(const CompressedTexture& texture, MipChain& rgba)
+{
+    rgba.channels = 4;
+    rgba.levels.clear();
+    size_t bytes = 0;
+    for (const CompressedTexture::Level& level : texture.levels)
+    {
+        rgba.levels.push_back({ level.width, level.height, bytes });
+        bytes += static_cast<size_t>(level.width) * level.height * 4;
+    }
+    rgba.pixels.resize(bytes);
+
+    const size_t blockSize = CompressedTexture::blockBytes(texture.format);
+    for (size_t index = 0; index < texture.levels.size(); index++)
+    {
+        const CompressedTexture::Level& level = texture.levels[index];
+        const unsigned char* block = texture.level(index);
+        unsigned char* out = rgba.pixels.data() + rgba.levels[index].offset;
+        for (int by = 0; by < (level.height + 3) / 4; by++)
+            for (int bx = 0; bx < (level.width + 3) / 4; bx++, block += blockSize)
+            {
+                unsigned char texels[16][4];
+                if (!decodeBlock(texture.format, block, texels))
+                    return false;
+                for (int i = 0; i < 16; i++)
+                {
+                    const int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                    if (x < level.width && y < level.height)
+                        std::memcpy(out + (static_cast<size_t>(y) * level.width + x) * 4, texels[i], 4);
+                }
+            }
+    }
+    return true;
+}
+
+bool saveCompressedTexture(const std::string& path, const CompressedTexture& texture)
+{
+    if (texture.levels.empty() || texture.blocks.size() < texture.bytes())
+        return false;
+    const bool dds = path.size() >= 4 && path.compare(path.size() - 4, 4, ".dds") == 0;
+    return dds ? saveDds(path, texture) : saveKtx2(path, texture);
+}
+
+bool parseCompressedTexture(const unsigned char* file, size_t size, CompressedTexture& texture, std::string& error)
+{
+    texture.blocks.clear();
+    if (size >= 12 && std::memcmp(file, ktx2Identifier, 12) == 0)
+        return parseKtx2(file, size, texture, error);
+    if (size >= 4 && get32(file) == fourCC("DDS "))
+        return parseDds(file, size, texture, error);
+    error = "not a KTX2 or DDS file";
+    return false;
+}
+
+void copyCompressedLevels(const unsigned char* file, const CompressedTexture& texture, unsigned char* blocks)
+{
+    for (const CompressedTexture::Level& level : texture.levels)
+        std::memcpy(blocks + level.offset, file + level.source, level.bytes);
+}
+
+bool loadCompressedTexture(const std::string& path, CompressedTexture& texture, std::string& error)
+{
+    const MappedFile file(path);
+    if (!file.valid())
+    {
+        error = "cannot open file";
+        return false;
+    }
+    if (!parseCompressedTexture(file.data(), file.size(), texture, error))
+        return false;
+    texture.blocks.resize(texture.bytes());
+    copyCompressedLevels(file.data(), texture, texture.blocks.data());
+    return true;
+}
+
+std::string compressedTexturePath(const std::string& imagePath, const char* extension)
+{
+    const size_t slash = imagePath.find_last_of("/\\");
+    const size_t dot = imagePath.find_last_of('.');
+    const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    return (hasExtension ? imagePath.substr(0, dot) : imagePath) + extension;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MipChain.h"
+
+class ThreadPool;
+
+// Block-compressed texture formats; every block holds 4x4 texels, levels smaller than a block
+// still take a whole one.
+//   BC1  8 bytes, RGB: two 565 endpoints, 2-bit indices (DXT1)
+//   BC3  16 bytes, RGBA: BC1 color plus 8-bit alpha endpoints, 3-bit indices (DXT5)
+//   BC7  16 bytes, RGBA: eight modes; BlockCompressor writes mode 6 (one 7777 endpoint pair with
+//        p-bits, 4-bit indices) and only mode 6 blocks decode on the CPU
+enum class BlockFormat
+{
+    BC1,
+    BC3,
+    BC7
+};
+
+// All levels of a block-compressed texture, level 0 first, packed one after another in blocks.
+// bottomUp: the first block row holds the bottom texel rows, GL's order, as written from pixels
+// loaded with flip; files straight from most tools are top-down.
+struct CompressedTexture
+{
+    struct Level
+    {
+        int width, height;
+        size_t offset;          // into blocks
+        size_t bytes;
+        size_t source;          // where parseCompressedTexture found the level in the file
+    };
+
+    BlockFormat format = BlockFormat::BC1;
+    bool srgb = false;
+    bool bottomUp = false;
+    std::vector<Level> levels;
+    std::vector<unsigned char> blocks;
+
+    size_t bytes() const { return levels.empty() ? 0 : levels.back().offset + levels.back().bytes; }
+    const unsigned char* level(size_t index) const { return blocks.data() + levels[index].offset; }
+
+    static size_t blockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+    static size_t levelBytes(BlockFormat format, int width, int height)
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+};
+
+// Encodes mip chains into block-compressed textures on the CPU, offline or on a loader thread.
+// Endpoints come from the principal axis of each block's texels (refined once by least squares);
+// the index search, texel against every palette entry, is what the SIMD kernels run, on 16-bit
+// integers, so every kernel writes the same blocks. The error is measured on the stored bytes,
+// the way the shader sees them. Blocks are split across a ThreadPool.
+class BlockCompressor
+{
+public:
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // pool == NULL encodes on the calling thread; the pool must outlive the compressor
+    explicit BlockCompressor(ThreadPool* pool = NULL);
+
+    // the best kernel supported by the CPU is picked in the constructor;
+    // asking for an unsupported one falls back to the best supported
+    void setKernel(Kernel kernel);
+    Kernel kernel() const { return selected; }
+    static bool kernelSupported(Kernel candidate);
+    static const char* kernelName(Kernel candidate);
+
+    // every level of chain (1 to 4 channels: gray is replicated, a missing alpha is opaque);
+    // the texture keeps the chain's row order, bottomUp is left for the caller to set.
+    // May be called from several threads at once.
+    void compress(const MipChain& chain, BlockFormat format, CompressedTexture& texture) const;
+
+private:
+    Kernel selected;
+    ThreadPool* pool;
+};
+
+// Every level back to RGBA texels, for formats or files the GL cannot take; false when a block
+// is not BC1, BC3 or BC7 mode 6.
+bool decompressTexture(const CompressedTexture& texture, MipChain& rgba);
+
+// Files: KTX2 (the orientation goes into KTXorientation, "rd" or "ru") or, for a path ending in
+// .dds, DDS with a DX10 header for BC7 (always read as top-down, DDS has no way to say otherwise).
+bool saveCompressedTexture(const std::string& path, const CompressedTexture& texture);
+// the header and level table of a KTX2 or DDS file in memory, blocks left empty; error says why not
+bool parseCompressedTexture(const unsigned char* file, size_t size, CompressedTexture& texture, std::string& error);
+// copies the levels of a parsed file to blocks, texture.bytes() of them, in texture's packing
+void copyCompressedLevels(const unsigned char* file, const CompressedTexture& texture, unsigned char* blocks);
+bool loadCompressedTexture(const std::string& path, CompressedTexture& texture, std::string& error);
+
+// what the loaders look for next to an image file: texture1.jpg -> texture1.ktx2
+std::string compressedTexturePath(const std::string& imagePath, const char* extension = ".ktx2");
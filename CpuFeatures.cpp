@@ -0,0 +1,62 @@
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CF_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace
+{
+#ifdef CF_X86
+    bool probeAvx()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") != 0;
+#endif
+    }
+
+    bool probeAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7 || !probeAvx())
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+}
+
+bool cpuHasAvx()
+{
+#ifdef CF_X86
+    static const bool avx = probeAvx();
+    return avx;
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAvx2()
+{
+#ifdef CF_X86
+    static const bool avx2 = probeAvx2();
+    return avx2;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Instruction sets both the CPU and the operating system support (AVX needs the OS to save
+// the YMM registers), probed on the first call and cached. Always false off x86.
+bool cpuHasAvx();
+bool cpuHasAvx2();
@@ -0,0 +1,349 @@
+#include "DecodeCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+namespace
+{
+    const uint32_t fileMagic = 0x43444B47;      // "GKDC"
+    const uint32_t fileVersion = 1;
+    // the pixels start on a cache line of their own
+    const size_t dataOffset = 64;
+    const char* entrySuffix = ".dec";
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        int32_t width, height, channels, levels;
+        uint64_t bytes;
+    };
+
+    // xxHash64: hashing the encoded file is all a hit costs besides opening the entry, so it has to
+    // keep up with reading it (several GB/s, where FNV-1a manages about one)
+    const uint64_t prime1 = 0x9E3779B185EBCA87ull, prime2 = 0xC2B2AE3D27D4EB4Full, prime3 = 0x165667B19E3779F9ull,
+        prime4 = 0x85EBCA77C2B2AE63ull, prime5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t rotate(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t read64(const unsigned char* bytes)
+    {
+        uint64_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    uint64_t round64(uint64_t accumulator, uint64_t input)
+    {
+        return rotate(accumulator + input * prime2, 31) * prime1;
+    }
+
+    uint64_t merge64(uint64_t hash, uint64_t accumulator)
+    {
+        return (hash ^ round64(0, accumulator)) * prime1 + prime4;
+    }
+
+    uint64_t xxHash64(const unsigned char* data, size_t size, uint64_t seed)
+    {
+        const unsigned char* end = data + size;
+        uint64_t hash;
+        if (size >= 32)
+        {
+            uint64_t lanes[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+            for (; data + 32 <= end; data += 32)
+                for (int i = 0; i < 4; i++)
+                    lanes[i] = round64(lanes[i], read64(data + i * 8));
+            hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) + rotate(lanes[2], 12) + rotate(lanes[3], 18);
+            for (int i = 0; i < 4; i++)
+                hash = merge64(hash, lanes[i]);
+        }
+        else
+            hash = seed + prime5;
+        hash += size;
+        for (; data + 8 <= end; data += 8)
+            hash = rotate(hash ^ round64(0, read64(data)), 27) * prime1 + prime4;
+        if (data + 4 <= end)
+        {
+            uint32_t word;
+            memcpy(&word, data, sizeof(word));
+            hash = rotate(hash ^ (word * prime1), 23) * prime2 + prime3;
+            data += 4;
+        }
+        for (; data < end; data++)
+            hash = rotate(hash ^ (*data * prime5), 11) * prime1;
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        return hash ^ (hash >> 32);
+    }
+
+    // level table of an entry: level 0 alone, or the whole chain down to 1x1; returns the bytes
+    size_t levelTable(int width, int height, int channels, int levels, std::vector<MipChain::Level>& table)
+    {
+        size_t bytes = 0;
+        for (int level = 0; level < levels; level++)
+        {
+            table.push_back({ width, height, bytes });
+            bytes += static_cast<size_t>(width) * height * channels;
+            if (width == 1 && height == 1)
+                return level + 1 == levels ? bytes : 0;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+        return levels == 1 ? bytes : 0;
+    }
+
+    struct Listed
+    {
+        uint64_t key;
+        unsigned long long bytes;
+        long long modified;
+    };
+
+    bool parseName(const char* name, uint64_t& key)
+    {
+        unsigned long long value;
+        char suffix[8];
+        if (strlen(name) != 16 + strlen(entrySuffix) || sscanf(name, "%16llx%7s", &value, suffix) != 2 || strcmp(suffix, entrySuffix) != 0)
+            return false;
+        key = value;
+        return true;
+    }
+
+    std::vector<Listed> listEntries(const std::string& directory)
+    {
+        std::vector<Listed> entries;
+        uint64_t key;
+#ifdef _WIN32
+        WIN32_FIND_DATAA found;
+        HANDLE search = FindFirstFileA((directory + "/*" + entrySuffix).c_str(), &found);
+        if (search == INVALID_HANDLE_VALUE)
+            return entries;
+        do
+        {
+            if (parseName(found.cFileName, key))
+                entries.push_back({ key, (static_cast<unsigned long long>(found.nFileSizeHigh) << 32) | found.nFileSizeLow,
+                    static_cast<long long>((static_cast<unsigned long long>(found.ftLastWriteTime.dwHighDateTime) << 32) |
+                        found.ftLastWriteTime.dwLowDateTime) });
+        } while (FindNextFileA(search, &found));
+        FindClose(search);
+#else
+        DIR* listing = opendir(directory.c_str());
+        if (!listing)
+            return entries;
+        while (const dirent* found = readdir(listing))
+        {
+            struct stat status;
+            if (parseName(found->d_name, key) && stat((directory + "/" + found->d_name).c_str(), &status) == 0)
+                entries.push_back({ key, static_cast<unsigned long long>(status.st_size), static_cast<long long>(status.st_mtime) });
+        }
+        closedir(listing);
+#endif
+        return entries;
+    }
+}
+
+DecodeCache::DecodeCache(const std::string& directory, unsigned long long maxBytes)
+    : directory(directory), maxBytes(maxBytes), total(0), clock(0), hits(0), misses(0), stores(0), evictions(0), hitBytes(0)
+{
+    // the order of last use, from the files' modification times
+    std::vector<Listed> entries = listEntries(directory);
+    std::sort(entries.begin(), entries.end(), [](const Listed& a, const Listed& b) { return a.modified < b.modified; });
+    for (const Listed& entry : entries)
+    {
+        records[entry.key] = { entry.bytes, ++clock };
+        total += entry.bytes;
+    }
+}
+
+uint64_t DecodeCache::key(const unsigned char* file, size_t size, const Options& options)
+{
+    const unsigned char shape[8] = { static_cast<unsigned char>(fileVersion), options.flip, static_cast<unsigned char>(options.channels),
+        options.mipmaps, static_cast<unsigned char>(options.mipmaps ? static_cast<int>(options.filter) : 0),
+        static_cast<unsigned char>(options.mipmaps && options.srgb), 0, 0 };
+    return xxHash64(shape, sizeof(shape), xxHash64(file, size, 0));
+}
+
+std::unique_ptr<DecodeCache::Entry> DecodeCache::find(uint64_t key)
+{
+    const std::string name = path(key);
+    std::unique_ptr<Entry> entry(new Entry(name));
+    if (!entry->file.valid())
+    {
+        misses++;
+        return NULL;
+    }
+
+    FileHeader header;
+    bool valid = entry->file.size() >= dataOffset;
+    if (valid)
+    {
+        memcpy(&header, entry->file.data(), sizeof(header));
+        valid = header.magic == fileMagic && header.version == fileVersion && header.key == key && header.width > 0 &&
+            header.height > 0 && header.channels >= 1 && header.channels <= 4 && header.levels >= 1 &&
+            levelTable(header.width, header.height, header.channels, header.levels, entry->table) == header.bytes &&
+            entry->file.size() == dataOffset + header.bytes;
+    }
+    if (!valid)
+    {
+        entry.reset();
+        remove(name.c_str());
+        std::lock_guard<std::mutex> lock(mutex);
+        forget(key);
+        misses++;
+        return NULL;
+    }
+    entry->channelCount = header.channels;
+    entry->data = entry->file.data() + dataOffset;
+    entry->size = static_cast<size_t>(header.bytes);
+
+    // a fresh modification time keeps the order of use for the next launch
+#ifdef _WIN32
+    _utime(name.c_str(), NULL);
+#else
+    utime(name.c_str(), NULL);
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto record = records.find(key);
+        if (record == records.end())
+        {
+            // stored by another process
+            records[key] = { entry->file.size(), ++clock };
+            total += entry->file.size();
+        }
+        else
+            record->second.lastUsed = ++clock;
+    }
+    hits++;
+    hitBytes += entry->size;
+    return entry;
+}
+
+bool DecodeCache::store(uint64_t key, const unsigned char* pixels, int width, int height, int channels)
+{
+    return write(key, width, height, channels, 1, pixels, static_cast<size_t>(width) * height * channels);
+}
+
+bool DecodeCache::store(uint64_t key, const MipChain& chain)
+{
+    if (chain.levels.empty())
+        return false;
+    return write(key, chain.levels[0].width, chain.levels[0].height, chain.channels, static_cast<int>(chain.levels.size()),
+        chain.pixels.data(), chain.pixels.size());
+}
+
+bool DecodeCache::write(uint64_t key, int width, int height, int channels, int levels, const unsigned char* pixels, size_t bytes)
+{
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    const std::string name = path(key);
+    const std::string temporary = temporaryPath(name);
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    const FileHeader header = { fileMagic, fileVersion, key, width, height, channels, levels, bytes };
+    unsigned char head[dataOffset] = {};
+    memcpy(head, &header, sizeof(header));
+    bool written = fwrite(head, 1, sizeof(head), file) == sizeof(head) && fwrite(pixels, 1, bytes, file) == bytes;
+    written = fclose(file) == 0 && written;
+    // replacing fails on Windows while a reader has the entry mapped; that one holds the same pixels
+    if (!written || !replaceFile(temporary, name))
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    forget(key);
+    records[key] = { dataOffset + bytes, ++clock };
+    total += dataOffset + bytes;
+    stores++;
+    trim(key);
+    return true;
+}
+
+void DecodeCache::trim(uint64_t keep)
+{
+    // an entry that cannot be removed (mapped, on Windows) is passed over this time
+    std::vector<uint64_t> skipped;
+    while (maxBytes > 0 && total > maxBytes)
+    {
+        auto oldest = records.end();
+        for (auto record = records.begin(); record != records.end(); ++record)
+            if (record->first != keep && std::find(skipped.begin(), skipped.end(), record->first) == skipped.end() &&
+                (oldest == records.end() || record->second.lastUsed < oldest->second.lastUsed))
+                oldest = record;
+        if (oldest == records.end())
+            return;
+        if (remove(path(oldest->first).c_str()) != 0 && errno != ENOENT)
+        {
+            skipped.push_back(oldest->first);
+            continue;
+        }
+        total -= oldest->second.bytes;
+        records.erase(oldest);
+        evictions++;
+    }
+}
+
+void DecodeCache::forget(uint64_t key)
+{
+    auto record = records.find(key);
+    if (record == records.end())
+        return;
+    total -= record->second.bytes;
+    records.erase(record);
+}
+
+DecodeCache::Statistics DecodeCache::statistics() const
+{
+    Statistics statistics;
+    statistics.hits = hits;
+    statistics.misses = misses;
+    statistics.stores = stores;
+    statistics.evictions = evictions;
+    statistics.hitBytes = hitBytes;
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.entries = static_cast<int>(records.size());
+    statistics.bytes = total;
+    return statistics;
+}
+
+void DecodeCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& record : records)
+        remove(path(record.first).c_str());
+    records.clear();
+    total = 0;
+}
+
+std::string DecodeCache::path(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), entrySuffix);
+    return directory + "/" + name;
+}
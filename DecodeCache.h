@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MipChain.h"
+
+// Decoded textures on disk, content-addressed: an entry's name is a hash of the encoded file and
+// of the options that shaped its pixels (flip, channels, mip chain filter), so an edited file
+// simply gets a new entry and an entry is never stale. An entry is a 64-byte header and the
+// pixels exactly as they are uploaded (level 0 only, or a whole MipChain), and find() maps it
+// rather than reading it: a hit costs hashing the encoded file and opening one more, the pixels
+// are paged in by the upload itself.
+// The directory is kept under maxBytes by removing the least recently used entries after each
+// store. Use is the file's modification time, which find() refreshes, so the order carries over
+// to the next launch. Entries are written under a temporary name and renamed, so processes and
+// threads sharing the directory never see half an entry.
+class DecodeCache
+{
+public:
+    // everything besides the file that the cached pixels depend on
+    struct Options
+    {
+        bool flip = true;
+        int channels = 0;       // as stbi_load's req_comp, 0 keeps the file's
+        bool mipmaps = false;   // a whole chain from MipChainBuilder, with the two below
+        MipChainBuilder::Filter filter = MipChainBuilder::Filter::Box;
+        bool srgb = true;
+    };
+
+    // One entry, mapped read-only; stays readable while it lives, even if it is evicted meanwhile
+    // (on Windows, eviction passes over mapped entries).
+    class Entry
+    {
+    public:
+        int width() const { return table[0].width; }
+        int height() const { return table[0].height; }
+        int channels() const { return channelCount; }
+        // a single level, or every level down to 1x1; offsets into pixels()
+        const std::vector<MipChain::Level>& levels() const { return table; }
+        const unsigned char* pixels() const { return data; }
+        const unsigned char* level(size_t index) const { return data + table[index].offset; }
+        size_t bytes() const { return size; }
+
+    private:
+        friend class DecodeCache;
+        explicit Entry(const std::string& path) : file(path), channelCount(0), data(NULL), size(0) {}
+
+        MappedFile file;
+        int channelCount;
+        std::vector<MipChain::Level> table;
+        const unsigned char* data;
+        size_t size;
+    };
+
+    struct Statistics
+    {
+        long long hits = 0, misses = 0, stores = 0, evictions = 0;
+        unsigned long long hitBytes = 0;    // mapped instead of decoded
+        int entries = 0;
+        unsigned long long bytes = 0;       // all entries, headers included
+    };
+
+    // lists the entries already in directory, which is created on the first store;
+    // maxBytes == 0 means no limit
+    explicit DecodeCache(const std::string& directory = "decode_cache", unsigned long long maxBytes = 1ull << 30);
+    DecodeCache(const DecodeCache&) = delete;
+    DecodeCache& operator=(const DecodeCache&) = delete;
+
+    static uint64_t key(const unsigned char* file, size_t size, const Options& options);
+
+    // any thread: NULL on a miss; an entry cut short or written by another version counts as a
+    // miss and is removed
+    std::unique_ptr<Entry> find(uint64_t key);
+    // any thread: false when the entry could not be written
+    bool store(uint64_t key, const unsigned char* pixels, int width, int height, int channels);
+    bool store(uint64_t key, const MipChain& chain);
+
+    Statistics statistics() const;
+    // removes every entry this cache knows of
+    void clear();
+
+private:
+    struct Record
+    {
+        unsigned long long bytes;
+        long long lastUsed;
+    };
+
+    bool write(uint64_t key, int width, int height, int channels, int levels, const unsigned char* pixels, size_t bytes);
+    // evicts until the entries fit maxBytes, never keep; called with mutex held
+    void trim(uint64_t keep);
+    void forget(uint64_t key);
+    std::string path(uint64_t key) const;
+
+    std::string directory;
+    unsigned long long maxBytes;
+    mutable std::mutex mutex;
+    std::map<uint64_t, Record> records;
+    unsigned long long total;
+    long long clock;                // lastUsed of the most recent use
+    std::atomic<long long> hits, misses, stores, evictions;
+    std::atomic<unsigned long long> hitBytes;
+};
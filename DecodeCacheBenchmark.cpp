@@ -0,0 +1,210 @@
+// What a TextureLoader worker does for a texture without and with a DecodeCache: stbi_load from
+// the mapped file (and a CPU mip chain) against hashing the file and mapping the cached entry,
+// with every page of the entry touched as the upload would. The first run into an empty cache
+// is timed too (decode and store). Every hit is compared with stbi_load byte for byte. Then the
+// size limit: entries are stored into a cache too small for all of them and the directory is
+// checked to stay under it, least recently used first; and an entry cut short must be a miss.
+// usage: DecodeCacheBenchmark [repeats] [files...]
+//   texture1.jpg and texture2.jpg by default; uses DecodeCacheBenchmark.cache/ and removes it
+// build with DecodeCache.cpp, MipChain.cpp, CpuFeatures.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "DecodeCache.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "TestImages.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char* directory = "DecodeCacheBenchmark.cache";
+
+    // reads one byte per page, so the mapping costs what an upload from it would
+    unsigned touch(const unsigned char* data, size_t size)
+    {
+        unsigned sum = 0;
+        for (size_t i = 0; i < size; i += 4096)
+            sum += data[i];
+        return sum + (size ? data[size - 1] : 0);
+    }
+
+    // the worker's part of a load, from the encoded file to pixels ready to upload; true when
+    // the pixels came from the cache and match reference
+    bool load(DecodeCache& cache, const std::string& path, bool mipmaps, const std::vector<unsigned char>& reference,
+        unsigned& sink)
+    {
+        const MappedFile file(path);
+        DecodeCache::Options options;
+        options.mipmaps = mipmaps;
+        const uint64_t key = DecodeCache::key(file.data(), file.size(), options);
+        if (std::unique_ptr<DecodeCache::Entry> entry = cache.find(key))
+        {
+            sink += touch(entry->pixels(), entry->bytes());
+            return entry->bytes() == reference.size() && std::memcmp(entry->pixels(), reference.data(), reference.size()) == 0;
+        }
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, 0);
+        if (!pixels)
+            return false;
+        if (mipmaps)
+        {
+            MipChain chain;
+            MipChainBuilder().build(pixels, width, height, channels, chain);
+            cache.store(key, chain);
+        }
+        else
+            cache.store(key, pixels, width, height, channels);
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    // what an uncached worker does
+    unsigned decode(const std::string& path, bool mipmaps)
+    {
+        const MappedFile file(path);
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, 0);
+        unsigned sum = pixels[0];
+        if (mipmaps)
+        {
+            MipChain chain;
+            MipChainBuilder().build(pixels, width, height, channels, chain);
+            sum += chain.pixels.back();
+        }
+        stbi_image_free(pixels);
+        return sum;
+    }
+
+    bool exists(const char* path)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (file)
+            std::fclose(file);
+        return file != NULL;
+    }
+
+    void removeDirectory()
+    {
+#ifdef _WIN32
+        _rmdir(directory);
+#else
+        rmdir(directory);
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    std::vector<std::string> paths(argv + std::min(argc, 2), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    bool correct = true;
+    unsigned sink = 0;
+    std::printf("best of %d, worker time per texture\n", repeats);
+    std::printf("%20s %8s %12s %14s %12s %10s %10s\n", "file", "mips", "decode ms", "first run ms", "hit ms", "entry KB", "identical");
+    for (const std::string& path : paths)
+        for (const bool mipmaps : { false, true })
+        {
+            int width, height, channels;
+            stbi_set_flip_vertically_on_load(true);
+            unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+            if (!pixels)
+            {
+                std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+                correct = false;
+                break;
+            }
+            std::vector<unsigned char> reference;
+            if (mipmaps)
+            {
+                MipChain chain;
+                MipChainBuilder().build(pixels, width, height, channels, chain);
+                reference = chain.pixels;
+            }
+            else
+                reference.assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+            stbi_image_free(pixels);
+
+            double decodeSeconds = 1e9, firstSeconds = 1e9, hitSeconds = 1e9;
+            bool same = true;
+            for (int i = 0; i < repeats; i++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                sink += decode(path, mipmaps);
+                decodeSeconds = std::min(decodeSeconds, secondsSince(start));
+
+                DecodeCache cache(directory);
+                cache.clear();
+                start = std::chrono::steady_clock::now();
+                load(cache, path, mipmaps, reference, sink);
+                firstSeconds = std::min(firstSeconds, secondsSince(start));
+                start = std::chrono::steady_clock::now();
+                same = load(cache, path, mipmaps, reference, sink) && same;
+                hitSeconds = std::min(hitSeconds, secondsSince(start));
+                cache.clear();
+            }
+            correct = correct && same;
+            std::printf("%20s %8s %12.2f %14.2f %12.3f %10.0f %10s\n", path.c_str(), mipmaps ? "chain" : "level 0", decodeSeconds * 1000.0,
+                firstSeconds * 1000.0, hitSeconds * 1000.0, reference.size() / 1024.0, same ? "yes" : "NO");
+        }
+
+    // the limit: 40 entries of 256 KB into 2 MB, with the first one read back all along
+    {
+        const int width = 256, height = 256, count = 40;
+        const unsigned long long limit = 2ull << 20;
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+        DecodeCache cache(directory, limit);
+        cache.clear();
+        bool kept = true;
+        for (int i = 0; i < count; i++)
+        {
+            std::fill(pixels.begin(), pixels.end(), static_cast<unsigned char>(i));
+            cache.store(1000 + i, pixels.data(), width, height, 4);
+            std::unique_ptr<DecodeCache::Entry> first = cache.find(1000);
+            kept = kept && first && first->pixels()[0] == 0;
+        }
+        const DecodeCache::Statistics statistics = cache.statistics();
+        // a fresh cache lists the same directory
+        const DecodeCache::Statistics listed = DecodeCache(directory, limit).statistics();
+        const bool limited = statistics.bytes <= limit && listed.bytes == statistics.bytes && listed.entries == statistics.entries &&
+            statistics.evictions == count - statistics.entries && kept && !cache.find(1001);
+        std::printf("\nlimit %llu KB: %d stores, %d entries of %llu KB kept, %lld evicted, %lld hits, %lld misses, most recent kept %s\n",
+            limit >> 10, count, statistics.entries, statistics.bytes >> 10, statistics.evictions, statistics.hits, statistics.misses,
+            limited ? "yes" : "NO");
+        correct = correct && limited;
+
+        // an entry cut short, as by a crash while another process wrote it
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s/%016llx.dec", directory, 1000ull + count - 1);
+        bool truncated = false;
+        if (exists(name))
+        {
+            FILE* file = std::fopen(name, "wb");
+            truncated = file && std::fwrite(pixels.data(), 1, 1000, file) == 1000;
+            truncated = file && std::fclose(file) == 0 && truncated;
+        }
+        const bool rejected = truncated && !cache.find(1000 + count - 1) && !exists(name);
+        std::printf("entry cut short: a miss and removed %s\n", rejected ? "yes" : "NO");
+        correct = correct && rejected;
+        cache.clear();
+    }
+    removeDirectory();
+    return correct && sink != 1 ? 0 : 1;
+}
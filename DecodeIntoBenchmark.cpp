@@ -0,0 +1,93 @@
+// Decoding into a caller's buffer the way TextureLoader fills its upload ring: stbi_load_from_memory
+// with the vertical flip, then a copy into the destination (what the workers used to do), against
+// stbi_load_from_memory_into, which writes the flipped rows straight into the destination.
+// The destination is one buffer reused for every decode, like a ring range. Results are compared
+// byte for byte.
+// usage: DecodeIntoBenchmark [repeats] [files...]
+//   texture1.jpg and texture2.jpg by default
+// build with TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "TestImages.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+double loadAndCopySeconds(const TestImage& image, int repeats, int channels, std::vector<unsigned char>& destination)
+{
+    double best = 1e9;
+    for (int i = 0; i < repeats; i++)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int width, height, components;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+            &components, channels);
+        stbi_set_flip_vertically_on_load(false);
+        if (!pixels)
+            return 0.0;
+        std::memcpy(destination.data(), pixels, destination.size());
+        stbi_image_free(pixels);
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+double decodeIntoSeconds(const TestImage& image, int repeats, int channels, int width, std::vector<unsigned char>& destination)
+{
+    double best = 1e9;
+    for (int i = 0; i < repeats; i++)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int x, y, components;
+        if (!stbi_load_from_memory_into(image.file.data(), static_cast<int>(image.file.size()), destination.data(),
+            destination.size(), width * channels, true, &x, &y, &components, channels))
+            return 0.0;
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+    std::vector<std::string> paths(argv + std::min(argc, 2), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    std::printf("best of %d, flipped, into one reused buffer\n", repeats);
+    std::printf("%24s %9s %12s %12s %8s %10s\n", "image", "channels", "load+copy ms", "into ms", "speedup", "identical");
+    for (const std::string& path : paths)
+    {
+        const TestImage image = { path, readFile(path) };
+        int width, height, components;
+        if (!stbi_info_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height, &components))
+        {
+            std::printf("%24s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+
+        for (int channels : { components, 4 })
+        {
+            std::vector<unsigned char> copied(static_cast<size_t>(width) * height * channels);
+            std::vector<unsigned char> direct(copied.size());
+            const double copy = loadAndCopySeconds(image, repeats, channels, copied);
+            const double into = decodeIntoSeconds(image, repeats, channels, width, direct);
+            if (copy == 0.0 || into == 0.0)
+            {
+                std::printf("%24s: %s\n", path.c_str(), stbi_failure_reason());
+                break;
+            }
+            std::printf("%24s %9d %12.2f %12.2f %7.2fx %10s\n", path.c_str(), channels, copy * 1000.0, into * 1000.0,
+                copy / into, copied == direct ? "yes" : "NO");
+            if (channels == 4)
+                break;
+        }
+    }
+    return 0;
+}
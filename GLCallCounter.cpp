@@ -0,0 +1,102 @@
+#include "GLCallCounter.h"
+
+#include <cstddef>
+
+namespace
+{
+    // only touched from the thread owning the GL context
+    GLCallCounts counts = {};
+
+#define COUNTED_CALL(name, counter, Return, parameters, arguments) \
+    decltype(glad_##name) original_##name = NULL; \
+    Return APIENTRY counted_##name parameters \
+    { \
+        counts.counter++; \
+        return original_##name arguments; \
+    }
+
+    COUNTED_CALL(glGetUniformLocation, uniformLookups, GLint, (GLuint program, const GLchar* name), (program, name))
+
+    COUNTED_CALL(glUniform1i, uniformUploads, void, (GLint location, GLint v0), (location, v0))
+    COUNTED_CALL(glUniform1f, uniformUploads, void, (GLint location, GLfloat v0), (location, v0))
+    COUNTED_CALL(glUniform3f, uniformUploads, void, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2), (location, v0, v1, v2))
+    COUNTED_CALL(glUniform4f, uniformUploads, void, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3), (location, v0, v1, v2, v3))
+    COUNTED_CALL(glUniform3fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+    COUNTED_CALL(glUniform4fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+    COUNTED_CALL(glUniformMatrix3fv, uniformUploads, void, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value))
+    COUNTED_CALL(glUniformMatrix4fv, uniformUploads, void, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value), (location, count, transpose, value))
+
+    COUNTED_CALL(glUseProgram, programBinds, void, (GLuint program), (program))
+
+    COUNTED_CALL(glBindVertexArray, objectBinds, void, (GLuint array), (array))
+    COUNTED_CALL(glBindBuffer, objectBinds, void, (GLenum target, GLuint buffer), (target, buffer))
+    COUNTED_CALL(glBindBufferBase, objectBinds, void, (GLenum target, GLuint index, GLuint buffer), (target, index, buffer))
+    COUNTED_CALL(glBindTexture, objectBinds, void, (GLenum target, GLuint texture), (target, texture))
+    COUNTED_CALL(glActiveTexture, objectBinds, void, (GLenum texture), (texture))
+
+    COUNTED_CALL(glBufferData, bufferUploads, void, (GLenum target, GLsizeiptr size, const void* data, GLenum usage), (target, size, data, usage))
+    COUNTED_CALL(glBufferSubData, bufferUploads, void, (GLenum target, GLintptr offset, GLsizeiptr size, const void* data), (target, offset, size, data))
+
+    COUNTED_CALL(glDrawArrays, draws, void, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+    COUNTED_CALL(glDrawElements, draws, void, (GLenum mode, GLsizei count, GLenum type, const void* indices), (mode, count, type, indices))
+    COUNTED_CALL(glDrawElementsInstanced, draws, void, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount), (mode, count, type, indices, instancecount))
+    COUNTED_CALL(glDrawElementsBaseVertex, draws, void, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex), (mode, count, type, indices, basevertex))
+
+#undef COUNTED_CALL
+}
+
+GLCallCounts& GLCallCounts::operator+=(const GLCallCounts& other)
+{
+    uniformLookups += other.uniformLookups;
+    uniformUploads += other.uniformUploads;
+    programBinds += other.programBinds;
+    objectBinds += other.objectBinds;
+    bufferUploads += other.bufferUploads;
+    draws += other.draws;
+    return *this;
+}
+
+void installGLCallCounter()
+{
+#define INSTALL_COUNTER(name) \
+    if (glad_##name && !original_##name) \
+    { \
+        original_##name = glad_##name; \
+        glad_##name = counted_##name; \
+    }
+
+    INSTALL_COUNTER(glGetUniformLocation)
+    INSTALL_COUNTER(glUniform1i)
+    INSTALL_COUNTER(glUniform1f)
+    INSTALL_COUNTER(glUniform3f)
+    INSTALL_COUNTER(glUniform4f)
+    INSTALL_COUNTER(glUniform3fv)
+    INSTALL_COUNTER(glUniform4fv)
+    INSTALL_COUNTER(glUniformMatrix3fv)
+    INSTALL_COUNTER(glUniformMatrix4fv)
+    INSTALL_COUNTER(glUseProgram)
+    INSTALL_COUNTER(glBindVertexArray)
+    INSTALL_COUNTER(glBindBuffer)
+    INSTALL_COUNTER(glBindBufferBase)
+    INSTALL_COUNTER(glBindTexture)
+    INSTALL_COUNTER(glActiveTexture)
+    INSTALL_COUNTER(glBufferData)
+    INSTALL_COUNTER(glBufferSubData)
+    INSTALL_COUNTER(glDrawArrays)
+    INSTALL_COUNTER(glDrawElements)
+    INSTALL_COUNTER(glDrawElementsInstanced)
+    INSTALL_COUNTER(glDrawElementsBaseVertex)
+
+#undef INSTALL_COUNTER
+    resetGLCallCounts();
+}
+
+GLCallCounts glCallCounts()
+{
+    return counts;
+}
+
+void resetGLCallCounts()
+{
+    counts = GLCallCounts();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Number of GL calls issued, grouped by what they cost the driver.
+struct GLCallCounts
+{
+    unsigned long long uniformLookups;    // glGetUniformLocation
+    unsigned long long uniformUploads;    // glUniform*
+    unsigned long long programBinds;      // glUseProgram
+    unsigned long long objectBinds;       // glBindVertexArray, glBindBuffer*, glBindTexture, glActiveTexture
+    unsigned long long bufferUploads;     // glBufferData, glBufferSubData
+    unsigned long long draws;             // glDrawArrays, glDrawElements*
+
+    unsigned long long total() const
+    {
+        return uniformLookups + uniformUploads + programBinds + objectBinds + bufferUploads + draws;
+    }
+    GLCallCounts& operator+=(const GLCallCounts& other);
+};
+
+// Replaces the glad function pointers of the counted calls with wrappers that bump the
+// counters and forward to the driver. Call after gladLoadGL; calling it again does nothing.
+void installGLCallCounter();
+GLCallCounts glCallCounts();
+void resetGLCallCounts();
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// What the current context offers beyond the GL 3.3 core that glad loads. Every function
+// queries the context that is current on the calling thread.
+
+// GL_ARB_buffer_storage / GL 4.4, not part of the GL 3.3 glad loader
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// the context is at least GL major.minor
+bool hasGLVersion(int major, int minor);
+// name is in the context's GL_EXTENSIONS list
+bool hasGLExtension(const char* name);
+// glBufferStorage when the context has GL 4.4 or GL_ARB_buffer_storage, NULL otherwise
+PFNGLBUFFERSTORAGEPROC loadBufferStorage();
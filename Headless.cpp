@@ -0,0 +1,246 @@
+#include "Headless.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+Headless::Headless(int argc, char** argv)
+    : frameCount(0), timeStep(1.0 / 60.0), format(ImageFormat::PPM), valid(true),
+    width(0), height(0), frame(0), software(false), framebuffer(0), colorBuffer(0), depthBuffer(0)
+{
+    packBuffers[0] = packBuffers[1] = 0;
+
+    std::string error;
+    for (int i = 1; i < argc && error.empty(); i += 2)
+    {
+        const std::string option = argv[i];
+        if (option.size() < 3 || option.compare(0, 2, "--") != 0)
+        {
+            error = "expected an option like --headless, got \"" + option + "\"";
+            break;
+        }
+        if (i + 1 >= argc)
+        {
+            error = option + " needs a value";
+            break;
+        }
+        const std::string value = argv[i + 1];
+        char* end = NULL;
+        if (option == "--headless")
+        {
+            const long frames = std::strtol(value.c_str(), &end, 10);
+            if (*end != '\0' || end == value.c_str() || frames <= 0 || frames > INT_MAX)
+                error = "--headless takes a number of frames above 0, got \"" + value + "\"";
+            else
+                frameCount = static_cast<int>(frames);
+        }
+        else if (option == "--dt")
+        {
+            timeStep = std::strtod(value.c_str(), &end);
+            if (*end != '\0' || end == value.c_str() || !(timeStep > 0.0))
+                error = "--dt takes a time step in seconds above 0, got \"" + value + "\"";
+        }
+        else if (option == "--out")
+            outputDirectory = value;
+        else if (option == "--format")
+        {
+            if (value == "ppm" || value == "png" || value == "raw")
+                format = value == "png" ? ImageFormat::PNG : value == "raw" ? ImageFormat::RAW : ImageFormat::PPM;
+            else
+                error = "--format takes ppm, png or raw, got \"" + value + "\"";
+        }
+        else
+            options[option] = value;
+    }
+    valid = error.empty();
+    if (!valid)
+        std::cout << "Error (command line): " << error << std::endl;
+}
+
+std::string Headless::option(const std::string& name, const std::string& fallback) const
+{
+    std::map<std::string, std::string>::const_iterator found = options.find(name);
+    return found != options.end() ? found->second : fallback;
+}
+
+void Headless::windowHints() const
+{
+    if (!enabled())
+        return;
+    // glfwInit fails without a display, and so will glfwCreateWindow; say why
+    const char* description = NULL;
+    if (glfwGetError(&description) != GLFW_NO_ERROR)
+        std::cout << "Error (headless): " << (description ? description : "GLFW failed to start")
+                  << ". --headless renders in a hidden window and still needs a display (e.g. xvfb-run);"
+                  << " only Zadanie9 --software 1 renders without one" << std::endl;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+}
+
+bool Headless::begin(int frameWidth, int frameHeight)
+{
+    if (!valid)
+        return false;
+    if (!enabled())
+        return true;
+
+    width = frameWidth;
+    height = frameHeight;
+    glfwSwapInterval(0);
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // stays bound for the whole run, the exercises never bind another framebuffer
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Failed to create offscreen framebuffer" << std::endl;
+        return false;
+    }
+
+    if (!outputDirectory.empty())
+    {
+        glGenBuffers(2, packBuffers);
+        for (GLuint buffer : packBuffers)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    calls = GLCallCounts();
+    installGLCallCounter();
+    glfwSetTime(0.0);
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool Headless::running(GLFWwindow* window) const
+{
+    if (enabled())
+        return frame < frameCount;
+    return !glfwWindowShouldClose(window);
+}
+
+double Headless::time() const
+{
+    if (enabled())
+        return frame * timeStep;
+    return glfwGetTime();
+}
+
+void Headless::present(GLFWwindow* window)
+{
+    if (!enabled())
+    {
+        glfwSwapBuffers(window);
+        return;
+    }
+
+    calls += glCallCounts();
+    if (!outputDirectory.empty())
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[frame % 2]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        if (frame > 0)
+            writeFrame(frame - 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    resetGLCallCounts();
+    frame++;
+    // code that still reads glfwGetTime() sees the simulated clock as well
+    glfwSetTime(frame * timeStep);
+}
+
+bool Headless::beginSoftware(int frameWidth, int frameHeight)
+{
+    if (!valid)
+        return false;
+    if (!enabled())
+    {
+        std::cout << "CPU frames need --headless <frames>, there is no window to show them in" << std::endl;
+        return false;
+    }
+    width = frameWidth;
+    height = frameHeight;
+    software = true;
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void Headless::present(const unsigned char* rgba)
+{
+    if (!outputDirectory.empty())
+        writeImage(frameName(frame), width, height, rgba, format);
+    frame++;
+}
+
+std::string Headless::frameName(int index) const
+{
+    static const char* extensions[] = { "ppm", "png", "raw" };
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%05d.%s", index, extensions[static_cast<int>(format)]);
+    return outputDirectory + "/" + name;
+}
+
+void Headless::writeFrame(int index)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[index % 2]);
+    const unsigned char* pixels = static_cast<const unsigned char*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (pixels)
+    {
+        writeImage(frameName(index), width, height, pixels, format);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+}
+
+void Headless::finish()
+{
+    if (!enabled())
+        return;
+    if (software)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Rendered " << frame << " frames (" << width << "x" << height << ") on the CPU in " << seconds << " s, "
+            << frame / seconds << " fps" << std::endl;
+        return;
+    }
+
+    if (!outputDirectory.empty() && frame > 0)
+    {
+        writeFrame(frame - 1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    glFinish();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Rendered " << frame << " frames (" << width << "x" << height << ") in " << seconds << " s, "
+        << frame / seconds << " fps" << std::endl;
+    if (frame > 0)
+    {
+        std::cout << "GL calls per frame: " << static_cast<double>(calls.total()) / frame
+            << " (uniform lookups " << static_cast<double>(calls.uniformLookups) / frame
+            << ", uniform uploads " << static_cast<double>(calls.uniformUploads) / frame
+            << ", program binds " << static_cast<double>(calls.programBinds) / frame
+            << ", object binds " << static_cast<double>(calls.objectBinds) / frame
+            << ", buffer uploads " << static_cast<double>(calls.bufferUploads) / frame
+            << ", draws " << static_cast<double>(calls.draws) / frame << ")" << std::endl;
+    }
+
+    glDeleteBuffers(2, packBuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "GLCallCounter.h"
+#include "ImageWriter.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+
+// Batch rendering in a hidden window.
+//
+//   Zadanie9 --headless 1000 [--dt 0.016] [--out frames] [--format ppm|png|raw]
+//
+// renders the given number of frames into an offscreen framebuffer with a fixed
+// simulated time step, without vsync, optionally writing every frame to
+// <out>/frame_00000.<format> (the directory must exist), and prints the frame rate
+// together with the average number of GL calls the exercise issued per frame.
+// The GL context still belongs to a GLFW window, only an invisible one, so this needs a
+// display like any other run (on a server e.g. xvfb-run); it is not an EGL or OSMesa context.
+// Without --headless everything behaves like the plain window loop. Other "--name value"
+// pairs are left for the exercise itself, see option(). An option without a value, or a
+// value that is not one, is reported at once and makes begin() fail.
+class Headless
+{
+public:
+    Headless(int argc, char** argv);
+
+    bool enabled() const { return frameCount > 0; }
+    // value of an exercise specific "--name value" option, or fallback when it is not given
+    std::string option(const std::string& name, const std::string& fallback) const;
+
+    // call after glfwInit, before glfwCreateWindow; hides the window in headless mode and
+    // reports a glfwInit that failed, e.g. for want of a display
+    void windowHints() const;
+    // call once GL is loaded; creates the offscreen framebuffer, false also when the
+    // command line was not valid
+    bool begin(int width, int height);
+    // loop condition, replaces !glfwWindowShouldClose(window)
+    bool running(GLFWwindow* window) const;
+    // end of frame, replaces glfwSwapBuffers(window)
+    void present(GLFWwindow* window);
+    // simulated time in headless mode, glfwGetTime() otherwise
+    double time() const;
+    // call before glfwTerminate, writes the last frame and prints statistics
+    void finish();
+
+    // Frames rendered on the CPU (SoftwareRasterizer) instead: beginSoftware() replaces begin()
+    // and present(rgba) replaces present(window), with the frame's RGBA8 pixels stored bottom row
+    // first. Neither these nor finish() make GL calls then, so no window or context is needed.
+    bool beginSoftware(int width, int height);
+    void present(const unsigned char* rgba);
+
+private:
+    std::string frameName(int index) const;
+    void writeFrame(int index);
+
+    int frameCount;
+    double timeStep;
+    std::string outputDirectory;
+    ImageFormat format;
+    std::map<std::string, std::string> options;
+    bool valid;
+
+    int width;
+    int height;
+    int frame;
+    bool software;
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+    GLuint packBuffers[2];    // glReadPixels of frame N overlaps writing frame N - 1
+    GLCallCounts calls;       // summed over all frames, without the readback calls above
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,63 @@
+#include "ImageProbe.h"
+#include "ThreadPool.h"
+
+#include <stb_image/stb_image.h>
+
+#include <climits>
+#include <cstdio>
+
+namespace
+{
+    // the header parsed from the first length bytes of the file, false when they do not hold it
+    bool parse(const unsigned char* data, size_t length, ImageProbe& probe)
+    {
+        const int size = static_cast<int>(length);
+        if (!stbi_info_from_memory(data, size, &probe.width, &probe.height, &probe.channels))
+            return false;
+        probe.hdr = stbi_is_hdr_from_memory(data, size) != 0;
+        probe.bitsPerChannel = probe.hdr ? 32 : stbi_is_16_bit_from_memory(data, size) ? 16 : 8;
+        probe.valid = true;
+        return true;
+    }
+}
+
+ImageProbe probeImage(const std::string& path, std::vector<unsigned char>& buffer, size_t headerBytes)
+{
+    ImageProbe probe;
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return probe;
+    // reads go straight into buffer, stdio's own would only add a copy
+    std::setvbuf(file, NULL, _IONBF, 0);
+
+    size_t length = 0, wanted = headerBytes > 0 ? headerBytes : 1;
+    for (;;)
+    {
+        if (buffer.size() < wanted)
+            buffer.resize(wanted);
+        length += std::fread(buffer.data() + length, 1, wanted - length, file);
+        if (parse(buffer.data(), length, probe) || length < wanted || wanted >= static_cast<size_t>(INT_MAX))
+            break;
+        wanted = wanted > static_cast<size_t>(INT_MAX) / 2 ? static_cast<size_t>(INT_MAX) : wanted * 2;
+    }
+    std::fclose(file);
+    return probe;
+}
+
+std::vector<ImageProbe> probeImages(const std::vector<std::string>& paths, ThreadPool* pool, size_t headerBytes)
+{
+    std::vector<ImageProbe> probes(paths.size());
+    auto body = [&](int index, unsigned)
+    {
+        // one buffer per thread, not per threadIndex: the caller may be a thread of another pool,
+        // whose index there can be out of range here or the same as one of this pool's workers
+        thread_local std::vector<unsigned char> buffer;
+        probes[index] = probeImage(paths[index], buffer, headerBytes);
+    };
+    if (pool)
+        pool->parallelFor(static_cast<int>(paths.size()), body);
+    else
+        for (size_t i = 0; i < paths.size(); i++)
+            body(static_cast<int>(i), 0);
+    return probes;
+}
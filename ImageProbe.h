@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// What stbi_info, stbi_is_16_bit and stbi_is_hdr say about an image file, without decoding it.
+struct ImageProbe
+{
+    bool valid = false;      // false when the file cannot be read or is no image stb_image knows
+    int width = 0;
+    int height = 0;
+    int channels = 0;        // as stbi_info: what stbi_load returns when asked for 0 channels
+    int bitsPerChannel = 0;  // 8, 16, or 32 for HDR, which stbi_loadf returns as floats
+    bool hdr = false;
+};
+
+// Probes one file from its first headerBytes only, read with one unbuffered fread, and parsed with
+// the stbi_*_from_memory functions. When that is not enough (a JPEG whose frame header comes after
+// large EXIF or ICC segments, a PNG with big chunks before its tRNS) the read is doubled until
+// the header parses or the whole file is in. buffer is reused between calls to save allocations.
+ImageProbe probeImage(const std::string& path, std::vector<unsigned char>& buffer, size_t headerBytes = 4096);
+
+// probeImage for every path, split across pool (on the calling thread when NULL); the results are
+// in the order of paths
+std::vector<ImageProbe> probeImages(const std::vector<std::string>& paths, ThreadPool* pool = NULL, size_t headerBytes = 4096);
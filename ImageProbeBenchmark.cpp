@@ -0,0 +1,173 @@
+// Probing a whole asset directory for sizes and formats: stbi_info, stbi_is_16_bit and stbi_is_hdr
+// on every file (three stdio opens, each refilling stb's 128 byte buffer through a 4 KB FILE
+// buffer), against probeImages, which reads the first 4 KB of every file once and parses them
+// from memory, on one thread and on a ThreadPool. The directory is generated: small PNGs (gray,
+// RGB, RGBA, 16-bit RGB, some with tRNS) like the icons of an atlas, Radiance HDR files, and hard
+// links to texture1.jpg and texture2.jpg. Every probe is compared with the stbi_info results.
+// Runs with warm files and cold ones (evicted with posix_fadvise(POSIX_FADV_DONTNEED) first).
+// usage: ImageProbeBenchmark [files] [threads]
+//   100000 files by default, threads 0 is std::thread::hardware_concurrency(); Linux only
+// build with ImageProbe.cpp, TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp,
+// MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "ImageProbe.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char* directory = "ImageProbeBenchmark.files";
+
+    // an all black PNG, compressed to a few bytes a row
+    std::vector<unsigned char> blackPng(int width, int height, int color, int depth, bool trns)
+    {
+        PngOptions options;
+        options.colorType = color;
+        options.depth = depth;
+        if (trns)
+            options.transparency.assign(6, 0);
+        const size_t rowBytes = static_cast<size_t>(width) * (color == 6 ? 4 : color == 2 ? 3 : 1) * depth / 8;
+        return encodePng(width, height, [rowBytes](int, unsigned char* row) { std::memset(row, 0, rowBytes); }, options);
+    }
+
+    // flat (not run-length coded) Radiance pixels, as stb reads them when a row starts without the
+    // 2 2 marker
+    std::vector<unsigned char> hdr(int width, int height)
+    {
+        const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+        std::vector<unsigned char> file(header.begin(), header.end());
+        for (int i = 0; i < width * height; i++)
+            file.insert(file.end(), { 128, 64, 32, 129 });
+        return file;
+    }
+
+    // every tenth file is a JPEG link, every tenth an HDR, the rest PNGs of a few kinds and sizes
+    std::vector<std::string> generate(int count)
+    {
+        mkdir(directory, 0755);
+        const int colors[4] = { 0, 2, 6, 2 };
+        std::vector<std::string> paths;
+        for (int i = 0; i < count; i++)
+        {
+            const std::string base = std::string(directory) + "/" + std::to_string(i);
+            std::string path;
+            bool written;
+            if (i % 10 == 0)
+            {
+                path = base + ".jpg";
+                unlink(path.c_str());
+                written = link(i % 20 ? "texture2.jpg" : "texture1.jpg", path.c_str()) == 0;
+            }
+            else if (i % 10 == 1)
+            {
+                path = base + ".hdr";
+                written = writeFile(path, hdr(8 + i % 9, 8 + i % 7));
+            }
+            else
+            {
+                path = base + ".png";
+                const int kind = i % 4, size = 16 << (i % 5);
+                written = writeFile(path, blackPng(size, size / 2 + i % 16, colors[kind], kind == 3 ? 16 : 8, kind == 1 && i % 7 == 0));
+            }
+            if (!written)
+            {
+                std::printf("cannot write %s\n", path.c_str());
+                return {};
+            }
+            paths.push_back(path);
+        }
+        // dirty pages cannot be evicted, the cold runs need the files on disk
+        sync();
+        return paths;
+    }
+
+    // what callers did before: the three stdio functions
+    ImageProbe stdioProbe(const std::string& path)
+    {
+        ImageProbe probe;
+        if (!stbi_info(path.c_str(), &probe.width, &probe.height, &probe.channels))
+            return probe;
+        probe.hdr = stbi_is_hdr(path.c_str()) != 0;
+        probe.bitsPerChannel = probe.hdr ? 32 : stbi_is_16_bit(path.c_str()) ? 16 : 8;
+        probe.valid = true;
+        return probe;
+    }
+
+    void evict(const std::vector<std::string>& paths)
+    {
+        for (const std::string& path : paths)
+        {
+            const int file = open(path.c_str(), O_RDONLY);
+            if (file < 0)
+                continue;
+            posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+            close(file);
+        }
+    }
+
+    bool same(const ImageProbe& a, const ImageProbe& b)
+    {
+        return a.valid == b.valid && a.width == b.width && a.height == b.height && a.channels == b.channels &&
+            a.bitsPerChannel == b.bitsPerChannel && a.hdr == b.hdr;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    const int count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100000;
+    ThreadPool pool(argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0);
+
+    const std::chrono::steady_clock::time_point generating = std::chrono::steady_clock::now();
+    const std::vector<std::string> paths = generate(count);
+    if (paths.empty())
+        return 1;
+    std::printf("%d files in %s, generated in %.1f s\n", count, directory, secondsSince(generating));
+
+    bool identical = true;
+    std::printf("%6s %28s %10s %12s %10s\n", "cache", "probe", "seconds", "files/s", "identical");
+    for (const bool cold : { false, true })
+    {
+        std::vector<ImageProbe> reference(paths.size());
+        if (cold)
+            evict(paths);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < paths.size(); i++)
+            reference[i] = stdioProbe(paths[i]);
+        double seconds = secondsSince(start);
+        std::printf("%6s %28s %10.2f %12.0f %10s\n", cold ? "cold" : "warm", "stbi_info + 16_bit + hdr", seconds, count / seconds, "-");
+
+        for (ThreadPool* probePool : { static_cast<ThreadPool*>(NULL), &pool })
+        {
+            if (cold)
+                evict(paths);
+            start = std::chrono::steady_clock::now();
+            const std::vector<ImageProbe> probes = probeImages(paths, probePool);
+            seconds = secondsSince(start);
+            bool match = true;
+            for (size_t i = 0; i < paths.size(); i++)
+                match = match && same(probes[i], reference[i]) && probes[i].valid;
+            identical = identical && match;
+            const std::string name = "probeImages, " + std::to_string(probePool ? probePool->size() : 1) + " thread(s)";
+            std::printf("%6s %28s %10.2f %12.0f %10s\n", cold ? "cold" : "warm", name.c_str(), seconds, count / seconds, match ? "yes" : "NO");
+        }
+    }
+
+    for (const std::string& path : paths)
+        unlink(path.c_str());
+    rmdir(directory);
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // PNG with stored (uncompressed) deflate blocks, fast to write and readable everywhere
+    void writePng(FILE* file, int width, int height, const unsigned char* rgba)
+    {
+        std::vector<unsigned char> scanlines;
+        scanlines.reserve(static_cast<size_t>(width * 3 + 1) * height);
+        for (int y = height - 1; y >= 0; y--)
+        {
+            scanlines.push_back(0);
+            const unsigned char* row = rgba + static_cast<size_t>(y) * width * 4;
+            for (int x = 0; x < width; x++)
+                scanlines.insert(scanlines.end(), row + x * 4, row + x * 4 + 3);
+        }
+
+        const std::vector<unsigned char> png = pngFile(width, height, 8, 2, storedZlib(scanlines));
+        fwrite(png.data(), 1, png.size(), file);
+    }
+}
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t adler32(const unsigned char* data, size_t size, uint32_t adler)
+{
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0)
+    {
+        // 5552 bytes is the most that cannot overflow b before the modulo
+        const size_t block = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < block; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+void putBigEndian(std::vector<unsigned char>& out, uint32_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+}
+
+void putPngChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    putBigEndian(out, static_cast<uint32_t>(data.size()));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+void putStoredBlocks(std::vector<unsigned char>& zlib, const unsigned char* data, size_t size, bool last)
+{
+    for (size_t offset = 0; offset < size || (last && offset == 0);)
+    {
+        const size_t length = std::min<size_t>(65535, size - offset);
+        zlib.push_back(last && offset + length == size ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(length));
+        zlib.push_back(static_cast<unsigned char>(length >> 8));
+        zlib.push_back(static_cast<unsigned char>(~length));
+        zlib.push_back(static_cast<unsigned char>(~length >> 8));
+        zlib.insert(zlib.end(), data + offset, data + offset + length);
+        offset += length;
+        if (length == 0)
+            break;
+    }
+}
+
+std::vector<unsigned char> storedZlib(const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> zlib;
+    zlib.reserve(data.size() + data.size() / 65535 * 5 + 11);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    putStoredBlocks(zlib, data.data(), data.size(), true);
+    putBigEndian(zlib, adler32(data.data(), data.size()));
+    return zlib;
+}
+
+std::vector<unsigned char> pngFile(int width, int height, int depth, int colorType, const std::vector<unsigned char>& zlib,
+    size_t idatBytes, const std::vector<unsigned char>& transparency)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> png(signature, signature + sizeof(signature));
+    png.reserve(zlib.size() + 64 + zlib.size() / std::max<size_t>(idatBytes, 1 << 16) * 12);
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(static_cast<unsigned char>(depth));
+    header.push_back(static_cast<unsigned char>(colorType));
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    putPngChunk(png, "IHDR", header);
+    if (!transparency.empty())
+        putPngChunk(png, "tRNS", transparency);
+
+    if (idatBytes == 0)
+        idatBytes = std::max<size_t>(zlib.size(), 1);
+    for (size_t offset = 0; offset < zlib.size(); offset += idatBytes)
+        putPngChunk(png, "IDAT", std::vector<unsigned char>(zlib.begin() + offset,
+            zlib.begin() + std::min(zlib.size(), offset + idatBytes)));
+    putPngChunk(png, "IEND", std::vector<unsigned char>());
+    return png;
+}
+
+bool writeImage(const std::string& path, int width, int height, const unsigned char* rgba, ImageFormat format)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    if (format == ImageFormat::PPM)
+    {
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+        std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+        for (int y = height - 1; y >= 0; y--)
+        {
+            const unsigned char* in = rgba + y * rowBytes;
+            for (int x = 0; x < width; x++)
+                memcpy(&row[x * 3], in + x * 4, 3);
+            fwrite(row.data(), 1, row.size(), file);
+        }
+    }
+    else if (format == ImageFormat::PNG)
+        writePng(file, width, height, rgba);
+    else
+    {
+        for (int y = height - 1; y >= 0; y--)
+            fwrite(rgba + y * rowBytes, 1, rowBytes, file);
+    }
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ImageFormat
+{
+    PPM,    // binary P6, RGB
+    PNG,    // RGB, uncompressed deflate blocks
+    RAW     // RGBA8, top row first
+};
+
+// writes width x height RGBA8 pixels stored bottom row first (glReadPixels order)
+bool writeImage(const std::string& path, int width, int height, const unsigned char* rgba, ImageFormat format);
+
+// The pieces the PNG writer is made of, also used for the benchmarks' test images (TestImages.h).
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0);
+uint32_t adler32(const unsigned char* data, size_t size, uint32_t adler = 1);
+void putBigEndian(std::vector<unsigned char>& out, uint32_t value, int bytes = 4);
+// length, type, data and CRC
+void putPngChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data);
+// appends data as stored (uncompressed) deflate blocks of at most 65535 bytes, the last of them
+// marked final when last is set (an empty one if there is no data); for a stream written a piece
+// at a time
+void putStoredBlocks(std::vector<unsigned char>& zlib, const unsigned char* data, size_t size, bool last);
+// a whole zlib stream of stored blocks
+std::vector<unsigned char> storedZlib(const std::vector<unsigned char>& data);
+// signature, IHDR (not interlaced), tRNS when transparency is not empty, the zlib stream in IDAT
+// chunks of at most idatBytes (0: one chunk), IEND
+std::vector<unsigned char> pngFile(int width, int height, int depth, int colorType, const std::vector<unsigned char>& zlib,
+    size_t idatBytes = 0, const std::vector<unsigned char>& transparency = std::vector<unsigned char>());
@@ -0,0 +1,246 @@
+// Frame time and draw calls of the Zadanie6 triangles drawn one glDrawElements per object
+// (model and color uniforms, like the exercise without --instances) against a single
+// glDrawElementsInstanced with per-instance attributes (Zadanie6 --instances N),
+// for 4 to 100k animated triangles. Frame time includes the instance buffer upload.
+// usage: InstancingBenchmark [frames]
+// build with glad.c, ShaderProgram.cpp, GLCapabilities.cpp, GLCallCounter.cpp and GLFW
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "GLCallCounter.h"
+#include "ShaderProgram.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int window_width = 1000;
+const unsigned int window_height = 1000;
+
+const GLchar* vertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"out vec3 vertexColor;\n"
+"uniform mat4 model;\n"
+"uniform vec3 color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = model * vec4(position, 1.0);\n"
+"    vertexColor = color;\n"
+"}\0";
+
+const GLchar* instancedVertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"layout(location = 1) in mat4 instanceModel;\n"
+"layout(location = 5) in vec3 instanceColor;\n"
+"out vec3 vertexColor;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = instanceModel * vec4(position, 1.0);\n"
+"    vertexColor = instanceColor;\n"
+"}\0";
+
+const GLchar* fragmentShaderSource =
+"#version 330 core\n"
+"in vec3 vertexColor;\n"
+"out vec4 fragmentColor;\n"
+"void main()\n"
+"{\n"
+"    fragmentColor = vec4(vertexColor, 1.0);\n"
+"}\0";
+
+struct Instance
+{
+    glm::mat4 model;
+    glm::vec3 color;
+};
+
+// same animation as the grid of Zadanie6 --instances
+void animateGrid(Instance* instances, int count, float time)
+{
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    const float cell = 2.0f / side;
+    for (int i = 0; i < count; i++)
+    {
+        const float u = (i % side + 0.5f) / side;
+        const float v = (i / side + 0.5f) / side;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(u * 2.0f - 1.0f, v * 2.0f - 1.0f, 0.0f));
+        model = glm::rotate(model, time * (1.0f + (i % 7) * 0.3f) + i, glm::vec3(0.0f, 0.0f, 1.0f));
+        model = glm::scale(model, glm::vec3(cell / 0.45f, cell / 0.45f, 1.0f));
+        instances[i].model = model;
+        instances[i].color = glm::vec3(0.2f + 0.4f * u, 0.2f + 0.4f * v, 0.5f);
+    }
+}
+
+struct Result
+{
+    double milliseconds;
+    double drawCalls;
+    double glCalls;
+};
+
+// average per frame; frame -1 warms up the driver and is not counted
+template <typename DrawFrame>
+Result measure(int frames, DrawFrame drawFrame)
+{
+    GLCallCounts calls = GLCallCounts();
+    std::chrono::steady_clock::time_point start;
+    for (int frame = -1; frame < frames; frame++)
+    {
+        if (frame == 0)
+        {
+            glFinish();
+            start = std::chrono::steady_clock::now();
+        }
+        resetGLCallCounts();
+        glClear(GL_COLOR_BUFFER_BIT);
+        drawFrame(frame / 60.0f);
+        if (frame >= 0)
+            calls += glCallCounts();
+    }
+    glFinish();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result result;
+    result.milliseconds = seconds * 1000.0 / frames;
+    result.drawCalls = static_cast<double>(calls.draws) / frames;
+    result.glCalls = static_cast<double>(calls.total()) / frames;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 20;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(window_width, window_height, "InstancingBenchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGL())
+    {
+        std::printf("Failed to initialize GLAD\n");
+        return -1;
+    }
+    std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    installGLCallCounter();
+
+    // a hidden window's own pixels may be skipped by the driver, draw into a renderbuffer
+    GLuint framebuffer, colorBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, window_width, window_height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glViewport(0, 0, window_width, window_height);
+    glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
+
+    ShaderProgram program(vertexShaderSource, fragmentShaderSource);
+    ShaderProgram instancedProgram(instancedVertexShaderSource, fragmentShaderSource);
+    const int modelLoc = program.uniform("model");
+    const int colorLoc = program.uniform("color");
+
+    // the Zadanie6 triangle
+    const GLfloat vertices[] = {
+         0.0f,  0.2f, 0.0f,
+        -0.2f,  0.0f, 0.0f,
+         0.2f,  0.0f, 0.0f
+    };
+    const GLuint indices[] = { 0, 1, 2 };
+
+    GLuint VAOs[2], VBO, EBO, instanceVBO;
+    glGenVertexArrays(2, VAOs);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instanceVBO);
+    // the element binding belongs to a VAO, upload the indices through GL_ARRAY_BUFFER
+    glBindBuffer(GL_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    for (GLuint VAO : VAOs)
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+    glBindVertexArray(VAOs[1]);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(1 + column);
+        glVertexAttribDivisor(1 + column, 1);
+    }
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color));
+    glEnableVertexAttribArray(5);
+    glVertexAttribDivisor(5, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::printf("%d frames, %ux%u\n", frames, window_width, window_height);
+    std::printf("%10s %10s %12s %12s %10s\n", "triangles", "mode", "draws/frame", "GL calls", "ms/frame");
+    for (int count : { 4, 100, 1000, 10000, 100000 })
+    {
+        std::vector<Instance> instances(count);
+        const size_t bytes = instances.size() * sizeof(Instance);
+
+        const Result separate = measure(frames, [&](float time) {
+            animateGrid(instances.data(), count, time);
+            program.use();
+            glBindVertexArray(VAOs[0]);
+            for (const Instance& instance : instances)
+            {
+                program.set(modelLoc, instance.model);
+                program.set(colorLoc, instance.color);
+                glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            }
+            glBindVertexArray(0);
+        });
+
+        const Result instanced = measure(frames, [&](float time) {
+            animateGrid(instances.data(), count, time);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            instancedProgram.use();
+            glBindVertexArray(VAOs[1]);
+            glDrawElementsInstanced(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0, count);
+            glBindVertexArray(0);
+        });
+
+        std::printf("%10d %10s %12.0f %12.0f %10.3f\n", count, "separate", separate.drawCalls, separate.glCalls, separate.milliseconds);
+        std::printf("%10d %10s %12.0f %12.0f %10.3f\n", count, "instanced", instanced.drawCalls, instanced.glCalls, instanced.milliseconds);
+    }
+
+    glDeleteVertexArrays(2, VAOs);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instanceVBO);
+    glDeleteProgram(program.id());
+    glDeleteProgram(instancedProgram.id());
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glfwTerminate();
+    return 0;
+}
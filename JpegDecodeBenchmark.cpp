@@ -0,0 +1,224 @@
+// Decoding speed of JPEGs with stb_image: first single-threaded with the scalar, SSE2 and AVX2
+// kernels (stbi_set_simd_limit), to RGB and RGBA, then with the best kernels on 1..N threads
+// (stbi_set_parallel_for_thread through setImageDecodePool), with restart markers (entropy decoding
+// split at the markers) and without (only the IDCT and the color conversion run in parallel).
+// The default test images are texture1.jpg, texture2.jpg and ones encoded with encodeJpeg of
+// TestImages.h: a synthetic photo-like picture at 4K and 8K, 4:2:0, quality 90, optimized Huffman
+// tables, optionally one restart interval per MCU row. Every result is compared byte for byte
+// with the scalar single-threaded decode. With more than one image, each kernel's throughput over
+// all of them follows, which is the number to read for a directory of real photos.
+// usage: JpegDecodeBenchmark [repeats] [files or directories...]
+//   files are decoded as they are instead of the default images, directories stand for their
+//   .jpg and .jpeg files, e.g. JpegDecodeBenchmark 5 photos
+// build with TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "StbImage.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // smooth shading, hard edges and some grain, so the entropy-coded data is about as dense as
+    // in a photograph
+    std::vector<unsigned char> makePicture(int width, int height)
+    {
+        std::vector<unsigned char> rgb(static_cast<size_t>(width) * height * 3);
+        unsigned seed = 12345;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const float u = static_cast<float>(x) / width, v = static_cast<float>(y) / height;
+                const float wave = std::sin(u * 40.0f + std::sin(v * 13.0f) * 3.0f) * std::cos(v * 27.0f - u * 5.0f);
+                const bool tile = ((x / 96) + (y / 80)) % 3 == 0;
+                seed = seed * 1664525u + 1013904223u;
+                const int grain = static_cast<int>(seed >> 27) - 16;
+                unsigned char* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+                const int base[3] = {
+                    static_cast<int>(120 + 90 * wave + 40 * u),
+                    static_cast<int>(110 + 60 * std::sin(v * 9.0f + wave)),
+                    static_cast<int>(tile ? 200 - 80 * v : 60 + 100 * u * v)
+                };
+                for (int c = 0; c < 3; c++)
+                    p[c] = static_cast<unsigned char>(std::min(255, std::max(0, base[c] + grain)));
+            }
+        }
+        return rgb;
+    }
+
+    // best of repeats, so one descheduled run does not count
+    double decodeSeconds(const TestImage& image, int repeats, int channels, const unsigned char* reference, size_t referenceBytes,
+        bool& identical)
+    {
+        double best = 1e30;
+        identical = true;
+        for (int r = 0; r < repeats; r++)
+        {
+            int width, height, components;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+                &components, channels);
+            best = std::min(best, secondsSince(start));
+            if (!pixels || (reference && std::memcmp(pixels, reference, referenceBytes) != 0))
+                identical = false;
+            stbi_image_free(pixels);
+        }
+        return best;
+    }
+
+    unsigned char* decodeReference(const TestImage& image, int channels)
+    {
+        int width, height, components;
+        setImageDecodePool(NULL);
+        stbi_set_simd_limit(STBI_SIMD_NONE);
+        unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+            &components, channels);
+        stbi_set_simd_limit(STBI_SIMD_AVX2);
+        return pixels;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++)
+        if (!listFiles(argv[i], { ".jpg", ".jpeg" }, paths))
+            paths.push_back(argv[i]);
+    if (argc <= 2)
+        paths = { "texture1.jpg", "texture2.jpg" };
+    std::vector<TestImage> images;
+    for (const std::string& path : paths)
+    {
+        TestImage image = { path, readFile(path) };
+        if (image.file.empty())
+            std::printf("%s: cannot be read\n", path.c_str());
+        else
+            images.push_back(image);
+    }
+    if (argc <= 2)
+    {
+        const int sizes[2][2] = { { 3840, 2160 }, { 7680, 4320 } };
+        for (const int* size : sizes)
+        {
+            std::printf("encoding %dx%d test images...\n", size[0], size[1]);
+            const std::vector<unsigned char> picture = makePicture(size[0], size[1]);
+            char name[64];
+            std::snprintf(name, sizeof(name), "%dx%d, no restarts", size[0], size[1]);
+            TestImage plain = { name, encodeJpeg(picture, size[0], size[1], 90, 0) };
+            std::snprintf(name, sizeof(name), "%dx%d, restart per MCU row", size[0], size[1]);
+            TestImage restarts = { name, encodeJpeg(picture, size[0], size[1], 90, (size[0] + 15) / 16) };
+            images.push_back(plain);
+            images.push_back(restarts);
+        }
+    }
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < cores; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+    if (cores == 1)
+        threadCounts.push_back(4);  // still shows that the split decodes are identical
+
+    const struct
+    {
+        const char* name;
+        int level;
+    } kernels[] = { { "scalar", STBI_SIMD_NONE }, { "SSE2", STBI_SIMD_SSE2 }, { "AVX2", STBI_SIMD_AVX2 } };
+
+    // every image decoded, by output (RGB, RGBA) and kernel
+    double totalSeconds[2][3] = {};
+    double totalMegabytes[2] = {};
+    bool allIdentical[2][3] = { { true, true, true }, { true, true, true } };
+    int decoded = 0;
+
+    std::printf("\nsingle thread, best of %d, MB/s of decoded pixels; the widest kernels the CPU lacks fall back\n", repeats);
+    std::printf("%34s %8s %8s %10s %10s %8s %10s\n", "image", "output", "kernels", "ms", "MB/s", "speedup", "identical");
+    for (const TestImage& image : images)
+    {
+        int width, height, components;
+        if (!stbi_info_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height, &components))
+        {
+            std::printf("%34s: %s\n", image.name.c_str(), stbi_failure_reason());
+            continue;
+        }
+        decoded++;
+        for (int channels = 3; channels <= 4; channels++)
+        {
+            const size_t bytes = static_cast<size_t>(width) * height * channels;
+            unsigned char* reference = decodeReference(image, channels);
+            double scalar = 0;
+            totalMegabytes[channels - 3] += bytes / (1024.0 * 1024.0);
+            for (int k = 0; k < 3; k++)
+            {
+                const auto& kernel = kernels[k];
+                bool identical;
+                stbi_set_simd_limit(kernel.level);
+                const double seconds = decodeSeconds(image, repeats, channels, reference, bytes, identical);
+                totalSeconds[channels - 3][k] += seconds;
+                allIdentical[channels - 3][k] = allIdentical[channels - 3][k] && identical;
+                if (kernel.level == STBI_SIMD_NONE)
+                    scalar = seconds;
+                std::printf("%34s %8s %8s %10.1f %10.1f %8.2f %10s\n", kernel.level == STBI_SIMD_NONE && channels == 3 ? image.name.c_str() : "",
+                    kernel.level == STBI_SIMD_NONE ? (channels == 3 ? "RGB" : "RGBA") : "", kernel.name, seconds * 1000.0,
+                    bytes / (1024.0 * 1024.0) / seconds, scalar / seconds, identical ? "yes" : "NO");
+            }
+            stbi_set_simd_limit(STBI_SIMD_AVX2);
+            stbi_image_free(reference);
+        }
+    }
+    if (decoded > 1)
+    {
+        char name[64];
+        std::snprintf(name, sizeof(name), "all %d images", decoded);
+        for (int output = 0; output < 2; output++)
+            for (int k = 0; k < 3; k++)
+                std::printf("%34s %8s %8s %10.1f %10.1f %8.2f %10s\n", output == 0 && k == 0 ? name : "",
+                    k == 0 ? (output == 0 ? "RGB" : "RGBA") : "", kernels[k].name, totalSeconds[output][k] * 1000.0,
+                    totalMegabytes[output] / totalSeconds[output][k], totalSeconds[output][0] / totalSeconds[output][k],
+                    allIdentical[output][k] ? "yes" : "NO");
+    }
+
+    std::printf("\n%u hardware threads, best kernels, best of %d, MB/s of decoded RGB\n", cores, repeats);
+    std::printf("%34s %8s %8s %10s %10s %8s %10s\n", "image", "file MB", "threads", "ms", "MB/s", "speedup", "identical");
+    for (const TestImage& image : images)
+    {
+        int width, height, components;
+        if (!stbi_info_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height, &components))
+            continue;
+        const size_t bytes = static_cast<size_t>(width) * height * 3;
+        const double megabytes = bytes / (1024.0 * 1024.0);
+
+        unsigned char* reference = decodeReference(image, 3);
+        if (!reference)
+            continue;
+        bool identical;
+        const double serial = decodeSeconds(image, repeats, 3, reference, bytes, identical);
+        std::printf("%34s %8.1f %8s %10.1f %10.1f %8.2f %10s\n", image.name.c_str(), image.file.size() / (1024.0 * 1024.0), "serial",
+            serial * 1000.0, megabytes / serial, 1.0, identical ? "yes" : "NO");
+
+        for (unsigned threads : threadCounts)
+        {
+            ThreadPool pool(threads);
+            setImageDecodePool(&pool);
+            const double seconds = decodeSeconds(image, repeats, 3, reference, bytes, identical);
+            setImageDecodePool(NULL);
+            std::printf("%34s %8s %8u %10.1f %10.1f %8.2f %10s\n", "", "", threads, seconds * 1000.0, megabytes / seconds,
+                serial / seconds, identical ? "yes" : "NO");
+        }
+        stbi_image_free(reference);
+    }
+    return 0;
+}
@@ -420,10 +420,32 @@ typedef struct
 STBIDEF stbi_uc *stbi_load_from_memory   (stbi_uc           const *buffer, int len   , int *x, int *y, int *channels_in_file, int desired_channels);
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk  , void *user, int *x, int *y, int *channels_in_file, int desired_channels);
 
+// decodes into the caller's out (out_size bytes, rows out_stride bytes apart, bytes between rows
+// are left alone) instead of a new allocation; desired_channels must be 1..4. Returns 1, or 0
+// with stbi_failure_reason() set, e.g. when the image does not fit. flip_vertically stores the
+// bottom row first and replaces stbi_set_flip_vertically_on_load for this call. Baseline and
+// progressive JPEG and 8-bit non-interlaced PNG without palette or tRNS are decoded straight
+// into out; other images are decoded as usual and copied, which saves nothing over stbi_load.
+// Use stbi_info_from_memory first to size out.
+STBIDEF int      stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *out, size_t out_size, int out_stride, int flip_vertically, int *x, int *y, int *channels_in_file, int desired_channels);
+
+// decodes a PNG or baseline JPEG from the top down a few rows at a time, so the image never has
+// to fit into memory whole. rows gets every batch: count rows from row y on, stride bytes apart,
+// 8 bits per channel (16-bit PNGs are scaled down like in stbi_load), only valid during the
+// call; returning 0 stops the decode. x, y and channels_in_file are set before the first batch.
+// JPEG batches are one MCU row (8 or 16 rows), PNG ones what the inflate window held, about
+// 256 KB. The flip setting is ignored. Returns 1, or 0 with stbi_failure_reason() set, which
+// includes progressive JPEG, interlaced PNG and other formats, as none of them decode in order.
+// PNG keeps its compressed data in memory, JPEG reads the input as it goes.
+typedef int stbi_rows_callback(void *user, int y, int count, const stbi_uc *pixels, int stride);
+STBIDEF int      stbi_load_rows_from_memory   (stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels, stbi_rows_callback *rows, void *user);
+STBIDEF int      stbi_load_rows_from_callbacks(stbi_io_callbacks const *clbk, void *clbk_user, int *x, int *y, int *channels_in_file, int desired_channels, stbi_rows_callback *rows, void *user);
+
 #ifndef STBI_NO_STDIO
 STBIDEF stbi_uc *stbi_load            (char const *filename, int *x, int *y, int *channels_in_file, int desired_channels);
 STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in_file, int desired_channels);
 // for stbi_load_from_file, file pointer is left pointing immediately after image
+STBIDEF int      stbi_load_rows       (char const *filename, int *x, int *y, int *channels_in_file, int desired_channels, stbi_rows_callback *rows, void *user);
 #endif
 
 #ifndef STBI_NO_GIF
@@ -521,6 +543,49 @@ STBIDEF void stbi_set_unpremultiply_on_load_thread(int flag_true_if_should_unpre
 STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// optional multithreaded decoding of large baseline JPEGs: parallel_for(user, count, job, context)
+// must call job(context, i) once for every i in [0, count), possibly concurrently on other
+// threads, and return when all of them have finished. max_jobs is the number of threads it runs
+// the calls on and sets how finely the work is split. Scans with restart intervals are entropy
+// decoded in parallel, one group of intervals per call; without them only the IDCT and the
+// color conversion are. Only images in memory are split; those read through callbacks
+// (stbi_load, stbi_load_from_file) are decoded on the calling thread. Set once before decoding,
+// NULL turns it off.
+typedef void stbi_parallel_job(void *context, int index);
+typedef void stbi_parallel_for(void *user, int count, stbi_parallel_job *job, void *context);
+STBIDEF void stbi_set_parallel_for(stbi_parallel_for *parallel_for, void *user, int max_jobs);
+// as above, but only for images decoded on the thread that calls it, e.g. by the workers of a
+// pool splitting their own images across that pool; NULL turns it off for the thread only.
+// Like the other _thread functions it needs thread-local variables.
+STBIDEF void stbi_set_parallel_for_thread(stbi_parallel_for *parallel_for, void *user, int max_jobs);
+
+// optional allocator for the JPEG and PNG decoders' temporaries (the decoder state, component
+// planes and coefficients, line buffers, compressed and inflated PNG data), e.g. an arena that is
+// reset between images. Images handed to the caller still come from STBI_MALLOC. Every
+// temporary is released on the thread that allocated it, the parallel JPEG jobs included, so
+// per-thread allocators need no locking. Set once before decoding, NULL goes back to STBI_MALLOC.
+typedef struct
+{
+   void *(*allocate)(void *user, size_t size);
+   void *(*reallocate)(void *user, void *p, size_t old_size, size_t new_size);
+   void  (*release)(void *user, void *p);
+   void *user;
+} stbi_scratch_allocator;
+STBIDEF void stbi_set_scratch_allocator(const stbi_scratch_allocator *allocator);
+// as above, but only for temporaries allocated on the calling thread; NULL makes the thread use
+// STBI_MALLOC whatever the global setting. Change it only while the thread is not decoding.
+STBIDEF void stbi_set_scratch_allocator_thread(const stbi_scratch_allocator *allocator);
+
+// the JPEG decoder uses the widest SIMD kernels the CPU has (SSE2 or NEON, and AVX2 found at
+// run time); this caps them, e.g. to compare them. All of them give the same pixels.
+enum
+{
+   STBI_SIMD_NONE = 0,
+   STBI_SIMD_SSE2 = 1, // or NEON
+   STBI_SIMD_AVX2 = 2
+};
+STBIDEF void stbi_set_simd_limit(int level);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -531,6 +596,12 @@ STBIDEF int   stbi_zlib_decode_buffer(char *obuffer, int olen, const char *ibuff
 STBIDEF char *stbi_zlib_decode_noheader_malloc(const char *buffer, int len, int *outlen);
 STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
 
+// inflate decodes the bulk of each block with a table-driven loop (64-bit bit buffer, up to two
+// literals per lookup, lengths and distances with their base and extra bits in the table entry,
+// matches copied 4 or 8 bytes at a time); 0 keeps it to the byte-at-a-time loop, e.g. to compare
+// them. Both give the same output.
+STBIDEF void  stbi_set_fast_inflate(int flag_true_if_should_use_fast_inflate);
+
 
 #ifdef __cplusplus
 }
@@ -635,17 +706,30 @@ STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const ch
    #endif
 #endif
 
+// the parallel JPEG jobs report a failure through a flag they share
+#if defined(__cplusplus) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700))
+   #include <atomic>
+   typedef std::atomic<int> stbi__atomic_int;
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+   #include <stdatomic.h>
+   typedef atomic_int stbi__atomic_int;
+#else
+   typedef volatile int stbi__atomic_int; // jobs only ever store 1, read after they all finished
+#endif
+
 #ifdef _MSC_VER
 typedef unsigned short stbi__uint16;
 typedef   signed short stbi__int16;
 typedef unsigned int   stbi__uint32;
 typedef   signed int   stbi__int32;
+typedef unsigned __int64 stbi__uint64;
 #else
 #include <stdint.h>
 typedef uint16_t stbi__uint16;
 typedef int16_t  stbi__int16;
 typedef uint32_t stbi__uint32;
 typedef int32_t  stbi__int32;
+typedef uint64_t stbi__uint64;
 #endif
 
 // should produce compiler error if size is wrong
@@ -771,6 +855,36 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels are compiled for their own functions only and picked when the CPU and the OS
+// support them, so no compiler flags are needed. Define STBI_NO_AVX2 to leave them out.
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG)
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+#define STBI_AVX2
+#define STBI__AVX2_TARGET
+#include <immintrin.h>
+static int stbi__avx2_available(void)
+{
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7) return 0;
+   __cpuid(info,1);
+   // AVX and OSXSAVE, and the OS saves the ymm registers
+   if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return (info[1] >> 5) & 1;
+}
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define STBI_AVX2
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+static int stbi__avx2_available(void)
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -814,17 +928,53 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   // stbi_load_from_memory_into: row 0 of the caller's image, dest_stride is negative when
+   // flipped; decoders that can write there ask stbi__dest_rows
+   stbi_uc *dest;
+   ptrdiff_t dest_stride;
+   stbi__uint32 dest_x, dest_y;
+   int dest_n;
 } stbi__context;
 
 
 static void stbi__refill_buffer(stbi__context *s);
 
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+// the caller's rows for an n-channel 8-bit image of the size being decoded, NULL to allocate
+static stbi_uc *stbi__dest_rows(stbi__context *s, int n)
+{
+   if (s->dest && s->img_x == s->dest_x && s->img_y == s->dest_y && n == s->dest_n)
+      return s->dest;
+   return NULL;
+}
+
+// stbi_load_rows_*: where the decoded rows go
+typedef struct
+{
+   stbi_rows_callback *callback;
+   void *user;
+   int next;                     // first row of the next batch
+   int *out_x, *out_y, *out_comp;
+} stbi__rows;
+
+// hands the caller the size before the first batch
+static void stbi__rows_start(stbi__rows *r, int x, int y, int comp)
+{
+   if (r->out_x) *r->out_x = x;
+   if (r->out_y) *r->out_y = y;
+   if (r->out_comp) *r->out_comp = comp;
+}
+
+#endif
+
 // initialize a memory-decode context
 static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
 {
    s->io.read = NULL;
    s->read_from_callbacks = 0;
    s->callback_already_read = 0;
+   s->dest = NULL;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
 }
@@ -837,6 +987,7 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->buflen = sizeof(s->buffer_start);
    s->read_from_callbacks = 1;
    s->callback_already_read = 0;
+   s->dest = NULL;
    s->img_buffer = s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
@@ -904,12 +1055,14 @@ typedef struct
 
 #ifndef STBI_NO_JPEG
 static int      stbi__jpeg_test(stbi__context *s);
+static int      stbi__jpeg_load_rows(stbi__context *s, int req_comp, stbi__rows *rows);
 static void    *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri);
 static int      stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp);
 #endif
 
 #ifndef STBI_NO_PNG
 static int      stbi__png_test(stbi__context *s);
+static int      stbi__png_load_rows(stbi__context *s, int req_comp, stbi__rows *rows);
 static void    *stbi__png_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri);
 static int      stbi__png_info(stbi__context *s, int *x, int *y, int *comp);
 static int      stbi__png_is16(stbi__context *s);
@@ -984,6 +1137,64 @@ static void *stbi__malloc(size_t size)
     return STBI_MALLOC(size);
 }
 
+static stbi_scratch_allocator stbi__scratch_global; // allocate == NULL: STBI_MALLOC
+
+STBIDEF void stbi_set_scratch_allocator(const stbi_scratch_allocator *allocator)
+{
+   if (allocator)
+      stbi__scratch_global = *allocator;
+   else
+      memset(&stbi__scratch_global, 0, sizeof(stbi__scratch_global));
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__scratch  stbi__scratch_global
+#else
+static STBI_THREAD_LOCAL stbi_scratch_allocator stbi__scratch_local;
+static STBI_THREAD_LOCAL int stbi__scratch_set;
+
+STBIDEF void stbi_set_scratch_allocator_thread(const stbi_scratch_allocator *allocator)
+{
+   if (allocator)
+      stbi__scratch_local = *allocator;
+   else
+      memset(&stbi__scratch_local, 0, sizeof(stbi__scratch_local));
+   stbi__scratch_set = 1;
+}
+
+#define stbi__scratch  (stbi__scratch_set ? stbi__scratch_local : stbi__scratch_global)
+#endif // STBI_THREAD_LOCAL
+
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+// temporaries that never leave the decoder, see stbi_set_scratch_allocator
+static void *stbi__scratch_malloc(size_t size)
+{
+   if (stbi__scratch.allocate)
+      return stbi__scratch.allocate(stbi__scratch.user, size);
+   return STBI_MALLOC(size);
+}
+
+static void stbi__scratch_free(void *p)
+{
+   if (!p)
+      return;
+   if (stbi__scratch.allocate)
+      stbi__scratch.release(stbi__scratch.user, p);
+   else
+      STBI_FREE(p);
+}
+#endif
+
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_ZLIB)
+static void *stbi__scratch_realloc(void *p, size_t old_size, size_t new_size)
+{
+   if (stbi__scratch.allocate)
+      return stbi__scratch.reallocate(stbi__scratch.user, p, old_size, new_size);
+   STBI_NOTUSED(old_size);
+   return STBI_REALLOC_SIZED(p, old_size, new_size);
+}
+#endif
+
 // stb_image uses ints pervasively, including for offset calculations.
 // therefore the largest decoded image size we can support with the
 // current code, even on 64-bit targets, is INT_MAX. this is not a
@@ -1063,6 +1274,20 @@ static void *stbi__malloc_mad4(int a, int b, int c, int d, int add)
 }
 #endif
 
+#ifndef STBI_NO_JPEG
+static void *stbi__scratch_malloc_mad2(int a, int b, int add)
+{
+   if (!stbi__mad2sizes_valid(a, b, add)) return NULL;
+   return stbi__scratch_malloc(a*b + add);
+}
+
+static void *stbi__scratch_malloc_mad3(int a, int b, int c, int add)
+{
+   if (!stbi__mad3sizes_valid(a, b, c, add)) return NULL;
+   return stbi__scratch_malloc(a*b*c + add);
+}
+#endif
+
 // stbi__err - error
 // stbi__errpf - error returning pointer to float
 // stbi__errpuc - error returning pointer to unsigned char
@@ -1078,6 +1303,17 @@ static void *stbi__malloc_mad4(int a, int b, int c, int d, int add)
 #define stbi__errpf(x,y)   ((float *)(size_t) (stbi__err(x,y)?NULL:NULL))
 #define stbi__errpuc(x,y)  ((unsigned char *)(size_t) (stbi__err(x,y)?NULL:NULL))
 
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+// hands the callback count rows from pixels, fails when it asks to stop
+static int stbi__rows_emit(stbi__rows *r, const stbi_uc *pixels, int count, int stride)
+{
+   if (!r->callback(r->user, r->next, count, pixels, stride))
+      return stbi__err("stopped", "Stopped by the rows callback");
+   r->next += count;
+   return 1;
+}
+#endif
+
 STBIDEF void stbi_image_free(void *retval_from_stbi_load)
 {
    STBI_FREE(retval_from_stbi_load);
@@ -1114,6 +1350,68 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+static int stbi__simd_limit = STBI_SIMD_AVX2;
+
+STBIDEF void stbi_set_simd_limit(int level)
+{
+   stbi__simd_limit = level;
+}
+
+typedef struct
+{
+   stbi_parallel_for *run;
+   void *user;
+   int jobs;
+} stbi__parallel_setting;
+
+static stbi__parallel_setting stbi__parallel_global = { NULL, NULL, 1 };
+
+STBIDEF void stbi_set_parallel_for(stbi_parallel_for *parallel_for, void *user, int max_jobs)
+{
+   stbi__parallel_global.run = parallel_for;
+   stbi__parallel_global.user = user;
+   stbi__parallel_global.jobs = max_jobs < 1 ? 1 : max_jobs;
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__parallel  stbi__parallel_global
+#else
+static STBI_THREAD_LOCAL stbi__parallel_setting stbi__parallel_local;
+static STBI_THREAD_LOCAL int stbi__parallel_set;
+
+STBIDEF void stbi_set_parallel_for_thread(stbi_parallel_for *parallel_for, void *user, int max_jobs)
+{
+   stbi__parallel_local.run = parallel_for;
+   stbi__parallel_local.user = user;
+   stbi__parallel_local.jobs = max_jobs < 1 ? 1 : max_jobs;
+   stbi__parallel_set = 1;
+}
+
+#define stbi__parallel  (stbi__parallel_set ? stbi__parallel_local : stbi__parallel_global)
+#endif // STBI_THREAD_LOCAL
+
+#ifndef STBI_NO_JPEG
+// smaller images are decoded on the calling thread, splitting them costs more than it gains
+#ifndef STBI_PARALLEL_MIN_PIXELS
+#define STBI_PARALLEL_MIN_PIXELS  (1 << 19)
+#endif
+
+static int stbi__parallel_worthwhile(stbi__uint32 w, stbi__uint32 h)
+{
+   return stbi__parallel.run && stbi__parallel.jobs > 1 && (double) w * h >= STBI_PARALLEL_MIN_PIXELS;
+}
+
+static void stbi__parallel_run(int count, stbi_parallel_job *job, void *context)
+{
+   int i;
+   if (count > 1 && stbi__parallel.run)
+      stbi__parallel.run(stbi__parallel.user, count, job, context);
+   else
+      for (i=0; i < count; ++i)
+         job(context, i);
+}
+#endif
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1420,6 +1718,102 @@ STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *u
    return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
 }
 
+static int stbi__info_main(stbi__context *s, int *x, int *y, int *comp);
+
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *out, size_t out_size, int out_stride, int flip_vertically, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__context s;
+   stbi__result_info ri;
+   stbi_uc *result;
+   size_t row_bytes;
+   int w, h, j;
+
+   if (req_comp < 1 || req_comp > 4) return stbi__err("bad req_comp", "Internal error");
+   stbi__start_mem(&s,buffer,len);
+   if (!stbi__info_main(&s, &w, &h, NULL)) return 0;
+   stbi__rewind(&s);
+   row_bytes = (size_t) w * req_comp;
+   if (out_stride < 0 || (size_t) out_stride < row_bytes) return stbi__err("bad stride", "Row stride is smaller than a row");
+   if (out_size < row_bytes || (size_t) (h-1) > (out_size - row_bytes) / (size_t) out_stride)
+      return stbi__err("too small", "Output buffer is too small for the image");
+
+   s.dest_x = w;
+   s.dest_y = h;
+   s.dest_n = req_comp;
+   s.dest_stride = flip_vertically ? -(ptrdiff_t) out_stride : out_stride;
+   s.dest = flip_vertically ? out + (ptrdiff_t) out_stride * (h-1) : out;
+
+   result = (stbi_uc *) stbi__load_main(&s, x, y, comp, req_comp, &ri, 8);
+   if (result == NULL) return 0;
+   if (result == s.dest) return 1;
+
+   // decoded into its own buffer: copy it over, as long as it has the size out was checked for
+   if (*x != w || *y != h) {
+      STBI_FREE(result);
+      return stbi__err("bad size", "Image size changed while loading");
+   }
+   if (ri.bits_per_channel != 8) {
+      result = stbi__convert_16_to_8((stbi__uint16 *) result, w, h, req_comp);
+      if (result == NULL) return 0;
+   }
+   for (j=0; j < h; ++j)
+      memcpy(s.dest + s.dest_stride * j, result + row_bytes * j, row_bytes);
+   STBI_FREE(result);
+   return 1;
+}
+
+static int stbi__load_rows_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi_rows_callback *callback, void *user)
+{
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+   stbi__rows rows;
+   if (req_comp < 0 || req_comp > 4) return stbi__err("bad req_comp", "Internal error");
+   rows.callback = callback;
+   rows.user = user;
+   rows.next = 0;
+   rows.out_x = x;
+   rows.out_y = y;
+   rows.out_comp = comp;
+   #ifndef STBI_NO_JPEG
+   if (stbi__jpeg_test(s)) return stbi__jpeg_load_rows(s, req_comp, &rows);
+   #endif
+   #ifndef STBI_NO_PNG
+   if (stbi__png_test(s))  return stbi__png_load_rows(s, req_comp, &rows);
+   #endif
+#else
+   STBI_NOTUSED(s); STBI_NOTUSED(x); STBI_NOTUSED(y); STBI_NOTUSED(comp);
+   STBI_NOTUSED(req_comp); STBI_NOTUSED(callback); STBI_NOTUSED(user);
+#endif
+   return stbi__err("unknown image type", "Image not PNG or JPEG, or corrupt");
+}
+
+STBIDEF int stbi_load_rows_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, stbi_rows_callback *rows, void *user)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__load_rows_main(&s, x, y, comp, req_comp, rows, user);
+}
+
+STBIDEF int stbi_load_rows_from_callbacks(stbi_io_callbacks const *clbk, void *clbk_user, int *x, int *y, int *comp, int req_comp, stbi_rows_callback *rows, void *user)
+{
+   stbi__context s;
+   stbi__start_callbacks(&s, (stbi_io_callbacks *) clbk, clbk_user);
+   return stbi__load_rows_main(&s, x, y, comp, req_comp, rows, user);
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_rows(char const *filename, int *x, int *y, int *comp, int req_comp, stbi_rows_callback *rows, void *user)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   stbi__context s;
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   stbi__start_file(&s, f);
+   result = stbi__load_rows_main(&s, x, y, comp, req_comp, rows, user);
+   fclose(f);
+   return result;
+}
+#endif
+
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp)
 {
@@ -1571,7 +1965,8 @@ enum
 {
    STBI__SCAN_load=0,
    STBI__SCAN_type,
-   STBI__SCAN_header
+   STBI__SCAN_header,
+   STBI__SCAN_rows    // JPEG: like load, with planes of two MCU rows (stbi_load_rows)
 };
 
 static void stbi__refill_buffer(stbi__context *s)
@@ -2670,84 +3065,241 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
-#ifdef STBI_NEON
-
-// NEON integer IDCT. should produce bit-identical
-// results to the generic C version.
-static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
+#ifdef STBI_AVX2
+// avx2 version of stbi__idct_simd: the same arithmetic, so again bit-identical to the generic
+// C version, but each 32-bit intermediate row is one ymm register instead of an _l/_h pair
+STBI__AVX2_TARGET
+static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[64])
 {
-   int16x8_t row0, row1, row2, row3, row4, row5, row6, row7;
+   __m128i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m128i tmp;
 
-   int16x4_t rot0_0 = vdup_n_s16(stbi__f2f(0.5411961f));
-   int16x4_t rot0_1 = vdup_n_s16(stbi__f2f(-1.847759065f));
-   int16x4_t rot0_2 = vdup_n_s16(stbi__f2f( 0.765366865f));
-   int16x4_t rot1_0 = vdup_n_s16(stbi__f2f( 1.175875602f));
-   int16x4_t rot1_1 = vdup_n_s16(stbi__f2f(-0.899976223f));
-   int16x4_t rot1_2 = vdup_n_s16(stbi__f2f(-2.562915447f));
-   int16x4_t rot2_0 = vdup_n_s16(stbi__f2f(-1.961570560f));
-   int16x4_t rot2_1 = vdup_n_s16(stbi__f2f(-0.390180644f));
-   int16x4_t rot3_0 = vdup_n_s16(stbi__f2f( 0.298631336f));
-   int16x4_t rot3_1 = vdup_n_s16(stbi__f2f( 2.053119869f));
-   int16x4_t rot3_2 = vdup_n_s16(stbi__f2f( 3.072711026f));
-   int16x4_t rot3_3 = vdup_n_s16(stbi__f2f( 1.501321110f));
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_set1_epi32((int) (((unsigned int) (y) << 16) | ((x) & 0xffff)))
 
-#define dct_long_mul(out, inq, coeff) \
-   int32x4_t out##_l = vmull_s16(vget_low_s16(inq), coeff); \
-   int32x4_t out##_h = vmull_s16(vget_high_s16(inq), coeff)
+   // out0 = c0[even]*x + c0[odd]*y, out1 likewise with c1 (x, y 16-bit, out 32-bit)
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##xy = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16((x),(y))), _mm_unpackhi_epi16((x),(y)), 1); \
+      __m256i out0 = _mm256_madd_epi16(c0##xy, c0); \
+      __m256i out1 = _mm256_madd_epi16(c0##xy, c1)
 
-#define dct_long_mac(out, acc, inq, coeff) \
-   int32x4_t out##_l = vmlal_s16(acc##_l, vget_low_s16(inq), coeff); \
-   int32x4_t out##_h = vmlal_s16(acc##_h, vget_high_s16(inq), coeff)
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out = _mm256_slli_epi32(_mm256_cvtepi16_epi32(in), 12)
 
-#define dct_widen(out, inq) \
-   int32x4_t out##_l = vshll_n_s16(vget_low_s16(inq), 12); \
-   int32x4_t out##_h = vshll_n_s16(vget_high_s16(inq), 12)
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased = _mm256_add_epi32(a, bias); \
+         __m256i sum = _mm256_srai_epi32(_mm256_add_epi32(abiased, b), s); \
+         __m256i dif = _mm256_srai_epi32(_mm256_sub_epi32(abiased, b), s); \
+         out0 = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)); \
+         out1 = _mm_packs_epi32(_mm256_castsi256_si128(dif), _mm256_extracti128_si256(dif, 1)); \
+      }
 
-// wide add
-#define dct_wadd(out, a, b) \
-   int32x4_t out##_l = vaddq_s32(a##_l, b##_l); \
-   int32x4_t out##_h = vaddq_s32(a##_h, b##_h)
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi8(a, b); \
+      b = _mm_unpackhi_epi8(tmp, b)
 
-// wide sub
-#define dct_wsub(out, a, b) \
-   int32x4_t out##_l = vsubq_s32(a##_l, b##_l); \
-   int32x4_t out##_h = vsubq_s32(a##_h, b##_h)
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi16(a, b); \
+      b = _mm_unpackhi_epi16(tmp, b)
 
-// butterfly a/b, then shift using "shiftop" by "s" and pack
-#define dct_bfly32o(out0,out1, a,b,shiftop,s) \
-   { \
-      dct_wadd(sum, a, b); \
-      dct_wsub(dif, a, b); \
-      out0 = vcombine_s16(shiftop(sum_l, s), shiftop(sum_h, s)); \
-      out1 = vcombine_s16(shiftop(dif_l, s), shiftop(dif_h, s)); \
-   }
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m128i sum04 = _mm_add_epi16(row0, row4); \
+         __m128i dif04 = _mm_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         __m256i x0 = _mm256_add_epi32(t0e, t3e); \
+         __m256i x3 = _mm256_sub_epi32(t0e, t3e); \
+         __m256i x1 = _mm256_add_epi32(t1e, t2e); \
+         __m256i x2 = _mm256_sub_epi32(t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m128i sum17 = _mm_add_epi16(row1, row7); \
+         __m128i sum35 = _mm_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         __m256i x4 = _mm256_add_epi32(y0o, y4o); \
+         __m256i x5 = _mm256_add_epi32(y1o, y5o); \
+         __m256i x6 = _mm256_add_epi32(y2o, y5o); \
+         __m256i x7 = _mm256_add_epi32(y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
 
-#define dct_pass(shiftop, shift) \
-   { \
-      /* even part */ \
-      int16x8_t sum26 = vaddq_s16(row2, row6); \
-      dct_long_mul(p1e, sum26, rot0_0); \
-      dct_long_mac(t2e, p1e, row6, rot0_1); \
-      dct_long_mac(t3e, p1e, row2, rot0_2); \
-      int16x8_t sum04 = vaddq_s16(row0, row4); \
-      int16x8_t dif04 = vsubq_s16(row0, row4); \
-      dct_widen(t0e, sum04); \
-      dct_widen(t1e, dif04); \
-      dct_wadd(x0, t0e, t3e); \
-      dct_wsub(x3, t0e, t3e); \
-      dct_wadd(x1, t1e, t2e); \
-      dct_wsub(x2, t1e, t2e); \
-      /* odd part */ \
-      int16x8_t sum15 = vaddq_s16(row1, row5); \
-      int16x8_t sum17 = vaddq_s16(row1, row7); \
-      int16x8_t sum35 = vaddq_s16(row3, row5); \
-      int16x8_t sum37 = vaddq_s16(row3, row7); \
-      int16x8_t sumodd = vaddq_s16(sum17, sum35); \
-      dct_long_mul(p5o, sumodd, rot1_0); \
-      dct_long_mac(p1o, p5o, sum17, rot1_1); \
-      dct_long_mac(p2o, p5o, sum35, rot1_2); \
-      dct_long_mul(p3o, sum37, rot2_0); \
-      dct_long_mul(p4o, sum15, rot2_1); \
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = _mm_load_si128((const __m128i *) (data + 0*8));
+   row1 = _mm_load_si128((const __m128i *) (data + 1*8));
+   row2 = _mm_load_si128((const __m128i *) (data + 2*8));
+   row3 = _mm_load_si128((const __m128i *) (data + 3*8));
+   row4 = _mm_load_si128((const __m128i *) (data + 4*8));
+   row5 = _mm_load_si128((const __m128i *) (data + 5*8));
+   row6 = _mm_load_si128((const __m128i *) (data + 6*8));
+   row7 = _mm_load_si128((const __m128i *) (data + 7*8));
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m128i p0 = _mm_packus_epi16(row0, row1);
+      __m128i p1 = _mm_packus_epi16(row2, row3);
+      __m128i p2 = _mm_packus_epi16(row4, row5);
+      __m128i p3 = _mm_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose
+      dct_interleave8(p0, p2);
+      dct_interleave8(p1, p3);
+
+      dct_interleave8(p0, p1);
+      dct_interleave8(p2, p3);
+
+      dct_interleave8(p0, p2);
+      dct_interleave8(p1, p3);
+
+      // store
+      _mm_storel_epi64((__m128i *) out, p0); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p2); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p2, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p1); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p1, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p3); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p3, 0x4e));
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+}
+#endif // STBI_AVX2
+
+#ifdef STBI_NEON
+
+// NEON integer IDCT. should produce bit-identical
+// results to the generic C version.
+static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
+{
+   int16x8_t row0, row1, row2, row3, row4, row5, row6, row7;
+
+   int16x4_t rot0_0 = vdup_n_s16(stbi__f2f(0.5411961f));
+   int16x4_t rot0_1 = vdup_n_s16(stbi__f2f(-1.847759065f));
+   int16x4_t rot0_2 = vdup_n_s16(stbi__f2f( 0.765366865f));
+   int16x4_t rot1_0 = vdup_n_s16(stbi__f2f( 1.175875602f));
+   int16x4_t rot1_1 = vdup_n_s16(stbi__f2f(-0.899976223f));
+   int16x4_t rot1_2 = vdup_n_s16(stbi__f2f(-2.562915447f));
+   int16x4_t rot2_0 = vdup_n_s16(stbi__f2f(-1.961570560f));
+   int16x4_t rot2_1 = vdup_n_s16(stbi__f2f(-0.390180644f));
+   int16x4_t rot3_0 = vdup_n_s16(stbi__f2f( 0.298631336f));
+   int16x4_t rot3_1 = vdup_n_s16(stbi__f2f( 2.053119869f));
+   int16x4_t rot3_2 = vdup_n_s16(stbi__f2f( 3.072711026f));
+   int16x4_t rot3_3 = vdup_n_s16(stbi__f2f( 1.501321110f));
+
+#define dct_long_mul(out, inq, coeff) \
+   int32x4_t out##_l = vmull_s16(vget_low_s16(inq), coeff); \
+   int32x4_t out##_h = vmull_s16(vget_high_s16(inq), coeff)
+
+#define dct_long_mac(out, acc, inq, coeff) \
+   int32x4_t out##_l = vmlal_s16(acc##_l, vget_low_s16(inq), coeff); \
+   int32x4_t out##_h = vmlal_s16(acc##_h, vget_high_s16(inq), coeff)
+
+#define dct_widen(out, inq) \
+   int32x4_t out##_l = vshll_n_s16(vget_low_s16(inq), 12); \
+   int32x4_t out##_h = vshll_n_s16(vget_high_s16(inq), 12)
+
+// wide add
+#define dct_wadd(out, a, b) \
+   int32x4_t out##_l = vaddq_s32(a##_l, b##_l); \
+   int32x4_t out##_h = vaddq_s32(a##_h, b##_h)
+
+// wide sub
+#define dct_wsub(out, a, b) \
+   int32x4_t out##_l = vsubq_s32(a##_l, b##_l); \
+   int32x4_t out##_h = vsubq_s32(a##_h, b##_h)
+
+// butterfly a/b, then shift using "shiftop" by "s" and pack
+#define dct_bfly32o(out0,out1, a,b,shiftop,s) \
+   { \
+      dct_wadd(sum, a, b); \
+      dct_wsub(dif, a, b); \
+      out0 = vcombine_s16(shiftop(sum_l, s), shiftop(sum_h, s)); \
+      out1 = vcombine_s16(shiftop(dif_l, s), shiftop(dif_h, s)); \
+   }
+
+#define dct_pass(shiftop, shift) \
+   { \
+      /* even part */ \
+      int16x8_t sum26 = vaddq_s16(row2, row6); \
+      dct_long_mul(p1e, sum26, rot0_0); \
+      dct_long_mac(t2e, p1e, row6, rot0_1); \
+      dct_long_mac(t3e, p1e, row2, rot0_2); \
+      int16x8_t sum04 = vaddq_s16(row0, row4); \
+      int16x8_t dif04 = vsubq_s16(row0, row4); \
+      dct_widen(t0e, sum04); \
+      dct_widen(t1e, dif04); \
+      dct_wadd(x0, t0e, t3e); \
+      dct_wsub(x3, t0e, t3e); \
+      dct_wadd(x1, t1e, t2e); \
+      dct_wsub(x2, t1e, t2e); \
+      /* odd part */ \
+      int16x8_t sum15 = vaddq_s16(row1, row5); \
+      int16x8_t sum17 = vaddq_s16(row1, row7); \
+      int16x8_t sum35 = vaddq_s16(row3, row5); \
+      int16x8_t sum37 = vaddq_s16(row3, row7); \
+      int16x8_t sumodd = vaddq_s16(sum17, sum35); \
+      dct_long_mul(p5o, sumodd, rot1_0); \
+      dct_long_mac(p1o, p5o, sum17, rot1_1); \
+      dct_long_mac(p2o, p5o, sum35, rot1_2); \
+      dct_long_mul(p3o, sum37, rot2_0); \
+      dct_long_mul(p4o, sum15, rot2_1); \
       dct_wadd(sump13o, p1o, p3o); \
       dct_wadd(sump24o, p2o, p4o); \
       dct_wadd(sump23o, p2o, p3o); \
@@ -2912,10 +3464,231 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// multithreaded baseline scans (see stbi_set_parallel_for); a unit is one MCU of an interleaved
+// scan or one block of a single component scan, the thing a restart interval counts
+
+static int stbi__min(int a, int b)
+{
+   return a < b ? a : b;
+}
+
+static void stbi__jpeg_scan_units(stbi__jpeg *z, int *units_x, int *units_y)
+{
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      *units_x = (z->img_comp[n].x+7) >> 3;
+      *units_y = (z->img_comp[n].y+7) >> 3;
+   } else {
+      *units_x = z->img_mcu_x;
+      *units_y = z->img_mcu_y;
+   }
+}
+
+// block row of component n holding the first blocks of unit row j
+static int stbi__jpeg_unit_block_row(stbi__jpeg *z, int n, int j)
+{
+   return z->scan_n == 1 ? j : j * z->img_comp[n].v;
+}
+
+// decodes unit (i,j); without coeff its blocks go through the idct into the planes straight away,
+// otherwise their dequantized coefficients are kept in coeff[n]. The first block row of either is
+// unit row first_row
+static int stbi__jpeg_decode_unit(stbi__jpeg *z, int i, int j, short **coeff, int first_row)
+{
+   STBI_SIMD_ALIGN(short, data[64]);
+   int k,x,y;
+   for (k=0; k < z->scan_n; ++k) {
+      int n = z->order[k];
+      int h = z->scan_n == 1 ? 1 : z->img_comp[n].h;
+      int v = z->scan_n == 1 ? 1 : z->img_comp[n].v;
+      int ha = z->img_comp[n].ha;
+      for (y=0; y < v; ++y) {
+         for (x=0; x < h; ++x) {
+            int x2 = i*h + x;
+            int y2 = (j - first_row)*v + y;
+            short *out = coeff ? coeff[n] + 64 * (x2 + y2 * z->img_comp[n].coeff_w) : data;
+            if (!stbi__jpeg_decode_block(z, out, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            if (!coeff)
+               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2*8+x2*8, z->img_comp[n].w2, data);
+         }
+      }
+   }
+   return 1;
+}
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **segment;      // entropy-coded data of restart interval s, without its marker,
+   stbi_uc **segment_end;  // is [segment[s], segment_end[s])
+   int segments, per_job;
+   int units_x, units;
+   stbi__atomic_int failed;
+} stbi__jpeg_restart_work;
+
+static void stbi__jpeg_restart_job(void *context, int index)
+{
+   stbi__jpeg_restart_work *w = (stbi__jpeg_restart_work *) context;
+   stbi__context s;
+   stbi__jpeg *z;
+   int seg, first = index * w->per_job;
+   int last = stbi__min(first + w->per_job, w->segments);
+
+   // every job runs its own copy of the decoder over its own part of the data
+   z = (stbi__jpeg *) stbi__scratch_malloc(sizeof(stbi__jpeg));
+   if (!z) { w->failed = 1; return; }
+   memcpy(z, w->z, sizeof(stbi__jpeg));
+   z->s = &s;
+   for (seg=first; seg < last; ++seg) {
+      int u = seg * z->restart_interval;
+      int end = stbi__min(u + z->restart_interval, w->units);
+      stbi__start_mem(&s, w->segment[seg], (int) (w->segment_end[seg] - w->segment[seg]));
+      stbi__jpeg_reset(z);
+      for (; u < end; ++u) {
+         if (!stbi__jpeg_decode_unit(z, u % w->units_x, u / w->units_x, NULL, 0)) {
+            w->failed = 1;
+            break;
+         }
+      }
+   }
+   stbi__scratch_free(z);
+}
+
+// splits the scan at its restart markers and decodes groups of intervals in parallel;
+// returns -1 when the data does not hold the expected number of intervals
+static int stbi__jpeg_decode_restarts_parallel(stbi__jpeg *z)
+{
+   stbi__jpeg_restart_work w;
+   stbi_uc *p = z->s->img_buffer, *end = z->s->img_buffer_end, *stop = end;
+   int units_y, found = 1, jobs;
+
+   stbi__jpeg_scan_units(z, &w.units_x, &units_y);
+   w.z = z;
+   w.units = w.units_x * units_y;
+   w.segments = (w.units + z->restart_interval - 1) / z->restart_interval;
+   w.failed = 0;
+   w.segment = (stbi_uc **) stbi__scratch_malloc_mad2(w.segments, 2 * sizeof(stbi_uc *), 0);
+   if (!w.segment) return stbi__err("outofmem", "Out of memory");
+   w.segment_end = w.segment + w.segments;
+
+   w.segment[0] = p;
+   while (p < end) {
+      stbi_uc *q;
+      p = (stbi_uc *) memchr(p, 0xff, end - p);
+      if (!p) { p = end; break; }
+      q = p + 1;
+      while (q < end && *q == 0xff) ++q; // fill bytes
+      if (q == end) { p = end; break; }
+      if (*q == 0) { p = q + 1; continue; } // stuffed 0xff data byte
+      if (STBI__RESTART(*q) && found < w.segments) {
+         w.segment_end[found-1] = p;
+         w.segment[found++] = q + 1;
+         p = q + 1;
+         continue;
+      }
+      stop = q - 1; // the marker ending the scan, left for stbi__decode_jpeg_image
+      break;
+   }
+   if (found != w.segments) {
+      stbi__scratch_free(w.segment);
+      return -1;
+   }
+   w.segment_end[found-1] = p;
+
+   // a few groups per thread, so uneven intervals even out
+   jobs = stbi__min(w.segments, stbi__parallel.jobs * 4);
+   w.per_job = (w.segments + jobs - 1) / jobs;
+   jobs = (w.segments + w.per_job - 1) / w.per_job;
+   stbi__parallel_run(jobs, stbi__jpeg_restart_job, &w);
+   stbi__scratch_free(w.segment);
+   if (w.failed) return stbi__err("bad huffman code", "Corrupt JPEG");
+
+   z->s->img_buffer = stop;
+   z->marker = STBI__MARKER_none;
+   return 1;
+}
+
+typedef struct
+{
+   stbi__jpeg *z;
+   short *coeff[4];
+   int first_row;
+} stbi__jpeg_idct_work;
+
+static void stbi__jpeg_idct_job(void *context, int index)
+{
+   stbi__jpeg_idct_work *w = (stbi__jpeg_idct_work *) context;
+   stbi__jpeg *z = w->z;
+   int j = w->first_row + index;
+   int i,k,y;
+   for (k=0; k < z->scan_n; ++k) {
+      int n = z->order[k];
+      int v = z->scan_n == 1 ? 1 : z->img_comp[n].v;
+      int blocks = z->scan_n == 1 ? (z->img_comp[n].x+7) >> 3 : z->img_mcu_x * z->img_comp[n].h;
+      for (y=0; y < v; ++y) {
+         int y2 = j*v + y;
+         short *data = w->coeff[n] + 64 * (index*v + y) * z->img_comp[n].coeff_w;
+         for (i=0; i < blocks; ++i)
+            z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2*8+i*8, z->img_comp[n].w2, data + 64*i);
+      }
+   }
+}
+
+// without restart markers the entropy decoding has to stay serial: it fills a band of unit rows
+// with coefficients, whose idct then runs one unit row per job
+static int stbi__jpeg_decode_idct_parallel(stbi__jpeg *z)
+{
+   stbi__jpeg_idct_work w;
+   int units_x, units_y, band, i, j, k;
+   size_t offset[4], total = 0;
+   void *raw;
+
+   stbi__jpeg_scan_units(z, &units_x, &units_y);
+   band = stbi__min(units_y, stbi__parallel.jobs * 2);
+   for (k=0; k < z->scan_n; ++k) {
+      int n = z->order[k];
+      z->img_comp[n].coeff_w = z->img_comp[n].w2 / 8;
+      offset[k] = total;
+      total += (size_t) z->img_comp[n].coeff_w * stbi__jpeg_unit_block_row(z, n, band) * 64 * sizeof(short);
+   }
+   raw = stbi__scratch_malloc(total + 15);
+   if (!raw) return stbi__err("outofmem", "Out of memory");
+   w.z = z;
+   for (k=0; k < z->scan_n; ++k)
+      w.coeff[z->order[k]] = (short *) ((((size_t) raw + 15) & ~15) + offset[k]);
+
+   for (w.first_row=0; w.first_row < units_y; w.first_row += band) {
+      int rows = stbi__min(band, units_y - w.first_row);
+      for (j=w.first_row; j < w.first_row + rows; ++j) {
+         for (i=0; i < units_x; ++i) {
+            if (!stbi__jpeg_decode_unit(z, i, j, w.coeff, w.first_row)) {
+               stbi__scratch_free(raw);
+               return 0;
+            }
+         }
+      }
+      stbi__parallel_run(rows, stbi__jpeg_idct_job, &w);
+   }
+   stbi__scratch_free(raw);
+   return 1;
+}
+
+// -1 when the scan is better decoded serially
+static int stbi__jpeg_decode_baseline_parallel(stbi__jpeg *z)
+{
+   if (z->progressive || z->s->read_from_callbacks || !stbi__parallel_worthwhile(z->s->img_x, z->s->img_y))
+      return -1;
+   if (z->restart_interval)
+      return stbi__jpeg_decode_restarts_parallel(z);
+   return stbi__jpeg_decode_idct_parallel(z);
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
    stbi__jpeg_reset(z);
    if (!z->progressive) {
+      int result = stbi__jpeg_decode_baseline_parallel(z);
+      if (result >= 0) return result;
       if (z->scan_n == 1) {
          int i,j;
          STBI_SIMD_ALIGN(short, data[64]);
@@ -3043,22 +3816,35 @@ static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
       data[i] *= dequant[i];
 }
 
+// dequantize and idct block row j of every component that has one
+static void stbi__jpeg_finish_row(void *context, int j)
+{
+   stbi__jpeg *z = (stbi__jpeg *) context;
+   int i,n;
+   for (n=0; n < z->s->img_n; ++n) {
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+      if (j >= h) continue;
+      for (i=0; i < w; ++i) {
+         short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+         stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+      }
+   }
+}
+
 static void stbi__jpeg_finish(stbi__jpeg *z)
 {
    if (z->progressive) {
-      // dequantize and idct the data
-      int i,j,n;
-      for (n=0; n < z->s->img_n; ++n) {
-         int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-               stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
-            }
-         }
-      }
+      int j,n,h = 0;
+      for (n=0; n < z->s->img_n; ++n)
+         if (h < (z->img_comp[n].y+7) >> 3)
+            h = (z->img_comp[n].y+7) >> 3;
+      if (stbi__parallel_worthwhile(z->s->img_x, z->s->img_y))
+         stbi__parallel_run(h, stbi__jpeg_finish_row, z);
+      else
+         for (j=0; j < h; ++j)
+            stbi__jpeg_finish_row(z, j);
    }
 }
 
@@ -3209,17 +3995,17 @@ static int stbi__free_jpeg_components(stbi__jpeg *z, int ncomp, int why)
    int i;
    for (i=0; i < ncomp; ++i) {
       if (z->img_comp[i].raw_data) {
-         STBI_FREE(z->img_comp[i].raw_data);
+         stbi__scratch_free(z->img_comp[i].raw_data);
          z->img_comp[i].raw_data = NULL;
          z->img_comp[i].data = NULL;
       }
       if (z->img_comp[i].raw_coeff) {
-         STBI_FREE(z->img_comp[i].raw_coeff);
+         stbi__scratch_free(z->img_comp[i].raw_coeff);
          z->img_comp[i].raw_coeff = 0;
          z->img_comp[i].coeff = 0;
       }
       if (z->img_comp[i].linebuf) {
-         STBI_FREE(z->img_comp[i].linebuf);
+         stbi__scratch_free(z->img_comp[i].linebuf);
          z->img_comp[i].linebuf = NULL;
       }
    }
@@ -3258,9 +4044,11 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       z->img_comp[i].tq = stbi__get8(s);  if (z->img_comp[i].tq > 3) return stbi__err("bad TQ","Corrupt JPEG");
    }
 
-   if (scan != STBI__SCAN_load) return 1;
+   if (scan != STBI__SCAN_load && scan != STBI__SCAN_rows) return 1;
 
-   if (!stbi__mad3sizes_valid(s->img_x, s->img_y, s->img_n, 0)) return stbi__err("too large", "Image too large to decode");
+   if (scan == STBI__SCAN_rows) {
+      if (z->progressive) return stbi__err("progressive jpeg", "JPEG format not supported: progressive, decoding rows");
+   } else if (!stbi__mad3sizes_valid(s->img_x, s->img_y, s->img_n, 0)) return stbi__err("too large", "Image too large to decode");
 
    for (i=0; i < s->img_n; ++i) {
       if (z->img_comp[i].h > h_max) h_max = z->img_comp[i].h;
@@ -3296,19 +4084,24 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // so these muls can't overflow with 32-bit ints (which we require)
       z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
       z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      // decoding rows: a row above two MCU rows, data starts after it (see stbi__jpeg_decode_rows)
+      if (scan == STBI__SCAN_rows)
+         z->img_comp[i].h2 = z->img_comp[i].v * 16 + 1;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
-      z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
+      z->img_comp[i].raw_data = stbi__scratch_malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
       if (z->img_comp[i].raw_data == NULL)
          return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
+      if (scan == STBI__SCAN_rows)
+         z->img_comp[i].data += z->img_comp[i].w2;
       if (z->progressive) {
          // w2, h2 are multiples of 8 (see above)
          z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
          z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         z->img_comp[i].raw_coeff = stbi__scratch_malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3589,6 +4382,64 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// stbi__resample_row_hv_2_simd 16 pixels at a time
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // as in the sse2 version, the last pixel is left to the scalar code
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass, 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i curr  = _mm256_add_epi16(_mm256_slli_epi16(nearw, 2), _mm256_sub_epi16(farw, nearw));
+
+      // "prev" and "next" are curr shifted by one pixel across both 128-bit lanes, which shifts
+      // in zeros where the pixels before and after this block go
+      __m256i lo_up = _mm256_permute2x128_si256(curr, curr, 0x08); // 0, lo
+      __m256i hi_dn = _mm256_permute2x128_si256(curr, curr, 0x81); // hi, 0
+      __m256i prev  = _mm256_or_si256(_mm256_alignr_epi8(curr, lo_up, 14), _mm256_set_epi32(0,0,0,0,0,0,0,t1));
+      __m256i next  = _mm256_or_si256(_mm256_alignr_epi8(hi_dn, curr, 2), _mm256_set_epi32((3*in_near[i+16] + in_far[i+16]) << 16,0,0,0,0,0,0,0));
+
+      // horizontal pass, polyphase: even = 4*cur + (prev - cur), odd = 4*cur + (next - cur)
+      __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), _mm256_set1_epi16(8));
+      __m256i even = _mm256_add_epi16(_mm256_sub_epi16(prev, curr), curb);
+      __m256i odd  = _mm256_add_epi16(_mm256_sub_epi16(next, curr), curb);
+
+      // interleave within the lanes, which keeps pixels 0-7 in the low lane and 8-15 in the high
+      __m256i de0 = _mm256_srli_epi16(_mm256_unpacklo_epi16(even, odd), 4);
+      __m256i de1 = _mm256_srli_epi16(_mm256_unpackhi_epi16(even, odd), 4);
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_packus_epi16(de0, de1));
+
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3761,51 +4612,364 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
       out += step;
    }
 }
-#endif
+#endif
+
+#ifdef STBI_AVX2
+// the sse2 color transform 16 pixels at a time, also for step == 3 (plain RGB output)
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 3 || step == 4) {
+      __m256i signflip  = _mm256_set1_epi16(-0x8000);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+      // drops the alpha bytes, leaving four rgb pixels in the low 12 bytes of each lane
+      __m256i drop_alpha = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+                                            0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+      // the 16-byte stores of step == 3 write 4 bytes past the 16 pixels, which
+      // the next ones overwrite; stop early enough that they stay inside the row
+      int end = step == 4 ? count - 15 : count - 17;
+
+      for (; i < end; i += 16) {
+         // load, unpack to short: y << 8 with the rounding bias below, cr and cb biased by -128 and shifted left by 8
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y+i))), 8), y_bias);
+         __m256i crw = _mm256_xor_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcr+i))), 8), signflip);
+         __m256i cbw = _mm256_xor_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcb+i))), 8), signflip);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte and interleave the channels; everything stays within its lane, so
+         // o0 holds pixels 0-3 and 8-11, o1 pixels 4-7 and 12-15
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         if (step == 4) {
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+         } else {
+            __m256i c0 = _mm256_shuffle_epi8(o0, drop_alpha);
+            __m256i c1 = _mm256_shuffle_epi8(o1, drop_alpha);
+            _mm_storeu_si128((__m128i *) (out + 0), _mm256_castsi256_si128(c0));
+            _mm_storeu_si128((__m128i *) (out + 12), _mm256_castsi256_si128(c1));
+            _mm_storeu_si128((__m128i *) (out + 24), _mm256_extracti128_si256(c0, 1));
+            _mm_storeu_si128((__m128i *) (out + 36), _mm256_extracti128_si256(c1, 1));
+            out += 48;
+         }
+      }
+   }
+
+   for (; i < count; ++i) {
+      int y_fixed = (y[i] << 20) + (1<<19); // rounding
+      int r,g,b;
+      int cr = pcr[i] - 128;
+      int cb = pcb[i] - 128;
+      r = y_fixed + cr* stbi__float2fixed(1.40200f);
+      g = y_fixed + cr*-stbi__float2fixed(0.71414f) + ((cb*-stbi__float2fixed(0.34414f)) & 0xffff0000);
+      b = y_fixed                                   +   cb* stbi__float2fixed(1.77200f);
+      r >>= 20;
+      g >>= 20;
+      b >>= 20;
+      if ((unsigned) r > 255) { if (r < 0) r = 0; else r = 255; }
+      if ((unsigned) g > 255) { if (g < 0) g = 0; else g = 255; }
+      if ((unsigned) b > 255) { if (b < 0) b = 0; else b = 255; }
+      out[0] = (stbi_uc)r;
+      out[1] = (stbi_uc)g;
+      out[2] = (stbi_uc)b;
+      out[3] = 255;
+      out += step;
+   }
+}
+#endif
+
+// set up the kernels
+static void stbi__setup_jpeg(stbi__jpeg *j)
+{
+   j->idct_block_kernel = stbi__idct_block;
+   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
+   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+
+#ifdef STBI_SSE2
+   if (stbi__simd_limit >= STBI_SIMD_SSE2 && stbi__sse2_available()) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
+#endif
+
+#ifdef STBI_AVX2
+   if (stbi__simd_limit >= STBI_SIMD_AVX2 && stbi__avx2_available()) {
+      j->idct_block_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
+#ifdef STBI_NEON
+   if (stbi__simd_limit >= STBI_SIMD_SSE2) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
+#endif
+}
+
+// clean up the temporary component buffers
+static void stbi__cleanup_jpeg(stbi__jpeg *j)
+{
+   stbi__free_jpeg_components(j, j->s->img_n, 0);
+}
+
+typedef struct
+{
+   resample_row_func resample;
+   stbi_uc *line0,*line1;
+   int hs,vs;   // expansion factor in each axis
+   int w_lores; // horizontal pixels pre-expansion
+   int ystep;   // how far through vertical expansion we are
+   int ypos;    // which pre-expansion row we're on
+} stbi__resample;
+
+// fast 0..255 * 0..255 => 0..255 rounded multiplication
+static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
+{
+   unsigned int t = x*y + 128;
+   return (stbi_uc) ((t + (t >>8)) >> 8);
+}
+
+// resamples and color-converts output rows [j0, j1) to output, stride bytes apart, with the
+// resamplers standing at row j0, and leaves them at row j1. The converters write a byte past the
+// end of a row (out[3] with n == 3), harmless while the next row comes later; rows from
+// spill_from on go through spill instead, for the last row of a job, as the next one may already
+// be done, or for every row of a caller's buffer
+static void stbi__jpeg_resample_rows(stbi__jpeg *z, stbi__resample *res_comp, stbi_uc **linebuf, stbi_uc *spill, unsigned int spill_from,
+                                     stbi_uc *output, ptrdiff_t stride, int n, int decode_n, int is_rgb, unsigned int j0, unsigned int j1)
+{
+   int k;
+   unsigned int i,j;
+   stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+
+   for (j=j0; j < j1; ++j) {
+      stbi_uc *row = j >= spill_from ? spill : output + stride * (ptrdiff_t) (j - j0);
+      stbi_uc *out = row;
+      for (k=0; k < decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         coutput[k] = r->resample(linebuf[k],
+                                  y_bot ? r->line1 : r->line0,
+                                  y_bot ? r->line0 : r->line1,
+                                  r->w_lores, r->hs);
+         if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y)
+               r->line1 += z->img_comp[k].w2;
+         }
+      }
+      if (n >= 3) {
+         stbi_uc *y = coutput[0];
+         if (z->s->img_n == 3) {
+            if (is_rgb) {
+               for (i=0; i < z->s->img_x; ++i) {
+                  out[0] = y[i];
+                  out[1] = coutput[1][i];
+                  out[2] = coutput[2][i];
+                  out[3] = 255;
+                  out += n;
+               }
+            } else {
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else if (z->s->img_n == 4) {
+            if (z->app14_color_transform == 0) { // CMYK
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                  out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                  out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                  out[3] = 255;
+                  out += n;
+               }
+            } else if (z->app14_color_transform == 2) { // YCCK
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(255 - out[0], m);
+                  out[1] = stbi__blinn_8x8(255 - out[1], m);
+                  out[2] = stbi__blinn_8x8(255 - out[2], m);
+                  out += n;
+               }
+            } else { // YCbCr + alpha?  Ignore the fourth channel for now
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = out[1] = out[2] = y[i];
+               out[3] = 255; // not used if n==3
+               out += n;
+            }
+      } else {
+         if (is_rgb) {
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i)
+                  *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+            else {
+               for (i=0; i < z->s->img_x; ++i, out += 2) {
+                  out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                  out[1] = 255;
+               }
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+               stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+               stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+               out[0] = stbi__compute_y(r, g, b);
+               out[1] = 255;
+               out += n;
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+               out[1] = 255;
+               out += n;
+            }
+         } else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+               for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+         }
+      }
+      if (row == spill)
+         memcpy(output + stride * (ptrdiff_t) (j - j0), spill, n * z->s->img_x);
+   }
+}
 
-// set up the kernels
-static void stbi__setup_jpeg(stbi__jpeg *j)
+// stbi__jpeg_resample_rows for rows [j0, j1) of the whole image at output, with the resamplers
+// as set up for row 0
+static void stbi__jpeg_convert_rows(stbi__jpeg *z, const stbi__resample *res_start, stbi_uc **linebuf, stbi_uc *spill, unsigned int spill_from,
+                                    stbi_uc *output, ptrdiff_t stride, int n, int decode_n, int is_rgb, unsigned int j0, unsigned int j1)
 {
-   j->idct_block_kernel = stbi__idct_block;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+   int k;
+   unsigned int j;
+   stbi__resample res_comp[4];
 
-#ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
-      j->idct_block_kernel = stbi__idct_simd;
-      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   memcpy(res_comp, res_start, sizeof(res_comp));
+   // step the resamplers to row j0, which only moves line0/line1 along the component rows
+   for (j=0; j < j0; ++j) {
+      for (k=0; k < decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y)
+               r->line1 += z->img_comp[k].w2;
+         }
+      }
    }
-#endif
-
-#ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
-#endif
+   stbi__jpeg_resample_rows(z, res_comp, linebuf, spill, spill_from, output + stride * (ptrdiff_t) j0, stride, n, decode_n, is_rgb, j0, j1);
 }
 
-// clean up the temporary component buffers
-static void stbi__cleanup_jpeg(stbi__jpeg *j)
+typedef struct
 {
-   stbi__free_jpeg_components(j, j->s->img_n, 0);
+   stbi__jpeg *z;
+   const stbi__resample *res_start;
+   stbi_uc *output;
+   ptrdiff_t stride;
+   int n, decode_n, is_rgb, spill_all;
+   unsigned int rows_per_job;
+   stbi__atomic_int failed;
+} stbi__jpeg_convert_work;
+
+static void stbi__jpeg_convert_job(void *context, int index)
+{
+   stbi__jpeg_convert_work *w = (stbi__jpeg_convert_work *) context;
+   stbi__jpeg *z = w->z;
+   stbi_uc *linebuf[4], *spill;
+   unsigned int j0 = index * w->rows_per_job;
+   unsigned int j1 = j0 + w->rows_per_job < z->s->img_y ? j0 + w->rows_per_job : z->s->img_y;
+   unsigned int spill_from = w->spill_all ? j0 : j1 < z->s->img_y ? j1-1 : j1;
+   int k;
+
+   // the line buffers are the only state the rows share, every job gets its own
+   linebuf[0] = (stbi_uc *) stbi__scratch_malloc_mad2(w->decode_n + w->n, z->s->img_x + 3, 0);
+   if (!linebuf[0]) { w->failed = 1; return; }
+   for (k=1; k < w->decode_n; ++k)
+      linebuf[k] = linebuf[k-1] + z->s->img_x + 3;
+   spill = linebuf[w->decode_n-1] + z->s->img_x + 3;
+   stbi__jpeg_convert_rows(z, w->res_start, linebuf, spill, spill_from, w->output, w->stride, w->n, w->decode_n, w->is_rgb, j0, j1);
+   stbi__scratch_free(linebuf[0]);
 }
 
-typedef struct
+// channels to write (n), components to resample (decode_n) and whether those are RGB already
+static void stbi__jpeg_output_format(stbi__jpeg *z, int req_comp, int *n, int *decode_n, int *is_rgb)
 {
-   resample_row_func resample;
-   stbi_uc *line0,*line1;
-   int hs,vs;   // expansion factor in each axis
-   int w_lores; // horizontal pixels pre-expansion
-   int ystep;   // how far through vertical expansion we are
-   int ypos;    // which pre-expansion row we're on
-} stbi__resample;
+   // determine actual number of components to generate
+   *n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
-// fast 0..255 * 0..255 => 0..255 rounded multiplication
-static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
+   *is_rgb = z->s->img_n == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
+
+   if (z->s->img_n == 3 && *n < 3 && !*is_rgb)
+      *decode_n = 1;
+   else
+      *decode_n = z->s->img_n;
+}
+
+// sets the resamplers up for row 0 and gives the components their line buffers; 0 when out of
+// memory, stbi__cleanup_jpeg frees what was allocated
+static int stbi__jpeg_setup_resample(stbi__jpeg *z, stbi__resample *res_comp, int decode_n)
 {
-   unsigned int t = x*y + 128;
-   return (stbi_uc) ((t + (t >>8)) >> 8);
+   int k;
+   for (k=0; k < decode_n; ++k) {
+      stbi__resample *r = &res_comp[k];
+
+      // allocate line buffer big enough for upsampling off the edges
+      // with upsample factor of 4
+      z->img_comp[k].linebuf = (stbi_uc *) stbi__scratch_malloc(z->s->img_x + 3);
+      if (!z->img_comp[k].linebuf) return 0;
+
+      r->hs      = z->img_h_max / z->img_comp[k].h;
+      r->vs      = z->img_v_max / z->img_comp[k].v;
+      r->ystep   = r->vs >> 1;
+      r->w_lores = (z->s->img_x + r->hs-1) / r->hs;
+      r->ypos    = 0;
+      r->line0   = r->line1 = z->img_comp[k].data;
+
+      if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+      else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+      else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+      else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+      else                               r->resample = stbi__resample_row_generic;
+   }
+   return 1;
 }
 
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
@@ -3819,15 +4983,7 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
-   // determine actual number of components to generate
-   n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
-
-   is_rgb = z->s->img_n == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
-
-   if (z->s->img_n == 3 && n < 3 && !is_rgb)
-      decode_n = 1;
-   else
-      decode_n = z->s->img_n;
+   stbi__jpeg_output_format(z, req_comp, &n, &decode_n, &is_rgb);
 
    // nothing to do if no components requested; check this now to avoid
    // accessing uninitialized coutput[0] later
@@ -3836,132 +4992,50 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // resample and color-convert
    {
       int k;
-      unsigned int i,j;
-      stbi_uc *output;
-      stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+      stbi_uc *output, *dest;
+      ptrdiff_t stride;
 
       stbi__resample res_comp[4];
 
-      for (k=0; k < decode_n; ++k) {
-         stbi__resample *r = &res_comp[k];
+      if (!stbi__jpeg_setup_resample(z, res_comp, decode_n)) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
-         // allocate line buffer big enough for upsampling off the edges
-         // with upsample factor of 4
-         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
-         if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-         r->hs      = z->img_h_max / z->img_comp[k].h;
-         r->vs      = z->img_v_max / z->img_comp[k].v;
-         r->ystep   = r->vs >> 1;
-         r->w_lores = (z->s->img_x + r->hs-1) / r->hs;
-         r->ypos    = 0;
-         r->line0   = r->line1 = z->img_comp[k].data;
-
-         if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
-         else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
-         else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
-         else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
-         else                               r->resample = stbi__resample_row_generic;
+      // the caller's rows have no byte to spare after them, with n == 3 every row is spilled
+      dest = stbi__dest_rows(z->s, n);
+      if (dest) {
+         output = dest;
+         stride = z->s->dest_stride;
+      } else {
+         output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+         stride = (ptrdiff_t) n * z->s->img_x;
       }
 
-      // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
-      if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
       // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
-            }
-         }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (is_rgb) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else if (z->s->img_n == 4) {
-               if (z->app14_color_transform == 0) { // CMYK
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                     out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                     out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else if (z->app14_color_transform == 2) { // YCCK
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(255 - out[0], m);
-                     out[1] = stbi__blinn_8x8(255 - out[1], m);
-                     out[2] = stbi__blinn_8x8(255 - out[2], m);
-                     out += n;
-                  }
-               } else { // YCbCr + alpha?  Ignore the fourth channel for now
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
-                  out += n;
-               }
-         } else {
-            if (is_rgb) {
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i)
-                     *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-               else {
-                  for (i=0; i < z->s->img_x; ++i, out += 2) {
-                     out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                     out[1] = 255;
-                  }
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  stbi_uc m = coutput[3][i];
-                  stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                  stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                  stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                  out[0] = stbi__compute_y(r, g, b);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else {
-               stbi_uc *y = coutput[0];
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-               else
-                  for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-            }
+      if (stbi__parallel_worthwhile(z->s->img_x, z->s->img_y)) {
+         stbi__jpeg_convert_work w;
+         int jobs = stbi__parallel.jobs * 4;
+         w.z = z;
+         w.res_start = res_comp;
+         w.output = output;
+         w.stride = stride;
+         w.n = n;
+         w.decode_n = decode_n;
+         w.is_rgb = is_rgb;
+         w.spill_all = dest && n == 3;
+         w.rows_per_job = (z->s->img_y + jobs - 1) / jobs;
+         w.failed = 0;
+         stbi__parallel_run((z->s->img_y + w.rows_per_job - 1) / w.rows_per_job, stbi__jpeg_convert_job, &w);
+         if (w.failed) { if (!dest) STBI_FREE(output); stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+      } else {
+         stbi_uc *linebuf[4], *spill = NULL;
+         for (k=0; k < decode_n; ++k)
+            linebuf[k] = z->img_comp[k].linebuf;
+         if (dest && n == 3) {
+            spill = (stbi_uc *) stbi__scratch_malloc_mad2(n, z->s->img_x, 1);
+            if (!spill) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
          }
+         stbi__jpeg_convert_rows(z, res_comp, linebuf, spill, spill ? 0 : z->s->img_y, output, stride, n, decode_n, is_rgb, 0, z->s->img_y);
+         stbi__scratch_free(spill);
       }
       stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
@@ -3971,29 +5045,124 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    }
 }
 
+// decodes unit rows [j0, j1) of the scan into the planes, whose first block row is unit row
+// first_row; *stopped is set when the data ends before the scan does
+static int stbi__jpeg_decode_unit_rows(stbi__jpeg *z, int j0, int j1, int first_row, int *stopped)
+{
+   int i,j,units_x,units_y;
+   stbi__jpeg_scan_units(z, &units_x, &units_y);
+   for (j=j0; j < j1; ++j) {
+      for (i=0; i < units_x; ++i) {
+         if (!stbi__jpeg_decode_unit(z, i, j, NULL, first_row)) return 0;
+         // count down the restart interval, as in stbi__parse_entropy_coded_data
+         if (--z->todo <= 0) {
+            if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+            if (!STBI__RESTART(z->marker)) { *stopped = 1; return 1; }
+            stbi__jpeg_reset(z);
+         }
+      }
+   }
+   return 1;
+}
+
+// stbi_load_rows for baseline JPEG with one scan over all components. The planes hold the row
+// above and two MCU rows (STBI__SCAN_rows): MCU row m is decoded into the second one while row
+// m-1 in the first is converted, which reads the first row of m too, then everything moves up an
+// MCU row and the resamplers' line pointers with it
+static int stbi__jpeg_decode_rows(stbi__jpeg *z, int req_comp, stbi__rows *rows)
+{
+   stbi__resample res_comp[4];
+   stbi_uc *linebuf[4], *output;
+   int n, decode_n, is_rgb, units_x, units_y, unit_rows, m, k, stopped = 0, result = 1;
+
+   z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+   for (k=0; k < 4; ++k) {
+      z->img_comp[k].raw_data = NULL;
+      z->img_comp[k].raw_coeff = NULL;
+   }
+   z->restart_interval = 0;
+   if (!stbi__decode_jpeg_header(z, STBI__SCAN_rows)) return 0;
+   m = stbi__get_marker(z);
+   while (!stbi__SOS(m)) {
+      if (!stbi__process_marker(z, m)) return 0;
+      m = stbi__get_marker(z);
+   }
+   if (!stbi__process_scan_header(z)) return 0;
+   if (z->scan_n != z->s->img_n) return stbi__err("multiscan jpeg", "JPEG format not supported: a scan per component, decoding rows");
+
+   stbi__jpeg_output_format(z, req_comp, &n, &decode_n, &is_rgb);
+   if (!stbi__jpeg_setup_resample(z, res_comp, decode_n)) return stbi__err("outofmem", "Out of memory");
+   for (k=0; k < decode_n; ++k)
+      linebuf[k] = z->img_comp[k].linebuf;
+   output = (stbi_uc *) stbi__scratch_malloc_mad3(n, z->s->img_x, z->img_mcu_h, 1);
+   if (!output) return stbi__err("outofmem", "Out of memory");
+
+   stbi__rows_start(rows, z->s->img_x, z->s->img_y, z->s->img_n >= 3 ? 3 : 1);
+   stbi__jpeg_scan_units(z, &units_x, &units_y);
+   // without interleaving the units are blocks, an MCU row has v rows of them
+   unit_rows = z->scan_n == 1 ? z->img_comp[z->order[0]].v : 1;
+   stbi__jpeg_reset(z);
+   for (m=0; m <= z->img_mcu_y; ++m) {
+      if (m < z->img_mcu_y && !stopped) {
+         int slot = m > 0;
+         if (!stbi__jpeg_decode_unit_rows(z, m * unit_rows, stbi__min((m+1) * unit_rows, units_y), (m - slot) * unit_rows, &stopped)) { result = 0; break; }
+      }
+      if (m > 0) {
+         unsigned int j0 = (m-1) * z->img_mcu_h;
+         unsigned int j1 = j0 + z->img_mcu_h < z->s->img_y ? j0 + z->img_mcu_h : z->s->img_y;
+         stbi__jpeg_resample_rows(z, res_comp, linebuf, NULL, j1, output, (ptrdiff_t) n * z->s->img_x, n, decode_n, is_rgb, j0, j1);
+         if (!stbi__rows_emit(rows, output, j1 - j0, n * z->s->img_x)) { result = 0; break; }
+         if (m < z->img_mcu_y) {
+            // the last row of m-1 and all of m move up to the row above and the first MCU row
+            for (k=0; k < decode_n; ++k) {
+               int w2 = z->img_comp[k].w2, shift = z->img_comp[k].v * 8;
+               memmove(z->img_comp[k].data - w2, z->img_comp[k].data + (shift-1) * w2, (size_t) (shift+1) * w2);
+               res_comp[k].line0 -= shift * w2;
+               res_comp[k].line1 -= shift * w2;
+            }
+         }
+      }
+   }
+   stbi__scratch_free(output);
+   return result;
+}
+
+static int stbi__jpeg_load_rows(stbi__context *s, int req_comp, stbi__rows *rows)
+{
+   int result;
+   stbi__jpeg *j = (stbi__jpeg *) stbi__scratch_malloc(sizeof(stbi__jpeg));
+   if (!j) return stbi__err("outofmem", "Out of memory");
+   j->s = s;
+   stbi__setup_jpeg(j);
+   result = stbi__jpeg_decode_rows(j, req_comp, rows);
+   stbi__cleanup_jpeg(j);
+   stbi__scratch_free(j);
+   return result;
+}
+
 static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri)
 {
    unsigned char* result;
-   stbi__jpeg* j = (stbi__jpeg*) stbi__malloc(sizeof(stbi__jpeg));
+   stbi__jpeg* j = (stbi__jpeg*) stbi__scratch_malloc(sizeof(stbi__jpeg));
    if (!j) return stbi__errpuc("outofmem", "Out of memory");
    STBI_NOTUSED(ri);
    j->s = s;
    stbi__setup_jpeg(j);
    result = load_jpeg_image(j, x,y,comp,req_comp);
-   STBI_FREE(j);
+   stbi__scratch_free(j);
    return result;
 }
 
 static int stbi__jpeg_test(stbi__context *s)
 {
    int r;
-   stbi__jpeg* j = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+   stbi__jpeg* j = (stbi__jpeg*)stbi__scratch_malloc(sizeof(stbi__jpeg));
    if (!j) return stbi__err("outofmem", "Out of memory");
    j->s = s;
    stbi__setup_jpeg(j);
    r = stbi__decode_jpeg_header(j, STBI__SCAN_type);
    stbi__rewind(s);
-   STBI_FREE(j);
+   stbi__scratch_free(j);
    return r;
 }
 
@@ -4012,11 +5181,11 @@ static int stbi__jpeg_info_raw(stbi__jpeg *j, int *x, int *y, int *comp)
 static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 {
    int result;
-   stbi__jpeg* j = (stbi__jpeg*) (stbi__malloc(sizeof(stbi__jpeg)));
+   stbi__jpeg* j = (stbi__jpeg*) (stbi__scratch_malloc(sizeof(stbi__jpeg)));
    if (!j) return stbi__err("outofmem", "Out of memory");
    j->s = s;
    result = stbi__jpeg_info_raw(j, x, y, comp);
-   STBI_FREE(j);
+   stbi__scratch_free(j);
    return result;
 }
 #endif
@@ -4035,6 +5204,11 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 #define STBI__ZNSYMS 288 // number of symbols in literal/length alphabet
 
+// tables of the fast inflate loop, see stbi__parse_huffman_block_fast
+#define STBI__ZFAST_LENGTH_BITS    11
+#define STBI__ZFAST_DISTANCE_BITS  10
+#define STBI__ZFAST_OUT           264 // output room for one round: up to three literal pairs, or two and a match
+
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
 typedef struct
@@ -4115,25 +5289,61 @@ static int stbi__zbuild_huffman(stbi__zhuffman *z, const stbi_uc *sizelist, int
 //    because PNG allows splitting the zlib stream arbitrarily,
 //    and it's annoying structurally to have PNG call ZLIB call PNG,
 //    we require PNG read all the IDATs and combine them into a single
-//    memory buffer
+//    memory buffer (stbi_load_rows reads them a piece at a time instead,
+//    see zread)
 
 typedef struct
 {
    stbi_uc *zbuffer, *zbuffer_end;
    int num_bits;
+   int hit_zeof_once;
+   int pad_bits; // zero bits put into code_buffer past the end of the input
    stbi__uint32 code_buffer;
 
    char *zout;
    char *zout_start;
    char *zout_end;
-   int   z_expandable;
+   int   z_expandable; // 0: fixed buffer, 1: grown with STBI_REALLOC, 2: with stbi__scratch_realloc,
+                       // 3: a window, zflush takes what is full (stbi__zlib_decode_window)
+
+   // window: zflush gets the output from zout_start + zflushed on, returns how much of it it
+   // took or -1 on errors
+   int (*zflush)(void *user, stbi_uc *data, int len);
+   void *zflush_user;
+   int zflushed;
+
+   // window: the input is read into zin as it is needed, zread returns how much it put at data,
+   // 0 at the end or -1 on errors, and is cleared after that
+   stbi_uc *zin;
+   int zin_size;
+   int (*zread)(void *user, stbi_uc *data, int len);
+   void *zread_user;
 
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 zfast_length[1 << STBI__ZFAST_LENGTH_BITS];
+   stbi__uint32 zfast_distance[1 << STBI__ZFAST_DISTANCE_BITS];
 } stbi__zbuf;
 
+// keeps the input not read yet, moved to the front of zin, and reads more after it; returns
+// whether there is any
+static int stbi__zrefill(stbi__zbuf *z)
+{
+   int left = (int) (z->zbuffer_end - z->zbuffer);
+   int n;
+   memmove(z->zin, z->zbuffer, left);
+   n = z->zread(z->zread_user, z->zin + left, z->zin_size - left);
+   if (n <= 0) {
+      z->zread = NULL;
+      n = 0;
+   }
+   z->zbuffer = z->zin;
+   z->zbuffer_end = z->zin + left + n;
+   return z->zbuffer < z->zbuffer_end;
+}
+
 stbi_inline static int stbi__zeof(stbi__zbuf *z)
 {
-   return (z->zbuffer >= z->zbuffer_end);
+   return (z->zbuffer >= z->zbuffer_end) && (z->zread == NULL || !stbi__zrefill(z));
 }
 
 stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
@@ -4146,8 +5356,10 @@ static void stbi__fill_bits(stbi__zbuf *z)
    do {
       if (z->code_buffer >= (1U << z->num_bits)) {
         z->zbuffer = z->zbuffer_end;  /* treat this as EOF so we fail. */
+        z->zread = NULL;
         return;
       }
+      if (stbi__zeof(z)) z->pad_bits += 8;
       z->code_buffer |= (unsigned int) stbi__zget8(z) << z->num_bits;
       z->num_bits += 8;
    } while (z->num_bits <= 24);
@@ -4163,12 +5375,14 @@ stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
    return k;
 }
 
-static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+// decodes the code at the bottom of bits without the fast table; returns the symbol and its
+// length in *size, or -1
+static int stbi__zhuffman_decode_code(const stbi__zhuffman *z, stbi__uint32 bits, int *size)
 {
    int b,s,k;
    // not resolved by fast table, so compute it the slow way
    // use jpeg approach, which requires MSbits at top
-   k = stbi__bit_reverse(a->code_buffer, 16);
+   k = stbi__bit_reverse((int) (bits & 0xffff), 16);
    for (s=STBI__ZFAST_BITS+1; ; ++s)
       if (k < z->maxcode[s])
          break;
@@ -4177,9 +5391,17 @@ static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
    b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
    if (b >= STBI__ZNSYMS) return -1; // some data was corrupt somewhere!
    if (z->size[b] != s) return -1;  // was originally an assert, but report failure instead.
+   *size = s;
+   return z->value[b];
+}
+
+static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+{
+   int s, v = stbi__zhuffman_decode_code(z, a->code_buffer, &s);
+   if (v < 0) return -1;
    a->code_buffer >>= s;
    a->num_bits -= s;
-   return z->value[b];
+   return v;
 }
 
 stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
@@ -4187,9 +5409,18 @@ stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
    int b,s;
    if (a->num_bits < 16) {
       if (stbi__zeof(a)) {
-         return -1;   /* report error for unexpected end of data. */
+         if (!a->hit_zeof_once) {
+            // the last codes may take fewer than 16 bits: go on with 16 zero bits of padding the
+            // first time, consuming any of them is caught at the end of the block
+            a->hit_zeof_once = 1;
+            a->num_bits += 16;
+            a->pad_bits += 16;
+         } else {
+            return -1;   /* report error for unexpected end of data. */
+         }
+      } else {
+         stbi__fill_bits(a);
       }
-      stbi__fill_bits(a);
    }
    b = z->fast[a->code_buffer & STBI__ZFAST_MASK];
    if (b) {
@@ -4208,13 +5439,33 @@ static int stbi__zexpand(stbi__zbuf *z, char *zout, int n)  // need to make room
    z->zout = zout;
    if (!z->z_expandable) return stbi__err("output buffer limit","Corrupt PNG");
    cur   = (unsigned int) (z->zout - z->zout_start);
+   if (z->z_expandable == 3) {
+      // hand the output over, then keep what it did not take and the last 32 KB back references
+      // may reach, and only grow when that still leaves no room
+      int taken = z->zflush(z->zflush_user, (stbi_uc *) z->zout_start + z->zflushed, (int) cur - z->zflushed);
+      unsigned int drop;
+      if (taken < 0) return 0;
+      z->zflushed += taken;
+      drop = cur > 32768 ? cur - 32768 : 0;
+      if (drop > (unsigned int) z->zflushed) drop = z->zflushed;
+      if (drop) {
+         memmove(z->zout_start, z->zout_start + drop, cur - drop);
+         cur -= drop;
+         z->zflushed -= drop;
+         z->zout = z->zout_start + cur;
+      }
+   }
    limit = old_limit = (unsigned) (z->zout_end - z->zout_start);
+   if (cur + n <= limit) return 1;
    if (UINT_MAX - cur < (unsigned) n) return stbi__err("outofmem", "Out of memory");
    while (cur + n > limit) {
       if(limit > UINT_MAX / 2) return stbi__err("outofmem", "Out of memory");
       limit *= 2;
    }
-   q = (char *) STBI_REALLOC_SIZED(z->zout_start, old_limit, limit);
+   if (z->z_expandable >= 2)
+      q = (char *) stbi__scratch_realloc(z->zout_start, old_limit, limit);
+   else
+      q = (char *) STBI_REALLOC_SIZED(z->zout_start, old_limit, limit);
    STBI_NOTUSED(old_limit);
    if (q == NULL) return stbi__err("outofmem", "Out of memory");
    z->zout_start = q;
@@ -4237,11 +5488,221 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
+static int stbi__zfast_inflate = 1;
+
+STBIDEF void stbi_set_fast_inflate(int flag_true_if_should_use_fast_inflate)
+{
+   stbi__zfast_inflate = flag_true_if_should_use_fast_inflate;
+}
+
+// entries of the fast tables: bits 0-4 are the bits to consume, 5-7 the kind, 8-15 the literal or
+// the number of extra bits, 16-31 the second literal or the base length/distance; 0 means the
+// code is longer than the table (or unused) and is decoded the slow way
+#define STBI__ZENTRY_KIND      0xe0
+#define STBI__ZENTRY_LENGTH    0x20
+#define STBI__ZENTRY_LITERAL   0x40 // also set in STBI__ZENTRY_LITERAL2
+#define STBI__ZENTRY_LITERAL2  0x60 // two literals, bits 0-4 hold both codes' lengths
+#define STBI__ZENTRY_END       0x80
+#define STBI__ZENTRY_DISTANCE  0xa0
+
+static void stbi__zbuild_fast_table(stbi__uint32 *table, int bits, const stbi__zhuffman *z, int distance)
+{
+   int s,c,j;
+   memset(table, 0, sizeof(*table) << bits);
+   for (s=1; s <= bits; ++s) {
+      int count = (z->maxcode[s] >> (16-s)) - z->firstcode[s];
+      for (c=0; c < count; ++c) {
+         int v = z->value[z->firstsymbol[s] + c];
+         stbi__uint32 e;
+         // the unused lengths 286, 287 and distances 30, 31 get base 0 like in the slow loop
+         if (distance)
+            e = STBI__ZENTRY_DISTANCE | (stbi__zdist_extra[v] << 8) | ((stbi__uint32) stbi__zdist_base[v] << 16);
+         else if (v < 256)
+            e = STBI__ZENTRY_LITERAL | (v << 8);
+         else if (v == 256)
+            e = STBI__ZENTRY_END;
+         else
+            e = STBI__ZENTRY_LENGTH | (stbi__zlength_extra[v-257] << 8) | ((stbi__uint32) stbi__zlength_base[v-257] << 16);
+         e |= s;
+         for (j = stbi__bit_reverse(z->firstcode[s] + c, s); j < (1 << bits); j += 1 << s)
+            table[j] = e;
+      }
+   }
+   if (!distance) {
+      // a literal followed by a literal whose code fits into the rest of the index decodes as a
+      // pair; going down, table[j >> s1] is always still a single entry
+      for (j=(1 << bits)-1; j >= 0; --j) {
+         stbi__uint32 e = table[j], e2;
+         int s1 = e & 31;
+         if ((e & STBI__ZENTRY_KIND) != STBI__ZENTRY_LITERAL) continue;
+         e2 = table[j >> s1];
+         if ((e2 & STBI__ZENTRY_KIND) == STBI__ZENTRY_LITERAL && s1 + (int) (e2 & 31) <= bits)
+            table[j] = (s1 + (e2 & 31)) | STBI__ZENTRY_LITERAL2 | (e & 0xff00) | ((e2 & 0xff00) << 8);
+      }
+   }
+}
+
+stbi_inline static stbi__uint64 stbi__zload64(const stbi_uc *p)
+{
+#if defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64) || defined(__i386__) || defined(__x86_64__) \
+    || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+   stbi__uint64 v;
+   memcpy(&v, p, 8);
+   return v;
+#else
+   return (stbi__uint64) p[0]       | ((stbi__uint64) p[1] << 8)  | ((stbi__uint64) p[2] << 16) | ((stbi__uint64) p[3] << 24) |
+         ((stbi__uint64) p[4] << 32) | ((stbi__uint64) p[5] << 40) | ((stbi__uint64) p[6] << 48) | ((stbi__uint64) p[7] << 56);
+#endif
+}
+
+// writes the one or two literals of entry e and consumes their codes
+#define STBI__ZFAST_LITERALS(e)                    \
+   do {                                            \
+      zout[0] = (char) ((e) >> 8);                 \
+      if (((e) & STBI__ZENTRY_KIND) == STBI__ZENTRY_LITERAL2) \
+         zout[1] = (char) ((e) >> 16), ++zout;     \
+      ++zout;                                      \
+      bits >>= (e) & 31;                           \
+      num_bits -= (e) & 31;                        \
+   } while (0)
+
+// decodes symbols while at least 16 input bytes and STBI__ZFAST_OUT output bytes are left. The
+// bit buffer is refilled with 8-byte loads (at least 56 bits, enough for a length and a distance
+// with their extra bits); on the way out the whole bytes still in it are given back to the input.
+// Returns 1 at the end of the block, 2 when it ran out of room, 0 on errors.
+static int stbi__parse_huffman_block_fast(stbi__zbuf *a)
+{
+   const stbi_uc *in = a->zbuffer, *in_end = a->zbuffer_end - 16;
+   char *zout = a->zout, *zout_end = a->zout_end - STBI__ZFAST_OUT;
+   const stbi__uint32 *length_table = a->zfast_length, *distance_table = a->zfast_distance;
+   stbi__uint64 bits = a->code_buffer;
+   int num_bits = a->num_bits, result = 2;
+
+   do {
+      stbi__uint32 e;
+      int len, dist, n;
+      const char *p;
+      bits |= stbi__zload64(in) << num_bits;
+      in += (63 - num_bits) >> 3;
+      num_bits |= 56;
+
+      // a literal entry takes at most STBI__ZFAST_LENGTH_BITS bits, so three of them fit into
+      // one refill; a match after one or two of them refills once more
+      e = length_table[bits & ((1 << STBI__ZFAST_LENGTH_BITS) - 1)];
+      if (e & STBI__ZENTRY_LITERAL) {
+         STBI__ZFAST_LITERALS(e);
+         e = length_table[bits & ((1 << STBI__ZFAST_LENGTH_BITS) - 1)];
+         if (e & STBI__ZENTRY_LITERAL) {
+            STBI__ZFAST_LITERALS(e);
+            e = length_table[bits & ((1 << STBI__ZFAST_LENGTH_BITS) - 1)];
+            if (e & STBI__ZENTRY_LITERAL) {
+               STBI__ZFAST_LITERALS(e);
+               continue;
+            }
+         }
+         bits |= stbi__zload64(in) << num_bits;
+         in += (63 - num_bits) >> 3;
+         num_bits |= 56;
+      }
+      n = e & 31;
+      if ((e & STBI__ZENTRY_KIND) == STBI__ZENTRY_LENGTH) {
+         bits >>= n; num_bits -= n;
+         n = (e >> 8) & 31;
+         len = (int) (e >> 16) + (int) (bits & ((1 << n) - 1));
+      } else if (e) {
+         bits >>= n; num_bits -= n;
+         result = 1;
+         break;
+      } else {
+         int z = stbi__zhuffman_decode_code(&a->z_length, (stbi__uint32) bits, &n);
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+         bits >>= n; num_bits -= n;
+         if (z < 256) {
+            *zout++ = (char) z;
+            continue;
+         }
+         if (z == 256) {
+            result = 1;
+            break;
+         }
+         z -= 257;
+         n = stbi__zlength_extra[z];
+         len = stbi__zlength_base[z] + (int) (bits & ((1 << n) - 1));
+      }
+      bits >>= n; num_bits -= n;
+
+      e = distance_table[bits & ((1 << STBI__ZFAST_DISTANCE_BITS) - 1)];
+      if (e) {
+         n = e & 31;
+         bits >>= n; num_bits -= n;
+         n = (e >> 8) & 31;
+         dist = (int) (e >> 16) + (int) (bits & ((1 << n) - 1));
+      } else {
+         int z = stbi__zhuffman_decode_code(&a->z_distance, (stbi__uint32) bits, &n);
+         if (z < 0) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+         bits >>= n; num_bits -= n;
+         n = stbi__zdist_extra[z];
+         dist = stbi__zdist_base[z] + (int) (bits & ((1 << n) - 1));
+      }
+      bits >>= n; num_bits -= n;
+      if (dist == 0 || zout - a->zout_start < dist) { result = stbi__err("bad dist","Corrupt PNG"); break; }
+
+      // the chunks of one copy never overlap each other's source, the last one is moved back to
+      // end exactly at the end of the match
+      p = zout - dist;
+      if (dist >= 8 && len >= 8) {
+         char *last = zout + len - 8;
+         for (; zout < last; zout += 8, p += 8)
+            memcpy(zout, p, 8);
+         memcpy(last, last - dist, 8);
+         zout = last + 8;
+      } else if (dist >= 4 && len >= 4) {
+         char *last = zout + len - 4;
+         for (; zout < last; zout += 4, p += 4)
+            memcpy(zout, p, 4);
+         memcpy(last, last - dist, 4);
+         zout = last + 4;
+      } else if (dist == 1) {
+         memset(zout, *p, len);
+         zout += len;
+      } else {
+         while (len--) *zout++ = *p++;
+      }
+   } while (in <= in_end && zout <= zout_end);
+
+   if (result) {
+      in -= num_bits >> 3;
+      num_bits &= 7;
+      a->zbuffer = (stbi_uc *) in;
+      a->code_buffer = (stbi__uint32) bits & ((1U << num_bits) - 1);
+      a->num_bits = num_bits;
+      a->zout = zout;
+   }
+   return result;
+}
+
 static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
    char *zout = a->zout;
+   int tables_built = 0;
    for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
+      int z;
+      // the fast loop stops near the end of the input or the output, and comes back after the
+      // output has grown or more input has been read
+      if (a->zread && a->zbuffer_end - a->zbuffer < 16)
+         stbi__zrefill(a);
+      if (stbi__zfast_inflate && a->zbuffer_end - a->zbuffer >= 16 && a->zout_end - zout >= STBI__ZFAST_OUT) {
+         if (!tables_built) {
+            stbi__zbuild_fast_table(a->zfast_length, STBI__ZFAST_LENGTH_BITS, &a->z_length, 0);
+            stbi__zbuild_fast_table(a->zfast_distance, STBI__ZFAST_DISTANCE_BITS, &a->z_distance, 1);
+            tables_built = 1;
+         }
+         a->zout = zout;
+         z = stbi__parse_huffman_block_fast(a);
+         if (z != 2) return z;
+         zout = a->zout;
+      }
+      z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
          if (zout >= a->zout_end) {
@@ -4254,6 +5715,9 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
          int len,dist;
          if (z == 256) {
             a->zout = zout;
+            // the padding is always the top of code_buffer
+            if (a->num_bits < a->pad_bits)
+               return stbi__err("unexpected end","Corrupt PNG");
             return 1;
          }
          z -= 257;
@@ -4263,7 +5727,7 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
          dist = stbi__zdist_base[z];
          if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
-         if (zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
+         if (dist == 0 || zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
          if (zout + len > a->zout_end) {
             if (!stbi__zexpand(a, zout, len)) return 0;
             zout = a->zout;
@@ -4349,9 +5813,18 @@ static int stbi__parse_uncompressed_block(stbi__zbuf *a)
    len  = header[1] * 256 + header[0];
    nlen = header[3] * 256 + header[2];
    if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt","Corrupt PNG");
-   if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer","Corrupt PNG");
+   if (!a->zread && a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer","Corrupt PNG");
    if (a->zout + len > a->zout_end)
       if (!stbi__zexpand(a, a->zout, len)) return 0;
+   // reading its input a piece at a time, the block may go on past what has been read
+   while (a->zbuffer + len > a->zbuffer_end) {
+      int n = (int) (a->zbuffer_end - a->zbuffer);
+      memcpy(a->zout, a->zbuffer, n);
+      a->zbuffer += n;
+      a->zout += n;
+      len -= n;
+      if (stbi__zeof(a)) return stbi__err("read past buffer","Corrupt PNG");
+   }
    memcpy(a->zout, a->zbuffer, len);
    a->zbuffer += len;
    a->zout += len;
@@ -4408,6 +5881,8 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
       if (!stbi__parse_zlib_header(a)) return 0;
    a->num_bits = 0;
    a->code_buffer = 0;
+   a->hit_zeof_once = 0;
+   a->pad_bits = 0;
    do {
       final = stbi__zreceive(a,1);
       type = stbi__zreceive(a,2);
@@ -4446,6 +5921,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer + len;
+   a.zread = NULL;
    if (stbi__do_zlib(&a, p, initial_size, 1, 1)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -4467,6 +5943,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, i
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer + len;
+   a.zread = NULL;
    if (stbi__do_zlib(&a, p, initial_size, 1, parse_header)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -4476,11 +5953,66 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, i
    }
 }
 
+#ifndef STBI_NO_PNG
+// stbi_zlib_decode_malloc_guesssize_headerflag with the output in scratch memory, for the PNG
+// loader, which frees it before returning
+static char *stbi__zlib_decode_scratch(const char *buffer, int len, int initial_size, int *outlen, int parse_header)
+{
+   stbi__zbuf a;
+   char *p = (char *) stbi__scratch_malloc(initial_size);
+   if (p == NULL) return NULL;
+   a.zbuffer = (stbi_uc *) buffer;
+   a.zbuffer_end = (stbi_uc *) buffer + len;
+   a.zread = NULL;
+   if (stbi__do_zlib(&a, p, initial_size, 2, parse_header)) {
+      if (outlen) *outlen = (int) (a.zout - a.zout_start);
+      return a.zout_start;
+   } else {
+      stbi__scratch_free(a.zout_start);
+      return NULL;
+   }
+}
+
+// inflates through a window of window_size bytes (at least 32 KB more than flush needs at once)
+// instead of into one buffer, reading the input 64 KB at a time; read and flush get the input and
+// output as in stbi__zbuf, flush the rest once the stream has ended
+static int stbi__zlib_decode_window(int (*read)(void *user, stbi_uc *data, int len), void *read_user,
+                                    int window_size, int parse_header,
+                                    int (*flush)(void *user, stbi_uc *data, int len), void *user)
+{
+   stbi__zbuf a;
+   int result;
+   // the window allocated last, so that growing it can stay in place
+   stbi_uc *in = (stbi_uc *) stbi__scratch_malloc(1 << 16);
+   char *p = (char *) stbi__scratch_malloc(window_size);
+   if (p == NULL || in == NULL) {
+      stbi__scratch_free(p);
+      stbi__scratch_free(in);
+      return stbi__err("outofmem", "Out of memory");
+   }
+   a.zin = in;
+   a.zin_size = 1 << 16;
+   a.zbuffer = a.zbuffer_end = in;
+   a.zread = read;
+   a.zread_user = read_user;
+   a.zflush = flush;
+   a.zflush_user = user;
+   a.zflushed = 0;
+   result = stbi__do_zlib(&a, p, window_size, 3, parse_header);
+   if (result && flush(user, (stbi_uc *) a.zout_start + a.zflushed, (int) (a.zout - a.zout_start) - a.zflushed) < 0)
+      result = 0;
+   stbi__scratch_free(a.zout_start);
+   stbi__scratch_free(in);
+   return result;
+}
+#endif
+
 STBIDEF int stbi_zlib_decode_buffer(char *obuffer, int olen, char const *ibuffer, int ilen)
 {
    stbi__zbuf a;
    a.zbuffer = (stbi_uc *) ibuffer;
    a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   a.zread = NULL;
    if (stbi__do_zlib(&a, obuffer, olen, 0, 1))
       return (int) (a.zout - a.zout_start);
    else
@@ -4494,6 +6026,7 @@ STBIDEF char *stbi_zlib_decode_noheader_malloc(char const *buffer, int len, int
    if (p == NULL) return NULL;
    a.zbuffer = (stbi_uc *) buffer;
    a.zbuffer_end = (stbi_uc *) buffer+len;
+   a.zread = NULL;
    if (stbi__do_zlib(&a, p, 16384, 1, 0)) {
       if (outlen) *outlen = (int) (a.zout - a.zout_start);
       return a.zout_start;
@@ -4508,6 +6041,7 @@ STBIDEF int stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char
    stbi__zbuf a;
    a.zbuffer = (stbi_uc *) ibuffer;
    a.zbuffer_end = (stbi_uc *) ibuffer + ilen;
+   a.zread = NULL;
    if (stbi__do_zlib(&a, obuffer, olen, 0, 0))
       return (int) (a.zout - a.zout_start);
    else
@@ -4554,6 +6088,8 @@ typedef struct
    stbi__context *s;
    stbi_uc *idata, *expanded, *out;
    int depth;
+   int direct; // unfilter into the caller's rows (stbi__dest_rows), out only points there once done
+   stbi__rows *rows; // stbi_load_rows: the first IDAT hands batches of rows here, out only holds one of them
 } stbi__png;
 
 
@@ -4599,14 +6135,23 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    stbi__uint32 img_len, img_width_bytes;
    int k;
    int img_n = s->img_n; // copy it into a local for later
+   stbi_uc *out;
+   ptrdiff_t out_stride = stride;
 
    int output_bytes = out_n*bytes;
    int filter_bytes = img_n*bytes;
    int width = x;
 
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
-   a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
-   if (!a->out) return stbi__err("outofmem", "Out of memory");
+   if (a->direct) {
+      // only 8-bit rows, which never write past their end
+      STBI_ASSERT(depth == 8);
+      out = s->dest;
+      out_stride = s->dest_stride;
+   } else {
+      a->out = out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
+      if (!a->out) return stbi__err("outofmem", "Out of memory");
+   }
 
    if (!stbi__mad3sizes_valid(img_n, x, depth, 7)) return stbi__err("too large", "Corrupt PNG");
    img_width_bytes = (((img_n * x * depth) + 7) >> 3);
@@ -4618,7 +6163,7 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    if (raw_len < img_len) return stbi__err("not enough pixels","Corrupt PNG");
 
    for (j=0; j < y; ++j) {
-      stbi_uc *cur = a->out + stride*j;
+      stbi_uc *cur = out + out_stride * (ptrdiff_t) j;
       stbi_uc *prior;
       int filter = *raw++;
 
@@ -4631,7 +6176,7 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          filter_bytes = 1;
          width = img_width_bytes;
       }
-      prior = cur - stride; // bugfix: need to compute this after 'cur +=' computation above
+      prior = cur - out_stride; // bugfix: need to compute this after 'cur +=' computation above
 
       // if first row, use special filter that doesn't sample previous row
       if (j == 0) filter = first_row_filter[filter];
@@ -4800,6 +6345,8 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       }
    }
 
+   if (a->direct)
+      a->out = out;
    return 1;
 }
 
@@ -4848,10 +6395,9 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
    return 1;
 }
 
-static int stbi__compute_transparency(stbi__png *z, stbi_uc tc[3], int out_n)
+static int stbi__compute_transparency(stbi__png *z, stbi_uc tc[3], int out_n, stbi__uint32 pixel_count)
 {
-   stbi__context *s = z->s;
-   stbi__uint32 i, pixel_count = s->img_x * s->img_y;
+   stbi__uint32 i;
    stbi_uc *p = z->out;
 
    // compute color-based transparency, assuming we've
@@ -4873,10 +6419,9 @@ static int stbi__compute_transparency(stbi__png *z, stbi_uc tc[3], int out_n)
    return 1;
 }
 
-static int stbi__compute_transparency16(stbi__png *z, stbi__uint16 tc[3], int out_n)
+static int stbi__compute_transparency16(stbi__png *z, stbi__uint16 tc[3], int out_n, stbi__uint32 pixel_count)
 {
-   stbi__context *s = z->s;
-   stbi__uint32 i, pixel_count = s->img_x * s->img_y;
+   stbi__uint32 i;
    stbi__uint16 *p = (stbi__uint16*) z->out;
 
    // compute color-based transparency, assuming we've
@@ -4898,9 +6443,9 @@ static int stbi__compute_transparency16(stbi__png *z, stbi__uint16 tc[3], int ou
    return 1;
 }
 
-static int stbi__expand_png_palette(stbi__png *a, stbi_uc *palette, int len, int pal_img_n)
+static int stbi__expand_png_palette(stbi__png *a, stbi_uc *palette, int len, int pal_img_n, stbi__uint32 pixel_count)
 {
-   stbi__uint32 i, pixel_count = a->s->img_x * a->s->img_y;
+   stbi__uint32 i;
    stbi_uc *p, *temp_out, *orig = a->out;
 
    p = (stbi_uc *) stbi__malloc_mad2(pixel_count, pal_img_n, 0);
@@ -4975,10 +6520,10 @@ STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_conve
                                 : stbi__de_iphone_flag_global)
 #endif // STBI_THREAD_LOCAL
 
-static void stbi__de_iphone(stbi__png *z)
+static void stbi__de_iphone(stbi__png *z, stbi__uint32 pixel_count)
 {
    stbi__context *s = z->s;
-   stbi__uint32 i, pixel_count = s->img_x * s->img_y;
+   stbi__uint32 i;
    stbi_uc *p = z->out;
 
    if (s->img_out_n == 3) {  // convert bgr to rgb
@@ -5020,6 +6565,200 @@ static void stbi__de_iphone(stbi__png *z)
 
 #define STBI__PNG_TYPE(a,b,c,d)  (((unsigned) (a) << 24) + ((unsigned) (b) << 16) + ((unsigned) (c) << 8) + (unsigned) (d))
 
+// unfilters one row of width bytes from raw into cur; prior is the row above, zeros for the first
+// row, which turns the filters into their first row variants
+static void stbi__png_unfilter_row(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int filter, stbi__uint32 width, int filter_bytes)
+{
+   stbi__uint32 k, n = (stbi__uint32) filter_bytes < width ? (stbi__uint32) filter_bytes : width;
+   for (k=0; k < n; ++k) {
+      switch (filter) {
+         case STBI__F_avg  : cur[k] = STBI__BYTECAST(raw[k] + (prior[k]>>1)); break;
+         case STBI__F_up   :
+         case STBI__F_paeth: cur[k] = STBI__BYTECAST(raw[k] + prior[k]); break;
+         default           : cur[k] = raw[k]; break;
+      }
+   }
+   for (; k < width; ++k) {
+      switch (filter) {
+         case STBI__F_none : cur[k] = raw[k]; break;
+         case STBI__F_sub  : cur[k] = STBI__BYTECAST(raw[k] + cur[k-filter_bytes]); break;
+         case STBI__F_up   : cur[k] = STBI__BYTECAST(raw[k] + prior[k]); break;
+         case STBI__F_avg  : cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + cur[k-filter_bytes])>>1)); break;
+         case STBI__F_paeth: cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(cur[k-filter_bytes],prior[k],prior[k-filter_bytes])); break;
+      }
+   }
+}
+
+// stbi_load_rows for non-interlaced PNG: the image data is read from the IDAT chunks as it is
+// inflated through a window, and the whole rows in it go through the steps of stbi_load a batch
+// at a time
+typedef struct
+{
+   stbi__png *z;
+   int color, is_iphone, has_trans, req_comp;
+   stbi_uc *tc;
+   stbi__uint16 *tc16;
+   stbi_uc *palette;
+   int pal_img_n, pal_len;
+   int out_n;                       // channels after unfiltering, as img_out_n
+   stbi__uint32 width_bytes;        // of a row without its filter byte
+   int filter_bytes;
+   stbi_uc *prior;                  // the last row unfiltered so far, zeros before the first
+   stbi_uc *batch;                  // batch_rows unfiltered rows, each after a filter byte of 0
+   stbi__uint32 batch_rows, done;
+} stbi__png_rows_work;
+
+// unfilters and converts count rows into z->out, then hands them to the callback
+static int stbi__png_rows_batch(stbi__png_rows_work *w, const stbi_uc *raw, stbi__uint32 count)
+{
+   stbi__png *z = w->z;
+   stbi__context *s = z->s;
+   stbi__uint32 j, pixels = s->img_x * count, row = w->width_bytes + 1;
+   const stbi_uc *prior = w->prior;
+   void *result;
+   int n, ok;
+
+   for (j=0; j < count; ++j, raw += row) {
+      stbi_uc *cur = w->batch + row * j;
+      if (raw[0] > 4) return stbi__err("invalid filter","Corrupt PNG");
+      cur[0] = STBI__F_none;
+      stbi__png_unfilter_row(cur + 1, raw + 1, prior, raw[0], w->width_bytes, w->filter_bytes);
+      prior = cur + 1;
+   }
+   memcpy(w->prior, prior, w->width_bytes);
+
+   z->direct = 0;
+   if (!stbi__create_png_image_raw(z, w->batch, row * count, w->out_n, s->img_x, count, z->depth, w->color)) return 0;
+   if (w->has_trans) {
+      if (z->depth == 16)
+         stbi__compute_transparency16(z, w->tc16, w->out_n, pixels);
+      else
+         stbi__compute_transparency(z, w->tc, w->out_n, pixels);
+   }
+   if (w->is_iphone && stbi__de_iphone_flag && w->out_n > 2)
+      stbi__de_iphone(z, pixels);
+   n = w->out_n;
+   if (w->pal_img_n) {
+      n = w->req_comp >= 3 ? w->req_comp : w->pal_img_n;
+      if (!stbi__expand_png_palette(z, w->palette, w->pal_len, n, pixels)) return 0;
+   }
+   result = z->out;
+   z->out = NULL;
+   if (w->req_comp && w->req_comp != n) {
+      if (z->depth == 16)
+         result = stbi__convert_format16((stbi__uint16 *) result, n, w->req_comp, s->img_x, count);
+      else
+         result = stbi__convert_format((stbi_uc *) result, n, w->req_comp, s->img_x, count);
+      n = w->req_comp;
+      if (result == NULL) return 0;
+   }
+   if (z->depth == 16) {
+      result = stbi__convert_16_to_8((stbi__uint16 *) result, s->img_x, count, n);
+      if (result == NULL) return 0;
+   }
+   ok = stbi__rows_emit(z->rows, (stbi_uc *) result, count, s->img_x * n);
+   STBI_FREE(result);
+   w->done += count;
+   return ok;
+}
+
+// the window's flush: takes the whole rows in data, ignoring any past the last row of the image
+static int stbi__png_rows_flush(void *user, stbi_uc *data, int len)
+{
+   stbi__png_rows_work *w = (stbi__png_rows_work *) user;
+   stbi__uint32 row = w->width_bytes + 1;
+   stbi__uint32 rows = (stbi__uint32) len / row, j, count;
+   if (rows > w->z->s->img_y - w->done) rows = w->z->s->img_y - w->done;
+   for (j=0; j < rows; j += count) {
+      count = rows - j < w->batch_rows ? rows - j : w->batch_rows;
+      if (!stbi__png_rows_batch(w, data + row * j, count)) return -1;
+   }
+   return (int) (row * rows);
+}
+
+// the zlib stream across consecutive IDAT chunks, for stbi__zlib_decode_window; the header of the
+// chunk after them is kept for the parse loop
+typedef struct
+{
+   stbi__context *s;
+   stbi__uint32 left;   // of the current IDAT
+   stbi__pngchunk next;
+   int ended;           // next is not an IDAT
+} stbi__png_idat_reader;
+
+// skips the CRC of the IDAT just read and reads the next chunk header
+static void stbi__png_idat_next(stbi__png_idat_reader *r)
+{
+   stbi__get32be(r->s);
+   r->next = stbi__get_chunk_header(r->s);
+   if (r->next.type == STBI__PNG_TYPE('I','D','A','T'))
+      r->left = r->next.length;
+   else
+      r->ended = 1;
+}
+
+static int stbi__png_idat_read(void *user, stbi_uc *data, int len)
+{
+   stbi__png_idat_reader *r = (stbi__png_idat_reader *) user;
+   int total = 0;
+   while (total < len && !r->ended) {
+      int n;
+      if (r->left == 0) {
+         stbi__png_idat_next(r);
+         continue;
+      }
+      n = r->left < (stbi__uint32) (len - total) ? (int) r->left : len - total;
+      if (!stbi__getn(r->s, data + total, n)) {
+         r->ended = 1;
+         r->next.type = 0;
+         return -1;
+      }
+      r->left -= n;
+      total += n;
+   }
+   return total;
+}
+
+// the rest of the IDATs once the stream has ended
+static void stbi__png_idat_skip(stbi__png_idat_reader *r)
+{
+   while (!r->ended) {
+      stbi__skip(r->s, (int) r->left);
+      r->left = 0;
+      stbi__png_idat_next(r);
+   }
+}
+
+static int stbi__png_decode_rows(stbi__png_rows_work *w, stbi__png_idat_reader *idat, int parse_header)
+{
+   stbi__png *z = w->z;
+   stbi__context *s = z->s;
+   stbi__uint32 row;
+   int result = 0;
+
+   if (!stbi__mad3sizes_valid(s->img_n, s->img_x, z->depth, 7)) return stbi__err("too large", "Corrupt PNG");
+   w->width_bytes = (s->img_n * s->img_x * z->depth + 7) >> 3;
+   w->filter_bytes = z->depth < 8 ? 1 : s->img_n * (z->depth == 16 ? 2 : 1);
+   row = w->width_bytes + 1;
+   // about 256 KB of rows a batch, the window holds that and the 32 KB of history
+   w->batch_rows = row < (1 << 18) ? (1 << 18) / row : 1;
+   if (!stbi__mad2sizes_valid(w->batch_rows, row, 32768 + row)) return stbi__err("too large", "Image too large to decode");
+   w->done = 0;
+   w->prior = (stbi_uc *) stbi__scratch_malloc(w->width_bytes);
+   w->batch = (stbi_uc *) stbi__scratch_malloc(w->batch_rows * row);
+   if (w->prior && w->batch) {
+      memset(w->prior, 0, w->width_bytes);
+      result = stbi__zlib_decode_window(stbi__png_idat_read, idat, w->batch_rows * row + 32768 + row, parse_header, stbi__png_rows_flush, w);
+      if (result && w->done < s->img_y)
+         result = stbi__err("not enough pixels","Corrupt PNG");
+   } else {
+      result = stbi__err("outofmem", "Out of memory");
+   }
+   stbi__scratch_free(w->batch);
+   stbi__scratch_free(w->prior);
+   return result;
+}
+
 static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 {
    stbi_uc palette[1024], pal_img_n=0;
@@ -5027,6 +6766,8 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
    stbi__uint16 tc16[3];
    stbi__uint32 ioff=0, idata_limit=0, i, pal_len=0;
    int first=1,k,interlace=0, color=0, is_iphone=0;
+   stbi__png_idat_reader idat;   // stbi_load_rows: the IDATs are read while decoding
+   int streamed=0;               // 1: decoded, its next chunk header not handled yet, 2: handled
    stbi__context *s = z->s;
 
    z->expanded = NULL;
@@ -5038,7 +6779,13 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
    if (scan == STBI__SCAN_type) return 1;
 
    for (;;) {
-      stbi__pngchunk c = stbi__get_chunk_header(s);
+      stbi__pngchunk c;
+      if (streamed == 1) {
+         c = idat.next;
+         streamed = 2;
+      } else {
+         c = stbi__get_chunk_header(s);
+      }
       switch (c.type) {
          case STBI__PNG_TYPE('C','g','B','I'):
             is_iphone = 1;
@@ -5064,7 +6811,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             if (!pal_img_n) {
                s->img_n = (color & 2 ? 3 : 1) + (color & 4 ? 1 : 0);
                if ((1 << 30) / s->img_x / s->img_n < s->img_y) return stbi__err("too large", "Image too large to decode");
-               if (scan == STBI__SCAN_header) return 1;
+               // if SCAN_header, scan on too, a tRNS adds an alpha channel as stbi_load reports it
             } else {
                // if paletted, then pal_n is our final components, and
                // img_n is # components to decompress/filter.
@@ -5091,7 +6838,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 
          case STBI__PNG_TYPE('t','R','N','S'): {
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
-            if (z->idata) return stbi__err("tRNS after IDAT","Corrupt PNG");
+            if (z->idata || streamed) return stbi__err("tRNS after IDAT","Corrupt PNG");
             if (pal_img_n) {
                if (scan == STBI__SCAN_header) { s->img_n = 4; return 1; }
                if (pal_len == 0) return stbi__err("tRNS before PLTE","Corrupt PNG");
@@ -5102,6 +6849,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             } else {
                if (!(s->img_n & 1)) return stbi__err("tRNS with alpha","Corrupt PNG");
                if (c.length != (stbi__uint32) s->img_n*2) return stbi__err("bad tRNS len","Corrupt PNG");
+               if (scan == STBI__SCAN_header) { ++s->img_n; return 1; }
                has_trans = 1;
                if (z->depth == 16) {
                   for (k = 0; k < s->img_n; ++k) tc16[k] = (stbi__uint16)stbi__get16be(s); // copy the values as-is
@@ -5115,7 +6863,32 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
          case STBI__PNG_TYPE('I','D','A','T'): {
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
             if (pal_img_n && !pal_len) return stbi__err("no PLTE","Corrupt PNG");
-            if (scan == STBI__SCAN_header) { s->img_n = pal_img_n; return 1; }
+            if (scan == STBI__SCAN_header) { if (pal_img_n) s->img_n = pal_img_n; return 1; }
+            if (z->rows) {
+               stbi__png_rows_work w;
+               if (streamed) return stbi__err("IDATs not consecutive","Corrupt PNG");
+               if (interlace) return stbi__err("interlaced png", "PNG not supported: interlaced, decoding rows");
+               w.z = z;
+               w.color = color;
+               w.is_iphone = is_iphone;
+               w.has_trans = has_trans;
+               w.req_comp = req_comp;
+               w.tc = tc;
+               w.tc16 = tc16;
+               w.palette = palette;
+               w.pal_img_n = pal_img_n;
+               w.pal_len = pal_len;
+               w.out_n = s->img_out_n = has_trans ? s->img_n+1 : s->img_n;
+               idat.s = s;
+               idat.left = c.length;
+               idat.ended = 0;
+               stbi__rows_start(z->rows, s->img_x, s->img_y, pal_img_n ? pal_img_n : s->img_out_n);
+               if (!stbi__png_decode_rows(&w, &idat, !is_iphone)) return 0;
+               // the chunk after the IDATs is handled next, its header already read
+               stbi__png_idat_skip(&idat);
+               streamed = 1;
+               continue;
+            }
             if ((int)(ioff + c.length) < (int)ioff) return 0;
             if (ioff + c.length > idata_limit) {
                stbi__uint32 idata_limit_old = idata_limit;
@@ -5124,7 +6897,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
                while (ioff + c.length > idata_limit)
                   idata_limit *= 2;
                STBI_NOTUSED(idata_limit_old);
-               p = (stbi_uc *) STBI_REALLOC_SIZED(z->idata, idata_limit_old, idata_limit); if (p == NULL) return stbi__err("outofmem", "Out of memory");
+               p = (stbi_uc *) stbi__scratch_realloc(z->idata, idata_limit_old, idata_limit); if (p == NULL) return stbi__err("outofmem", "Out of memory");
                z->idata = p;
             }
             if (!stbi__getn(s, z->idata+ioff,c.length)) return stbi__err("outofdata","Corrupt PNG");
@@ -5136,39 +6909,47 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             stbi__uint32 raw_len, bpl;
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
             if (scan != STBI__SCAN_load) return 1;
+            if (z->rows) {
+               if (!streamed) return stbi__err("no IDAT","Corrupt PNG");
+               stbi__get32be(s);
+               return 1;
+            }
             if (z->idata == NULL) return stbi__err("no IDAT","Corrupt PNG");
             // initial guess for decoded data size to avoid unnecessary reallocs
             bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
             raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
-            z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
+            z->expanded = (stbi_uc *) stbi__zlib_decode_scratch((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
             if (z->expanded == NULL) return 0; // zlib should set error
-            STBI_FREE(z->idata); z->idata = NULL;
+            stbi__scratch_free(z->idata); z->idata = NULL;
             if ((req_comp == s->img_n+1 && req_comp != 3 && !pal_img_n) || has_trans)
                s->img_out_n = s->img_n+1;
             else
                s->img_out_n = s->img_n;
+            // the cases that need no pass over the image after unfiltering
+            z->direct = z->depth == 8 && !interlace && !pal_img_n && !has_trans && !is_iphone &&
+                        s->img_out_n == req_comp && stbi__dest_rows(s, req_comp) != NULL;
             if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
             if (has_trans) {
                if (z->depth == 16) {
-                  if (!stbi__compute_transparency16(z, tc16, s->img_out_n)) return 0;
+                  if (!stbi__compute_transparency16(z, tc16, s->img_out_n, s->img_x * s->img_y)) return 0;
                } else {
-                  if (!stbi__compute_transparency(z, tc, s->img_out_n)) return 0;
+                  if (!stbi__compute_transparency(z, tc, s->img_out_n, s->img_x * s->img_y)) return 0;
                }
             }
             if (is_iphone && stbi__de_iphone_flag && s->img_out_n > 2)
-               stbi__de_iphone(z);
+               stbi__de_iphone(z, s->img_x * s->img_y);
             if (pal_img_n) {
                // pal_img_n == 3 or 4
                s->img_n = pal_img_n; // record the actual colors we had
                s->img_out_n = pal_img_n;
                if (req_comp >= 3) s->img_out_n = req_comp;
-               if (!stbi__expand_png_palette(z, palette, pal_len, s->img_out_n))
+               if (!stbi__expand_png_palette(z, palette, pal_len, s->img_out_n, s->img_x * s->img_y))
                   return 0;
             } else if (has_trans) {
                // non-paletted image with tRNS -> source image has (constant) alpha
                ++s->img_n;
             }
-            STBI_FREE(z->expanded); z->expanded = NULL;
+            stbi__scratch_free(z->expanded); z->expanded = NULL;
             // end of PNG chunk, read and skip CRC
             stbi__get32be(s);
             return 1;
@@ -5222,8 +7003,8 @@ static void *stbi__do_png(stbi__png *p, int *x, int *y, int *n, int req_comp, st
       if (n) *n = p->s->img_n;
    }
    STBI_FREE(p->out);      p->out      = NULL;
-   STBI_FREE(p->expanded); p->expanded = NULL;
-   STBI_FREE(p->idata);    p->idata    = NULL;
+   stbi__scratch_free(p->expanded); p->expanded = NULL;
+   stbi__scratch_free(p->idata);    p->idata    = NULL;
 
    return result;
 }
@@ -5232,9 +7013,22 @@ static void *stbi__png_load(stbi__context *s, int *x, int *y, int *comp, int req
 {
    stbi__png p;
    p.s = s;
+   p.rows = NULL;
    return stbi__do_png(&p, x,y,comp,req_comp, ri);
 }
 
+static int stbi__png_load_rows(stbi__context *s, int req_comp, stbi__rows *rows)
+{
+   int result;
+   stbi__png p;
+   p.s = s;
+   p.rows = rows;
+   result = stbi__parse_png_file(&p, STBI__SCAN_load, req_comp);
+   STBI_FREE(p.out);
+   stbi__scratch_free(p.idata);
+   return result;
+}
+
 static int stbi__png_test(stbi__context *s)
 {
    int r;
@@ -5259,6 +7053,7 @@ static int stbi__png_info(stbi__context *s, int *x, int *y, int *comp)
 {
    stbi__png p;
    p.s = s;
+   p.rows = NULL;
    return stbi__png_info_raw(&p, x, y, comp);
 }
 
@@ -5266,6 +7061,7 @@ static int stbi__png_is16(stbi__context *s)
 {
    stbi__png p;
    p.s = s;
+   p.rows = NULL;
    if (!stbi__png_info_raw(&p, NULL, NULL, NULL))
 	   return 0;
    if (p.depth != 16) {
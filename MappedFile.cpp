@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+    : bytes(NULL), length(0)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 &&
+        static_cast<unsigned long long>(fileSize.QuadPart) <= static_cast<size_t>(-1))
+    {
+        // the view keeps the mapping and the file alive, both handles can go right away
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (bytes)
+                length = static_cast<size_t>(fileSize.QuadPart);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+    struct stat status;
+    if (fstat(file, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0 &&
+        static_cast<unsigned long long>(status.st_size) <= static_cast<size_t>(-1))
+    {
+        // the mapping holds its own reference to the file
+        void* view = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (view != MAP_FAILED)
+        {
+            length = static_cast<size_t>(status.st_size);
+            bytes = static_cast<const unsigned char*>(view);
+            // hints only, a mapping works the same without them
+            madvise(view, length, MADV_SEQUENTIAL);
+            madvise(view, length, MADV_WILLNEED);
+        }
+    }
+    close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (!bytes)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+#else
+    munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+}
+
+std::string temporaryPath(const std::string& path)
+{
+#ifdef _WIN32
+    const int process = _getpid();
+#else
+    const int process = getpid();
+#endif
+    return path + "." + std::to_string(process) + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+}
+
+bool replaceFile(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file through the virtual memory system (mmap on POSIX, a file
+// mapping on Windows), so a decoder reads it like a memory buffer without copying it
+// through read() calls first. Opened with a sequential hint (madvise MADV_SEQUENTIAL and
+// MADV_WILLNEED, FILE_FLAG_SEQUENTIAL_SCAN): the kernel reads ahead in large chunks and may
+// drop pages behind the reader. Empty files, special files and failed mappings leave
+// valid() false. The file must not be truncated while mapped, reading the cut-off pages
+// would raise SIGBUS.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return bytes != NULL; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes;
+    size_t length;
+};
+
+// Replacing a whole file so that readers see the old one or the new one, never a part of it:
+// write to temporaryPath(path), a name next to path no other thread or process writes to, then
+// replaceFile() it over path. On Windows the replace fails while path is open or mapped.
+std::string temporaryPath(const std::string& path);
+bool replaceFile(const std::string& from, const std::string& to);
@@ -0,0 +1,159 @@
+// stbi_load (the file read through stdio in small chunks by stbi__refill_buffer) against
+// loadImageMapped (the file mapped with MappedFile and decoded from memory), for warm files
+// (in the page cache) and cold ones (evicted with posix_fadvise(POSIX_FADV_DONTNEED) before
+// every load, so the data comes from the disk again). Reports wall time, read() calls and bytes
+// (syscr and rchar from /proc/self/io) and page faults (getrusage) per load. The mapped path
+// makes no read() calls, only open, fstat, mmap, two madvise, close and munmap per file.
+// Every decode is compared with the stbi_load result.
+// usage: MappedLoadBenchmark [repeats] [files...]
+//   texture1.jpg and texture2.jpg by default; Linux only
+// build with StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "StbImage.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Counters
+{
+    double seconds;
+    long long readCalls;
+    long long readBytes;
+    long minorFaults;
+    long majorFaults;
+};
+
+Counters sample()
+{
+    Counters counters = Counters();
+    counters.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (FILE* io = std::fopen("/proc/self/io", "r"))
+    {
+        char name[32];
+        long long value;
+        while (std::fscanf(io, "%31s %lld", name, &value) == 2)
+        {
+            if (std::strcmp(name, "syscr:") == 0)
+                counters.readCalls = value;
+            else if (std::strcmp(name, "rchar:") == 0)
+                counters.readBytes = value;
+        }
+        std::fclose(io);
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    counters.minorFaults = usage.ru_minflt;
+    counters.majorFaults = usage.ru_majflt;
+    return counters;
+}
+
+// drops the file's clean pages from the page cache
+void evict(const std::string& path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+    posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+    close(file);
+}
+
+struct Image
+{
+    std::string path;
+    std::vector<unsigned char> pixels;
+    int width, height;
+};
+
+// total over repeats passes through all images, false when a decode differs
+bool run(const std::vector<Image>& images, int repeats, bool mapped, bool cold, Counters& total)
+{
+    bool identical = true;
+    total = Counters();
+    // reading /proc/self/io counts as a read() too, taken off every load
+    const Counters first = sample();
+    const Counters second = sample();
+    const long long sampleCalls = second.readCalls - first.readCalls;
+    const long long sampleBytes = second.readBytes - first.readBytes;
+    for (int r = 0; r < repeats; r++)
+    {
+        for (const Image& image : images)
+        {
+            if (cold)
+                evict(image.path);
+            const Counters before = sample();
+            int width, height, components;
+            unsigned char* pixels = mapped ? loadImageMapped(image.path.c_str(), &width, &height, &components, 4)
+                : stbi_load(image.path.c_str(), &width, &height, &components, 4);
+            const Counters after = sample();
+            total.seconds += after.seconds - before.seconds;
+            total.readCalls += after.readCalls - before.readCalls - sampleCalls;
+            total.readBytes += after.readBytes - before.readBytes - sampleBytes;
+            total.minorFaults += after.minorFaults - before.minorFaults;
+            total.majorFaults += after.majorFaults - before.majorFaults;
+            identical = identical && pixels && width == image.width && height == image.height &&
+                std::memcmp(pixels, image.pixels.data(), image.pixels.size()) == 0;
+            stbi_image_free(pixels);
+        }
+    }
+    return identical;
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+    std::vector<std::string> paths(argv + std::min(argc, 2), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    std::vector<Image> images;
+    double megabytes = 0.0;
+    for (const std::string& path : paths)
+    {
+        Image image = { path, std::vector<unsigned char>(), 0, 0 };
+        int components;
+        unsigned char* pixels = stbi_load(path.c_str(), &image.width, &image.height, &components, 4);
+        if (!pixels)
+        {
+            std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+        image.pixels.assign(pixels, pixels + static_cast<size_t>(image.width) * image.height * 4);
+        stbi_image_free(pixels);
+        if (FILE* file = std::fopen(path.c_str(), "rb"))
+        {
+            std::fseek(file, 0, SEEK_END);
+            megabytes += std::ftell(file) / (1024.0 * 1024.0);
+            std::fclose(file);
+        }
+        images.push_back(image);
+    }
+    if (images.empty())
+        return 1;
+
+    const double loads = static_cast<double>(repeats) * images.size();
+    std::printf("%d files, %.1f MB, %d passes, per load:\n", static_cast<int>(images.size()), megabytes, repeats);
+    std::printf("%6s %10s %10s %12s %14s %14s %14s %10s\n", "cache", "path", "ms", "read calls", "read KB",
+        "minor faults", "major faults", "identical");
+    for (int cold = 0; cold < 2; cold++)
+    {
+        for (int mapped = 0; mapped < 2; mapped++)
+        {
+            Counters total;
+            const bool identical = run(images, repeats, mapped != 0, cold != 0, total);
+            std::printf("%6s %10s %10.2f %12.1f %14.1f %14.1f %14.1f %10s\n", cold ? "cold" : "warm", mapped ? "mmap" : "stdio",
+                total.seconds * 1000.0 / loads, total.readCalls / loads, total.readBytes / 1024.0 / loads,
+                total.minorFaults / loads, total.majorFaults / loads, identical ? "yes" : "NO");
+        }
+    }
+    return 0;
+}
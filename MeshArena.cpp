@@ -0,0 +1,171 @@
+#include "MeshArena.h"
+#include "GLCapabilities.h"
+
+#include <cstring>
+
+namespace
+{
+    // a buffer of bytes bound to target, mapped for good when storage is given; NULL when it is not mapped.
+    // Dynamic storage keeps glBufferSubData working on it after all, should the other buffer fail to map.
+    unsigned char* createBuffer(GLenum target, GLuint& buffer, size_t bytes, PFNGLBUFFERSTORAGEPROC bufferStorage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        if (bufferStorage)
+        {
+            bufferStorage(target, static_cast<GLsizeiptr>(bytes), NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+            if (unsigned char* memory = static_cast<unsigned char*>(glMapBufferRange(target, 0, static_cast<GLsizeiptr>(bytes), flags)))
+                return memory;
+            // immutable storage cannot be respecified, a failed mapping needs a new buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+        }
+        glBufferData(target, static_cast<GLsizeiptr>(bytes), NULL, GL_STATIC_DRAW);
+        return NULL;
+    }
+}
+
+MeshArena::MeshArena(GLsizei stride, const std::vector<VertexAttribute>& attributes, uint32_t vertexCapacity, uint32_t indexCapacity)
+    : vertexStride(stride), vao(0), vertexBuffer(0), indexBuffer(0), vertexMemory(NULL), indexMemory(NULL),
+      vertexAllocator(vertexCapacity), indexAllocator(indexCapacity)
+{
+    PFNGLBUFFERSTORAGEPROC bufferStorage = loadBufferStorage();
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    vertexMemory = createBuffer(GL_ARRAY_BUFFER, vertexBuffer, static_cast<size_t>(vertexCapacity) * stride, bufferStorage);
+    // bound while the VAO is, so the VAO keeps it
+    indexMemory = createBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, static_cast<size_t>(indexCapacity) * sizeof(GLuint),
+        vertexMemory ? bufferStorage : NULL);
+    for (const VertexAttribute& attribute : attributes)
+    {
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, stride,
+            reinterpret_cast<const void*>(attribute.offset));
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // both mapped or neither, so add() takes one way for both
+    if (vertexMemory && !indexMemory)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        vertexMemory = NULL;
+    }
+}
+
+bool MeshArena::add(const void* vertices, uint32_t vertexCount, const GLuint* indices, uint32_t indexCount, Mesh& mesh)
+{
+    mesh = Mesh();
+    if (!vertexAllocator.allocate(vertexCount, mesh.vertices))
+        return false;
+    if (!indexAllocator.allocate(indexCount, mesh.indices))
+    {
+        vertexAllocator.free(mesh.vertices);
+        return false;
+    }
+    mesh.indexCount = static_cast<GLsizei>(indexCount);
+    write(vertexBuffer, vertexMemory, static_cast<size_t>(mesh.vertices.offset) * vertexStride, vertices,
+        static_cast<size_t>(vertexCount) * vertexStride);
+    write(indexBuffer, indexMemory, static_cast<size_t>(mesh.indices.offset) * sizeof(GLuint), indices,
+        static_cast<size_t>(indexCount) * sizeof(GLuint));
+    return true;
+}
+
+void MeshArena::remove(Mesh& mesh)
+{
+    if (!mesh.valid())
+        return;
+    if (persistent())
+        removed.push_back({ mesh.vertices, mesh.indices });
+    else
+    {
+        // glBufferSubData waits for the draws reading the range, or copies aside
+        vertexAllocator.free(mesh.vertices);
+        indexAllocator.free(mesh.indices);
+    }
+    mesh = Mesh();
+}
+
+void MeshArena::retire()
+{
+    while (!pending.empty())
+    {
+        const GLenum state = glClientWaitSync(pending.front().fence, 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(pending.front().fence);
+        for (Retired& ranges : pending.front().ranges)
+        {
+            vertexAllocator.free(ranges.vertices);
+            indexAllocator.free(ranges.indices);
+        }
+        pending.erase(pending.begin());
+    }
+    // one fence for everything removed since the last call, behind every draw that could read it
+    if (!removed.empty())
+    {
+        pending.push_back({ std::vector<Retired>(), glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+        pending.back().ranges.swap(removed);
+    }
+}
+
+void MeshArena::draw(const Mesh& mesh, GLenum mode) const
+{
+    glDrawElementsBaseVertex(mode, mesh.indexCount, GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(static_cast<size_t>(mesh.indices.offset) * sizeof(GLuint)),
+        static_cast<GLint>(mesh.vertices.offset));
+}
+
+void MeshArena::draw(const Mesh* const* meshes, size_t count, GLenum mode)
+{
+    counts.resize(count);
+    firsts.resize(count);
+    bases.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        counts[i] = meshes[i]->indexCount;
+        firsts[i] = reinterpret_cast<const void*>(static_cast<size_t>(meshes[i]->indices.offset) * sizeof(GLuint));
+        bases[i] = static_cast<GLint>(meshes[i]->vertices.offset);
+    }
+    glMultiDrawElementsBaseVertex(mode, counts.data(), GL_UNSIGNED_INT, firsts.data(), static_cast<GLsizei>(count), bases.data());
+}
+
+void MeshArena::destroy()
+{
+    for (const Pending& batch : pending)
+        glDeleteSync(batch.fence);
+    pending.clear();
+    removed.clear();
+    if (persistent())
+    {
+        // GL_COPY_WRITE_BUFFER leaves the element array binding of whatever VAO is bound alone
+        for (const GLuint buffer : { vertexBuffer, indexBuffer })
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    vao = vertexBuffer = indexBuffer = 0;
+    vertexMemory = indexMemory = NULL;
+}
+
+void MeshArena::write(GLuint buffer, unsigned char* memory, size_t offset, const void* data, size_t bytes)
+{
+    if (bytes == 0)
+        return;
+    if (memory)
+    {
+        std::memcpy(memory + offset, data, bytes);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes), data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
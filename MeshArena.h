@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RangeAllocator.h"
+
+// One vertex attribute of a MeshArena's format, as glVertexAttribPointer takes it
+struct VertexAttribute
+{
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;      // bytes from the start of the vertex
+};
+
+// Vertex and index data of many meshes of one vertex format in one vertex buffer and one index
+// buffer behind a single VAO, instead of a VAO, VBO and EBO per mesh. add() takes a range of each
+// buffer from a RangeAllocator (counted in vertices and in indices, so no range needs padding)
+// and copies the data in; draw() is glDrawElementsBaseVertex with the mesh's first index and
+// first vertex, so the indices stay relative to the mesh and every mesh is drawn with the arena's
+// VAO bound once. A list of meshes goes out in one glMultiDrawElementsBaseVertex.
+// Where glBufferStorage is there (GL 4.4 / GL_ARB_buffer_storage) both buffers are mapped once,
+// persistently and coherently, and add() is a memcpy; a removed mesh's ranges are then only reused
+// after a fence set by the next retire() has signaled, since draws in flight may still read them.
+// Otherwise add() uses glBufferSubData and ranges are reused at once. The buffers do not grow:
+// add() fails when one of them is full, and a scene that outgrows it needs another arena.
+class MeshArena
+{
+public:
+    struct Mesh
+    {
+        RangeAllocator::Range vertices, indices;
+        GLsizei indexCount = 0;
+
+        bool valid() const { return vertices.valid(); }
+    };
+
+    // GL thread, once GL is loaded; stride in bytes, capacities in vertices and in indices
+    MeshArena(GLsizei stride, const std::vector<VertexAttribute>& attributes, uint32_t vertexCapacity, uint32_t indexCapacity);
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    bool persistent() const { return vertexMemory != NULL; }
+
+    // GL thread: false, with mesh left invalid, when either buffer has no room left. Indices count
+    // from the mesh's first vertex, GL_UNSIGNED_INT. indexCount == 0 is not drawable.
+    bool add(const void* vertices, uint32_t vertexCount, const GLuint* indices, uint32_t indexCount, Mesh& mesh);
+    // GL thread: mesh must not be drawn again, it is left invalid
+    void remove(Mesh& mesh);
+    // GL thread, once per frame: ranges removed before the draws still running become free once
+    // those draws are done
+    void retire();
+
+    // GL thread: binds the VAO, which every draw below needs
+    void bind() const { glBindVertexArray(vao); }
+    void draw(const Mesh& mesh, GLenum mode = GL_TRIANGLES) const;
+    void draw(const Mesh* const* meshes, size_t count, GLenum mode = GL_TRIANGLES);
+
+    GLuint vertexArray() const { return vao; }
+    const RangeAllocator& vertexRanges() const { return vertexAllocator; }
+    const RangeAllocator& indexRanges() const { return indexAllocator; }
+
+    // GL thread: unmaps and deletes the buffers, the VAO and the fences
+    void destroy();
+
+private:
+    struct Retired
+    {
+        RangeAllocator::Range vertices, indices;
+    };
+
+    struct Pending
+    {
+        std::vector<Retired> ranges;
+        GLsync fence;
+    };
+
+    void write(GLuint buffer, unsigned char* memory, size_t offset, const void* data, size_t bytes);
+
+    GLsizei vertexStride;
+    GLuint vao, vertexBuffer, indexBuffer;
+    unsigned char* vertexMemory;
+    unsigned char* indexMemory;
+    RangeAllocator vertexAllocator, indexAllocator;
+    std::vector<Retired> removed;           // since the last retire(), no fence yet
+    std::vector<Pending> pending;           // oldest first
+    // glMultiDrawElementsBaseVertex arguments, kept between calls
+    std::vector<GLsizei> counts;
+    std::vector<const void*> firsts;
+    std::vector<GLint> bases;
+};
@@ -0,0 +1,437 @@
+#include "MipChain.h"
+#include "CpuFeatures.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define MC_TARGET_SSE2
+#define MC_TARGET_AVX2
+#else
+#define MC_TARGET_SSE2 __attribute__((target("sse2")))
+#define MC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    typedef MipChainBuilder::Filter Filter;
+
+    const int maxTaps = 6;
+    // texels replicated on both sides of a vertically filtered row, so no horizontal tap needs a clamp
+    const int padLeft = 2, padRight = 3;
+    // linear values are encoded to sRGB through a table of this many steps
+    const int encodeSteps = 16384;
+    // output texels per parallelFor job
+    const int texelsPerJob = 32768;
+
+    const uint32_t fileMagic = 0x434D4B47;      // "GKMC"
+    const uint32_t fileVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        int32_t width, height, channels, levels;
+        uint64_t bytes;
+    };
+
+    // source texel offsets of output texel x (from 2x) and their weights, the same both ways
+    struct Taps
+    {
+        int count;
+        int offset[maxTaps];
+        float weight[maxTaps];
+    };
+
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 25; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    Taps tapsFor(Filter filter)
+    {
+        Taps taps;
+        if (filter == Filter::Box)
+        {
+            taps.count = 2;
+            taps.offset[0] = 0;
+            taps.offset[1] = 1;
+            taps.weight[0] = taps.weight[1] = 0.5f;
+            return taps;
+        }
+
+        // sinc at half the source rate under a Kaiser window reaching 3 source texels out
+        const double pi = 3.14159265358979323846, alpha = 4.0, radius = 3.0;
+        double weights[maxTaps], sum = 0.0;
+        taps.count = maxTaps;
+        for (int k = 0; k < maxTaps; k++)
+        {
+            taps.offset[k] = k - 2;
+            const double distance = taps.offset[k] - 0.5;   // from the center, 2x + 0.5
+            const double t = distance / 2.0, u = distance / radius;
+            const double sinc = std::sin(pi * t) / (pi * t);
+            weights[k] = sinc * besselI0(alpha * std::sqrt(1.0 - u * u)) / besselI0(alpha);
+            sum += weights[k];
+        }
+        for (int k = 0; k < maxTaps; k++)
+            taps.weight[k] = static_cast<float>(weights[k] / sum);
+        return taps;
+    }
+
+    struct Tables
+    {
+        float srgbToLinear[256];
+        unsigned char linearToSrgb[encodeSteps + 1];
+
+        Tables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                const double c = i / 255.0;
+                srgbToLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+            }
+            for (int i = 0; i <= encodeSteps; i++)
+            {
+                const double v = static_cast<double>(i) / encodeSteps;
+                const double s = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+                linearToSrgb[i] = static_cast<unsigned char>(std::min(255.0, s * 255.0 + 0.5));
+            }
+        }
+    };
+
+    const Tables& tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    // where channel c of a channels-texel lives in the RGBA float texel: gray + alpha is x and w
+    int slotOf(int channels, int c)
+    {
+        return channels == 2 && c == 1 ? 3 : c;
+    }
+
+    bool isAlpha(int channels, int c)
+    {
+        return (channels == 2 && c == 1) || (channels == 4 && c == 3);
+    }
+
+    // out[i] = w0 * rows[0][i] + w1 * rows[1][i] + ..., summed in that order
+    typedef void (*VerticalKernel)(const float* const* rows, const float* weights, int taps, int floats, float* out);
+    // out texel x = clamp(sum of weight[k] * in texel (2x + offset[k]), 0, 1); in is padded
+    typedef void (*HorizontalKernel)(const float* in, const Taps& taps, int width, float* out);
+
+    // The SIMD kernels evaluate exactly these expressions in the same order, lane by lane.
+    void verticalScalar(const float* const* rows, const float* weights, int taps, int floats, float* out)
+    {
+        for (int i = 0; i < floats; i++)
+        {
+            float sum = weights[0] * rows[0][i];
+            for (int k = 1; k < taps; k++)
+                sum = sum + weights[k] * rows[k][i];
+            out[i] = sum;
+        }
+    }
+
+    void horizontalScalar(const float* in, const Taps& taps, int width, float* out)
+    {
+        for (int x = 0; x < width; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = taps.weight[0] * in[(2 * x + taps.offset[0]) * 4 + c];
+                for (int k = 1; k < taps.count; k++)
+                    sum = sum + taps.weight[k] * in[(2 * x + taps.offset[k]) * 4 + c];
+                out[x * 4 + c] = std::min(std::max(sum, 0.0f), 1.0f);
+            }
+    }
+
+#ifdef MC_X86
+    MC_TARGET_SSE2 void verticalSse2(const float* const* rows, const float* weights, int taps, int floats, float* out)
+    {
+        int i = 0;
+        for (; i + 4 <= floats; i += 4)
+        {
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+            for (int k = 1; k < taps; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+            _mm_storeu_ps(out + i, sum);
+        }
+        const float* tail[maxTaps];
+        for (int k = 0; k < taps; k++)
+            tail[k] = rows[k] + i;
+        verticalScalar(tail, weights, taps, floats - i, out + i);
+    }
+
+    MC_TARGET_SSE2 void horizontalSse2(const float* in, const Taps& taps, int width, float* out)
+    {
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for (int x = 0; x < width; x++)
+        {
+            __m128 sum = _mm_mul_ps(_mm_set1_ps(taps.weight[0]), _mm_loadu_ps(in + (2 * x + taps.offset[0]) * 4));
+            for (int k = 1; k < taps.count; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.weight[k]), _mm_loadu_ps(in + (2 * x + taps.offset[k]) * 4)));
+            _mm_storeu_ps(out + x * 4, _mm_min_ps(_mm_max_ps(sum, zero), one));
+        }
+    }
+
+    MC_TARGET_AVX2 void verticalAvx2(const float* const* rows, const float* weights, int taps, int floats, float* out)
+    {
+        int i = 0;
+        for (; i + 8 <= floats; i += 8)
+        {
+            __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+            for (int k = 1; k < taps; k++)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+            _mm256_storeu_ps(out + i, sum);
+        }
+        const float* tail[maxTaps];
+        for (int k = 0; k < taps; k++)
+            tail[k] = rows[k] + i;
+        verticalScalar(tail, weights, taps, floats - i, out + i);
+    }
+
+    // texels x and x + 1 share a register, their taps are 8 floats apart
+    MC_TARGET_AVX2 inline __m256 texelPair(const float* in, int x, int offset)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in + (2 * x + offset) * 4)),
+            _mm_loadu_ps(in + (2 * x + 2 + offset) * 4), 1);
+    }
+
+    MC_TARGET_AVX2 void horizontalAvx2(const float* in, const Taps& taps, int width, float* out)
+    {
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        int x = 0;
+        for (; x + 2 <= width; x += 2)
+        {
+            __m256 sum = _mm256_mul_ps(_mm256_set1_ps(taps.weight[0]), texelPair(in, x, taps.offset[0]));
+            for (int k = 1; k < taps.count; k++)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(taps.weight[k]), texelPair(in, x, taps.offset[k])));
+            _mm256_storeu_ps(out + x * 4, _mm256_min_ps(_mm256_max_ps(sum, zero), one));
+        }
+        horizontalScalar(in + x * 2 * 4, taps, width - x, out + x * 4);
+    }
+#endif
+
+    void encodeRow(const float* in, int width, int channels, bool srgb, unsigned char* out)
+    {
+        const unsigned char* toSrgb = tables().linearToSrgb;
+        for (int x = 0; x < width; x++)
+            for (int c = 0; c < channels; c++)
+            {
+                const float v = std::min(std::max(in[x * 4 + slotOf(channels, c)], 0.0f), 1.0f);
+                out[x * channels + c] = srgb && !isAlpha(channels, c)
+                    ? toSrgb[static_cast<int>(v * encodeSteps + 0.5f)]
+                    : static_cast<unsigned char>(v * 255.0f + 0.5f);
+            }
+    }
+
+    size_t chainBytes(int width, int height, int channels, std::vector<MipChain::Level>* levels)
+    {
+        size_t bytes = 0;
+        for (;;)
+        {
+            if (levels)
+                levels->push_back({ width, height, bytes });
+            bytes += static_cast<size_t>(width) * height * channels;
+            if (width == 1 && height == 1)
+                return bytes;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    }
+}
+
+MipChainBuilder::MipChainBuilder(ThreadPool* pool)
+    : selected(Kernel::Scalar), pool(pool)
+{
+    setKernel(Kernel::AVX2);
+}
+
+bool MipChainBuilder::kernelSupported(Kernel candidate)
+{
+    switch (candidate)
+    {
+#ifdef MC_X86
+    case Kernel::SSE2:
+        return true;
+    case Kernel::AVX2:
+        return cpuHasAvx2();
+#endif
+    case Kernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* MipChainBuilder::kernelName(Kernel candidate)
+{
+    switch (candidate)
+    {
+    case Kernel::SSE2: return "SSE2";
+    case Kernel::AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+void MipChainBuilder::setKernel(Kernel wanted)
+{
+    if (!kernelSupported(wanted))
+        wanted = kernelSupported(Kernel::AVX2) ? Kernel::AVX2 :
+            kernelSupported(Kernel::SSE2) ? Kernel::SSE2 : Kernel::Scalar;
+    selected = wanted;
+}
+
+void MipChainBuilder::build(const unsigned char* pixels, int width, int height, int channels, MipChain& chain,
+    Filter filter, bool srgb) const
+{
+    chain.channels = channels;
+    chain.levels.clear();
+    chain.pixels.resize(chainBytes(width, height, channels, &chain.levels));
+    std::copy(pixels, pixels + static_cast<size_t>(width) * height * channels, chain.pixels.begin());
+
+    VerticalKernel vertical = verticalScalar;
+    HorizontalKernel horizontal = horizontalScalar;
+#ifdef MC_X86
+    if (selected == Kernel::SSE2)
+    {
+        vertical = verticalSse2;
+        horizontal = horizontalSse2;
+    }
+    else if (selected == Kernel::AVX2)
+    {
+        vertical = verticalAvx2;
+        horizontal = horizontalAvx2;
+    }
+#endif
+
+    const Taps taps = tapsFor(filter);
+    float decode[4][256];
+    for (int c = 0; c < channels; c++)
+        for (int i = 0; i < 256; i++)
+            decode[c][i] = srgb && !isAlpha(channels, c) ? tables().srgbToLinear[i] : i / 255.0f;
+
+    // the level before in RGBA floats, level 0 is read from its bytes instead
+    std::vector<float> previous, next;
+    for (size_t level = 1; level < chain.levels.size(); level++)
+    {
+        const MipChain::Level source = chain.levels[level - 1], target = chain.levels[level];
+        const bool last = level + 1 == chain.levels.size();
+        next.assign(last ? 0 : static_cast<size_t>(target.width) * target.height * 4, 0.0f);
+        const int rowsPerJob = std::max(1, texelsPerJob / target.width);
+        const int jobs = (target.height + rowsPerJob - 1) / rowsPerJob;
+
+        auto job = [&](int index, unsigned)
+        {
+            const size_t sourceFloats = static_cast<size_t>(source.width) * 4;
+            std::vector<float> padded((source.width + padLeft + padRight) * 4), row(last ? target.width * 4 : 0);
+            // level 0 rows converted to floats, row y in slot y % 8, which holds all rows of a tap window
+            std::vector<float> converted(level == 1 ? sourceFloats * 8 : 0);
+            int convertedRow[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+            auto sourceRow = [&](int y) -> const float*
+            {
+                if (level > 1)
+                    return previous.data() + sourceFloats * y;
+                float* slot = converted.data() + sourceFloats * (y & 7);
+                if (convertedRow[y & 7] != y)
+                {
+                    const unsigned char* bytes = chain.pixels.data() + static_cast<size_t>(source.width) * channels * y;
+                    for (int x = 0; x < source.width; x++)
+                    {
+                        float* texel = slot + x * 4;
+                        texel[0] = texel[1] = texel[2] = texel[3] = 0.0f;
+                        for (int c = 0; c < channels; c++)
+                            texel[slotOf(channels, c)] = decode[c][bytes[x * channels + c]];
+                    }
+                    convertedRow[y & 7] = y;
+                }
+                return slot;
+            };
+
+            const int end = std::min(target.height, (index + 1) * rowsPerJob);
+            for (int y = index * rowsPerJob; y < end; y++)
+            {
+                const float* rows[maxTaps];
+                for (int k = 0; k < taps.count; k++)
+                    rows[k] = sourceRow(std::min(std::max(2 * y + taps.offset[k], 0), source.height - 1));
+                float* middle = padded.data() + padLeft * 4;
+                vertical(rows, taps.weight, taps.count, source.width * 4, middle);
+                for (int c = 0; c < 4; c++)
+                {
+                    for (int x = 1; x <= padLeft; x++)
+                        middle[-x * 4 + c] = middle[c];
+                    for (int x = 0; x < padRight; x++)
+                        middle[(source.width + x) * 4 + c] = middle[(source.width - 1) * 4 + c];
+                }
+                float* out = last ? row.data() : next.data() + static_cast<size_t>(target.width) * 4 * y;
+                horizontal(middle, taps, target.width, out);
+                encodeRow(out, target.width, channels, srgb,
+                    chain.pixels.data() + target.offset + static_cast<size_t>(target.width) * channels * y);
+            }
+        };
+        if (pool && pool->size() > 1 && jobs > 1)
+            pool->parallelFor(jobs, job);
+        else
+            for (int i = 0; i < jobs; i++)
+                job(i, 0);
+        previous.swap(next);
+    }
+}
+
+bool saveMipChain(const std::string& path, const MipChain& chain)
+{
+    if (chain.levels.empty())
+        return false;
+    // written under a name of its own and renamed into place, so a reader never sees half a
+    // chain and two writers of one path never mix their bytes
+    const std::string temporary = temporaryPath(path);
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    const FileHeader header = { fileMagic, fileVersion, chain.levels[0].width, chain.levels[0].height, chain.channels,
+        static_cast<int32_t>(chain.levels.size()), chain.pixels.size() };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(chain.pixels.data(), 1, chain.pixels.size(), file) == chain.pixels.size();
+    written = fclose(file) == 0 && written;
+    written = written && replaceFile(temporary, path);
+    if (!written)
+        remove(temporary.c_str());
+    return written;
+}
+
+bool loadMipChain(const std::string& path, MipChain& chain)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    FileHeader header;
+    std::vector<MipChain::Level> levels;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == fileMagic && header.version == fileVersion &&
+        header.width > 0 && header.height > 0 && header.channels >= 1 && header.channels <= 4 &&
+        chainBytes(header.width, header.height, header.channels, &levels) == header.bytes &&
+        levels.size() == static_cast<size_t>(header.levels);
+    if (valid)
+    {
+        chain.pixels.resize(static_cast<size_t>(header.bytes));
+        valid = fread(chain.pixels.data(), 1, chain.pixels.size(), file) == chain.pixels.size();
+    }
+    fclose(file);
+    if (!valid)
+        return false;
+    chain.channels = header.channels;
+    chain.levels.swap(levels);
+    return true;
+}
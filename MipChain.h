@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// All mip levels of an 8-bit image, level 0 down to 1x1, packed one after another with tightly
+// packed rows (GL_UNPACK_ALIGNMENT 1). Every level is half the size of the one before, rounded
+// down, at least 1, as GL expects for a complete texture.
+struct MipChain
+{
+    struct Level
+    {
+        int width, height;
+        size_t offset;          // into pixels
+    };
+
+    int channels = 0;
+    std::vector<Level> levels;
+    std::vector<unsigned char> pixels;
+
+    const unsigned char* level(size_t index) const { return pixels.data() + levels[index].offset; }
+};
+
+// Builds mip chains on the CPU, for GL implementations where glGenerateMipmap is missing or slow
+// and for control over the filter. Each level is filtered from the one before it, kept in linear
+// floats between levels: with srgb, color channels are decoded from sRGB first and encoded again
+// for every level, so dark and bright texels average the way the eye sees them; alpha (the last
+// channel of 2 or 4) is always linear. Box averages 2x2 texels; an odd last row or column only
+// reaches the level through its neighbour's edge clamp. Kaiser is a separable 6x6 Kaiser-windowed
+// sinc (alpha 4), sharper and without box aliasing, clamped to [0, 1] against its ringing.
+// The SIMD kernels filter one RGBA texel per SSE2 register and two per AVX2 register and give the
+// same bytes as the scalar one; the rows of each level are split across a ThreadPool.
+class MipChainBuilder
+{
+public:
+    enum class Filter
+    {
+        Box,
+        Kaiser
+    };
+
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // pool == NULL builds on the calling thread; the pool must outlive the builder
+    explicit MipChainBuilder(ThreadPool* pool = NULL);
+
+    // the best kernel supported by the CPU is picked in the constructor;
+    // asking for an unsupported one falls back to the best supported
+    void setKernel(Kernel kernel);
+    Kernel kernel() const { return selected; }
+    static bool kernelSupported(Kernel candidate);
+    static const char* kernelName(Kernel candidate);
+
+    // level 0 is copied from pixels (width * channels bytes per row, channels 1 to 4); may be
+    // called from several threads at once
+    void build(const unsigned char* pixels, int width, int height, int channels, MipChain& chain,
+        Filter filter = Filter::Box, bool srgb = true) const;
+
+private:
+    Kernel selected;
+    ThreadPool* pool;
+};
+
+// A chain in a file of its own: a small header, then the pixels as they are in memory.
+// save writes a temporary file and renames it over path, so concurrent saves and loads of one
+// path see a whole chain or none; load fails on anything written by another version or cut short.
+bool saveMipChain(const std::string& path, const MipChain& chain);
+bool loadMipChain(const std::string& path, MipChain& chain);
@@ -0,0 +1,161 @@
+// Building full mip chains on the CPU with MipChainBuilder: every filter (Box, Kaiser) with every
+// kernel the CPU supports, on one thread and on a ThreadPool, compared byte for byte with the
+// scalar kernel. Then the cost of a chain read from disk against decoding and filtering again:
+// loadMipChain on a saved chain versus stbi_load + build.
+// The default images are texture1.jpg, texture2.jpg and a generated 4096x4096 RGBA picture
+// (gradients under fine stripes, which a box filter aliases).
+// usage: MipChainBenchmark [repeats] [threads] [files...]
+//   threads 0 is std::thread::hardware_concurrency()
+// build with MipChain.cpp, CpuFeatures.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "MipChain.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Image
+    {
+        std::string name;
+        std::string path;   // empty for the generated one
+        std::vector<unsigned char> pixels;
+        int width, height, channels;
+    };
+
+    Image generated(int size)
+    {
+        Image image = { "generated " + std::to_string(size) + "x" + std::to_string(size), "", {}, size, size, 4 };
+        image.pixels.resize(static_cast<size_t>(size) * size * 4);
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+            {
+                unsigned char* texel = &image.pixels[(static_cast<size_t>(y) * size + x) * 4];
+                const bool stripe = ((x + y / 3) % 3) == 0;
+                texel[0] = static_cast<unsigned char>(stripe ? 255 : x * 255 / size);
+                texel[1] = static_cast<unsigned char>(stripe ? 0 : y * 255 / size);
+                texel[2] = static_cast<unsigned char>((x ^ y) & 0xff);
+                texel[3] = static_cast<unsigned char>(255 - (x + y) * 255 / (2 * size));
+            }
+        return image;
+    }
+
+    double buildSeconds(const MipChainBuilder& builder, const Image& image, MipChainBuilder::Filter filter, int repeats, MipChain& chain)
+    {
+        double best = 1e9;
+        for (int i = 0; i < repeats; i++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            builder.build(image.pixels.data(), image.width, image.height, image.channels, chain, filter);
+            best = std::min(best, secondsSince(start));
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    ThreadPool pool(argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0);
+    std::vector<std::string> paths(argv + std::min(argc, 3), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    std::vector<Image> images;
+    for (const std::string& path : paths)
+    {
+        Image image = { path, path, {}, 0, 0, 0 };
+        unsigned char* pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+        if (!pixels)
+        {
+            std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+        image.pixels.assign(pixels, pixels + static_cast<size_t>(image.width) * image.height * image.channels);
+        stbi_image_free(pixels);
+        images.push_back(image);
+    }
+    if (argc <= 3)
+        images.push_back(generated(4096));
+
+    bool identical = true;
+    const MipChainBuilder::Kernel kernels[] = { MipChainBuilder::Kernel::Scalar, MipChainBuilder::Kernel::SSE2, MipChainBuilder::Kernel::AVX2 };
+    std::printf("best of %d, sRGB, level 0 MB/s over the whole chain\n", repeats);
+    std::printf("%24s %7s %7s %8s %10s %10s %10s\n", "image", "filter", "kernel", "threads", "ms", "MB/s", "identical");
+    for (const Image& image : images)
+    {
+        const double megabytes = static_cast<double>(image.pixels.size()) / (1 << 20);
+        for (const MipChainBuilder::Filter filter : { MipChainBuilder::Filter::Box, MipChainBuilder::Filter::Kaiser })
+        {
+            MipChain reference;
+            MipChainBuilder scalar(NULL);
+            scalar.setKernel(MipChainBuilder::Kernel::Scalar);
+            scalar.build(image.pixels.data(), image.width, image.height, image.channels, reference, filter);
+            for (const MipChainBuilder::Kernel kernel : kernels)
+            {
+                if (!MipChainBuilder::kernelSupported(kernel))
+                    continue;
+                for (ThreadPool* buildPool : { static_cast<ThreadPool*>(NULL), &pool })
+                {
+                    if (buildPool && pool.size() < 2)
+                        continue;
+                    MipChainBuilder builder(buildPool);
+                    builder.setKernel(kernel);
+                    MipChain chain;
+                    const double seconds = buildSeconds(builder, image, filter, repeats, chain);
+                    const bool same = chain.pixels == reference.pixels;
+                    identical = identical && same;
+                    std::printf("%24s %7s %7s %8u %10.2f %10.0f %10s\n", image.name.c_str(),
+                        filter == MipChainBuilder::Filter::Box ? "box" : "Kaiser", MipChainBuilder::kernelName(kernel),
+                        buildPool ? buildPool->size() : 1u, seconds * 1000.0, megabytes / seconds, same ? "yes" : "NO");
+                }
+            }
+        }
+    }
+
+    // a saved chain against decoding the file and filtering it again
+    std::printf("\n%24s %16s %16s %10s\n", "file, box", "decode+build ms", "load chain ms", "identical");
+    MipChainBuilder builder(&pool);
+    for (const Image& image : images)
+    {
+        if (image.path.empty())
+            continue;
+        MipChain built, loaded;
+        double rebuild = 1e9, load = 1e9;
+        for (int i = 0; i < repeats; i++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(image.path.c_str(), &width, &height, &channels, 0);
+            builder.build(pixels, width, height, channels, built);
+            stbi_image_free(pixels);
+            rebuild = std::min(rebuild, secondsSince(start));
+        }
+        const std::string chainPath = "MipChainBenchmark.mip";
+        if (!saveMipChain(chainPath, built))
+        {
+            std::printf("%24s: cannot write %s\n", image.name.c_str(), chainPath.c_str());
+            identical = false;
+            continue;
+        }
+        bool read = true;
+        for (int i = 0; i < repeats; i++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            read = loadMipChain(chainPath, loaded) && read;
+            load = std::min(load, secondsSince(start));
+        }
+        std::remove(chainPath.c_str());
+        const bool same = read && loaded.pixels == built.pixels && loaded.levels.size() == built.levels.size();
+        identical = identical && same;
+        std::printf("%24s %16.2f %16.2f %10s\n", image.name.c_str(), rebuild * 1000.0, load * 1000.0, same ? "yes" : "NO");
+    }
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#include "NormalMatrix.h"
+
+#include <glm/gtc/type_aligned.hpp>
+
+// glm's SIMD matrix functions only apply to the aligned types, which need GLM_FORCE_INTRINSICS and
+// GLM_FORCE_ALIGNED_GENTYPES. Both are project-wide definitions: set per file, glm's inline functions
+// would differ between files.
+glm::mat3 normalMatrix(const glm::mat4& model)
+{
+#if GLM_CONFIG_SIMD == GLM_ENABLE && GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE
+    const glm::aligned_mat4 inverse = glm::inverse(glm::aligned_mat4(model));
+    return glm::transpose(glm::mat3(glm::mat4(inverse)));
+#else
+    return glm::transpose(glm::mat3(glm::inverse(model)));
+#endif
+}
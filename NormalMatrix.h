@@ -0,0 +1,8 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// mat3(transpose(inverse(model))), the matrix for transforming normals of an object.
+// Computed once per object on the CPU instead of once per vertex in the vertex shader;
+// the 4x4 inverse uses glm's SSE2/NEON implementation where the compiler allows it.
+glm::mat3 normalMatrix(const glm::mat4& model);
@@ -0,0 +1,216 @@
+// Vertex throughput of the Zadanie9 lighting vertex shader with the normal matrix computed
+// per vertex in GLSL (mat3(transpose(inverse(model)))) against a uniform computed once per
+// object on the CPU (normalMatrix), for grid meshes of 10k to 1M vertices.
+// The vertices are drawn as points with GL_RASTERIZER_DISCARD so only the vertex stage is
+// measured, not triangle setup or shading.
+// usage: NormalMatrixBenchmark [frames]
+// build with glad.c, ShaderProgram.cpp, GLCapabilities.cpp, NormalMatrix.cpp and GLFW, every file with
+// -DGLM_FORCE_INTRINSICS -DGLM_FORCE_ALIGNED_GENTYPES like the project
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "NormalMatrix.h"
+#include "ShaderProgram.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const unsigned int window_width = 64;
+const unsigned int window_height = 64;
+const int objectsPerFrame = 8;
+
+const GLchar* vertexShaderInverseSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"layout(location = 1) in vec3 normal;\n"
+"out vec3 fragmentPosition;\n"
+"out vec3 Normal;\n"
+"uniform mat4 model;\n"
+"uniform mat4 viewProjection;\n"
+"void main()\n"
+"{\n"
+"    fragmentPosition = vec3(model * vec4(position, 1.0));\n"
+"    Normal = mat3(transpose(inverse(model))) * normal;\n"
+"    gl_Position = viewProjection * model * vec4(position, 1.0);\n"
+"}\0";
+
+const GLchar* vertexShaderUniformSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"layout(location = 1) in vec3 normal;\n"
+"out vec3 fragmentPosition;\n"
+"out vec3 Normal;\n"
+"uniform mat4 model;\n"
+"uniform mat3 normalMatrix;\n"
+"uniform mat4 viewProjection;\n"
+"void main()\n"
+"{\n"
+"    fragmentPosition = vec3(model * vec4(position, 1.0));\n"
+"    Normal = normalMatrix * normal;\n"
+"    gl_Position = viewProjection * model * vec4(position, 1.0);\n"
+"}\0";
+
+const GLchar* fragmentShaderSource =
+"#version 330 core\n"
+"in vec3 Normal;\n"
+"in vec3 fragmentPosition;\n"
+"out vec4 fragmentColor;\n"
+"void main()\n"
+"{\n"
+"    float diff = max(dot(normalize(Normal), normalize(vec3(3.0, 2.0, 0.0) - fragmentPosition)), 0.0);\n"
+"    fragmentColor = vec4(vec3(0.15 + diff) * vec3(0.0, 1.0, 0.0), 1.0);\n"
+"}\0";
+
+struct Mesh
+{
+    GLuint VAO, VBO;
+    int vertices;
+};
+
+// side x side vertices of a wavy grid, position + normal like the Zadanie9 VBO
+Mesh makeGrid(int side)
+{
+    std::vector<float> vertices;
+    vertices.reserve(static_cast<size_t>(side) * side * 6);
+    for (int y = 0; y < side; y++)
+    {
+        for (int x = 0; x < side; x++)
+        {
+            const float u = x / float(side - 1) * 2.0f - 1.0f;
+            const float v = y / float(side - 1) * 2.0f - 1.0f;
+            const float height = 0.1f * std::sin(u * 6.0f) * std::cos(v * 6.0f);
+            const glm::vec3 normal = glm::normalize(glm::vec3(-0.6f * std::cos(u * 6.0f) * std::cos(v * 6.0f),
+                0.6f * std::sin(u * 6.0f) * std::sin(v * 6.0f), 1.0f));
+            const float vertex[] = { u, v, height, normal.x, normal.y, normal.z };
+            vertices.insert(vertices.end(), vertex, vertex + 6);
+        }
+    }
+
+    Mesh mesh;
+    mesh.vertices = side * side;
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    glBindVertexArray(mesh.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    return mesh;
+}
+
+void deleteMesh(Mesh& mesh)
+{
+    glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteBuffers(1, &mesh.VBO);
+}
+
+// seconds per frame of objectsPerFrame draws of the mesh, each with its own model matrix
+double renderFrames(ShaderProgram& program, bool cpuNormalMatrix, const Mesh& mesh, int frames)
+{
+    const int modelLoc = program.uniform("model");
+    const int normalMatrixLoc = program.uniform("normalMatrix");
+    const int viewProjectionLoc = program.uniform("viewProjection");
+
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    program.use();
+    program.set(viewProjectionLoc, projection * view);
+    glBindVertexArray(mesh.VAO);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    std::chrono::steady_clock::time_point start;
+    for (int frame = -1; frame < frames; frame++)
+    {
+        // frame -1 warms up the driver and is not timed
+        if (frame == 0)
+        {
+            glFinish();
+            start = std::chrono::steady_clock::now();
+        }
+        for (int object = 0; object < objectsPerFrame; object++)
+        {
+            glm::mat4 model = glm::rotate(glm::mat4(1.0f), 0.1f * frame + object, glm::vec3(0.3f, 1.0f, 0.0f));
+            model = glm::scale(model, glm::vec3(1.0f, 1.0f + 0.1f * object, 1.0f));
+            program.set(modelLoc, model);
+            if (cpuNormalMatrix)
+                program.set(normalMatrixLoc, normalMatrix(model));
+            glDrawArrays(GL_POINTS, 0, mesh.vertices);
+        }
+    }
+    glFinish();
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(0);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 20;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(window_width, window_height, "NormalMatrixBenchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGL())
+    {
+        std::printf("Failed to initialize GLAD\n");
+        return -1;
+    }
+    std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+    // nothing reaches the pixels, but a complete framebuffer keeps drivers from skipping draws
+    GLuint framebuffer, colorBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, window_width, window_height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glViewport(0, 0, window_width, window_height);
+
+    ShaderProgram inverseProgram(vertexShaderInverseSource, fragmentShaderSource);
+    ShaderProgram uniformProgram(vertexShaderUniformSource, fragmentShaderSource);
+
+    std::printf("%d objects per frame, %d frames\n", objectsPerFrame, frames);
+    std::printf("%10s %22s %10s %12s %10s\n", "vertices", "normal matrix", "ms/frame", "Mvertices/s", "speedup");
+    for (int side : { 100, 317, 1000 })
+    {
+        Mesh mesh = makeGrid(side);
+        const double vertices = static_cast<double>(mesh.vertices) * objectsPerFrame;
+
+        const double inverseSeconds = renderFrames(inverseProgram, false, mesh, frames);
+        const double uniformSeconds = renderFrames(uniformProgram, true, mesh, frames);
+        std::printf("%10d %22s %10.3f %12.2f\n", mesh.vertices, "inverse() per vertex",
+            inverseSeconds * 1000.0, vertices / inverseSeconds / 1e6);
+        std::printf("%10d %22s %10.3f %12.2f %9.2fx\n", mesh.vertices, "CPU, once per object",
+            uniformSeconds * 1000.0, vertices / uniformSeconds / 1e6, inverseSeconds / uniformSeconds);
+        deleteMesh(mesh);
+    }
+
+    glDeleteProgram(inverseProgram.id());
+    glDeleteProgram(uniformProgram.id());
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Texture upload bandwidth from client memory (glTexSubImage2D with a pointer, the way the
+// exercises uploaded stbi_load results) against a PixelUploadRing (pixels copied into the
+// persistently mapped unpack buffer, glTexSubImage2D from the buffer offset, fence per upload).
+// "GL thread" is the time spent in the GL calls of the uploading thread, "total" also waits for
+// the GPU (glFinish) and, for the ring, includes a memcpy into it where TextureLoader's workers
+// decode straight into the ring.
+// usage: PixelUploadBenchmark [uploads]
+// build with glad.c, PixelUploadRing.cpp, GLCapabilities.cpp and GLFW
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "PixelUploadRing.h"
+#include "TestImages.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+const int textureCount = 4;
+
+struct Result
+{
+    double glSeconds;
+    double totalSeconds;
+};
+
+Result uploadFromClient(const GLuint* textures, int side, const std::vector<unsigned char>& pixels, int uploads)
+{
+    Result result = Result();
+    glFinish();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < uploads; i++)
+    {
+        const std::chrono::steady_clock::time_point call = std::chrono::steady_clock::now();
+        glBindTexture(GL_TEXTURE_2D, textures[i % textureCount]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, side, side, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        result.glSeconds += secondsSince(call);
+    }
+    glFinish();
+    result.totalSeconds = secondsSince(start);
+    return result;
+}
+
+Result uploadFromRing(const GLuint* textures, int side, const std::vector<unsigned char>& pixels, int uploads, PixelUploadRing& ring)
+{
+    Result result = Result();
+    glFinish();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < uploads; i++)
+    {
+        // in TextureLoader this part runs on the workers
+        size_t offset;
+        unsigned char* target;
+        while (!ring.reserve(pixels.size(), offset, target))
+            ring.retire();
+        std::memcpy(target, pixels.data(), pixels.size());
+
+        const std::chrono::steady_clock::time_point call = std::chrono::steady_clock::now();
+        glBindTexture(GL_TEXTURE_2D, textures[i % textureCount]);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.buffer());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, side, side, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ring.submitted(offset);
+        ring.retire();
+        result.glSeconds += secondsSince(call);
+    }
+    glFinish();
+    ring.retire();
+    result.totalSeconds = secondsSince(start);
+    return result;
+}
+
+void print(int side, const char* path, const Result& result, double megabytes)
+{
+    std::printf("%6d %8s %14.1f %14.1f %14.1f\n", side, path, megabytes / result.glSeconds, megabytes / result.totalSeconds,
+        result.totalSeconds * 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+    const int uploads = argc > 1 ? std::atoi(argv[1]) : 32;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "PixelUploadBenchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGL())
+    {
+        std::printf("Failed to initialize GLAD\n");
+        return -1;
+    }
+    std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+    PixelUploadRing ring(64 << 20);
+    if (!ring.available())
+    {
+        std::printf("persistent mapping (GL 4.4 / GL_ARB_buffer_storage) is not available\n");
+        glfwTerminate();
+        return -1;
+    }
+
+    std::printf("%d uploads per size into %d RGBA8 textures, %u MB ring\n", uploads, textureCount,
+        static_cast<unsigned>(ring.capacity() >> 20));
+    std::printf("%6s %8s %14s %14s %14s\n", "side", "source", "GL thread MB/s", "total MB/s", "total ms");
+    for (int side : { 256, 512, 1024, 2048 })
+    {
+        std::vector<unsigned char> pixels(static_cast<size_t>(side) * side * 4);
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = static_cast<unsigned char>(i * 7 + (i >> 12));
+
+        GLuint textures[textureCount];
+        glGenTextures(textureCount, textures);
+        for (GLuint texture : textures)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+
+        const double megabytes = static_cast<double>(pixels.size()) * uploads / (1024.0 * 1024.0);
+        // one pass of each first so allocations and driver paths are warm
+        uploadFromClient(textures, side, pixels, textureCount);
+        uploadFromRing(textures, side, pixels, textureCount, ring);
+        print(side, "client", uploadFromClient(textures, side, pixels, uploads), megabytes);
+        print(side, "ring", uploadFromRing(textures, side, pixels, uploads, ring), megabytes);
+        glDeleteTextures(textureCount, textures);
+    }
+
+    ring.destroy();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "PixelUploadRing.h"
+#include "GLCapabilities.h"
+
+#include <algorithm>
+
+namespace
+{
+    // keeps every range suitably aligned for any pixel format and for the driver's DMA
+    const size_t rangeAlignment = 256;
+}
+
+PixelUploadRing::PixelUploadRing(size_t capacity)
+    : size(capacity), pbo(0), memory(NULL), head(0), stopping(false)
+{
+    PFNGLBUFFERSTORAGEPROC bufferStorage = loadBufferStorage();
+    if (!bufferStorage || size == 0)
+        return;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+    memory = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!memory)
+    {
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+    }
+}
+
+bool PixelUploadRing::reserve(size_t bytes, size_t& offset, unsigned char*& pointer)
+{
+    bytes = (std::max<size_t>(bytes, 1) + rangeAlignment - 1) / rangeAlignment * rangeAlignment;
+    if (!memory || bytes > size)
+        return false;
+
+    std::unique_lock<std::mutex> lock(rangesMutex);
+    for (;;)
+    {
+        if (stopping)
+            return false;
+
+        if (ranges.empty())
+            head = 0;
+        // free space is [head, size) + [0, tail) while head is behind the oldest range, [head, tail)
+        // after wrapping; a wrapped head never reaches tail, so head == tail is never ambiguous
+        const size_t tail = ranges.empty() ? size : ranges.front().offset;
+        if (ranges.empty() || head > tail)
+        {
+            if (head + bytes <= size)
+                break;
+            if (bytes < tail)
+            {
+                head = 0;
+                break;
+            }
+        }
+        else if (head + bytes < tail)
+        {
+            break;
+        }
+        rangesFreed.wait(lock);
+    }
+
+    Range range = { head, bytes, NULL };
+    ranges.push_back(range);
+    head += bytes;
+    offset = range.offset;
+    pointer = memory + range.offset;
+    return true;
+}
+
+void PixelUploadRing::submitted(size_t offset)
+{
+    const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    std::lock_guard<std::mutex> lock(rangesMutex);
+    for (Range& range : ranges)
+    {
+        if (range.offset == offset && !range.fence)
+        {
+            range.fence = fence;
+            return;
+        }
+    }
+    glDeleteSync(fence);
+}
+
+void PixelUploadRing::retire()
+{
+    bool freed = false;
+    {
+        std::lock_guard<std::mutex> lock(rangesMutex);
+        while (!ranges.empty() && ranges.front().fence)
+        {
+            const GLenum state = glClientWaitSync(ranges.front().fence, 0, 0);
+            if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+                break;
+            glDeleteSync(ranges.front().fence);
+            ranges.pop_front();
+            freed = true;
+        }
+    }
+    if (freed)
+        rangesFreed.notify_all();
+}
+
+void PixelUploadRing::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(rangesMutex);
+        stopping = true;
+    }
+    rangesFreed.notify_all();
+}
+
+void PixelUploadRing::destroy()
+{
+    shutdown();
+    std::lock_guard<std::mutex> lock(rangesMutex);
+    for (const Range& range : ranges)
+        if (range.fence)
+            glDeleteSync(range.fence);
+    ranges.clear();
+    if (pbo)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &pbo);
+    }
+    pbo = 0;
+    memory = NULL;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Ring of pixel unpack buffer memory, mapped once and kept mapped (glBufferStorage with
+// GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT, GL 4.4 / GL_ARB_buffer_storage).
+// Any thread may reserve() a range and write pixels straight into it; the GL thread then
+// sources glTexSubImage2D from that offset with the buffer bound to GL_PIXEL_UNPACK_BUFFER,
+// calls submitted(), and the range is reused only after its fence has signaled (retire()).
+// Without persistent mapping available() is false and reserve() always fails, callers keep
+// uploading from client memory.
+class PixelUploadRing
+{
+public:
+    // GL thread, capacity in bytes
+    explicit PixelUploadRing(size_t capacity);
+    PixelUploadRing(const PixelUploadRing&) = delete;
+    PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+    bool available() const { return memory != NULL; }
+    size_t capacity() const { return size; }
+    GLuint buffer() const { return pbo; }
+
+    // any thread: a range of at least bytes, waiting while earlier uploads still use the ring.
+    // Fails when the ring is not available, bytes exceed the capacity or after shutdown().
+    bool reserve(size_t bytes, size_t& offset, unsigned char*& pointer);
+    // GL thread: the upload commands reading the range at offset have been issued
+    void submitted(size_t offset);
+    // GL thread: frees the ranges whose uploads the GPU has finished, oldest first
+    void retire();
+
+    // wakes up and fails all waiting and later reserve() calls
+    void shutdown();
+    // GL thread: unmaps and deletes the buffer and the fences
+    void destroy();
+
+private:
+    struct Range
+    {
+        size_t offset;
+        size_t bytes;
+        GLsync fence;       // NULL until submitted()
+    };
+
+    size_t size;
+    GLuint pbo;
+    unsigned char* memory;
+    size_t head;            // where the next range starts
+    bool stopping;
+    std::deque<Range> ranges;   // in reservation order
+    std::mutex rangesMutex;
+    std::condition_variable rangesFreed;
+};
@@ -0,0 +1,218 @@
+// Decoding speed of large RGBA PNGs with stb_image, with the byte-at-a-time inflate loop and
+// with the table-driven one (stbi_set_fast_inflate), both for whole stbi_load_from_memory calls
+// and for the zlib stream alone (stbi_zlib_decode_malloc_guesssize on the joined IDAT chunks).
+// The default test images are encoded the way common PNG writers do it (encodePng of
+// TestImages.h): one is a photo-like picture with grain (mostly literals), one flat shapes and
+// gradients like a UI or a diagram (mostly matches). Every result is compared byte for byte with
+// the byte-at-a-time decode.
+// usage: PngDecodeBenchmark [repeats] [files...]
+//   files are decoded as they are instead of the generated images, e.g. PngDecodeBenchmark 5 *.png
+// build with TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "TestImages.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // smooth shading with some grain and a soft alpha edge, like a photo cut out for a sprite
+    std::vector<unsigned char> makePicture(int width, int height)
+    {
+        std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+        unsigned seed = 12345;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const float u = static_cast<float>(x) / width, v = static_cast<float>(y) / height;
+                const float wave = std::sin(u * 40.0f + std::sin(v * 13.0f) * 3.0f) * std::cos(v * 27.0f - u * 5.0f);
+                seed = seed * 1664525u + 1013904223u;
+                const int grain = static_cast<int>(seed >> 29) - 4;
+                unsigned char* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+                const int base[3] = {
+                    static_cast<int>(120 + 90 * wave + 40 * u),
+                    static_cast<int>(110 + 60 * std::sin(v * 9.0f + wave)),
+                    static_cast<int>(60 + 100 * u * v)
+                };
+                for (int c = 0; c < 3; c++)
+                    p[c] = static_cast<unsigned char>(std::min(255, std::max(0, base[c] + grain)));
+                const float edge = std::min(std::min(u, 1 - u), std::min(v, 1 - v)) * 20.0f;
+                p[3] = static_cast<unsigned char>(std::min(1.0f, edge) * 255);
+            }
+        }
+        return rgba;
+    }
+
+    // flat panels, stripes, gradients and some text-like dots
+    std::vector<unsigned char> makeDiagram(int width, int height)
+    {
+        std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                unsigned char* p = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+                const int panel = (x / 320) + (y / 240) * 16;
+                int r = 40 + panel * 37 % 180, g = 60 + panel * 53 % 160, b = 90 + panel * 29 % 150;
+                if (panel % 4 == 1)
+                {
+                    r = r * (y % 240) / 240;
+                    g = g * (x % 320) / 320;
+                }
+                else if (panel % 4 == 2 && (x + y) / 6 % 2)
+                {
+                    r /= 2;
+                    g /= 2;
+                }
+                else if (panel % 4 == 3 && y % 24 > 6 && y % 24 < 18 && x % 10 < 7 && (x * 7 + y / 24 * 13) % 11 < 8)
+                {
+                    r = g = b = 20;
+                }
+                if (x % 320 < 2 || y % 240 < 2)
+                    r = g = b = 255;
+                p[0] = static_cast<unsigned char>(r);
+                p[1] = static_cast<unsigned char>(g);
+                p[2] = static_cast<unsigned char>(b);
+                p[3] = 255;
+            }
+        }
+        return rgba;
+    }
+
+    // the IDAT chunks joined, as stb_image hands them to inflate
+    std::vector<unsigned char> zlibStream(const std::vector<unsigned char>& png)
+    {
+        std::vector<unsigned char> stream;
+        for (size_t i = 8; i + 12 <= png.size();)
+        {
+            const size_t length = (static_cast<size_t>(png[i]) << 24) | (png[i + 1] << 16) | (png[i + 2] << 8) | png[i + 3];
+            if (i + 12 + length > png.size())
+                break;
+            if (std::memcmp(&png[i + 4], "IDAT", 4) == 0)
+                stream.insert(stream.end(), png.begin() + i + 8, png.begin() + i + 8 + length);
+            i += 12 + length;
+        }
+        return stream;
+    }
+
+    // best of repeats, so one descheduled run does not count
+    double loadSeconds(const TestImage& image, int repeats, const std::vector<unsigned char>& reference, bool& identical)
+    {
+        double best = 1e30;
+        identical = true;
+        for (int r = 0; r < repeats; r++)
+        {
+            int width, height, components;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+                &components, 4);
+            best = std::min(best, secondsSince(start));
+            if (!pixels || std::memcmp(pixels, reference.data(), reference.size()) != 0)
+                identical = false;
+            stbi_image_free(pixels);
+        }
+        return best;
+    }
+
+    double inflateSeconds(const std::vector<unsigned char>& stream, int repeats, const std::vector<unsigned char>& reference,
+        bool& identical)
+    {
+        double best = 1e30;
+        identical = true;
+        for (int r = 0; r < repeats; r++)
+        {
+            int size = 0;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            char* data = stbi_zlib_decode_malloc_guesssize(reinterpret_cast<const char*>(stream.data()), static_cast<int>(stream.size()),
+                static_cast<int>(reference.size()), &size);
+            best = std::min(best, secondsSince(start));
+            if (!data || static_cast<size_t>(size) != reference.size() || std::memcmp(data, reference.data(), reference.size()) != 0)
+                identical = false;
+            stbi_image_free(data);
+        }
+        return best;
+    }
+
+    void print(const char* name, const char* what, const char* loop, double seconds, double megabytes, double baseline, bool identical)
+    {
+        std::printf("%28s %8s %14s %10.1f %10.1f %8.2f %10s\n", name, what, loop, seconds * 1000.0, megabytes / seconds,
+            baseline / seconds, identical ? "yes" : "NO");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    std::vector<TestImage> images;
+    for (int i = 2; i < argc; i++)
+    {
+        TestImage image = { argv[i], readFile(argv[i]) };
+        images.push_back(image);
+    }
+    if (images.empty())
+    {
+        const int width = 3840, height = 2160;
+        std::printf("encoding %dx%d test images...\n", width, height);
+        char name[64];
+        std::snprintf(name, sizeof(name), "%dx%d photo", width, height);
+        TestImage photo = { name, encodePng(makePicture(width, height), width, height) };
+        std::snprintf(name, sizeof(name), "%dx%d diagram", width, height);
+        TestImage diagram = { name, encodePng(makeDiagram(width, height), width, height) };
+        images.push_back(photo);
+        images.push_back(diagram);
+    }
+
+    std::printf("\nbest of %d, MB/s of decoded RGBA pixels (load) or of the inflated stream (inflate)\n", repeats);
+    std::printf("%28s %8s %14s %10s %10s %8s %10s\n", "image", "decode", "inflate loop", "ms", "MB/s", "speedup", "identical");
+    for (const TestImage& image : images)
+    {
+        int width, height, components;
+        stbi_set_fast_inflate(0);
+        unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+            &components, 4);
+        if (!pixels)
+        {
+            std::printf("%28s: %s\n", image.name.c_str(), stbi_failure_reason());
+            stbi_set_fast_inflate(1);
+            continue;
+        }
+        const std::vector<unsigned char> reference(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+        std::printf("%28s %.1f MB file, %.1f MB pixels\n", image.name.c_str(), image.file.size() / (1024.0 * 1024.0),
+            reference.size() / (1024.0 * 1024.0));
+
+        bool identical;
+        const double megabytes = reference.size() / (1024.0 * 1024.0);
+        const double bytewise = loadSeconds(image, repeats, reference, identical);
+        print("", "load", "byte at a time", bytewise, megabytes, bytewise, identical);
+        stbi_set_fast_inflate(1);
+        print("", "", "table-driven", loadSeconds(image, repeats, reference, identical), megabytes, bytewise, identical);
+
+        const std::vector<unsigned char> stream = zlibStream(image.file);
+        int inflatedSize = 0;
+        stbi_set_fast_inflate(0);
+        char* inflated = stbi_zlib_decode_malloc(reinterpret_cast<const char*>(stream.data()), static_cast<int>(stream.size()), &inflatedSize);
+        if (!inflated)
+        {
+            stbi_set_fast_inflate(1);
+            continue;
+        }
+        const std::vector<unsigned char> inflatedReference(inflated, inflated + inflatedSize);
+        stbi_image_free(inflated);
+        const double streamMegabytes = inflatedSize / (1024.0 * 1024.0);
+        const double bytewiseInflate = inflateSeconds(stream, repeats, inflatedReference, identical);
+        print("", "inflate", "byte at a time", bytewiseInflate, streamMegabytes, bytewiseInflate, identical);
+        stbi_set_fast_inflate(1);
+        print("", "", "table-driven", inflateSeconds(stream, repeats, inflatedReference, identical), streamMegabytes, bytewiseInflate,
+            identical);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    int highestBit(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return static_cast<int>(index);
+#else
+        return 31 - __builtin_clz(value);
+#endif
+    }
+
+    int lowestBit(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+}
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+    : firstMap(0), total(capacity), allocated(0), freeCount(0)
+{
+    std::fill(secondMap, secondMap + firstLevels, 0u);
+    std::fill(&heads[0][0], &heads[0][0] + firstLevels * secondLevels, none);
+    if (capacity > 0)
+        link(newBlock(0, capacity, none, none));
+}
+
+void RangeAllocator::sizeClass(uint32_t size, int& first, int& second)
+{
+    // sizes below secondLevels each have a list of their own in class 0
+    if (size < secondLevels)
+    {
+        first = 0;
+        second = static_cast<int>(size);
+        return;
+    }
+    const int log = highestBit(size);
+    first = log - secondLevelBits + 1;
+    second = static_cast<int>((size >> (log - secondLevelBits)) - secondLevels);
+}
+
+bool RangeAllocator::searchClass(uint32_t size, int& first, int& second)
+{
+    // rounded up to the next class boundary, any block of that class fits
+    if (size >= secondLevels)
+    {
+        const uint32_t step = (1u << (highestBit(size) - secondLevelBits)) - 1;
+        if (size > UINT32_MAX - step)
+            return false;
+        size += step;
+    }
+    sizeClass(size, first, second);
+    return true;
+}
+
+bool RangeAllocator::allocate(uint32_t size, Range& range)
+{
+    size = std::max(size, 1u);
+    int first, second;
+    if (!searchClass(size, first, second))
+        return false;
+    uint32_t lists = secondMap[first] & (~0u << second);
+    if (!lists)
+    {
+        const uint32_t classes = first + 1 < firstLevels ? firstMap & (~0u << (first + 1)) : 0;
+        if (!classes)
+            return false;
+        first = lowestBit(classes);
+        lists = secondMap[first];
+    }
+    second = lowestBit(lists);
+
+    const uint32_t index = heads[first][second];
+    unlink(index);
+    // the rest of the block goes back as a free block of its own
+    if (blocks[index].size > size)
+    {
+        Block& block = blocks[index];
+        const uint32_t rest = newBlock(block.offset + size, block.size - size, index, block.next);
+        Block& split = blocks[index];
+        if (split.next != none)
+            blocks[split.next].previous = rest;
+        split.next = rest;
+        split.size = size;
+        link(rest);
+    }
+    Block& block = blocks[index];
+    block.free = false;
+    allocated += block.size;
+    range.offset = block.offset;
+    range.size = block.size;
+    range.block = index;
+    return true;
+}
+
+void RangeAllocator::free(Range& range)
+{
+    uint32_t index = range.block;
+    range = Range();
+    allocated -= blocks[index].size;
+
+    // merged with the free neighbours on both sides, the absorbed entries become spare
+    const uint32_t previous = blocks[index].previous;
+    if (previous != none && blocks[previous].free)
+    {
+        unlink(previous);
+        blocks[previous].size += blocks[index].size;
+        blocks[previous].next = blocks[index].next;
+        if (blocks[index].next != none)
+            blocks[blocks[index].next].previous = previous;
+        spare.push_back(index);
+        index = previous;
+    }
+    const uint32_t next = blocks[index].next;
+    if (next != none && blocks[next].free)
+    {
+        unlink(next);
+        blocks[index].size += blocks[next].size;
+        blocks[index].next = blocks[next].next;
+        if (blocks[next].next != none)
+            blocks[blocks[next].next].previous = index;
+        spare.push_back(next);
+    }
+    link(index);
+}
+
+uint32_t RangeAllocator::largestFree() const
+{
+    if (!firstMap)
+        return 0;
+    const int first = highestBit(firstMap);
+    const int second = highestBit(secondMap[first]);
+    uint32_t largest = 0;
+    for (uint32_t index = heads[first][second]; index != none; index = blocks[index].nextFree)
+        largest = std::max(largest, blocks[index].size);
+    return largest;
+}
+
+void RangeAllocator::link(uint32_t index)
+{
+    Block& block = blocks[index];
+    int first, second;
+    sizeClass(block.size, first, second);
+    block.free = true;
+    block.previousFree = none;
+    block.nextFree = heads[first][second];
+    if (block.nextFree != none)
+        blocks[block.nextFree].previousFree = index;
+    heads[first][second] = index;
+    firstMap |= 1u << first;
+    secondMap[first] |= 1u << second;
+    freeCount++;
+}
+
+void RangeAllocator::unlink(uint32_t index)
+{
+    Block& block = blocks[index];
+    int first, second;
+    sizeClass(block.size, first, second);
+    if (block.previousFree != none)
+        blocks[block.previousFree].nextFree = block.nextFree;
+    else
+        heads[first][second] = block.nextFree;
+    if (block.nextFree != none)
+        blocks[block.nextFree].previousFree = block.previousFree;
+    if (heads[first][second] == none)
+    {
+        secondMap[first] &= ~(1u << second);
+        if (!secondMap[first])
+            firstMap &= ~(1u << first);
+    }
+    block.free = false;
+    freeCount--;
+}
+
+uint32_t RangeAllocator::newBlock(uint32_t offset, uint32_t size, uint32_t previous, uint32_t next)
+{
+    const Block block = { offset, size, previous, next, none, none, false };
+    if (!spare.empty())
+    {
+        const uint32_t index = spare.back();
+        spare.pop_back();
+        blocks[index] = block;
+        return index;
+    }
+    blocks.push_back(block);
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
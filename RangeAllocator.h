@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hands out ranges of [0, capacity) in constant time with a two-level segregated fit (TLSF):
+// free blocks are kept in 16 lists per power of two of their size, with a bitmap of the non-empty
+// lists per level, so finding a block large enough is two bit scans and freeing merges a block
+// with its free neighbours at once. Fragmentation stays low because a request is served from the
+// smallest list whose blocks are all large enough, splitting off the rest.
+// Units are whatever the caller counts, vertices of one format or indices, so every range is
+// aligned to the caller's element without padding. Not thread-safe.
+class RangeAllocator
+{
+public:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Range
+    {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t block = none;      // none when the range is not allocated
+
+        bool valid() const { return block != none; }
+    };
+
+    explicit RangeAllocator(uint32_t capacity);
+
+    // false when no free block has size units (size 0 counts as 1)
+    bool allocate(uint32_t size, Range& range);
+    // range must come from allocate() of this allocator; it is left invalid
+    void free(Range& range);
+
+    uint32_t capacity() const { return total; }
+    uint32_t used() const { return allocated; }
+    uint32_t largestFree() const;
+    int freeBlocks() const { return freeCount; }
+
+private:
+    static constexpr int secondLevelBits = 4;
+    static constexpr int secondLevels = 1 << secondLevelBits;
+    static constexpr int firstLevels = 32;
+
+    struct Block
+    {
+        uint32_t offset, size;
+        uint32_t previous, next;            // neighbours in address order
+        uint32_t previousFree, nextFree;    // in the list of its size class
+        bool free;
+    };
+
+    // the size class holding blocks of size, and the one whose blocks are all at least size
+    static void sizeClass(uint32_t size, int& first, int& second);
+    static bool searchClass(uint32_t size, int& first, int& second);
+
+    void link(uint32_t block);
+    void unlink(uint32_t block);
+    uint32_t newBlock(uint32_t offset, uint32_t size, uint32_t previous, uint32_t next);
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> spare;            // unused entries of blocks
+    uint32_t firstMap;
+    uint32_t secondMap[firstLevels];
+    uint32_t heads[firstLevels][secondLevels];
+    uint32_t total, allocated;
+    int freeCount;
+};
@@ -0,0 +1,186 @@
+// RangeAllocator (TLSF) against a first-fit free list in a std::map, under the churn of a scene
+// whose meshes come and go: the buffer is filled to 80% with meshes of 4 to 4096 vertices
+// (log-uniform, so most are small), then meshes are removed and added at random. Reports the time
+// per allocate + free, the allocations that failed with room still left in total, and the free
+// blocks and largest free block at the end. Every live range is checked against every other one,
+// and after freeing everything the allocator must be one free block again.
+// usage: RangeAllocatorBenchmark [operations] [capacity]
+//   1 000 000 operations and 16M units by default
+// build with RangeAllocator.cpp
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // the obvious allocator: free ranges by offset, the first one large enough is split
+    class FirstFit
+    {
+    public:
+        explicit FirstFit(uint32_t capacity)
+        {
+            freeRanges[0] = capacity;
+        }
+
+        bool allocate(uint32_t size, uint32_t& offset)
+        {
+            for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range)
+                if (range->second >= size)
+                {
+                    offset = range->first;
+                    if (range->second > size)
+                        freeRanges[range->first + size] = range->second - size;
+                    freeRanges.erase(range);
+                    return true;
+                }
+            return false;
+        }
+
+        void free(uint32_t offset, uint32_t size)
+        {
+            auto next = freeRanges.lower_bound(offset);
+            if (next != freeRanges.end() && offset + size == next->first)
+            {
+                size += next->second;
+                next = freeRanges.erase(next);
+            }
+            if (next != freeRanges.begin())
+            {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset)
+                {
+                    previous->second += size;
+                    return;
+                }
+            }
+            freeRanges[offset] = size;
+        }
+
+        int freeBlocks() const { return static_cast<int>(freeRanges.size()); }
+
+        uint32_t largestFree() const
+        {
+            uint32_t largest = 0;
+            for (const auto& range : freeRanges)
+                largest = std::max(largest, range.second);
+            return largest;
+        }
+
+    private:
+        std::map<uint32_t, uint32_t> freeRanges;
+    };
+
+    struct Live
+    {
+        uint32_t offset, size;
+        RangeAllocator::Range range;
+    };
+
+    struct Result
+    {
+        double seconds;
+        long long failed;
+        int freeBlocks;
+        uint32_t largestFree;
+        bool correct;
+    };
+
+    bool disjoint(std::vector<Live> live)
+    {
+        std::sort(live.begin(), live.end(), [](const Live& a, const Live& b) { return a.offset < b.offset; });
+        for (size_t i = 1; i < live.size(); i++)
+            if (live[i - 1].offset + live[i - 1].size > live[i].offset)
+                return false;
+        return true;
+    }
+
+    // the same sequence of sizes and choices for both allocators; inspect sees the allocator at the
+    // end of the churn, before everything is freed
+    template <typename Allocate, typename Free, typename Inspect>
+    Result run(uint32_t capacity, long long operations, Allocate allocate, Free free, Inspect inspect)
+    {
+        std::mt19937 random(12345);
+        std::uniform_real_distribution<double> logSize(std::log(4.0), std::log(4096.0));
+        std::vector<Live> live;
+        uint64_t used = 0;
+        Result result = { 0.0, 0, 0, 0, true };
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < operations; i++)
+        {
+            const bool filling = used < capacity * 0.8;
+            if (!filling && !live.empty())
+            {
+                const size_t index = random() % live.size();
+                free(live[index]);
+                used -= live[index].size;
+                live[index] = live.back();
+                live.pop_back();
+            }
+            Live mesh;
+            mesh.size = static_cast<uint32_t>(std::exp(logSize(random)));
+            if (allocate(mesh))
+            {
+                live.push_back(mesh);
+                used += mesh.size;
+            }
+            else if (capacity - used >= mesh.size)
+                result.failed++;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.correct = disjoint(live);
+        inspect(result);
+        for (Live& mesh : live)
+            free(mesh);
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const long long operations = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    const uint32_t capacity = argc > 2 ? static_cast<uint32_t>(std::atoll(argv[2])) : 16u << 20;
+
+    RangeAllocator tlsf(capacity);
+    Result tlsfResult = run(capacity, operations,
+        [&](Live& mesh) {
+            if (!tlsf.allocate(mesh.size, mesh.range))
+                return false;
+            mesh.offset = mesh.range.offset;
+            return true;
+        },
+        [&](Live& mesh) { tlsf.free(mesh.range); },
+        [&](Result& result) {
+            result.freeBlocks = tlsf.freeBlocks();
+            result.largestFree = tlsf.largestFree();
+        });
+    // freeing everything merges it back into one block
+    tlsfResult.correct = tlsfResult.correct && tlsf.used() == 0 && tlsf.freeBlocks() == 1 && tlsf.largestFree() == capacity;
+
+    FirstFit firstFit(capacity);
+    Result firstFitResult = run(capacity, operations,
+        [&](Live& mesh) { return firstFit.allocate(mesh.size, mesh.offset); },
+        [&](Live& mesh) { firstFit.free(mesh.offset, mesh.size); },
+        [&](Result& result) {
+            result.freeBlocks = firstFit.freeBlocks();
+            result.largestFree = firstFit.largestFree();
+        });
+    firstFitResult.correct = firstFitResult.correct && firstFit.freeBlocks() == 1 && firstFit.largestFree() == capacity;
+
+    std::printf("%lld operations, %u units, filled to 80%% with 4-4096 unit ranges\n", operations, capacity);
+    std::printf("%12s %14s %10s %12s %14s %10s\n", "allocator", "ns/operation", "failed", "free blocks", "largest free", "correct");
+    const Result* results[] = { &tlsfResult, &firstFitResult };
+    const char* names[] = { "TLSF", "first fit" };
+    for (int i = 0; i < 2; i++)
+        std::printf("%12s %14.1f %10lld %12d %14u %10s\n", names[i], results[i]->seconds * 1e9 / operations, results[i]->failed,
+            results[i]->freeBlocks, results[i]->largestFree, results[i]->correct ? "yes" : "NO");
+    return tlsfResult.correct && firstFitResult.correct ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Fill rate of the scalar, SSE2 and AVX2 row kernels of the CPU rasterizer on one thread.
+// Every kernel draws the same random triangles; the resulting images are compared
+// against the scalar one.
+// usage: RasterKernelBenchmark [triangles]
+
+#include "SoftwareRasterizer.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+const unsigned int window_width = 1000;
+const unsigned int window_height = 1000;
+
+// x, y, z in NDC and the six varyings of the Zadanie9 shader (fragmentPosition, Normal)
+std::vector<float> makeTriangles(int count, float size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<float> vertices;
+    for (int i = 0; i < count; i++)
+    {
+        const float cx = unit(random);
+        const float cy = unit(random);
+        const float cz = unit(random) * 0.9f;
+        for (int v = 0; v < 3; v++)
+        {
+            vertices.push_back(cx + unit(random) * size);
+            vertices.push_back(cy + unit(random) * size);
+            vertices.push_back(cz + unit(random) * 0.05f);
+            for (int k = 0; k < 6; k++)
+                vertices.push_back(unit(random));
+        }
+    }
+    return vertices;
+}
+
+void draw(SoftwareRasterizer& rasterizer, const std::vector<float>& vertices, const std::vector<unsigned int>& indices, int varyings)
+{
+    rasterizer.drawElements(vertices.data(), 9, indices.data(), static_cast<int>(indices.size()), varyings,
+        [](const float* vertex, SoftwareRasterizer::VertexOutput& out) {
+            out.position = glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+            for (int k = 0; k < 6; k++)
+                out.varyings[k] = vertex[3 + k];
+        },
+        [varyings](const float* in) {
+            glm::vec4 result(0.0f, 0.0f, 0.0f, 1.0f);
+            for (int k = 0; k < varyings; k++)
+                result[k % 3] += in[k] * 0.25f;
+            return result;
+        });
+}
+
+int main(int argc, char** argv)
+{
+    const int triangles = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    const SoftwareRasterizer::RasterKernel kernels[] = {
+        SoftwareRasterizer::RasterKernel::Scalar,
+        SoftwareRasterizer::RasterKernel::SSE2,
+        SoftwareRasterizer::RasterKernel::AVX2
+    };
+    const float sizes[] = { 0.01f, 0.05f, 0.3f };
+
+    SoftwareRasterizer rasterizer(window_width, window_height, 1);
+    std::vector<uint32_t> reference(static_cast<size_t>(window_width) * window_height);
+
+    std::printf("%8s %6s %9s %12s %12s %10s\n", "kernel", "size", "varyings", "Mpixels/s", "Mtris/s", "identical");
+    for (float size : sizes)
+    {
+        const std::vector<float> vertices = makeTriangles(triangles, size, 1234);
+        std::vector<unsigned int> indices(static_cast<size_t>(triangles) * 3);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = static_cast<unsigned int>(i);
+
+        for (int varyings : { 0, 6 })
+        {
+            for (SoftwareRasterizer::RasterKernel kernel : kernels)
+            {
+                if (!SoftwareRasterizer::kernelSupported(kernel))
+                {
+                    std::printf("%8s %6.2f %9d %12s\n", SoftwareRasterizer::kernelName(kernel), size, varyings, "unsupported");
+                    continue;
+                }
+                rasterizer.setRasterKernel(kernel);
+
+                const int repeats = size < 0.1f ? 20 : 3;
+                double seconds = 0.0;
+                rasterizer.resetStatistics();
+                for (int r = 0; r < repeats; r++)
+                {
+                    rasterizer.clear(0.0f, 0.0f, 0.0f, 1.0f);
+                    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    draw(rasterizer, vertices, indices, varyings);
+                    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+
+                const size_t bytes = reference.size() * sizeof(uint32_t);
+                if (kernel == SoftwareRasterizer::RasterKernel::Scalar)
+                    std::memcpy(reference.data(), rasterizer.colorBuffer(), bytes);
+                const bool identical = std::memcmp(reference.data(), rasterizer.colorBuffer(), bytes) == 0;
+
+                const SoftwareRasterizer::Statistics stats = rasterizer.statistics();
+                std::printf("%8s %6.2f %9d %12.2f %12.3f %10s\n", SoftwareRasterizer::kernelName(kernel), size, varyings,
+                    stats.fragments / seconds / 1e6, stats.triangles / seconds / 1e6, identical ? "yes" : "NO");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+// Throughput of the CPU rasterizer on the Zadanie9 scene (lit cube + light cube)
+// and on a field of cubes, for every thread count up to the number of cores.
+// usage: RasterizerBenchmark [frames]
+
+#include "SoftwareRasterizer.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+const unsigned int window_width = 1000;
+const unsigned int window_height = 1000;
+
+// same layout as the VBO of Zadanie9: position, normal
+const float cubeVertices[] = {
+    -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+
+    -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+
+     0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+
+    -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+
+    -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f
+};
+
+struct Mesh
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+};
+
+Mesh makeCube()
+{
+    Mesh mesh;
+    mesh.vertices.assign(cubeVertices, cubeVertices + sizeof(cubeVertices) / sizeof(float));
+    for (unsigned int i = 0; i < 36; i++)
+        mesh.indices.push_back(i);
+    return mesh;
+}
+
+// size^3 small cubes baked into one vertex/index array
+Mesh makeCubeField(int size)
+{
+    Mesh mesh;
+    const float spacing = 2.0f / size;
+    for (int z = 0; z < size; z++)
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+            {
+                const glm::vec3 offset(-1.0f + (x + 0.5f) * spacing, -1.0f + (y + 0.5f) * spacing, -1.0f + (z + 0.5f) * spacing);
+                const unsigned int base = static_cast<unsigned int>(mesh.vertices.size() / 6);
+                for (int v = 0; v < 36; v++)
+                {
+                    const float* in = cubeVertices + v * 6;
+                    mesh.vertices.push_back(offset.x + in[0] * spacing * 0.6f);
+                    mesh.vertices.push_back(offset.y + in[1] * spacing * 0.6f);
+                    mesh.vertices.push_back(offset.z + in[2] * spacing * 0.6f);
+                    mesh.vertices.push_back(in[3]);
+                    mesh.vertices.push_back(in[4]);
+                    mesh.vertices.push_back(in[5]);
+                    mesh.indices.push_back(base + v);
+                }
+            }
+    return mesh;
+}
+
+struct Uniforms
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 lightPos;
+    glm::vec3 viewPos;
+    float ambientStrength;
+    float specularStrength;
+    float diffuseStrength;
+};
+
+// vertexShaderSource / fragmentShaderSource of Zadanie9
+void drawLit(SoftwareRasterizer& rasterizer, const Mesh& mesh, const Uniforms& u)
+{
+    const glm::mat4 mvp = u.projection * u.view * u.model;
+    rasterizer.drawElements(mesh.vertices.data(), 6, mesh.indices.data(), static_cast<int>(mesh.indices.size()), 6,
+        [&](const float* vertex, SoftwareRasterizer::VertexOutput& out) {
+            const glm::vec4 position(vertex[0], vertex[1], vertex[2], 1.0f);
+            const glm::vec3 fragmentPosition = glm::vec3(u.model * position);
+            const glm::vec3 normal = u.normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+            out.position = mvp * position;
+            out.varyings[0] = fragmentPosition.x; out.varyings[1] = fragmentPosition.y; out.varyings[2] = fragmentPosition.z;
+            out.varyings[3] = normal.x; out.varyings[4] = normal.y; out.varyings[5] = normal.z;
+        },
+        [&](const float* in) {
+            const glm::vec3 fragmentPosition(in[0], in[1], in[2]);
+            const glm::vec3 objectColor(0.0f, 1.0f, 0.0f);
+            const glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
+            const glm::vec3 ambientColor = u.ambientStrength * lightColor;
+            const glm::vec3 norm = glm::normalize(glm::vec3(in[3], in[4], in[5]));
+            const glm::vec3 lightDir = glm::normalize(u.lightPos - fragmentPosition);
+            const float diff = glm::max(glm::dot(norm, lightDir), 0.0f);
+            const glm::vec3 diffuse = diff * lightColor * u.diffuseStrength;
+            const glm::vec3 viewDir = glm::normalize(u.viewPos - fragmentPosition);
+            const glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+            const float spec = glm::pow(glm::max(glm::dot(viewDir, reflectDir), 0.0f), 64.0f);
+            const glm::vec3 specular = u.specularStrength * spec * lightColor;
+            return glm::vec4((ambientColor + diffuse + specular) * objectColor, 1.0f);
+        });
+}
+
+// vertexShaderLightSource / fragmentShaderLightSource of Zadanie9
+void drawLight(SoftwareRasterizer& rasterizer, const Mesh& mesh, const glm::mat4& mvp)
+{
+    rasterizer.drawElements(mesh.vertices.data(), 6, mesh.indices.data(), static_cast<int>(mesh.indices.size()), 0,
+        [&](const float* vertex, SoftwareRasterizer::VertexOutput& out) {
+            out.position = mvp * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+        },
+        [](const float*) {
+            return glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+        });
+}
+
+void renderFrame(SoftwareRasterizer& rasterizer, const Mesh& object, const Mesh& light, float time)
+{
+    const glm::vec3 cameraPosition(0.0f, 0.0f, 2.5f);
+    const glm::vec3 lightPosition(cos(time) * 3.0f, 2.0f, sin(time) * 3.0f);
+
+    Uniforms u;
+    u.model = glm::rotate(glm::mat4(1.0f), time * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    u.normalMatrix = glm::mat3(glm::transpose(glm::inverse(u.model)));
+    u.view = glm::lookAt(cameraPosition, cameraPosition + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    u.projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
+    u.lightPos = lightPosition;
+    u.viewPos = cameraPosition;
+    u.ambientStrength = 0.15f;
+    u.specularStrength = 0.4f;
+    u.diffuseStrength = 1.0f;
+
+    rasterizer.clear(0.066f, 0.09f, 0.07f, 1.0f);
+    drawLit(rasterizer, object, u);
+
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), lightPosition);
+    model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
+    drawLight(rasterizer, light, u.projection * u.view * model);
+}
+
+void benchmark(const char* name, const Mesh& object, const Mesh& light, int frames)
+{
+    std::printf("%s: %zu triangles per frame, %ux%u\n", name, (object.indices.size() + light.indices.size()) / 3,
+        window_width, window_height);
+    std::printf("%8s %10s %10s %14s %14s\n", "threads", "ms/frame", "fps", "Mtriangles/s", "Mpixels/s");
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < cores; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(cores);
+
+    SoftwareRasterizer rasterizer(window_width, window_height, 1);
+    for (unsigned threads : threadCounts)
+    {
+        rasterizer.setThreadCount(threads);
+        renderFrame(rasterizer, object, light, 0.0f); // warm up the bins
+        rasterizer.resetStatistics();
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            renderFrame(rasterizer, object, light, frame / 60.0f);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const SoftwareRasterizer::Statistics stats = rasterizer.statistics();
+        std::printf("%8u %10.3f %10.1f %14.2f %14.2f\n", threads, seconds * 1000.0 / frames, frames / seconds,
+            stats.triangles / seconds / 1e6, stats.fragments / seconds / 1e6);
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    const Mesh cube = makeCube();
+    benchmark("Zadanie9 lit cube", cube, cube, frames);
+    benchmark("cube field 24^3", makeCubeField(24), cube, std::max(1, frames / 10));
+    return 0;
+}
@@ -0,0 +1,297 @@
+// Decoding huge images a batch of rows at a time with stbi_load_rows, for textures that should
+// never be in memory whole. A size x size RGB PNG and a baseline 4:2:0 JPEG (DC-only blocks) are
+// generated a row or an MCU at a time (TestImages.h), written to files and decoded back through
+// the callback, which checks the rows arrive in order and checksums them; the PNG rows are also
+// compared with the pattern they were generated from. Reports the peak resident set size during
+// each decode (VmHWM, reset through /proc/self/clear_refs) against the size of the whole decoded
+// image. Then a 4096x4096 PNG of random pixels in stored blocks, which deflate cannot shrink, is
+// decoded the same way: its IDAT chunks should be read as they are inflated, so the peak may grow
+// by no more than 16 MB over the 48 MB file. Before all that, small generated images (some with
+// the zlib stream split into tiny IDAT chunks) and the given files are decoded both ways and
+// compared byte for byte with stbi_load_from_memory, and stopping from the callback is checked.
+// usage: RowDecodeBenchmark [size] [files...]
+//   size is 16384 by default, files are texture1.jpg and texture2.jpg; Linux only
+// build with TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "TestImages.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // the PNG test pattern, linear in x and y, so every filtered row is mostly one repeated 3 byte
+    // step, which deflates to long matches
+    const int pngStep[3] = { 1, 2, 5 };
+
+    unsigned char pngPixel(int x, int y, int c)
+    {
+        const int rowStart[3] = { y, y * 3, y >> 3 };
+        return static_cast<unsigned char>(x * pngStep[c] + rowStart[c]);
+    }
+
+    void pngRow(int y, int width, unsigned char* row)
+    {
+        for (int x = 0; x < width; x++)
+            for (int c = 0; c < 3; c++)
+                row[x * 3 + c] = pngPixel(x, y, c);
+    }
+
+    std::vector<unsigned char> patternPng(int width, int height, bool compressed = true, size_t idatBytes = 1 << 16)
+    {
+        PngOptions options;
+        options.colorType = 2;
+        options.compressed = compressed;
+        options.idatBytes = idatBytes;
+        return encodePng(width, height, [width](int y, unsigned char* row) { pngRow(y, width, row); }, options);
+    }
+
+    // DC-only blocks: flat 8x8 squares, with standard tables at quality 50 a DC coefficient is
+    // half the distance of the square's value from 128
+    std::vector<unsigned char> dcJpeg(int width, int height)
+    {
+        return encodeJpeg(width, height, 50, 0, [](int mx, int my, JpegBlock* blocks)
+        {
+            std::memset(blocks, 0, sizeof(JpegBlock) * 6);
+            for (int b = 0; b < 4; b++)
+            {
+                const int bx = mx * 2 + (b & 1), by = my * 2 + (b >> 1);
+                blocks[b].coefficient[0] = static_cast<short>((bx * 3 + by * 5) % 112 - 56);
+            }
+            blocks[4].coefficient[0] = static_cast<short>((mx + my * 2) % 32 - 16);
+            blocks[5].coefficient[0] = static_cast<short>((mx * 3 + my) % 32 - 16);
+        });
+    }
+
+    // the rows as stbi_load would return them
+    struct Collected
+    {
+        std::vector<unsigned char> pixels;
+        int next = 0;
+        int batches = 0;
+        bool ordered = true;
+    };
+
+    int collectRows(void* user, int y, int count, const unsigned char* pixels, int stride)
+    {
+        Collected& collected = *static_cast<Collected*>(user);
+        collected.ordered = collected.ordered && y == collected.next;
+        collected.next = y + count;
+        collected.batches++;
+        collected.pixels.insert(collected.pixels.end(), pixels, pixels + static_cast<size_t>(stride) * count);
+        return 1;
+    }
+
+    int stopAfterFirst(void* user, int, int, const unsigned char*, int)
+    {
+        ++*static_cast<int*>(user);
+        return 0;
+    }
+
+    // decodes data both ways with each channel count, empty when they agree
+    std::string compare(const std::vector<unsigned char>& data)
+    {
+        for (int channels : { 0, 1, 3, 4 })
+        {
+            int x, y, components;
+            unsigned char* whole = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &x, &y, &components, channels);
+            if (!whole)
+                return stbi_failure_reason();
+            const size_t size = static_cast<size_t>(x) * y * (channels ? channels : components);
+            Collected collected;
+            int rx = 0, ry = 0, rcomponents = 0;
+            const int result = stbi_load_rows_from_memory(data.data(), static_cast<int>(data.size()), &rx, &ry, &rcomponents,
+                channels, collectRows, &collected);
+            const bool same = collected.pixels.size() == size && std::memcmp(collected.pixels.data(), whole, size) == 0;
+            stbi_image_free(whole);
+            if (!result)
+                return stbi_failure_reason();
+            if (!same || !collected.ordered || collected.next != y || rx != x || ry != y || rcomponents != components)
+                return "rows differ with " + std::to_string(channels) + " channels";
+        }
+        int calls = 0, x, y, components;
+        if (stbi_load_rows_from_memory(data.data(), static_cast<int>(data.size()), &x, &y, &components, 0, stopAfterFirst, &calls)
+            || calls != 1)
+            return "did not stop";
+        return "";
+    }
+
+    struct Streamed
+    {
+        int next = 0;
+        int batches = 0;
+        int width = 0;
+        bool ordered = true;
+        bool pattern = true; // the PNG pattern, when checkPattern
+        bool checkPattern = false;
+        unsigned checksum = 0;
+        std::vector<unsigned char> expected;
+    };
+
+    int streamRows(void* user, int y, int count, const unsigned char* pixels, int stride)
+    {
+        Streamed& streamed = *static_cast<Streamed*>(user);
+        streamed.ordered = streamed.ordered && y == streamed.next;
+        streamed.next = y + count;
+        streamed.batches++;
+        for (int j = 0; j < count; j++)
+        {
+            const unsigned char* row = pixels + static_cast<size_t>(stride) * j;
+            streamed.checksum = crc32(row, static_cast<size_t>(streamed.width) * 3, streamed.checksum);
+            if (streamed.checkPattern)
+            {
+                pngRow(y + j, streamed.width, streamed.expected.data());
+                streamed.pattern = streamed.pattern && std::memcmp(row, streamed.expected.data(), streamed.expected.size()) == 0;
+            }
+        }
+        return 1;
+    }
+
+    // resets VmHWM to the current resident set, false when the kernel does not allow it
+    bool resetPeakResident()
+    {
+        FILE* file = std::fopen("/proc/self/clear_refs", "w");
+        if (!file)
+            return false;
+        const bool written = std::fputs("5", file) >= 0;
+        return std::fclose(file) == 0 && written;
+    }
+
+    long peakResidentKb()
+    {
+        long kb = 0;
+        if (FILE* file = std::fopen("/proc/self/status", "r"))
+        {
+            char line[256];
+            while (std::fgets(line, sizeof(line), file))
+                if (std::sscanf(line, "VmHWM: %ld", &kb) == 1)
+                    break;
+            std::fclose(file);
+        }
+        return kb;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    const int size = argc > 1 ? std::max(16, std::atoi(argv[1])) : 16384;
+    std::vector<std::string> paths(argv + std::min(argc, 2), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    bool ok = true;
+    std::printf("stbi_load_rows against stbi_load_from_memory, 0, 1, 3 and 4 channels\n");
+    const std::pair<std::string, std::vector<unsigned char>> generated[] = {
+        { "generated 1000x700 PNG", patternPng(1000, 700) },
+        { "7 byte IDATs", patternPng(1000, 700, true, 7) },
+        { "stored, 1000 byte IDATs", patternPng(1000, 700, false, 1000) },
+        { "generated 1000x700 JPEG", dcJpeg(1000, 700) },
+        { "generated 333x17 JPEG", dcJpeg(333, 17) },
+    };
+    for (const auto& image : generated)
+    {
+        const std::string error = compare(image.second);
+        std::printf("%28s: %s\n", image.first.c_str(), error.empty() ? "identical" : error.c_str());
+        ok = ok && error.empty();
+    }
+    for (const std::string& path : paths)
+    {
+        const std::string error = compare(readFile(path));
+        std::printf("%28s: %s\n", path.c_str(), error.empty() ? "identical" : error.c_str());
+    }
+
+    const bool resets = resetPeakResident();
+    std::printf("\n%dx%d RGB, whole image %.0f MB%s\n", size, size, static_cast<double>(size) * size * 3 / (1 << 20),
+        resets ? "" : " (VmHWM cannot be reset here, peaks include everything before)");
+    std::printf("%6s %10s %10s %10s %12s %8s %8s\n", "format", "file MB", "batches", "seconds", "peak RSS MB", "ordered", "pixels");
+    for (const bool png : { true, false })
+    {
+        const std::string path = png ? "RowDecodeBenchmark.png" : "RowDecodeBenchmark.jpg";
+        double fileMb;
+        {
+            const std::vector<unsigned char> data = png ? patternPng(size, size) : dcJpeg(size, size);
+            fileMb = static_cast<double>(data.size()) / (1 << 20);
+            if (!writeFile(path, data))
+            {
+                std::printf("%6s: cannot write %s\n", png ? "PNG" : "JPEG", path.c_str());
+                ok = false;
+                continue;
+            }
+        }
+        Streamed streamed;
+        streamed.width = size;
+        streamed.checkPattern = png;
+        streamed.expected.resize(static_cast<size_t>(size) * 3);
+        resetPeakResident();
+        const long before = peakResidentKb();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int x, y, components;
+        const int result = stbi_load_rows(path.c_str(), &x, &y, &components, 3, streamRows, &streamed);
+        const double seconds = secondsSince(start);
+        const long peak = peakResidentKb();
+        std::remove(path.c_str());
+        if (!result)
+        {
+            std::printf("%6s: %s\n", png ? "PNG" : "JPEG", stbi_failure_reason());
+            ok = false;
+            continue;
+        }
+        const bool ordered = streamed.ordered && streamed.next == size;
+        std::printf("%6s %10.1f %10d %10.2f %12.1f %8s %8s   (%.1f MB before, checksum %08x)\n", png ? "PNG" : "JPEG", fileMb,
+            streamed.batches, seconds, peak / 1024.0, ordered ? "yes" : "NO", png ? (streamed.pattern ? "yes" : "NO") : "-",
+            before / 1024.0, streamed.checksum);
+        ok = ok && ordered && streamed.pattern;
+    }
+
+    // random pixels, which deflate cannot shrink: holding the compressed stream whole would take
+    // as much memory as the file
+    const int noiseSize = 4096;
+    const long noiseLimitKb = 16 << 10;
+    const std::string noisePath = "RowDecodeBenchmark-noise.png";
+    unsigned noiseChecksum = 0;
+    double noiseMb = 0;
+    {
+        PngOptions options;
+        options.colorType = 2;
+        options.compressed = false;
+        unsigned state = 1;
+        const std::vector<unsigned char> data = encodePng(noiseSize, noiseSize, [&](int, unsigned char* row)
+        {
+            for (int i = 0; i < noiseSize * 3; i++)
+            {
+                state = state * 1664525u + 1013904223u;
+                row[i] = static_cast<unsigned char>(state >> 24);
+            }
+            noiseChecksum = crc32(row, static_cast<size_t>(noiseSize) * 3, noiseChecksum);
+        }, options);
+        noiseMb = static_cast<double>(data.size()) / (1 << 20);
+        ok = writeFile(noisePath, data) && ok;
+    }
+    Streamed streamed;
+    streamed.width = noiseSize;
+    resetPeakResident();
+    const long before = peakResidentKb();
+    int x, y, components;
+    const int result = stbi_load_rows(noisePath.c_str(), &x, &y, &components, 3, streamRows, &streamed);
+    const long growth = peakResidentKb() - before;
+    std::remove(noisePath.c_str());
+    std::printf("\n%dx%d RGB random pixels in stored blocks, %.1f MB file\n", noiseSize, noiseSize, noiseMb);
+    if (!result)
+    {
+        std::printf("   %s\n", stbi_failure_reason());
+        return 1;
+    }
+    const bool pixels = streamed.ordered && streamed.next == noiseSize && streamed.checksum == noiseChecksum;
+    const bool small = !resets || growth < noiseLimitKb;
+    std::printf("   peak RSS %.1f MB over the %.1f MB before: %s, pixels %s\n", growth / 1024.0, before / 1024.0,
+        resets ? (small ? "under 16 MB" : "NOT under 16 MB") : "not checked", pixels ? "yes" : "NO");
+    ok = ok && pixels && small;
+    return ok ? 0 : 1;
+}
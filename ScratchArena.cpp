@@ -0,0 +1,162 @@
+#include "ScratchArena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    const size_t alignment = 16;
+
+    size_t alignUp(size_t bytes)
+    {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+ScratchArena::ScratchArena(size_t blockBytes, size_t retainBytes)
+    : current(NULL), newest(NULL), blockBytes(std::max<size_t>(alignUp(blockBytes), 4096)), retainBytes(retainBytes),
+      live(0), passBytes(0), passPeak(0), nextBlockBytes(0), counters()
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    freeBlocks();
+}
+
+unsigned char* ScratchArena::base(Block* block) const
+{
+    return reinterpret_cast<unsigned char*>(block) + alignUp(sizeof(Block));
+}
+
+void* ScratchArena::allocate(size_t bytes)
+{
+    bytes = alignUp(std::max<size_t>(bytes, 1));
+    if ((!current || current->size - current->used < bytes) && !grow(bytes))
+        return NULL;
+    unsigned char* pointer = base(current) + current->used;
+    current->used += bytes;
+    newest = pointer;
+    live++;
+    passBytes += bytes;
+    passPeak = std::max(passPeak, passBytes);
+    counters.allocations++;
+    counters.peakBytes = std::max(counters.peakBytes, passPeak);
+    return pointer;
+}
+
+void* ScratchArena::reallocate(void* p, size_t oldBytes, size_t newBytes)
+{
+    counters.reallocations++;
+    if (!p)
+        return allocate(newBytes);
+    if (p == newest)
+    {
+        // the newest allocation ends where the block's free space starts
+        const size_t offset = static_cast<unsigned char*>(p) - base(current);
+        const size_t bytes = alignUp(std::max<size_t>(newBytes, 1));
+        if (offset + bytes <= current->size)
+        {
+            passBytes = passBytes - (current->used - offset) + bytes;
+            passPeak = std::max(passPeak, passBytes);
+            counters.peakBytes = std::max(counters.peakBytes, passPeak);
+            current->used = offset + bytes;
+            counters.inPlace++;
+            return p;
+        }
+    }
+    void* moved = allocate(newBytes);
+    if (!moved)
+        return NULL;
+    std::memcpy(moved, p, std::min(oldBytes, newBytes));
+    release(p);
+    return moved;
+}
+
+void ScratchArena::release(void* p)
+{
+    if (!p || live == 0 || !owns(p))
+        return;
+    if (p == newest)
+    {
+        // freed in reverse order, e.g. a buffer that lived only during one step: reuse its space
+        const size_t offset = static_cast<unsigned char*>(p) - base(current);
+        passBytes -= current->used - offset;
+        current->used = offset;
+        newest = NULL;
+    }
+    if (--live == 0)
+        startOver();
+}
+
+bool ScratchArena::owns(const void* p) const
+{
+    const unsigned char* pointer = static_cast<const unsigned char*>(p);
+    for (Block* block = current; block; block = block->next)
+        if (pointer >= base(block) && pointer < base(block) + block->used)
+            return true;
+    return false;
+}
+
+size_t ScratchArena::capacity() const
+{
+    size_t total = 0;
+    for (Block* block = current; block; block = block->next)
+        total += block->size;
+    return total;
+}
+
+void ScratchArena::resetStats()
+{
+    counters = Stats();
+}
+
+void ScratchArena::trim()
+{
+    if (live == 0)
+        freeBlocks();
+}
+
+void ScratchArena::startOver()
+{
+    newest = NULL;
+    passBytes = 0;
+    if (current && (current->next || current->size > retainBytes))
+    {
+        // one block of the whole pass next time, unless that is more than worth keeping
+        nextBlockBytes = passPeak <= retainBytes ? passPeak : 0;
+        freeBlocks();
+    }
+    else if (current)
+    {
+        current->used = 0;
+    }
+    passPeak = 0;
+}
+
+bool ScratchArena::grow(size_t bytes)
+{
+    const size_t size = std::max(std::max(bytes, blockBytes), nextBlockBytes);
+    Block* block = static_cast<Block*>(std::malloc(alignUp(sizeof(Block)) + size));
+    if (!block)
+        return false;
+    block->next = current;
+    block->size = size;
+    block->used = 0;
+    current = block;
+    nextBlockBytes = 0;
+    counters.heapCalls++;
+    return true;
+}
+
+void ScratchArena::freeBlocks()
+{
+    while (current)
+    {
+        Block* next = current->next;
+        std::free(current);
+        current = next;
+    }
+    newest = NULL;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+// Bump allocator for short-lived buffers, e.g. a decoder's temporaries. Allocations are carved
+// from large blocks taken from the heap and release() only counts them; once nothing is
+// outstanding the arena starts over from the beginning. If that pass needed more than one
+// block, they are replaced by a single block of the pass's total, so after the first few images
+// of a size the arena makes no heap calls at all. reallocate() grows the newest allocation in
+// place when its block has room, which suits buffers that are grown while being filled.
+// Not thread-safe: one arena per thread (imageScratchArena() in StbImage.h).
+class ScratchArena
+{
+public:
+    struct Stats
+    {
+        size_t allocations;     // allocate() calls, including the ones reallocate() makes
+        size_t reallocations;   // reallocate() calls
+        size_t inPlace;         // reallocations that grew in place
+        size_t heapCalls;       // blocks taken from the heap
+        size_t peakBytes;       // most bytes handed out during one pass
+    };
+
+    // blockBytes: size of the first block and the smallest one taken later; on a reset, a
+    // single block larger than retainBytes is given back instead of kept
+    explicit ScratchArena(size_t blockBytes = 1 << 20, size_t retainBytes = 64 << 20);
+    ~ScratchArena();
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // 16-byte aligned, NULL only when the heap is exhausted
+    void* allocate(size_t bytes);
+    // p == NULL allocates; the first oldBytes of p are kept
+    void* reallocate(void* p, size_t oldBytes, size_t newBytes);
+    // p == NULL, and any pointer this arena did not hand out, is ignored
+    void release(void* p);
+    // p lies in memory handed out since the last reset
+    bool owns(const void* p) const;
+
+    size_t outstanding() const { return live; }
+    size_t capacity() const;
+    const Stats& stats() const { return counters; }
+    void resetStats();
+    // gives every block back to the heap, only while nothing is outstanding
+    void trim();
+
+private:
+    struct Block
+    {
+        Block* next;        // older blocks
+        size_t size;
+        size_t used;
+    };
+
+    void startOver();
+    bool grow(size_t bytes);
+    void freeBlocks();
+    unsigned char* base(Block* block) const;
+
+    Block* current;         // newest block, allocations come from its end
+    void* newest;           // most recent allocation, may grow in place
+    size_t blockBytes;
+    size_t retainBytes;
+    size_t live;
+    size_t passBytes;       // bytes in use since the last reset
+    size_t passPeak;        // most of passBytes since the last reset
+    size_t nextBlockBytes;  // size of the block replacing several, taken on the next allocation
+    Stats counters;
+};
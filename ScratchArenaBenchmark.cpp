@@ -0,0 +1,173 @@
+// stb_image's decode temporaries from the heap against a ScratchArena per thread
+// (setImageScratchArenas). The heap run installs a stbi_scratch_allocator that forwards to
+// malloc/realloc/free and counts the calls; the arena run reads the arenas' own stats. Both
+// count only the temporaries: the result buffer stbi_load_from_memory returns is always
+// malloc'd. Decodes run one after another on one thread, then spread over a ThreadPool, and
+// every result is compared with a plain stbi_load_from_memory.
+// usage: ScratchArenaBenchmark [repeats] [threads] [files...]
+//   texture1.jpg and texture2.jpg by default; threads == 0 uses every core
+// build with TestImages.cpp, ImageWriter.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "ScratchArena.h"
+#include "StbImage.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Image
+{
+    std::string name;
+    std::vector<unsigned char> file;
+    std::vector<unsigned char> pixels;
+};
+
+// the heap run's counters, one set per thread like the arenas
+thread_local ScratchArena::Stats heapStats = ScratchArena::Stats();
+
+void* countedMalloc(void*, size_t size)
+{
+    heapStats.allocations++;
+    heapStats.heapCalls++;
+    return std::malloc(size);
+}
+
+void* countedRealloc(void*, void* p, size_t, size_t newSize)
+{
+    heapStats.reallocations++;
+    heapStats.heapCalls++;
+    return std::realloc(p, newSize);
+}
+
+void countedFree(void*, void* p)
+{
+    std::free(p);
+}
+
+ScratchArena::Stats threadStats(bool arena)
+{
+    return arena ? imageScratchArena().stats() : heapStats;
+}
+
+void add(ScratchArena::Stats& total, const ScratchArena::Stats& before, const ScratchArena::Stats& after)
+{
+    total.allocations += after.allocations - before.allocations;
+    total.reallocations += after.reallocations - before.reallocations;
+    total.inPlace += after.inPlace - before.inPlace;
+    total.heapCalls += after.heapCalls - before.heapCalls;
+}
+
+// decodes image and adds what it cost to total, false when the pixels differ
+bool decode(const Image& image, bool arena, ScratchArena::Stats& total)
+{
+    const ScratchArena::Stats before = threadStats(arena);
+    int width, height, components;
+    unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+        &components, 4);
+    add(total, before, threadStats(arena));
+    const bool identical = pixels && std::memcmp(pixels, image.pixels.data(), image.pixels.size()) == 0;
+    stbi_image_free(pixels);
+    return identical;
+}
+
+void select(bool arena)
+{
+    if (arena)
+    {
+        setImageScratchArenas(true);
+    }
+    else
+    {
+        const stbi_scratch_allocator counting = { countedMalloc, countedRealloc, countedFree, NULL };
+        stbi_set_scratch_allocator(&counting);
+    }
+}
+
+void report(const char* name, const char* temporaries, unsigned threads, int decodes, double megabytes, double seconds,
+    const ScratchArena::Stats& total, bool identical)
+{
+    std::printf("%24s %6s %7u %9.1f %9.1f %9.1f %11.2f %10.1f %10s\n", name, temporaries, threads,
+        total.allocations / static_cast<double>(decodes), total.reallocations / static_cast<double>(decodes),
+        total.inPlace / static_cast<double>(decodes), total.heapCalls / static_cast<double>(decodes),
+        megabytes / seconds, identical ? "yes" : "NO");
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+    const unsigned threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0;
+    std::vector<std::string> paths(argv + std::min(argc, 3), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    std::vector<Image> images;
+    double megabytes = 0.0;
+    for (const std::string& path : paths)
+    {
+        Image image = { path, readFile(path), std::vector<unsigned char>() };
+        int width, height, components;
+        unsigned char* pixels = stbi_load_from_memory(image.file.data(), static_cast<int>(image.file.size()), &width, &height,
+            &components, 4);
+        if (!pixels)
+        {
+            std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+        image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+        megabytes += image.pixels.size() / (1024.0 * 1024.0);
+        images.push_back(image);
+    }
+    if (images.empty())
+        return 1;
+
+    std::printf("%d decodes of each image to RGBA, per decode; MB/s of decoded pixels\n", repeats);
+    std::printf("%24s %6s %7s %9s %9s %9s %11s %10s %10s\n", "image", "temps", "threads", "allocs", "reallocs", "in place",
+        "heap calls", "MB/s", "identical");
+
+    // one thread: every image on its own, the first decode included (the arena grows there)
+    for (const Image& image : images)
+    {
+        for (int arena = 0; arena < 2; arena++)
+        {
+            select(arena != 0);
+            ScratchArena::Stats total = ScratchArena::Stats();
+            bool identical = true;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; r++)
+                identical = decode(image, arena != 0, total) && identical;
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report(image.name.c_str(), arena ? "arena" : "heap", 1, repeats,
+                repeats * image.pixels.size() / (1024.0 * 1024.0), seconds, total, identical);
+        }
+    }
+
+    // all images mixed across the pool, each worker with its own arena
+    ThreadPool pool(threads);
+    const int decodes = repeats * static_cast<int>(images.size());
+    for (int arena = 0; arena < 2; arena++)
+    {
+        select(arena != 0);
+        std::vector<ScratchArena::Stats> totals(pool.size(), ScratchArena::Stats());
+        std::vector<char> identical(decodes, 0);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pool.parallelFor(decodes, [&](int index, unsigned thread) {
+            identical[index] = decode(images[index % images.size()], arena != 0, totals[thread]);
+        });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ScratchArena::Stats total = ScratchArena::Stats();
+        for (const ScratchArena::Stats& stats : totals)
+            add(total, ScratchArena::Stats(), stats);
+        report("all", arena ? "arena" : "heap", pool.size(), decodes, repeats * megabytes, seconds, total,
+            std::count(identical.begin(), identical.end(), 0) == 0);
+    }
+    setImageScratchArenas(false);
+    return 0;
+}
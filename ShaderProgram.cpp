@@ -0,0 +1,340 @@
+#include "ShaderProgram.h"
+#include "GLCapabilities.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// GL_ARB_get_program_binary / GL 4.1, not part of the GL 3.3 glad loader
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+namespace
+{
+    const char* cacheDirectory = "shader_cache";
+    const uint32_t cacheMagic = 0x42504B47;     // "GKPB"
+    const uint32_t cacheVersion = 1;
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t length;
+    };
+
+    PFNGLGETPROGRAMBINARYPROC getProgramBinary = NULL;
+    PFNGLPROGRAMBINARYPROC programBinary = NULL;
+    PFNGLPROGRAMPARAMETERIPROC programParameteri = NULL;
+
+    bool binariesSupported()
+    {
+        static int supported = -1;
+        if (supported < 0)
+        {
+            GLint formats = 0;
+            const bool available = hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary");
+            if (available)
+            {
+                getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(glfwGetProcAddress("glGetProgramBinary"));
+                programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(glfwGetProcAddress("glProgramBinary"));
+                programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(glfwGetProcAddress("glProgramParameteri"));
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            }
+            supported = available && getProgramBinary && programBinary && programParameteri && formats > 0;
+        }
+        return supported != 0;
+    }
+
+    uint64_t fnv1a(const char* data, uint64_t hash = 14695981039346656037ull)
+    {
+        // the terminating zero is hashed too, so "ab" + "c" differs from "a" + "bc"
+        do
+        {
+            hash ^= static_cast<unsigned char>(*data);
+            hash *= 1099511628211ull;
+        } while (*data++);
+        return hash;
+    }
+
+    uint64_t cacheKey(const GLchar* vertexSource, const GLchar* fragmentSource)
+    {
+        const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+        uint64_t hash = fnv1a(vertexSource);
+        hash = fnv1a(fragmentSource, hash);
+        for (GLenum name : driverStrings)
+        {
+            const char* value = reinterpret_cast<const char*>(glGetString(name));
+            hash = fnv1a(value ? value : "", hash);
+        }
+        return hash;
+    }
+
+    std::string cachePath(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return std::string(cacheDirectory) + "/" + name;
+    }
+
+    GLuint loadCachedProgram(uint64_t key)
+    {
+        FILE* file = fopen(cachePath(key).c_str(), "rb");
+        if (!file)
+            return 0;
+
+        CacheHeader header;
+        std::vector<char> binary;
+        bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.magic == cacheMagic && header.version == cacheVersion && header.key == key && header.length > 0;
+        if (valid)
+        {
+            binary.resize(header.length);
+            valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+        if (!valid)
+            return 0;
+
+        GLuint program = glCreateProgram();
+        programBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        // drivers reject binaries after an update, then the program is simply rebuilt
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void storeProgram(GLuint program, uint64_t key)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        getProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+
+#ifdef _WIN32
+        _mkdir(cacheDirectory);
+#else
+        mkdir(cacheDirectory, 0755);
+#endif
+        FILE* file = fopen(cachePath(key).c_str(), "wb");
+        if (!file)
+            return;
+
+        CacheHeader header = { cacheMagic, cacheVersion, key, format, static_cast<uint32_t>(written) };
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary.data(), 1, written, file);
+        fclose(file);
+    }
+
+    GLuint compileShader(GLenum type, const GLchar* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+
+        GLint status;
+        GLchar error_message[512];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status)
+        {
+            glGetShaderInfoLog(shader, 512, NULL, error_message);
+            std::cout << (type == GL_VERTEX_SHADER ? "Error (Vertex shader): " : "Error (Fragment shader): ")
+                << error_message << std::endl;
+        }
+        return shader;
+    }
+
+    GLuint compileProgram(const GLchar* vertexSource, const GLchar* fragmentSource, bool retrievable)
+    {
+        GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+        GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+        GLuint shaderProgram = glCreateProgram();
+        if (retrievable)
+            programParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(shaderProgram, vertexShader);
+        glAttachShader(shaderProgram, fragmentShader);
+        glLinkProgram(shaderProgram);
+
+        GLint status;
+        GLchar error_message[512];
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
+        if (!status)
+        {
+            glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
+            std::cout << "Error (Shader program): " << error_message << std::endl;
+        }
+
+        glDetachShader(shaderProgram, vertexShader);
+        glDetachShader(shaderProgram, fragmentShader);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return shaderProgram;
+    }
+}
+
+GLuint createShaderProgram(const GLchar* vertexSource, const GLchar* fragmentSource)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool cached = binariesSupported();
+    const uint64_t key = cached ? cacheKey(vertexSource, fragmentSource) : 0;
+
+    GLuint shaderProgram = cached ? loadCachedProgram(key) : 0;
+    const bool hit = shaderProgram != 0;
+    if (!hit)
+    {
+        shaderProgram = compileProgram(vertexSource, fragmentSource, cached);
+        GLint status;
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
+        if (cached && status)
+            storeProgram(shaderProgram, key);
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Shader program " << shaderProgram << ": " << (hit ? "loaded from cache" : "compiled")
+        << " in " << ms << " ms" << std::endl;
+    return shaderProgram;
+}
+
+ShaderProgram::ShaderProgram(const GLchar* vertexSource, const GLchar* fragmentSource)
+    : program(createShaderProgram(vertexSource, fragmentSource))
+{
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+        Uniform entry;
+        entry.name.assign(name.data(), length);
+        entry.location = glGetUniformLocation(program, entry.name.c_str());
+        // members of uniform blocks have no location of their own
+        if (entry.location < 0)
+            continue;
+        if (entry.name.size() > 3 && entry.name.compare(entry.name.size() - 3, 3, "[0]") == 0)
+            entry.name.resize(entry.name.size() - 3);
+        entry.type = type;
+        entry.valid = false;
+        uniforms.push_back(entry);
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(), [](const Uniform& a, const Uniform& b) { return a.name < b.name; });
+}
+
+void ShaderProgram::use() const
+{
+    glUseProgram(program);
+}
+
+int ShaderProgram::uniform(const char* name) const
+{
+    std::string key = name;
+    if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+        key.resize(key.size() - 3);
+
+    std::vector<Uniform>::const_iterator found = std::lower_bound(uniforms.begin(), uniforms.end(), key,
+        [](const Uniform& entry, const std::string& value) { return entry.name < value; });
+    if (found == uniforms.end() || found->name != key)
+        return -1;
+    return static_cast<int>(found - uniforms.begin());
+}
+
+void ShaderProgram::bindUniformBlock(const char* name, GLuint binding) const
+{
+    const GLuint index = glGetUniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX)
+    {
+        std::cout << "Error (Shader program " << program << "): no active uniform block " << name << std::endl;
+        return;
+    }
+    glUniformBlockBinding(program, index, binding);
+}
+
+bool ShaderProgram::changed(int uniform, const void* value, size_t size)
+{
+    if (uniform < 0 || uniform >= static_cast<int>(uniforms.size()))
+        return false;
+
+    Uniform& entry = uniforms[uniform];
+    if (entry.valid && memcmp(entry.value, value, size) == 0)
+        return false;
+    memcpy(entry.value, value, size);
+    entry.valid = true;
+    return true;
+}
+
+void ShaderProgram::set(int uniform, int value)
+{
+    if (changed(uniform, &value, sizeof(value)))
+        glUniform1i(uniforms[uniform].location, value);
+}
+
+void ShaderProgram::set(int uniform, float value)
+{
+    if (changed(uniform, &value, sizeof(value)))
+        glUniform1f(uniforms[uniform].location, value);
+}
+
+void ShaderProgram::set(int uniform, const glm::vec3& value)
+{
+    if (changed(uniform, glm::value_ptr(value), sizeof(value)))
+        glUniform3fv(uniforms[uniform].location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(int uniform, const glm::vec4& value)
+{
+    if (changed(uniform, glm::value_ptr(value), sizeof(value)))
+        glUniform4fv(uniforms[uniform].location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(int uniform, const glm::mat3& value)
+{
+    if (changed(uniform, glm::value_ptr(value), sizeof(value)))
+        glUniformMatrix3fv(uniforms[uniform].location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(int uniform, const glm::mat4& value)
+{
+    if (changed(uniform, glm::value_ptr(value), sizeof(value)))
+        glUniformMatrix4fv(uniforms[uniform].location, 1, GL_FALSE, glm::value_ptr(value));
+}
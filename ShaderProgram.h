@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Compiles and links a vertex + fragment shader pair, printing compile/link errors.
+// Linked programs are kept on disk in shader_cache/ (glGetProgramBinary) under a hash of
+// both sources and the driver strings, and reloaded with glProgramBinary on the next start.
+// Any mismatch or rejected binary falls back to compiling from source.
+GLuint createShaderProgram(const GLchar* vertexSource, const GLchar* fragmentSource);
+
+// Linked program with its active uniforms reflected once (glGetActiveUniform) into a table.
+// Handles from uniform() are resolved at setup and index that table directly, so the render
+// loop does no string lookups; the setters also skip uploads of unchanged values.
+//
+//   ShaderProgram program(vertexSource, fragmentSource);
+//   const int modelLoc = program.uniform("model");
+//   ...
+//   program.use();
+//   program.set(modelLoc, model);
+//
+// The setters go through glUniform*, so the program has to be in use. The GL program is
+// not deleted by the destructor, glDeleteProgram(program.id()) like any other GL object.
+class ShaderProgram
+{
+public:
+    ShaderProgram(const GLchar* vertexSource, const GLchar* fragmentSource);
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    GLuint id() const { return program; }
+    void use() const;
+
+    // handle of an active uniform ("name" or "name[0]" for arrays), -1 if it is not active
+    // and was optimized out; setting -1 is ignored like glUniform* with location -1
+    int uniform(const char* name) const;
+    // connects the named uniform block to a buffer binding point (glUniformBlockBinding)
+    void bindUniformBlock(const char* name, GLuint binding) const;
+
+    void set(int uniform, int value);
+    void set(int uniform, float value);
+    void set(int uniform, const glm::vec3& value);
+    void set(int uniform, const glm::vec4& value);
+    void set(int uniform, const glm::mat3& value);
+    void set(int uniform, const glm::mat4& value);
+
+private:
+    struct Uniform
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        bool valid;          // value holds what the program currently has
+        float value[16];
+    };
+
+    // true when the value differs from the last upload and has to be sent
+    bool changed(int uniform, const void* value, size_t size);
+
+    GLuint program;
+    std::vector<Uniform> uniforms;    // sorted by name
+};
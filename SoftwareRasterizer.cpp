@@ -0,0 +1,551 @@
+#include "SoftwareRasterizer.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SR_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define SR_TARGET_SSE2
+#define SR_TARGET_AVX2
+#else
+#define SR_TARGET_SSE2 __attribute__((target("sse2")))
+#define SR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    uint32_t packColor(const glm::vec4& c)
+    {
+        glm::vec4 clamped = glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return static_cast<uint32_t>(clamped.r) | (static_cast<uint32_t>(clamped.g) << 8) |
+            (static_cast<uint32_t>(clamped.b) << 16) | (static_cast<uint32_t>(clamped.a) << 24);
+    }
+
+    SoftwareRasterizer::VertexOutput lerpVertex(const SoftwareRasterizer::VertexOutput& a, const SoftwareRasterizer::VertexOutput& b,
+        float t, int varyingCount)
+    {
+        SoftwareRasterizer::VertexOutput result;
+        result.position = a.position + (b.position - a.position) * t;
+        for (int i = 0; i < varyingCount; i++)
+            result.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+        return result;
+    }
+
+    bool outside(const glm::vec4& p0, const glm::vec4& p1, const glm::vec4& p2)
+    {
+        // whole triangle behind one of the frustum planes
+        if (p0.x > p0.w && p1.x > p1.w && p2.x > p2.w) return true;
+        if (p0.x < -p0.w && p1.x < -p1.w && p2.x < -p2.w) return true;
+        if (p0.y > p0.w && p1.y > p1.w && p2.y > p2.w) return true;
+        if (p0.y < -p0.w && p1.y < -p1.w && p2.y < -p2.w) return true;
+        if (p0.z > p0.w && p1.z > p1.w && p2.z > p2.w) return true;
+        if (p0.z < -p0.w && p1.z < -p1.w && p2.z < -p2.w) return true;
+        return false;
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, unsigned threads)
+    : frameWidth(width), frameHeight(height),
+    tilesX((width + TileSize - 1) / TileSize), tilesY((height + TileSize - 1) / TileSize),
+    depthTest(true), kernel(RasterKernel::Scalar), shadeRow(&SoftwareRasterizer::shadeRowScalar),
+    color(static_cast<size_t>(width) * height), depth(static_cast<size_t>(width) * height, 1.0f),
+    pool(new ThreadPool(threads)), activeChunks(0),
+    submittedTriangles(0), rasterizedTriangles(0), shadedFragments(0)
+{
+    setRasterKernel(RasterKernel::AVX2);
+}
+
+void SoftwareRasterizer::setThreadCount(unsigned threads)
+{
+    pool.reset(new ThreadPool(threads));
+}
+
+unsigned SoftwareRasterizer::threadCount() const
+{
+    return pool->size();
+}
+
+void SoftwareRasterizer::setDepthTest(bool enabled)
+{
+    depthTest = enabled;
+}
+
+bool SoftwareRasterizer::kernelSupported(RasterKernel candidate)
+{
+    switch (candidate)
+    {
+#ifdef SR_X86
+    case RasterKernel::SSE2:
+        return true;
+    case RasterKernel::AVX2:
+        return cpuHasAvx2();
+#endif
+    case RasterKernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* SoftwareRasterizer::kernelName(RasterKernel candidate)
+{
+    switch (candidate)
+    {
+    case RasterKernel::SSE2: return "SSE2";
+    case RasterKernel::AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+void SoftwareRasterizer::setRasterKernel(RasterKernel wanted)
+{
+    if (!kernelSupported(wanted))
+        wanted = kernelSupported(RasterKernel::AVX2) ? RasterKernel::AVX2 :
+            kernelSupported(RasterKernel::SSE2) ? RasterKernel::SSE2 : RasterKernel::Scalar;
+
+    kernel = wanted;
+    switch (kernel)
+    {
+    case RasterKernel::SSE2: shadeRow = &SoftwareRasterizer::shadeRowSse2; break;
+    case RasterKernel::AVX2: shadeRow = &SoftwareRasterizer::shadeRowAvx2; break;
+    default: shadeRow = &SoftwareRasterizer::shadeRowScalar; break;
+    }
+}
+
+void SoftwareRasterizer::clear(float r, float g, float b, float a)
+{
+    const uint32_t packed = packColor(glm::vec4(r, g, b, a));
+    pool->parallelFor(frameHeight, [&](int y, unsigned) {
+        const size_t row = static_cast<size_t>(y) * frameWidth;
+        std::fill(color.begin() + row, color.begin() + row + frameWidth, packed);
+        std::fill(depth.begin() + row, depth.begin() + row + frameWidth, 1.0f);
+    });
+}
+
+SoftwareRasterizer::Statistics SoftwareRasterizer::statistics() const
+{
+    Statistics result;
+    result.triangles = submittedTriangles.load();
+    result.rasterized = rasterizedTriangles.load();
+    result.fragments = shadedFragments.load();
+    return result;
+}
+
+void SoftwareRasterizer::resetStatistics()
+{
+    submittedTriangles = 0;
+    rasterizedTriangles = 0;
+    shadedFragments = 0;
+}
+
+void SoftwareRasterizer::drawElements(const float* vertices, int stride, const unsigned int* indices, int count,
+    int varyingCount, const VertexShader& vertexShader, const FragmentShader& fragmentShader)
+{
+    const int triangleCount = count / 3;
+    if (triangleCount == 0)
+        return;
+    varyingCount = std::min(varyingCount, static_cast<int>(MaxVaryings));
+
+    // vertex shader runs once per vertex referenced by the index buffer
+    unsigned int vertexCount = 0;
+    for (int i = 0; i < triangleCount * 3; i++)
+        vertexCount = std::max(vertexCount, indices[i] + 1);
+    shadedVertices.resize(vertexCount);
+
+    const int vertexBatch = 256;
+    pool->parallelFor((vertexCount + vertexBatch - 1) / vertexBatch, [&](int batch, unsigned) {
+        const unsigned int end = std::min(vertexCount, static_cast<unsigned int>(batch + 1) * vertexBatch);
+        for (unsigned int i = static_cast<unsigned int>(batch) * vertexBatch; i < end; i++)
+            vertexShader(vertices + static_cast<size_t>(i) * stride, shadedVertices[i]);
+    });
+
+    // clipping, triangle setup and binning, a few chunks per thread
+    const int wantedChunks = static_cast<int>(pool->size()) * 4;
+    const int trianglesPerChunk = std::max(64, (triangleCount + wantedChunks - 1) / wantedChunks);
+    activeChunks = (triangleCount + trianglesPerChunk - 1) / trianglesPerChunk;
+    if (static_cast<int>(chunks.size()) < activeChunks)
+        chunks.resize(activeChunks);
+
+    pool->parallelFor(activeChunks, [&](int c, unsigned) {
+        Chunk& chunk = chunks[c];
+        chunk.triangles.clear();
+        chunk.bins.resize(static_cast<size_t>(tilesX) * tilesY);
+        for (std::vector<uint32_t>& bin : chunk.bins)
+            bin.clear();
+
+        const int end = std::min(triangleCount, (c + 1) * trianglesPerChunk);
+        for (int t = c * trianglesPerChunk; t < end; t++)
+        {
+            const VertexOutput* v[3] = {
+                &shadedVertices[indices[t * 3]],
+                &shadedVertices[indices[t * 3 + 1]],
+                &shadedVertices[indices[t * 3 + 2]]
+            };
+            emitTriangle(v, varyingCount, chunk);
+        }
+    });
+
+    uint64_t rasterized = 0;
+    for (int c = 0; c < activeChunks; c++)
+        rasterized += chunks[c].triangles.size();
+    submittedTriangles += triangleCount;
+    rasterizedTriangles += rasterized;
+
+    pool->parallelFor(tilesX * tilesY, [&](int tile, unsigned) {
+        rasterizeTile(tile, varyingCount, fragmentShader);
+    });
+}
+
+void SoftwareRasterizer::emitTriangle(const VertexOutput* v[3], int varyingCount, Chunk& chunk)
+{
+    if (outside(v[0]->position, v[1]->position, v[2]->position))
+        return;
+
+    // only the near plane (z >= -w) is clipped, the rest is handled by the pixel bounds
+    float distance[3];
+    int inside = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        distance[i] = v[i]->position.z + v[i]->position.w;
+        if (distance[i] >= 0.0f)
+            inside++;
+    }
+
+    if (inside == 3)
+    {
+        setupTriangle(*v[0], *v[1], *v[2], varyingCount, chunk);
+        return;
+    }
+
+    VertexOutput polygon[4];
+    int polygonSize = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const int j = (i + 1) % 3;
+        if (distance[i] >= 0.0f)
+            polygon[polygonSize++] = *v[i];
+        if ((distance[i] >= 0.0f) != (distance[j] >= 0.0f))
+            polygon[polygonSize++] = lerpVertex(*v[i], *v[j], distance[i] / (distance[i] - distance[j]), varyingCount);
+    }
+
+    for (int i = 1; i + 1 < polygonSize; i++)
+        setupTriangle(polygon[0], polygon[i], polygon[i + 1], varyingCount, chunk);
+}
+
+void SoftwareRasterizer::setupTriangle(const VertexOutput& v0, const VertexOutput& v1, const VertexOutput& v2,
+    int varyingCount, Chunk& chunk)
+{
+    const VertexOutput* v[3] = { &v0, &v1, &v2 };
+
+    Triangle triangle;
+    float x[3], y[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4& p = v[i]->position;
+        if (p.w <= 0.0f)
+            return;
+        triangle.invW[i] = 1.0f / p.w;
+        x[i] = (p.x * triangle.invW[i] + 1.0f) * 0.5f * frameWidth;
+        y[i] = (p.y * triangle.invW[i] + 1.0f) * 0.5f * frameHeight;
+        triangle.z[i] = p.z * triangle.invW[i] * 0.5f + 0.5f;
+        for (int k = 0; k < varyingCount; k++)
+            triangle.varyings[i][k] = v[i]->varyings[k] * triangle.invW[i];
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (!(std::fabs(area) > 0.0f))
+        return;
+
+    // both windings are drawn (no GL_CULL_FACE in the exercises), so make it counter-clockwise
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(triangle.z[1], triangle.z[2]);
+        std::swap(triangle.invW[1], triangle.invW[2]);
+        for (int k = 0; k < varyingCount; k++)
+            std::swap(triangle.varyings[1][k], triangle.varyings[2][k]);
+        area = -area;
+    }
+    triangle.invArea = 1.0f / area;
+
+    // edge i is opposite to vertex i, so e_i / area is the barycentric weight of vertex i
+    for (int i = 0; i < 3; i++)
+    {
+        const int from = (i + 1) % 3;
+        const int to = (i + 2) % 3;
+        triangle.a[i] = y[from] - y[to];
+        triangle.b[i] = x[to] - x[from];
+        triangle.c[i] = -(triangle.a[i] * x[from] + triangle.b[i] * y[from]);
+        triangle.topLeft[i] = triangle.a[i] > 0.0f || (triangle.a[i] == 0.0f && triangle.b[i] < 0.0f);
+    }
+
+    const float minX = std::min(x[0], std::min(x[1], x[2]));
+    const float maxX = std::max(x[0], std::max(x[1], x[2]));
+    const float minY = std::min(y[0], std::min(y[1], y[2]));
+    const float maxY = std::max(y[0], std::max(y[1], y[2]));
+    triangle.minX = std::max(0, static_cast<int>(std::floor(minX)));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(minY)));
+    triangle.maxX = std::min(frameWidth - 1, static_cast<int>(std::ceil(maxX)));
+    triangle.maxY = std::min(frameHeight - 1, static_cast<int>(std::ceil(maxY)));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    const uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+    chunk.triangles.push_back(triangle);
+
+    for (int ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ty++)
+        for (int tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; tx++)
+            chunk.bins[ty * tilesX + tx].push_back(index);
+}
+
+void SoftwareRasterizer::rasterizeTile(int tile, int varyingCount, const FragmentShader& fragmentShader)
+{
+    const int x0 = (tile % tilesX) * TileSize;
+    const int y0 = (tile / tilesX) * TileSize;
+    const int x1 = std::min(x0 + TileSize, frameWidth) - 1;
+    const int y1 = std::min(y0 + TileSize, frameHeight) - 1;
+
+    uint64_t fragments = 0;
+    for (int c = 0; c < activeChunks; c++)
+    {
+        const Chunk& chunk = chunks[c];
+        for (uint32_t index : chunk.bins[tile])
+            rasterizeTriangle(chunk.triangles[index], x0, y0, x1, y1, varyingCount, fragmentShader, fragments);
+    }
+    if (fragments)
+        shadedFragments += fragments;
+}
+
+void SoftwareRasterizer::rasterizeTriangle(const Triangle& t, int x0, int y0, int x1, int y1, int varyingCount,
+    const FragmentShader& fragmentShader, uint64_t& fragments)
+{
+    const int startX = std::max(x0, t.minX);
+    const int endX = std::min(x1, t.maxX);
+    const int startY = std::max(y0, t.minY);
+    const int endY = std::min(y1, t.maxY);
+    if (startX > endX || startY > endY)
+        return;
+
+    // blocks are aligned to the tile, tiles are a multiple of BlockSize
+    const int firstBlockX = x0 + ((startX - x0) & ~(BlockSize - 1));
+    const int firstBlockY = y0 + ((startY - y0) & ~(BlockSize - 1));
+    const float blockSpan = BlockSize - 1.0f;
+
+    RowInput row;
+    RowOutput out;
+    float varyings[MaxVaryings];
+    float clippedDepth[BlockSize];
+
+    for (int by = firstBlockY; by <= endY; by += BlockSize)
+    {
+        const int rows = std::min(BlockSize, y1 - by + 1);
+        for (int bx = firstBlockX; bx <= endX; bx += BlockSize)
+        {
+            // edge functions at the centre of the first pixel and their extremes over the block
+            float e[3];
+            bool covered = true;
+            bool rejected = false;
+            for (int i = 0; i < 3; i++)
+            {
+                e[i] = t.a[i] * (bx + 0.5f) + t.b[i] * (by + 0.5f) + t.c[i];
+                const float stepX = t.a[i] * blockSpan;
+                const float stepY = t.b[i] * blockSpan;
+                const float maxE = e[i] + std::max(stepX, 0.0f) + std::max(stepY, 0.0f);
+                const float minE = e[i] + std::min(stepX, 0.0f) + std::min(stepY, 0.0f);
+                rejected = rejected || maxE < 0.0f;
+                covered = covered && minE > 0.0f;
+            }
+            if (rejected)
+                continue;
+
+            const int columns = std::min(BlockSize, x1 - bx + 1);
+            row.validMask = (1 << columns) - 1;
+            row.covered = covered;
+
+            for (int r = 0; r < rows; r++)
+            {
+                const int y = by + r;
+                for (int i = 0; i < 3; i++)
+                    row.e[i] = e[i] + t.b[i] * r;
+
+                float* depthRow = &depth[static_cast<size_t>(y) * frameWidth + bx];
+                if (columns == BlockSize)
+                    row.depth = depthRow;
+                else
+                {
+                    // the block hangs over the right edge of the framebuffer
+                    for (int j = 0; j < BlockSize; j++)
+                        clippedDepth[j] = j < columns ? depthRow[j] : 0.0f;
+                    row.depth = clippedDepth;
+                }
+
+                int mask = shadeRow(t, row, varyingCount, depthTest, out);
+                uint32_t* colorRow = &color[static_cast<size_t>(y) * frameWidth + bx];
+                while (mask)
+                {
+                    int lane = 0;
+                    while (!(mask & (1 << lane)))
+                        lane++;
+                    mask &= ~(1 << lane);
+
+                    for (int k = 0; k < varyingCount; k++)
+                        varyings[k] = out.varyings[k][lane];
+                    colorRow[lane] = packColor(fragmentShader(varyings));
+                    if (depthTest)
+                        depthRow[lane] = out.z[lane];
+                    fragments++;
+                }
+            }
+        }
+    }
+}
+
+int SoftwareRasterizer::shadeRowScalar(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out)
+{
+    int mask = 0;
+    for (int j = 0; j < BlockSize; j++)
+    {
+        if (!(in.validMask & (1 << j)))
+            continue;
+
+        float e[3];
+        bool inside = true;
+        for (int i = 0; i < 3; i++)
+        {
+            e[i] = in.e[i] + t.a[i] * j;
+            inside = inside && (e[i] > 0.0f || (e[i] == 0.0f && t.topLeft[i]));
+        }
+        if (!in.covered && !inside)
+            continue;
+
+        const float l0 = e[0] * t.invArea;
+        const float l1 = e[1] * t.invArea;
+        const float l2 = e[2] * t.invArea;
+        const float z = l0 * t.z[0] + l1 * t.z[1] + l2 * t.z[2];
+        if (depthTest && !(z < in.depth[j]))
+            continue;
+
+        const float w0 = l0 * t.invW[0];
+        const float w1 = l1 * t.invW[1];
+        const float w2 = l2 * t.invW[2];
+        const float invSum = 1.0f / (w0 + w1 + w2);
+        out.z[j] = z;
+        for (int k = 0; k < varyingCount; k++)
+            out.varyings[k][j] = (w0 * t.varyings[0][k] + w1 * t.varyings[1][k] + w2 * t.varyings[2][k]) * invSum;
+        mask |= 1 << j;
+    }
+    return mask;
+}
+
+#ifdef SR_X86
+
+SR_TARGET_SSE2 int SoftwareRasterizer::shadeRowSse2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 invArea = _mm_set1_ps(t.invArea);
+    int mask = 0;
+
+    // two halves of four lanes
+    for (int half = 0; half < BlockSize; half += 4)
+    {
+        const __m128 lanes = _mm_setr_ps(half + 0.0f, half + 1.0f, half + 2.0f, half + 3.0f);
+        __m128 l[3];
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int i = 0; i < 3; i++)
+        {
+            const __m128 e = _mm_add_ps(_mm_set1_ps(in.e[i]), _mm_mul_ps(_mm_set1_ps(t.a[i]), lanes));
+            const __m128 topLeft = t.topLeft[i] ? _mm_cmpeq_ps(e, zero) : zero;
+            inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e, zero), topLeft));
+            l[i] = _mm_mul_ps(e, invArea);
+        }
+
+        int halfMask = (in.validMask >> half) & 0xF;
+        if (!in.covered)
+            halfMask &= _mm_movemask_ps(inside);
+        if (!halfMask)
+            continue;
+
+        const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l[0], _mm_set1_ps(t.z[0])), _mm_mul_ps(l[1], _mm_set1_ps(t.z[1]))),
+            _mm_mul_ps(l[2], _mm_set1_ps(t.z[2])));
+        if (depthTest)
+            halfMask &= _mm_movemask_ps(_mm_cmplt_ps(z, _mm_loadu_ps(in.depth + half)));
+        if (!halfMask)
+            continue;
+
+        const __m128 w0 = _mm_mul_ps(l[0], _mm_set1_ps(t.invW[0]));
+        const __m128 w1 = _mm_mul_ps(l[1], _mm_set1_ps(t.invW[1]));
+        const __m128 w2 = _mm_mul_ps(l[2], _mm_set1_ps(t.invW[2]));
+        const __m128 invSum = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(w0, w1), w2));
+        _mm_storeu_ps(out.z + half, z);
+        for (int k = 0; k < varyingCount; k++)
+        {
+            const __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(t.varyings[0][k])), _mm_mul_ps(w1, _mm_set1_ps(t.varyings[1][k]))),
+                _mm_mul_ps(w2, _mm_set1_ps(t.varyings[2][k])));
+            _mm_storeu_ps(out.varyings[k] + half, _mm_mul_ps(v, invSum));
+        }
+        mask |= halfMask << half;
+    }
+    return mask;
+}
+
+SR_TARGET_AVX2 int SoftwareRasterizer::shadeRowAvx2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 invArea = _mm256_set1_ps(t.invArea);
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    __m256 l[3];
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int i = 0; i < 3; i++)
+    {
+        const __m256 e = _mm256_add_ps(_mm256_set1_ps(in.e[i]), _mm256_mul_ps(_mm256_set1_ps(t.a[i]), lanes));
+        const __m256 topLeft = t.topLeft[i] ? _mm256_cmp_ps(e, zero, _CMP_EQ_OQ) : zero;
+        inside = _mm256_and_ps(inside, _mm256_or_ps(_mm256_cmp_ps(e, zero, _CMP_GT_OQ), topLeft));
+        l[i] = _mm256_mul_ps(e, invArea);
+    }
+
+    int mask = in.validMask;
+    if (!in.covered)
+        mask &= _mm256_movemask_ps(inside);
+    if (!mask)
+        return 0;
+
+    const __m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l[0], _mm256_set1_ps(t.z[0])), _mm256_mul_ps(l[1], _mm256_set1_ps(t.z[1]))),
+        _mm256_mul_ps(l[2], _mm256_set1_ps(t.z[2])));
+    if (depthTest)
+        mask &= _mm256_movemask_ps(_mm256_cmp_ps(z, _mm256_loadu_ps(in.depth), _CMP_LT_OQ));
+    if (!mask)
+        return 0;
+
+    const __m256 w0 = _mm256_mul_ps(l[0], _mm256_set1_ps(t.invW[0]));
+    const __m256 w1 = _mm256_mul_ps(l[1], _mm256_set1_ps(t.invW[1]));
+    const __m256 w2 = _mm256_mul_ps(l[2], _mm256_set1_ps(t.invW[2]));
+    const __m256 invSum = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_add_ps(w0, w1), w2));
+    _mm256_storeu_ps(out.z, z);
+    for (int k = 0; k < varyingCount; k++)
+    {
+        const __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w0, _mm256_set1_ps(t.varyings[0][k])), _mm256_mul_ps(w1, _mm256_set1_ps(t.varyings[1][k]))),
+            _mm256_mul_ps(w2, _mm256_set1_ps(t.varyings[2][k])));
+        _mm256_storeu_ps(out.varyings[k], _mm256_mul_ps(v, invSum));
+    }
+    return mask;
+}
+
+#else
+
+int SoftwareRasterizer::shadeRowSse2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out)
+{
+    return shadeRowScalar(t, in, varyingCount, depthTest, out);
+}
+
+int SoftwareRasterizer::shadeRowAvx2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out)
+{
+    return shadeRowScalar(t, in, varyingCount, depthTest, out);
+}
+
+#endif
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+
+// CPU replacement for glDrawElements(GL_TRIANGLES, ...) on machines without a GPU.
+// It reads the same vertex/index arrays that the exercises upload to their VBO/EBO.
+// The framebuffer is split into TileSize x TileSize tiles, every draw bins its triangles
+// per tile and the tiles are shaded in parallel on a ThreadPool.
+class SoftwareRasterizer
+{
+public:
+    static constexpr int TileSize = 64;
+    static constexpr int BlockSize = 8;     // tiles are walked in 8x8 blocks, one SIMD row of 8 pixels at a time
+    static constexpr int MaxVaryings = 8;
+
+    // implementation of the per-row inside test / interpolation
+    enum class RasterKernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct VertexOutput
+    {
+        glm::vec4 position;             // clip space, same as gl_Position
+        float varyings[MaxVaryings];    // "out" variables of the vertex shader
+    };
+
+    // vertex points at one vertex of the vertex array (stride floats apart)
+    typedef std::function<void(const float* vertex, VertexOutput& out)> VertexShader;
+    // varyings are interpolated with perspective correction, returns the fragment color
+    typedef std::function<glm::vec4(const float* varyings)> FragmentShader;
+
+    struct Statistics
+    {
+        uint64_t triangles;     // triangles submitted
+        uint64_t rasterized;    // triangles left after clipping
+        uint64_t fragments;     // fragments that passed the depth test
+    };
+
+    SoftwareRasterizer(int width, int height, unsigned threads = 0);
+
+    void setThreadCount(unsigned threads);
+    unsigned threadCount() const;
+
+    // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
+    void clear(float r, float g, float b, float a);
+    // glEnable/glDisable(GL_DEPTH_TEST), depth function is GL_LESS
+    void setDepthTest(bool enabled);
+
+    // the best kernel supported by the CPU is picked in the constructor;
+    // asking for an unsupported one falls back to the best supported
+    void setRasterKernel(RasterKernel kernel);
+    RasterKernel rasterKernel() const { return kernel; }
+    static bool kernelSupported(RasterKernel candidate);
+    static const char* kernelName(RasterKernel candidate);
+
+    // stride is given in floats, count is the number of indices like in glDrawElements
+    void drawElements(const float* vertices, int stride, const unsigned int* indices, int count,
+        int varyingCount, const VertexShader& vertexShader, const FragmentShader& fragmentShader);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    // RGBA8 pixels, bottom row first like glReadPixels
+    const uint32_t* colorBuffer() const { return color.data(); }
+    const float* depthBuffer() const { return depth.data(); }
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    struct Triangle
+    {
+        float a[3], b[3], c[3];         // edge functions e = a * x + b * y + c, inside when all >= 0
+        bool topLeft[3];                // pixels exactly on the edge belong to the triangle
+        float invArea;
+        float z[3];                     // window depth [0, 1]
+        float invW[3];
+        float varyings[3][MaxVaryings]; // divided by w for perspective correction
+        int minX, minY, maxX, maxY;     // pixel bounds clamped to the framebuffer
+    };
+
+    // one row of BlockSize pixels handed to a kernel
+    struct RowInput
+    {
+        float e[3];             // edge functions at the first pixel of the row
+        const float* depth;     // BlockSize depth values
+        int validMask;          // lanes inside the framebuffer
+        bool covered;           // the whole block is inside the triangle
+    };
+
+    // interpolated values of the visible lanes, structure of arrays
+    struct RowOutput
+    {
+        float z[BlockSize];
+        float varyings[MaxVaryings][BlockSize];
+    };
+
+    // returns the mask of lanes that are covered and pass the depth test
+    typedef int (*RowKernel)(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out);
+
+    static int shadeRowScalar(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out);
+    static int shadeRowSse2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out);
+    static int shadeRowAvx2(const Triangle& t, const RowInput& in, int varyingCount, bool depthTest, RowOutput& out);
+
+    // triangles set up by one thread, binned per tile; chunks are consumed in order
+    // so the primitive order required by GL is kept inside every tile
+    struct Chunk
+    {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    void setupTriangle(const VertexOutput& v0, const VertexOutput& v1, const VertexOutput& v2, int varyingCount, Chunk& chunk);
+    void emitTriangle(const VertexOutput* v[3], int varyingCount, Chunk& chunk);
+    void rasterizeTile(int tile, int varyingCount, const FragmentShader& fragmentShader);
+    void rasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1, int varyingCount,
+        const FragmentShader& fragmentShader, uint64_t& fragments);
+
+    int frameWidth;
+    int frameHeight;
+    int tilesX;
+    int tilesY;
+    bool depthTest;
+    RasterKernel kernel;
+    RowKernel shadeRow;
+
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<VertexOutput> shadedVertices;
+    std::vector<Chunk> chunks;
+    int activeChunks;
+
+    std::atomic<uint64_t> submittedTriangles;
+    std::atomic<uint64_t> rasterizedTriangles;
+    std::atomic<uint64_t> shadedFragments;
+};
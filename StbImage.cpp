@@ -0,0 +1,85 @@
+// The stb_image implementation, compiled once for every module that decodes images.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image/stb_image.h>
+
+#include "StbImage.h"
+#include "MappedFile.h"
+#include "ScratchArena.h"
+#include "ThreadPool.h"
+
+#include <climits>
+
+namespace
+{
+    thread_local ThreadPool* decodePool = NULL;
+
+    void runOnPool(void* user, int count, stbi_parallel_job* job, void* context)
+    {
+        static_cast<ThreadPool*>(user)->parallelFor(count, [job, context](int index, unsigned) { job(context, index); });
+    }
+
+    bool scratchArenas = false;
+
+    // stb frees every temporary on the thread that allocated it, so each call goes to the caller's arena
+    void* arenaAllocate(void*, size_t size)
+    {
+        return imageScratchArena().allocate(size);
+    }
+
+    void* arenaReallocate(void*, void* p, size_t oldSize, size_t newSize)
+    {
+        return imageScratchArena().reallocate(p, oldSize, newSize);
+    }
+
+    void arenaRelease(void*, void* p)
+    {
+        imageScratchArena().release(p);
+    }
+
+    const stbi_scratch_allocator arenaAllocator = { arenaAllocate, arenaReallocate, arenaRelease, NULL };
+}
+
+void setImageDecodePool(ThreadPool* pool)
+{
+    decodePool = pool;
+    if (pool)
+        stbi_set_parallel_for_thread(runOnPool, pool, static_cast<int>(pool->size()));
+    else
+        stbi_set_parallel_for_thread(NULL, NULL, 1);
+}
+
+ThreadPool* imageDecodePool()
+{
+    return decodePool;
+}
+
+void setImageScratchArenas(bool enabled)
+{
+    scratchArenas = enabled;
+    stbi_set_scratch_allocator(enabled ? &arenaAllocator : NULL);
+}
+
+void setImageScratchArenaForThread(bool enabled)
+{
+    stbi_set_scratch_allocator_thread(enabled ? &arenaAllocator : NULL);
+}
+
+bool imageScratchArenas()
+{
+    return scratchArenas;
+}
+
+ScratchArena& imageScratchArena()
+{
+    // blocks go back to the heap when the thread ends
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+unsigned char* loadImageMapped(const char* filename, int* x, int* y, int* channels, int desiredChannels)
+{
+    const MappedFile file(filename);
+    if (!file.valid() || file.size() > static_cast<size_t>(INT_MAX))
+        return stbi_load(filename, x, y, channels, desiredChannels);
+    return stbi_load_from_memory(file.data(), static_cast<int>(file.size()), x, y, channels, desiredChannels);
+}
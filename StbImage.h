@@ -0,0 +1,27 @@
+#pragma once
+
+class ScratchArena;
+class ThreadPool;
+
+// Lets stb_image split the large JPEGs that the calling thread decodes across pool
+// (stbi_set_parallel_for_thread), NULL goes back to decoding them on the thread alone. Other
+// threads are not affected, so a pool's workers can each point at their own pool; the pool must
+// outlive the decodes that use it.
+void setImageDecodePool(ThreadPool* pool);
+ThreadPool* imageDecodePool();
+
+// Points stb_image's temporaries (JPEG coefficient and plane buffers, the inflated PNG data, ...)
+// at a ScratchArena per decoding thread (stbi_set_scratch_allocator), false goes back to malloc.
+// This is the process-wide setting: change it only while no image is being decoded anywhere.
+void setImageScratchArenas(bool enabled);
+bool imageScratchArenas();
+// the same for the calling thread only (stbi_set_scratch_allocator_thread), whatever the
+// process-wide setting; change it only while the thread is not decoding
+void setImageScratchArenaForThread(bool enabled);
+// the calling thread's arena, for its stats
+ScratchArena& imageScratchArena();
+
+// stbi_load (same flip setting, free the result with stbi_image_free) decoding from a MappedFile
+// instead of reading the file through stdio in small chunks. Files that cannot be mapped, or are
+// too large for stb's int lengths, go through stbi_load.
+unsigned char* loadImageMapped(const char* filename, int* x, int* y, int* channels, int desiredChannels);
@@ -0,0 +1,933 @@
+#include "TestImages.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace
+{
+    const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const int distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049,
+        3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const int distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const int codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    const int windowSize = 32768;
+    const int maxChain = 32;
+    const int maxMatch = 258;
+    const int maxInsert = 32;
+    const size_t symbolsPerBlock = 65536;
+
+    class DeflateBits
+    {
+    public:
+        explicit DeflateBits(std::vector<unsigned char>& out) : out(out), buffer(0), count(0) {}
+
+        // deflate packs from the least significant bit
+        void put(unsigned bits, int length)
+        {
+            buffer |= static_cast<unsigned long long>(bits & ((1u << length) - 1)) << count;
+            count += length;
+            while (count >= 8)
+            {
+                out.push_back(static_cast<unsigned char>(buffer));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        // Huffman codes go most significant bit first
+        void putCode(unsigned code, int length)
+        {
+            unsigned reversed = 0;
+            for (int i = 0; i < length; i++)
+                reversed |= ((code >> i) & 1) << (length - 1 - i);
+            put(reversed, length);
+        }
+
+        void flush()
+        {
+            if (count > 0)
+                put(0, 8 - count);
+        }
+
+    private:
+        std::vector<unsigned char>& out;
+        unsigned long long buffer;
+        int count;
+    };
+
+    // a literal (distance 0) or a match
+    struct Symbol
+    {
+        unsigned short value;
+        unsigned short distance;
+    };
+
+    struct HuffmanCode
+    {
+        std::vector<int> length;
+        std::vector<unsigned> code;
+    };
+
+    // Huffman code lengths limited to maxLength bits: the longest codes are moved up the way
+    // section K.2 of the JPEG standard does it, then given to the symbols by frequency
+    HuffmanCode buildCode(const std::vector<long>& frequency, int maxLength)
+    {
+        const int count = static_cast<int>(frequency.size());
+        std::vector<int> used;
+        for (int i = 0; i < count; i++)
+            if (frequency[i])
+                used.push_back(i);
+        // a code needs two symbols, deflate decoders accept an unused one
+        for (int i = 0; used.size() < 2; i++)
+            if (!frequency[i])
+                used.push_back(i);
+
+        std::vector<long> weight;
+        std::vector<int> parent(used.size() * 2, -1);
+        std::vector<int> active;
+        for (size_t i = 0; i < used.size(); i++)
+        {
+            weight.push_back(std::max(1L, frequency[used[i]]));
+            active.push_back(static_cast<int>(i));
+        }
+        while (active.size() > 1)
+        {
+            std::sort(active.begin(), active.end(), [&](int a, int b) { return weight[a] > weight[b]; });
+            const int a = active.back();
+            active.pop_back();
+            const int b = active.back();
+            active.pop_back();
+            const int node = static_cast<int>(weight.size());
+            weight.push_back(weight[a] + weight[b]);
+            parent[a] = parent[b] = node;
+            active.push_back(node);
+        }
+
+        std::vector<int> bits(64, 0);
+        for (size_t i = 0; i < used.size(); i++)
+        {
+            int depth = 0;
+            for (int node = static_cast<int>(i); parent[node] >= 0; node = parent[node])
+                depth++;
+            bits[depth]++;
+        }
+        for (int i = 63; i > maxLength; i--)
+        {
+            while (bits[i] > 0)
+            {
+                int j = i - 2;
+                while (bits[j] == 0)
+                    j--;
+                bits[i] -= 2;
+                bits[i - 1]++;
+                bits[j + 1] += 2;
+                bits[j]--;
+            }
+        }
+
+        std::stable_sort(used.begin(), used.end(), [&](int a, int b) { return frequency[a] > frequency[b]; });
+        HuffmanCode result;
+        result.length.assign(count, 0);
+        result.code.assign(count, 0);
+        size_t next = 0;
+        for (int length = 1; length <= maxLength; length++)
+            for (int i = 0; i < bits[length]; i++)
+                result.length[used[next++]] = length;
+
+        // canonical codes, shorter first and in symbol order within a length
+        unsigned code = 0;
+        for (int length = 1; length <= maxLength; length++)
+        {
+            for (int i = 0; i < count; i++)
+                if (result.length[i] == length)
+                    result.code[i] = code++;
+            code <<= 1;
+        }
+        return result;
+    }
+
+    int lengthSymbol(int length)
+    {
+        int i = 28;
+        while (lengthBase[i] > length)
+            i--;
+        return i;
+    }
+
+    int distanceSymbol(int distance)
+    {
+        int i = 29;
+        while (distanceBase[i] > distance)
+            i--;
+        return i;
+    }
+
+    void writeBlock(DeflateBits& writer, const Symbol* symbols, size_t count, bool last)
+    {
+        std::vector<long> literalFrequency(286, 0), distanceFrequency(30, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (symbols[i].distance)
+            {
+                literalFrequency[257 + lengthSymbol(symbols[i].value)]++;
+                distanceFrequency[distanceSymbol(symbols[i].distance)]++;
+            }
+            else
+            {
+                literalFrequency[symbols[i].value]++;
+            }
+        }
+        literalFrequency[256] = 1;
+        const HuffmanCode literals = buildCode(literalFrequency, 15);
+        const HuffmanCode distances = buildCode(distanceFrequency, 15);
+
+        int literalCount = 286, distanceCount = 30;
+        while (literalCount > 257 && literals.length[literalCount - 1] == 0)
+            literalCount--;
+        while (distanceCount > 1 && distances.length[distanceCount - 1] == 0)
+            distanceCount--;
+
+        // both code length lists, run-length coded with the symbols 16-18 (extra bits in .distance)
+        std::vector<int> lengths(literals.length.begin(), literals.length.begin() + literalCount);
+        lengths.insert(lengths.end(), distances.length.begin(), distances.length.begin() + distanceCount);
+        std::vector<Symbol> runs;
+        for (size_t i = 0; i < lengths.size();)
+        {
+            size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == lengths[i])
+                run++;
+            size_t left = run;
+            if (lengths[i] == 0)
+            {
+                while (left >= 11)
+                {
+                    const size_t n = std::min<size_t>(left, 138);
+                    runs.push_back({ 18, static_cast<unsigned short>(n - 11) });
+                    left -= n;
+                }
+                if (left >= 3)
+                {
+                    runs.push_back({ 17, static_cast<unsigned short>(left - 3) });
+                    left = 0;
+                }
+            }
+            else if (run >= 4)
+            {
+                runs.push_back({ static_cast<unsigned short>(lengths[i]), 0 });
+                left--;
+                while (left >= 3)
+                {
+                    const size_t n = std::min<size_t>(left, 6);
+                    runs.push_back({ 16, static_cast<unsigned short>(n - 3) });
+                    left -= n;
+                }
+            }
+            for (; left > 0; left--)
+                runs.push_back({ static_cast<unsigned short>(lengths[i]), 0 });
+            i += run;
+        }
+        std::vector<long> runFrequency(19, 0);
+        for (const Symbol& run : runs)
+            runFrequency[run.value]++;
+        const HuffmanCode runCode = buildCode(runFrequency, 7);
+        int runCodeCount = 19;
+        while (runCodeCount > 4 && runCode.length[codeLengthOrder[runCodeCount - 1]] == 0)
+            runCodeCount--;
+
+        writer.put(last ? 1 : 0, 1);
+        writer.put(2, 2);
+        writer.put(literalCount - 257, 5);
+        writer.put(distanceCount - 1, 5);
+        writer.put(runCodeCount - 4, 4);
+        for (int i = 0; i < runCodeCount; i++)
+            writer.put(runCode.length[codeLengthOrder[i]], 3);
+        for (const Symbol& run : runs)
+        {
+            writer.putCode(runCode.code[run.value], runCode.length[run.value]);
+            if (run.value >= 16)
+                writer.put(run.distance, run.value == 16 ? 2 : run.value == 17 ? 3 : 7);
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const Symbol& symbol = symbols[i];
+            if (symbol.distance)
+            {
+                const int l = lengthSymbol(symbol.value), d = distanceSymbol(symbol.distance);
+                writer.putCode(literals.code[257 + l], literals.length[257 + l]);
+                writer.put(symbol.value - lengthBase[l], lengthExtra[l]);
+                writer.putCode(distances.code[d], distances.length[d]);
+                writer.put(symbol.distance - distanceBase[d], distanceExtra[d]);
+            }
+            else
+            {
+                writer.putCode(literals.code[symbol.value], literals.length[symbol.value]);
+            }
+        }
+        writer.putCode(literals.code[256], literals.length[256]);
+    }
+
+    // the blocks and the checksum of a zlib stream written a piece at a time, keeping only the window and the next match's bytes
+    class Deflater
+    {
+    public:
+        explicit Deflater(std::vector<unsigned char>& out)
+            : out(out), writer(out), head(1 << 15, -1), previous(windowSize, -1), base(0), next(0), adler(1)
+        {
+        }
+
+        void write(const unsigned char* data, size_t size)
+        {
+            adler = adler32(data, size, adler);
+            pending.insert(pending.end(), data, data + size);
+            compress(false);
+        }
+
+        void finish()
+        {
+            compress(true);
+            writeBlock(writer, symbols.data(), symbols.size(), true);
+            writer.flush();
+            putBigEndian(out, adler);
+        }
+
+    private:
+        // greedy matching, a position is only coded once the longest match it can have is buffered
+        void compress(bool final)
+        {
+            const long long end = base + static_cast<long long>(pending.size());
+            const unsigned char* data = pending.data();
+            for (; next < end && (final || next + maxMatch <= end);)
+            {
+                const size_t i = static_cast<size_t>(next - base);
+                int bestLength = 0, bestDistance = 0;
+                if (next + 3 <= end)
+                {
+                    long long candidate = head[hash(data + i)];
+                    const int limit = static_cast<int>(std::min<long long>(maxMatch, end - next));
+                    for (int chain = 0; candidate >= 0 && chain < maxChain && next - candidate < windowSize && bestLength < limit; chain++)
+                    {
+                        const unsigned char* match = data + (candidate - base);
+                        int length = 0;
+                        while (length < limit && match[length] == data[i + length])
+                            length++;
+                        if (length > bestLength)
+                        {
+                            bestLength = length;
+                            bestDistance = static_cast<int>(next - candidate);
+                        }
+                        candidate = previous[candidate & (windowSize - 1)];
+                    }
+                }
+                const int step = bestLength >= 3 ? bestLength : 1;
+                if (symbols.size() == symbolsPerBlock)
+                {
+                    writeBlock(writer, symbols.data(), symbols.size(), false);
+                    symbols.clear();
+                }
+                if (bestLength >= 3)
+                    symbols.push_back({ static_cast<unsigned short>(bestLength), static_cast<unsigned short>(bestDistance) });
+                else
+                    symbols.push_back({ data[i], 0 });
+                // the middle of a long match is not hashed, as in zlib's faster levels, only its ends,
+                // so that runs continue from the match's last bytes
+                for (long long k = next; k < next + step && k + 3 <= end; k++)
+                {
+                    if (step > maxInsert && k > next && k < next + step - 3)
+                        k = next + step - 3;
+                    const unsigned h = hash(data + (k - base));
+                    previous[k & (windowSize - 1)] = head[h];
+                    head[h] = k;
+                }
+                next += step;
+            }
+
+            // drop what no match can reach any more
+            if (next - base > 2 * windowSize)
+            {
+                const long long keep = next - windowSize;
+                pending.erase(pending.begin(), pending.begin() + static_cast<size_t>(keep - base));
+                base = keep;
+            }
+        }
+
+        static unsigned hash(const unsigned char* p)
+        {
+            return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & 0x7fff;
+        }
+
+        std::vector<unsigned char>& out;
+        DeflateBits writer;
+        std::vector<long long> head, previous;  // absolute positions, previous indexed modulo the window
+        std::vector<unsigned char> pending;     // the input from position base on
+        std::vector<Symbol> symbols;            // of the block being collected
+        long long base, next;
+        uint32_t adler;
+    };
+
+    int paeth(int a, int b, int c)
+    {
+        const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+
+    // the filters of PNG, a separate loop each so they vectorize; left of the first pixel is 0
+    void filterRow(int filter, const unsigned char* row, const unsigned char* up, size_t size, size_t pixelBytes, unsigned char* out)
+    {
+        const size_t first = std::min(pixelBytes, size);
+        switch (filter)
+        {
+        case 0:
+            std::copy(row, row + size, out);
+            break;
+        case 1:
+            std::copy(row, row + first, out);
+            for (size_t x = first; x < size; x++)
+                out[x] = static_cast<unsigned char>(row[x] - row[x - pixelBytes]);
+            break;
+        case 2:
+            for (size_t x = 0; x < size; x++)
+                out[x] = static_cast<unsigned char>(row[x] - up[x]);
+            break;
+        case 3:
+            for (size_t x = 0; x < first; x++)
+                out[x] = static_cast<unsigned char>(row[x] - up[x] / 2);
+            for (size_t x = first; x < size; x++)
+                out[x] = static_cast<unsigned char>(row[x] - (row[x - pixelBytes] + up[x]) / 2);
+            break;
+        default:
+            for (size_t x = 0; x < first; x++)
+                out[x] = static_cast<unsigned char>(row[x] - up[x]);
+            for (size_t x = first; x < size; x++)
+                out[x] = static_cast<unsigned char>(row[x] - paeth(row[x - pixelBytes], up[x], up[x - pixelBytes]));
+            break;
+        }
+    }
+
+    const int zigzag[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    const int lumaQuant[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99
+    };
+
+    const int chromaQuant[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+    };
+
+    // a canonical Huffman table as written into DHT
+    struct HuffmanTable
+    {
+        unsigned char bits[17];         // bits[n]: number of codes of length n
+        std::vector<unsigned char> values;
+        unsigned short code[256];
+        unsigned char length[256];
+    };
+
+    int category(int value)
+    {
+        int magnitude = std::abs(value), bits = 0;
+        while (magnitude)
+        {
+            bits++;
+            magnitude >>= 1;
+        }
+        return bits;
+    }
+
+    // code lengths limited to 16 bits, as in section K.2 of the JPEG standard
+    HuffmanTable buildTable(const long* symbolCounts)
+    {
+        long frequency[257];
+        int codeSize[257], others[257];
+        for (int i = 0; i < 256; i++)
+            frequency[i] = symbolCounts[i];
+        // a reserved symbol keeps any real code from being all ones
+        frequency[256] = 1;
+        std::fill(codeSize, codeSize + 257, 0);
+        std::fill(others, others + 257, -1);
+
+        for (;;)
+        {
+            int c1 = -1, c2 = -1;
+            for (int i = 0; i <= 256; i++)
+                if (frequency[i] && (c1 < 0 || frequency[i] <= frequency[c1]))
+                    c1 = i;
+            for (int i = 0; i <= 256; i++)
+                if (frequency[i] && i != c1 && (c2 < 0 || frequency[i] <= frequency[c2]))
+                    c2 = i;
+            if (c2 < 0)
+                break;
+            frequency[c1] += frequency[c2];
+            frequency[c2] = 0;
+            codeSize[c1]++;
+            while (others[c1] >= 0)
+            {
+                c1 = others[c1];
+                codeSize[c1]++;
+            }
+            others[c1] = c2;
+            codeSize[c2]++;
+            while (others[c2] >= 0)
+            {
+                c2 = others[c2];
+                codeSize[c2]++;
+            }
+        }
+
+        int bits[33] = { 0 };
+        for (int i = 0; i <= 256; i++)
+            if (codeSize[i])
+                bits[codeSize[i]]++;
+        for (int i = 32; i > 16; i--)
+        {
+            while (bits[i] > 0)
+            {
+                int j = i - 2;
+                while (bits[j] == 0)
+                    j--;
+                bits[i] -= 2;
+                bits[i - 1]++;
+                bits[j + 1] += 2;
+                bits[j]--;
+            }
+        }
+        // drop the reserved symbol from the longest codes
+        int longest = 16;
+        while (bits[longest] == 0)
+            longest--;
+        bits[longest]--;
+
+        HuffmanTable table;
+        table.bits[0] = 0;
+        for (int i = 1; i <= 16; i++)
+            table.bits[i] = static_cast<unsigned char>(bits[i]);
+        for (int size = 1; size <= 32; size++)
+            for (int i = 0; i < 256; i++)
+                if (codeSize[i] == size)
+                    table.values.push_back(static_cast<unsigned char>(i));
+
+        int code = 0;
+        size_t next = 0;
+        for (int size = 1; size <= 16; size++)
+        {
+            for (int i = 0; i < table.bits[size]; i++)
+            {
+                table.code[table.values[next]] = static_cast<unsigned short>(code++);
+                table.length[table.values[next]] = static_cast<unsigned char>(size);
+                next++;
+            }
+            code <<= 1;
+        }
+        return table;
+    }
+
+    // JPEG packs from the most significant bit, a 0xff byte is followed by a 0
+    class JpegBits
+    {
+    public:
+        explicit JpegBits(std::vector<unsigned char>& out) : out(out), buffer(0), count(0) {}
+
+        void put(unsigned bits, int length)
+        {
+            buffer = (buffer << length) | (bits & ((1u << length) - 1));
+            count += length;
+            while (count >= 8)
+            {
+                const unsigned char byte = static_cast<unsigned char>(buffer >> (count - 8));
+                out.push_back(byte);
+                if (byte == 0xff)
+                    out.push_back(0);
+                count -= 8;
+            }
+        }
+
+        // pads the last byte with ones, before a marker
+        void flush()
+        {
+            if (count > 0)
+                put(0x7f, 8 - count);
+            buffer = 0;
+        }
+
+    private:
+        std::vector<unsigned char>& out;
+        unsigned buffer;
+        int count;
+    };
+
+    void encodeBlock(JpegBits& writer, const JpegBlock& block, int& previousDc, const HuffmanTable& dc, const HuffmanTable& ac)
+    {
+        const int diff = block.coefficient[0] - previousDc;
+        previousDc = block.coefficient[0];
+        const int dcSize = category(diff);
+        writer.put(dc.code[dcSize], dc.length[dcSize]);
+        if (dcSize)
+            writer.put(diff < 0 ? diff - 1 : diff, dcSize);
+
+        int run = 0;
+        for (int k = 1; k < 64; k++)
+        {
+            const int value = block.coefficient[k];
+            if (value == 0)
+            {
+                run++;
+                continue;
+            }
+            while (run > 15)
+            {
+                writer.put(ac.code[0xf0], ac.length[0xf0]);
+                run -= 16;
+            }
+            const int size = category(value);
+            const int symbol = (run << 4) | size;
+            writer.put(ac.code[symbol], ac.length[symbol]);
+            writer.put(value < 0 ? value - 1 : value, size);
+            run = 0;
+        }
+        if (run)
+            writer.put(ac.code[0], ac.length[0]);
+    }
+
+    void countBlock(const JpegBlock& block, int& previousDc, long* dc, long* ac)
+    {
+        dc[category(block.coefficient[0] - previousDc)]++;
+        previousDc = block.coefficient[0];
+        int run = 0;
+        for (int k = 1; k < 64; k++)
+        {
+            if (block.coefficient[k] == 0)
+            {
+                run++;
+                continue;
+            }
+            for (; run > 15; run -= 16)
+                ac[0xf0]++;
+            ac[(run << 4) | category(block.coefficient[k])]++;
+            run = 0;
+        }
+        if (run)
+            ac[0]++;
+    }
+
+    void putMarker(std::vector<unsigned char>& out, int marker, int length)
+    {
+        out.push_back(0xff);
+        out.push_back(static_cast<unsigned char>(marker));
+        if (length >= 0)
+            putBigEndian(out, length + 2, 2);
+    }
+
+    void putTable(std::vector<unsigned char>& out, int tableClass, int id, const HuffmanTable& table)
+    {
+        putMarker(out, 0xc4, 1 + 16 + static_cast<int>(table.values.size()));
+        out.push_back(static_cast<unsigned char>((tableClass << 4) | id));
+        out.insert(out.end(), table.bits + 1, table.bits + 17);
+        out.insert(out.end(), table.values.begin(), table.values.end());
+    }
+
+    void quantTables(int quality, int quant[2][64])
+    {
+        const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        for (int i = 0; i < 64; i++)
+        {
+            quant[0][i] = std::min(255, std::max(1, (lumaQuant[i] * scale + 50) / 100));
+            quant[1][i] = std::min(255, std::max(1, (chromaQuant[i] * scale + 50) / 100));
+        }
+    }
+}
+
+std::vector<unsigned char> readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& data)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && written;
+}
+
+bool listFiles(const std::string& directory, const std::vector<std::string>& extensions, std::vector<std::string>& paths)
+{
+    std::vector<std::string> names;
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            names.push_back(found.cFileName);
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+#else
+    DIR* listing = opendir(directory.c_str());
+    if (!listing)
+        return false;
+    while (const dirent* found = readdir(listing))
+        names.push_back(found->d_name);
+    closedir(listing);
+#endif
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names)
+    {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        for (const std::string& extension : extensions)
+            if (lower.size() > extension.size() && lower.compare(lower.size() - extension.size(), extension.size(), extension) == 0)
+            {
+                paths.push_back(directory + "/" + name);
+                break;
+            }
+    }
+    return true;
+}
+
+std::vector<unsigned char> encodePng(int width, int height, const PngRows& rows, const PngOptions& options)
+{
+    const int channels[7] = { 1, 0, 3, 0, 2, 0, 4 };
+    const size_t pixelBytes = static_cast<size_t>(channels[options.colorType]) * options.depth / 8;
+    const size_t stride = width * pixelBytes;
+
+    std::vector<unsigned char> zlib = { 0x78, static_cast<unsigned char>(options.compressed ? 0x9c : 0x01) };
+    Deflater deflater(zlib);
+    uint32_t adler = 1;
+
+    // the filter type byte, then the row
+    std::vector<unsigned char> row(stride + 1), up(stride + 1, 0), filtered(stride + 1), candidate(stride + 1);
+    for (int y = 0; y < height; y++)
+    {
+        row[0] = 0;
+        rows(y, &row[1]);
+        if (!options.compressed)
+        {
+            putStoredBlocks(zlib, row.data(), row.size(), false);
+            adler = adler32(row.data(), row.size(), adler);
+            continue;
+        }
+
+        // each row with the filter whose output has the smallest sum of absolute values (the first
+        // one on a tie, so nothing beats a sum of 0)
+        long bestSum = -1;
+        for (int filter = 0; filter < 5 && bestSum != 0; filter++)
+        {
+            candidate[0] = static_cast<unsigned char>(filter);
+            filterRow(filter, &row[1], &up[1], stride, pixelBytes, &candidate[1]);
+            long sum = 0;
+            for (size_t x = 1; x <= stride; x++)
+                sum += std::abs(static_cast<signed char>(candidate[x]));
+            if (bestSum < 0 || sum < bestSum)
+            {
+                bestSum = sum;
+                filtered.swap(candidate);
+            }
+        }
+        deflater.write(filtered.data(), filtered.size());
+        row.swap(up);
+    }
+
+    if (options.compressed)
+    {
+        deflater.finish();
+    }
+    else
+    {
+        putStoredBlocks(zlib, NULL, 0, true);
+        putBigEndian(zlib, adler);
+    }
+    return pngFile(width, height, options.depth, options.colorType, zlib, options.idatBytes, options.transparency);
+}
+
+std::vector<unsigned char> encodePng(const std::vector<unsigned char>& rgba, int width, int height)
+{
+    const size_t stride = static_cast<size_t>(width) * 4;
+    return encodePng(width, height, [&](int y, unsigned char* row)
+    {
+        std::copy(rgba.begin() + y * stride, rgba.begin() + (y + 1) * stride, row);
+    });
+}
+
+std::vector<unsigned char> encodeJpeg(int width, int height, int quality, int restartInterval, const JpegMcus& mcus)
+{
+    int quant[2][64];
+    quantTables(quality, quant);
+
+    const int mcuX = (width + 15) / 16, mcuY = (height + 15) / 16;
+    JpegBlock blocks[6];
+    long counts[4][256] = { { 0 } };
+    int dcPrediction[3] = { 0, 0, 0 };
+    for (int mcu = 0; mcu < mcuX * mcuY; mcu++)
+    {
+        if (restartInterval && mcu % restartInterval == 0)
+            dcPrediction[0] = dcPrediction[1] = dcPrediction[2] = 0;
+        mcus(mcu % mcuX, mcu / mcuX, blocks);
+        for (int b = 0; b < 6; b++)
+        {
+            const int component = b < 4 ? 0 : b - 3;
+            const int table = component ? 1 : 0;
+            countBlock(blocks[b], dcPrediction[component], counts[table * 2], counts[table * 2 + 1]);
+        }
+    }
+    const HuffmanTable tables[4] = { buildTable(counts[0]), buildTable(counts[1]), buildTable(counts[2]), buildTable(counts[3]) };
+
+    std::vector<unsigned char> out;
+    putMarker(out, 0xd8, -1);
+    const unsigned char jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    putMarker(out, 0xe0, sizeof(jfif));
+    out.insert(out.end(), jfif, jfif + sizeof(jfif));
+    for (int t = 0; t < 2; t++)
+    {
+        putMarker(out, 0xdb, 65);
+        out.push_back(static_cast<unsigned char>(t));
+        for (int k = 0; k < 64; k++)
+            out.push_back(static_cast<unsigned char>(quant[t][zigzag[k]]));
+    }
+    putMarker(out, 0xc0, 15);
+    const unsigned char frame[] = { 8, static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+        static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width), 3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+    out.insert(out.end(), frame, frame + sizeof(frame));
+    for (int t = 0; t < 2; t++)
+    {
+        putTable(out, 0, t, tables[t * 2]);
+        putTable(out, 1, t, tables[t * 2 + 1]);
+    }
+    if (restartInterval)
+    {
+        putMarker(out, 0xdd, 2);
+        putBigEndian(out, restartInterval, 2);
+    }
+    putMarker(out, 0xda, 10);
+    const unsigned char scan[] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    out.insert(out.end(), scan, scan + sizeof(scan));
+
+    JpegBits writer(out);
+    dcPrediction[0] = dcPrediction[1] = dcPrediction[2] = 0;
+    for (int mcu = 0; mcu < mcuX * mcuY; mcu++)
+    {
+        if (restartInterval && mcu > 0 && mcu % restartInterval == 0)
+        {
+            writer.flush();
+            putMarker(out, 0xd0 + ((mcu / restartInterval - 1) & 7), -1);
+            dcPrediction[0] = dcPrediction[1] = dcPrediction[2] = 0;
+        }
+        mcus(mcu % mcuX, mcu / mcuX, blocks);
+        for (int b = 0; b < 6; b++)
+        {
+            const int component = b < 4 ? 0 : b - 3;
+            const int table = component ? 1 : 0;
+            encodeBlock(writer, blocks[b], dcPrediction[component], tables[table * 2], tables[table * 2 + 1]);
+        }
+    }
+    writer.flush();
+    putMarker(out, 0xd9, -1);
+    return out;
+}
+
+std::vector<unsigned char> encodeJpeg(const std::vector<unsigned char>& rgb, int width, int height, int quality, int restartInterval)
+{
+    int quant[2][64];
+    quantTables(quality, quant);
+
+    float basis[8][8];
+    for (int x = 0; x < 8; x++)
+        for (int u = 0; u < 8; u++)
+            basis[x][u] = std::cos((2 * x + 1) * u * 3.14159265f / 16) * (u == 0 ? std::sqrt(0.125f) : 0.5f);
+
+    // the transform is the slow part, done once for both passes
+    const int mcuX = (width + 15) / 16, mcuY = (height + 15) / 16;
+    std::vector<JpegBlock> blocks(static_cast<size_t>(mcuX) * mcuY * 6);
+    for (int my = 0; my < mcuY; my++)
+    {
+        for (int mx = 0; mx < mcuX; mx++)
+        {
+            float planes[3][16][16];
+            for (int y = 0; y < 16; y++)
+            {
+                for (int x = 0; x < 16; x++)
+                {
+                    const int px = std::min(mx * 16 + x, width - 1), py = std::min(my * 16 + y, height - 1);
+                    const unsigned char* p = &rgb[(static_cast<size_t>(py) * width + px) * 3];
+                    planes[0][y][x] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] - 128;
+                    planes[1][y][x] = -0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2];
+                    planes[2][y][x] = 0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2];
+                }
+            }
+            for (int b = 0; b < 6; b++)
+            {
+                float samples[8][8];
+                for (int y = 0; y < 8; y++)
+                {
+                    for (int x = 0; x < 8; x++)
+                    {
+                        if (b < 4)
+                        {
+                            samples[y][x] = planes[0][(b >> 1) * 8 + y][(b & 1) * 8 + x];
+                        }
+                        else
+                        {
+                            const float (*c)[16] = planes[b - 3];
+                            samples[y][x] = 0.25f * (c[2 * y][2 * x] + c[2 * y][2 * x + 1] + c[2 * y + 1][2 * x] + c[2 * y + 1][2 * x + 1]);
+                        }
+                    }
+                }
+                float rows[8][8];
+                for (int y = 0; y < 8; y++)
+                {
+                    for (int u = 0; u < 8; u++)
+                    {
+                        float sum = 0;
+                        for (int x = 0; x < 8; x++)
+                            sum += samples[y][x] * basis[x][u];
+                        rows[y][u] = sum;
+                    }
+                }
+                JpegBlock& block = blocks[(static_cast<size_t>(my) * mcuX + mx) * 6 + b];
+                const int* q = quant[b < 4 ? 0 : 1];
+                for (int k = 0; k < 64; k++)
+                {
+                    const int u = zigzag[k] & 7, v = zigzag[k] >> 3;
+                    float sum = 0;
+                    for (int y = 0; y < 8; y++)
+                        sum += rows[y][u] * basis[y][v];
+                    block.coefficient[k] = static_cast<short>(std::lround(sum / q[zigzag[k]]));
+                }
+            }
+        }
+    }
+
+    return encodeJpeg(width, height, quality, restartInterval, [&](int x, int y, JpegBlock* mcu)
+    {
+        std::copy(&blocks[(static_cast<size_t>(y) * mcuX + x) * 6], &blocks[(static_cast<size_t>(y) * mcuX + x) * 6] + 6, mcu);
+    });
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ImageWriter.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Test images for the benchmarks, encoded here so they run without data files and know what the
+// decoders should give back. PNGs are put together from the pieces of ImageWriter.h (chunks,
+// stored blocks), JPEGs are baseline 4:2:0 with optimized Huffman tables. Images are made a row
+// or an MCU at a time, so even ones too large to hold decoded can be written.
+
+struct TestImage
+{
+    std::string name;
+    std::vector<unsigned char> file;
+};
+
+inline double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the whole file, empty when it cannot be read
+std::vector<unsigned char> readFile(const std::string& path);
+bool writeFile(const std::string& path, const std::vector<unsigned char>& data);
+// the files in directory whose names end in one of extensions (".jpg", any case), sorted; false
+// when it is not a directory that can be listed
+bool listFiles(const std::string& directory, const std::vector<std::string>& extensions, std::vector<std::string>& paths);
+
+// fills row y of the image, width * channels samples, 16-bit ones big-endian
+typedef std::function<void(int y, unsigned char* row)> PngRows;
+
+struct PngOptions
+{
+    int colorType = 6;          // 0 gray, 2 RGB, 4 gray + alpha, 6 RGBA
+    int depth = 8;              // 8 or 16
+    // per-row adaptive filters (smallest sum of absolute differences), greedy LZ77 with hash
+    // chains over a 32 KB window and a dynamic Huffman block per 64K symbols, the way common PNG
+    // writers do it; false writes unfiltered rows in stored blocks
+    bool compressed = true;
+    std::vector<unsigned char> transparency;    // tRNS chunk, none when empty
+    size_t idatBytes = 1 << 16;                 // split like most writers do, 0 for one IDAT chunk
+};
+
+// rows is called once for every row, top to bottom
+std::vector<unsigned char> encodePng(int width, int height, const PngRows& rows, const PngOptions& options = PngOptions());
+// 8-bit RGBA pixels, top row first
+std::vector<unsigned char> encodePng(const std::vector<unsigned char>& rgba, int width, int height);
+
+// quantized coefficients of one 8x8 block in zigzag order
+struct JpegBlock
+{
+    short coefficient[64];
+};
+
+// fills the blocks of MCU (x, y): four luma blocks (left to right, top to bottom), then Cb and Cr.
+// Called twice for every MCU in order, first to count the symbols for the Huffman tables.
+typedef std::function<void(int x, int y, JpegBlock* blocks)> JpegMcus;
+
+// baseline JFIF, 4:2:0, the standard quantization tables scaled to quality, a restart marker
+// every restartInterval MCUs (0 for none)
+std::vector<unsigned char> encodeJpeg(int width, int height, int quality, int restartInterval, const JpegMcus& mcus);
+// 8-bit RGB pixels, top row first
+std::vector<unsigned char> encodeJpeg(const std::vector<unsigned char>& rgb, int width, int height, int quality, int restartInterval);
@@ -0,0 +1,431 @@
+#include "TextureAtlas.h"
+#include "ImageProbe.h"
+#include "MappedFile.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    const unsigned char placeholderTexel[] = { 128, 128, 128, 255 };
+    // files up to this size are read instead of mapped
+    const size_t smallFileBytes = 64 << 10;
+}
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : pageWidth(width), pageHeight(height), used(0)
+{
+    skyline.push_back({ 0, 0, width });
+}
+
+bool SkylinePacker::insert(int width, int height, int& x, int& y)
+{
+    size_t best = skyline.size();
+    int bestY = INT_MAX;
+    long long bestWaste = LLONG_MAX;
+    for (size_t i = 0; i < skyline.size() && skyline[i].x + width <= pageWidth; i++)
+    {
+        // resting on the highest segment under it
+        const int right = skyline[i].x + width;
+        int top = 0;
+        for (size_t j = i; j < skyline.size() && skyline[j].x < right; j++)
+            top = std::max(top, skyline[j].y);
+        if (top + height > pageHeight || top > bestY)
+            continue;
+        long long waste = 0;
+        for (size_t j = i; j < skyline.size() && skyline[j].x < right; j++)
+            waste += static_cast<long long>(std::min(right, skyline[j].x + skyline[j].width) - skyline[j].x) * (top - skyline[j].y);
+        if (top < bestY || waste < bestWaste)
+        {
+            best = i;
+            bestY = top;
+            bestWaste = waste;
+        }
+    }
+    if (best == skyline.size())
+        return false;
+
+    x = skyline[best].x;
+    y = bestY;
+    used += static_cast<long long>(width) * height;
+    // the new segment covers the start of the ones it rests on
+    skyline.insert(skyline.begin() + best, { x, y + height, width });
+    for (size_t i = best + 1; i < skyline.size();)
+    {
+        Segment& segment = skyline[i];
+        const int overlap = x + width - segment.x;
+        if (overlap <= 0)
+            break;
+        if (segment.width <= overlap)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        segment.x += overlap;
+        segment.width -= overlap;
+        break;
+    }
+    for (size_t i = 1; i < skyline.size();)
+    {
+        if (skyline[i - 1].y == skyline[i].y)
+        {
+            skyline[i - 1].width += skyline[i].width;
+            skyline.erase(skyline.begin() + i);
+        }
+        else
+            i++;
+    }
+    return true;
+}
+
+AtlasLayout packAtlas(const std::vector<std::string>& paths, int pageSize, int padding, ThreadPool* pool)
+{
+    AtlasLayout layout;
+    layout.pageSize = pageSize;
+    layout.padding = padding;
+    layout.paths = paths;
+    layout.regions.resize(paths.size());
+
+    const std::vector<ImageProbe> probes = probeImages(paths, pool);
+    std::vector<int> order(paths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return probes[a].height != probes[b].height ? probes[a].height > probes[b].height : probes[a].width > probes[b].width;
+    });
+
+    std::vector<SkylinePacker> packers;
+    for (const int image : order)
+    {
+        const ImageProbe& probe = probes[image];
+        const int width = probe.width + 2 * padding, height = probe.height + 2 * padding;
+        if (!probe.valid || width > pageSize || height > pageSize)
+            continue;
+        AtlasRegion& region = layout.regions[image];
+        int x = 0, y = 0;
+        size_t page = 0;
+        while (page < packers.size() && !packers[page].insert(width, height, x, y))
+            page++;
+        if (page == packers.size())
+        {
+            packers.emplace_back(pageSize, pageSize);
+            layout.pages.emplace_back();
+            packers.back().insert(width, height, x, y);
+        }
+        layout.pages[page].push_back(image);
+        region.page = static_cast<int>(page);
+        region.x = x + padding;
+        region.y = y + padding;
+        region.width = probe.width;
+        region.height = probe.height;
+        region.u0 = static_cast<float>(region.x) / pageSize;
+        region.v0 = static_cast<float>(region.y) / pageSize;
+        region.u1 = static_cast<float>(region.x + region.width) / pageSize;
+        region.v1 = static_cast<float>(region.y + region.height) / pageSize;
+    }
+    return layout;
+}
+
+bool decodeAtlasImage(const AtlasLayout& layout, int image, bool flip, unsigned char* page, std::string& error)
+{
+    const AtlasRegion& region = layout.regions[image];
+    // icons are read whole into a buffer per thread; mapping costs more than reading below a few pages
+    thread_local std::vector<unsigned char> buffer;
+    const unsigned char* data = NULL;
+    size_t size = 0;
+    std::unique_ptr<MappedFile> mapped;
+    if (FILE* file = fopen(layout.paths[image].c_str(), "rb"))
+    {
+        setvbuf(file, NULL, _IONBF, 0);
+        buffer.resize(smallFileBytes);
+        size = fread(buffer.data(), 1, buffer.size(), file);
+        const bool whole = size < buffer.size() || fgetc(file) == EOF;
+        fclose(file);
+        if (whole)
+            data = buffer.data();
+    }
+    if (!data)
+    {
+        mapped.reset(new MappedFile(layout.paths[image]));
+        data = mapped->data();
+        size = mapped->size();
+    }
+    if (!data || size == 0 || size > static_cast<size_t>(INT_MAX))
+    {
+        error = "cannot read file";
+        return false;
+    }
+    const size_t stride = static_cast<size_t>(layout.pageSize) * 4;
+    const size_t offset = stride * region.y + static_cast<size_t>(region.x) * 4;
+    // the page is shared, an image that no longer fits its region must not be written into it
+    int width, height, channels;
+    if (!stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels))
+    {
+        error = stbi_failure_reason();
+        return false;
+    }
+    if (width != region.width || height != region.height)
+    {
+        error = "image size changed since the atlas was packed";
+        return false;
+    }
+    if (!stbi_load_from_memory_into(data, static_cast<int>(size), page + offset, stride * layout.pageSize - offset,
+        static_cast<int>(stride), flip, &width, &height, &channels, 4))
+    {
+        error = stbi_failure_reason();
+        return false;
+    }
+
+    // padding: the edge columns copied sideways, then the edge rows (with their padding) up and down
+    const int padding = layout.padding;
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char* row = page + offset + stride * y;
+        for (int x = 1; x <= padding; x++)
+        {
+            std::memcpy(row - x * 4, row, 4);
+            std::memcpy(row + (width - 1 + x) * 4, row + (width - 1) * 4, 4);
+        }
+    }
+    const size_t rowBytes = static_cast<size_t>(width + 2 * padding) * 4;
+    unsigned char* bottom = page + offset - padding * 4;
+    unsigned char* top = bottom + stride * (height - 1);
+    for (int y = 1; y <= padding; y++)
+    {
+        std::memcpy(bottom - stride * y, bottom, rowBytes);
+        std::memcpy(top + stride * y, top, rowBytes);
+    }
+    return true;
+}
+
+TextureAtlas::TextureAtlas(size_t budgetBytes, int pageSize, int padding, unsigned threads)
+    : flipRows(true), pageBytes(static_cast<size_t>(pageSize) * pageSize * 4), committed(0), frame(0), loaded(0), evicted(0),
+      placeholder(0), cancelled(false)
+{
+    atlas.pageSize = pageSize;
+    atlas.padding = padding;
+    budget = std::max(budgetBytes, pageBytes);
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    // as in TextureLoader, the GL thread itself never decodes
+    pool.reset(new ThreadPool(std::max(threads, 1u) + 1));
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    stopWorkers();
+}
+
+int TextureAtlas::build(const std::vector<std::string>& paths, bool flip)
+{
+    flipRows = flip;
+    atlas = packAtlas(paths, atlas.pageSize, atlas.padding, pool.get());
+    pages.clear();
+    for (size_t i = 0; i < atlas.pages.size(); i++)
+        pages.emplace_back(new Page());
+
+    GLint previous;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderTexel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, previous);
+
+    int placed = 0;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (atlas.regions[i].page >= 0)
+            placed++;
+        else
+            std::cout << "Error (TextureAtlas): " << paths[i] << ": cannot be read or is larger than a page" << std::endl;
+    }
+    return placed;
+}
+
+void TextureAtlas::remapUVs(int image, float* vertices, size_t count, size_t stride, size_t uvOffset) const
+{
+    const AtlasRegion& r = atlas.regions[image];
+    for (size_t i = 0; i < count; i++)
+    {
+        float* uv = vertices + i * stride + uvOffset;
+        uv[0] = r.u0 + uv[0] * (r.u1 - r.u0);
+        uv[1] = r.v0 + uv[1] * (r.v1 - r.v0);
+    }
+}
+
+GLuint TextureAtlas::usePage(int index)
+{
+    if (index < 0 || index >= static_cast<int>(pages.size()))
+        return placeholder;
+    Page& page = *pages[index];
+    page.lastUsed = frame;
+    if (page.state == State::Evicted)
+    {
+        page.state = State::Queued;
+        queue.push_back(index);
+    }
+    return page.state == State::Resident ? page.texture : placeholder;
+}
+
+int TextureAtlas::poll()
+{
+    return update(true);
+}
+
+void TextureAtlas::wait()
+{
+    for (;;)
+    {
+        const bool loading = std::any_of(pages.begin(), pages.end(), [](const std::unique_ptr<Page>& page)
+        {
+            return page->state == State::Loading;
+        });
+        const size_t queued = queue.size();
+        if (!loading && queued == 0)
+            return;
+        // nothing decoding and nothing started: the rest cannot fit
+        if (update(false) == 0 && !loading && queue.size() == queued)
+            return;
+        std::this_thread::yield();
+    }
+}
+
+int TextureAtlas::update(bool advance)
+{
+    if (advance)
+        frame++;
+    // pages used in the last frame or the current one are kept, queued or resident: poll() has
+    // just started a frame, wait() may run before this frame has asked for its pages again
+    const long long inUse = frame - 1;
+
+    std::vector<int> finished;
+    std::vector<std::string> failures;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        finished.swap(decoded);
+        failures.swap(errors);
+    }
+    for (const std::string& failure : failures)
+        std::cout << "Error (TextureAtlas): " << failure << std::endl;
+
+    GLint previous;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    for (const int index : finished)
+    {
+        Page& page = *pages[index];
+        glGenTextures(1, &page.texture);
+        glBindTexture(GL_TEXTURE_2D, page.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas.pageSize, atlas.pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, page.pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        std::vector<unsigned char>().swap(page.pixels);
+        page.state = State::Resident;
+    }
+    glBindTexture(GL_TEXTURE_2D, previous);
+
+    // queued pages in order, each after making room for it; pages nobody asked for since the last
+    // frame are dropped from the queue
+    for (size_t i = 0; i < queue.size();)
+    {
+        Page& page = *pages[queue[i]];
+        if (page.lastUsed < inUse)
+        {
+            page.state = State::Evicted;
+            queue.erase(queue.begin() + i);
+            continue;
+        }
+        while (committed + pageBytes > budget)
+        {
+            int oldest = -1;
+            for (size_t p = 0; p < pages.size(); p++)
+                if (pages[p]->state == State::Resident && pages[p]->lastUsed < inUse &&
+                    (oldest < 0 || pages[p]->lastUsed < pages[oldest]->lastUsed))
+                    oldest = static_cast<int>(p);
+            if (oldest < 0)
+                break;
+            evict(oldest);
+        }
+        if (committed + pageBytes > budget)
+            break;
+        startLoad(queue[i]);
+        queue.erase(queue.begin() + i);
+    }
+    return static_cast<int>(finished.size());
+}
+
+void TextureAtlas::startLoad(int index)
+{
+    Page& page = *pages[index];
+    page.state = State::Loading;
+    page.pixels.assign(pageBytes, 0);
+    committed += pageBytes;
+    loaded++;
+    const std::vector<int>& images = atlas.pages[index];
+    page.remaining = static_cast<int>(images.size());
+    for (const int image : images)
+        pool->enqueue([this, index, image]() {
+            Page& target = *pages[index];
+            std::string error;
+            if (!cancelled && !decodeAtlasImage(atlas, image, flipRows, target.pixels.data(), error))
+            {
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                errors.push_back(atlas.paths[image] + ": " + error);
+            }
+            // the last image of the page hands it to the GL thread, one that failed stays transparent
+            if (target.remaining.fetch_sub(1) == 1 && !cancelled)
+            {
+                std::lock_guard<std::mutex> lock(decodedMutex);
+                decoded.push_back(index);
+            }
+        });
+}
+
+void TextureAtlas::evict(int index)
+{
+    Page& page = *pages[index];
+    glDeleteTextures(1, &page.texture);
+    page.texture = 0;
+    page.state = State::Evicted;
+    committed -= pageBytes;
+    evicted++;
+}
+
+int TextureAtlas::residentPages() const
+{
+    return static_cast<int>(std::count_if(pages.begin(), pages.end(), [](const std::unique_ptr<Page>& page)
+    {
+        return page->state == State::Resident;
+    }));
+}
+
+void TextureAtlas::destroy()
+{
+    stopWorkers();
+    for (const std::unique_ptr<Page>& page : pages)
+        if (page->texture)
+            glDeleteTextures(1, &page->texture);
+    pages.clear();
+    if (placeholder)
+        glDeleteTextures(1, &placeholder);
+    placeholder = 0;
+    committed = 0;
+}
+
+void TextureAtlas::stopWorkers()
+{
+    // queued decodes return at once, the pool's destructor waits for the running ones
+    cancelled = true;
+    pool.reset();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Packs rectangles into one page along a skyline: the top edge of everything packed so far, kept
+// as horizontal segments from left to right. A rectangle goes where its bottom lands lowest, on a
+// tie where it leaves the least area unusable below it. Feeding the rectangles tallest first
+// keeps the skyline flat.
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    // false when the rectangle does not fit anywhere
+    bool insert(int width, int height, int& x, int& y);
+    // packed area over page area
+    double occupancy() const { return static_cast<double>(used) / (static_cast<double>(pageWidth) * pageHeight); }
+
+private:
+    struct Segment
+    {
+        int x, y, width;
+    };
+
+    int pageWidth, pageHeight;
+    long long used;
+    std::vector<Segment> skyline;
+};
+
+// Where an image of an atlas is: page, its texels (x, y from the bottom-left like GL, without the
+// padding around it) and the same as texture coordinates.
+struct AtlasRegion
+{
+    int page = -1;          // -1 when the image could not be read or is larger than a page
+    int x = 0, y = 0, width = 0, height = 0;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+};
+
+// The packing of a list of image files into square RGBA pages: sizes from probeImages
+// (stbi_info, no decoding), tallest first into SkylinePackers, first page it fits on.
+// Every image gets padding texels around it, filled with copies of its edge, so bilinear
+// filtering at the border never reads a neighbour.
+struct AtlasLayout
+{
+    int pageSize = 0;
+    int padding = 0;
+    std::vector<std::string> paths;
+    std::vector<AtlasRegion> regions;           // in the order of paths
+    std::vector<std::vector<int>> pages;        // images on each page
+};
+
+AtlasLayout packAtlas(const std::vector<std::string>& paths, int pageSize = 2048, int padding = 2, ThreadPool* pool = NULL);
+
+// Decodes one image of the layout straight into its place in page (pageSize * pageSize RGBA
+// texels, bottom row first) with stbi_load_from_memory_into and fills its padding. Images of the
+// same page may be decoded on several threads at once, their rectangles never overlap.
+// flip as stbi_set_flip_vertically_on_load(true), which the regions' v coordinates assume.
+bool decodeAtlasImage(const AtlasLayout& layout, int image, bool flip, unsigned char* page, std::string& error);
+
+// Texture atlas pages streamed in and out of GL under a memory budget.
+// build() packs the files (packAtlas); no page is decoded yet. usePage() / use(), called while
+// drawing, return a page's texture and mark it used in this frame; a page that is not resident is
+// queued and a 1x1 grey placeholder is returned until it is. poll(), once per frame on the GL
+// thread, starts queued pages while the resident and loading pages fit the budget, evicting the
+// least recently used pages that were not used in the last frame (glDeleteTextures), and uploads
+// the pages whose images the workers have decoded, all images of a page in parallel, each straight
+// into the page's pixels. Pages are RGBA8 without mipmaps, with linear filtering and clamped edges:
+// texture coordinates must stay inside [0, 1] of an image, remapUVs() moves them into its region.
+class TextureAtlas
+{
+public:
+    // call once GL is loaded; budgetBytes is raised to at least one page; threads == 0 uses
+    // std::thread::hardware_concurrency(), there is always at least one worker
+    explicit TextureAtlas(size_t budgetBytes = 256 << 20, int pageSize = 2048, int padding = 2, unsigned threads = 0);
+    // waits for the decodes still running; the textures are left to destroy()
+    ~TextureAtlas();
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // GL thread, once: lays the files out, reports the ones left out; returns how many were placed
+    int build(const std::vector<std::string>& paths, bool flip = true);
+
+    const AtlasLayout& layout() const { return atlas; }
+    const AtlasRegion& region(int image) const { return atlas.regions[image]; }
+    int pageCount() const { return static_cast<int>(pages.size()); }
+
+    // u' = u0 + u * (u1 - u0), v likewise, for count vertices of stride floats whose texture
+    // coordinates start at float uvOffset
+    void remapUVs(int image, float* vertices, size_t count, size_t stride, size_t uvOffset) const;
+
+    // GL thread: the texture to draw image or page with this frame
+    GLuint use(int image) { return usePage(atlas.regions[image].page); }
+    GLuint usePage(int page);
+
+    // GL thread, once per frame: returns how many pages were uploaded
+    int poll();
+    // GL thread: until every queued page is resident or can never fit next to the pages in use
+    void wait();
+    // GL thread: stops the workers and deletes the page textures, the atlas must not be used afterwards
+    void destroy();
+
+    int residentPages() const;
+    size_t residentBytes() const { return committed; }
+    int loads() const { return loaded; }
+    int evictions() const { return evicted; }
+
+private:
+    enum class State
+    {
+        Evicted,
+        Queued,     // used, waiting for room in the budget
+        Loading,    // workers decoding its images
+        Resident
+    };
+
+    struct Page
+    {
+        State state = State::Evicted;
+        GLuint texture = 0;
+        std::vector<unsigned char> pixels;  // while loading
+        std::atomic<int> remaining{ 0 };    // images still decoding
+        long long lastUsed = -1;            // frame
+    };
+
+    // advance: a new frame starts, the last one's pages are the ones in use
+    int update(bool advance);
+    void startLoad(int page);
+    void evict(int page);
+    void stopWorkers();
+
+    AtlasLayout atlas;
+    bool flipRows;
+    size_t budget;
+    size_t pageBytes;
+    size_t committed;       // resident and loading pages
+    long long frame;
+    int loaded, evicted;
+    GLuint placeholder;
+    std::vector<std::unique_ptr<Page>> pages;
+    std::vector<int> queue;             // in the order the pages were first used
+    std::mutex decodedMutex;
+    std::vector<int> decoded;           // pages whose last image finished, for the GL thread
+    std::vector<std::string> errors;    // reported by poll()
+    std::atomic<bool> cancelled;
+    std::unique_ptr<ThreadPool> pool;
+};
@@ -0,0 +1,233 @@
+// Block compression with BlockCompressor: BC1, BC3 and BC7 of whole mip chains with every kernel the
+// CPU supports, on one thread and on a ThreadPool, compared byte for byte with the scalar kernel,
+// with the PSNR of level 0. Then the loading side: what a worker does for a JPEG (stbi_load and a
+// CPU mip chain) against what it does for the same texture as KTX2 (map, parse, copy the blocks),
+// the GPU memory each takes, and a KTX2 and a DDS round trip of every texture, whose files must
+// no longer parse once their level count says 0x80000000.
+// The default images are texture1.jpg, texture2.jpg and a generated 2048x2048 RGBA picture.
+// usage: TextureCompressionBenchmark [repeats] [threads] [files...]
+//   threads 0 is std::thread::hardware_concurrency()
+// build with CompressedTexture.cpp, MipChain.cpp, CpuFeatures.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "CompressedTexture.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "TestImages.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Image
+    {
+        std::string name;
+        std::string path;   // empty for the generated one
+        MipChain chain;
+    };
+
+    // soft gradients, hard edges and a varying alpha
+    MipChain generated(int size)
+    {
+        std::vector<unsigned char> pixels(static_cast<size_t>(size) * size * 4);
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+            {
+                unsigned char* texel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+                const bool disc = (x - size / 2) * (x - size / 2) + (y - size / 2) * (y - size / 2) < size * size / 9;
+                texel[0] = static_cast<unsigned char>(disc ? 230 : x * 255 / size);
+                texel[1] = static_cast<unsigned char>(disc ? 40 : y * 255 / size);
+                texel[2] = static_cast<unsigned char>(((x / 64) + (y / 64)) % 2 ? 200 : 30);
+                texel[3] = static_cast<unsigned char>(disc ? 255 : (x + y) * 255 / (2 * size));
+            }
+        MipChain chain;
+        MipChainBuilder().build(pixels.data(), size, size, 4, chain);
+        return chain;
+    }
+
+    double psnr(const MipChain& image, const CompressedTexture& texture)
+    {
+        MipChain decoded;
+        if (!decompressTexture(texture, decoded))
+            return 0.0;
+        const int channels = image.channels;
+        const size_t texels = static_cast<size_t>(image.levels[0].width) * image.levels[0].height;
+        double sum = 0.0;
+        for (size_t i = 0; i < texels; i++)
+            for (int c = 0; c < channels; c++)
+            {
+                const int slot = (channels == 2 && c == 1) ? 3 : c;
+                const double d = static_cast<double>(image.pixels[i * channels + c]) - decoded.pixels[i * 4 + slot];
+                sum += d * d;
+            }
+        const double mse = sum / (texels * channels);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    }
+
+    bool sameTexture(const CompressedTexture& a, const CompressedTexture& b)
+    {
+        if (a.format != b.format || a.srgb != b.srgb || a.bottomUp != b.bottomUp || a.levels.size() != b.levels.size())
+            return false;
+        for (size_t i = 0; i < a.levels.size(); i++)
+            if (a.levels[i].width != b.levels[i].width || a.levels[i].height != b.levels[i].height || a.levels[i].bytes != b.levels[i].bytes)
+                return false;
+        return a.blocks == b.blocks;
+    }
+
+    // the saved file at path with 0x80000000 written over its level count (and flag set in the
+    // 32-bit field at flagsOffset) must not parse: the count is above INT_MAX, not negative
+    bool rejectsHugeLevelCount(const std::string& path, size_t countOffset, size_t flagsOffset, uint32_t flag)
+    {
+        std::vector<unsigned char> file = readFile(path);
+        if (file.size() < std::max(countOffset, flagsOffset) + 4)
+            return false;
+        file[countOffset + 3] = 0x80;
+        file[countOffset] = file[countOffset + 1] = file[countOffset + 2] = 0;
+        for (int i = 0; i < 4; i++)
+            file[flagsOffset + i] |= static_cast<unsigned char>(flag >> (i * 8));
+        CompressedTexture parsed;
+        std::string error;
+        return !parseCompressedTexture(file.data(), file.size(), parsed, error) && parsed.levels.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    ThreadPool pool(argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0);
+    std::vector<std::string> paths(argv + std::min(argc, 3), argv + argc);
+    if (paths.empty())
+        paths = { "texture1.jpg", "texture2.jpg" };
+
+    std::vector<Image> images;
+    stbi_set_flip_vertically_on_load(true);
+    for (const std::string& path : paths)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (!pixels)
+        {
+            std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+        Image image = { path, path, MipChain() };
+        MipChainBuilder().build(pixels, width, height, channels, image.chain);
+        stbi_image_free(pixels);
+        images.push_back(image);
+    }
+    if (argc <= 3)
+        images.push_back({ "generated 2048x2048", "", generated(2048) });
+
+    bool identical = true;
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 };
+    const char* formatNames[] = { "BC1", "BC3", "BC7" };
+    const BlockCompressor::Kernel kernels[] = { BlockCompressor::Kernel::Scalar, BlockCompressor::Kernel::SSE2, BlockCompressor::Kernel::AVX2 };
+    std::printf("best of %d, whole mip chains, megatexels/s of level 0\n", repeats);
+    std::printf("%20s %6s %7s %8s %10s %10s %10s %10s\n", "image", "format", "kernel", "threads", "ms", "MT/s", "PSNR dB", "identical");
+    for (const Image& image : images)
+    {
+        const double megatexels = static_cast<double>(image.chain.levels[0].width) * image.chain.levels[0].height / 1e6;
+        for (int f = 0; f < 3; f++)
+        {
+            CompressedTexture reference;
+            BlockCompressor scalar(NULL);
+            scalar.setKernel(BlockCompressor::Kernel::Scalar);
+            scalar.compress(image.chain, formats[f], reference);
+            const double quality = psnr(image.chain, reference);
+            for (const BlockCompressor::Kernel kernel : kernels)
+            {
+                if (!BlockCompressor::kernelSupported(kernel))
+                    continue;
+                for (ThreadPool* compressPool : { static_cast<ThreadPool*>(NULL), &pool })
+                {
+                    if (compressPool && pool.size() < 2)
+                        continue;
+                    BlockCompressor compressor(compressPool);
+                    compressor.setKernel(kernel);
+                    CompressedTexture texture;
+                    double best = 1e9;
+                    for (int i = 0; i < repeats; i++)
+                    {
+                        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                        compressor.compress(image.chain, formats[f], texture);
+                        best = std::min(best, secondsSince(start));
+                    }
+                    const bool same = texture.blocks == reference.blocks;
+                    identical = identical && same;
+                    std::printf("%20s %6s %7s %8u %10.1f %10.1f %10.1f %10s\n", image.name.c_str(), formatNames[f],
+                        BlockCompressor::kernelName(kernel), compressPool ? compressPool->size() : 1u, best * 1000.0,
+                        megatexels / best, quality, same ? "yes" : "NO");
+                }
+            }
+        }
+    }
+
+    // the worker's part of a load: decode and filter, or map and copy
+    std::printf("\n%20s %6s %16s %16s %12s %12s %10s\n", "file", "format", "JPEG+chain ms", "KTX2 copy ms", "RGBA8 KB", "GPU KB", "round trip");
+    const MipChainBuilder builder(&pool);
+    const BlockCompressor compressor(&pool);
+    for (const Image& image : images)
+    {
+        for (int f = 0; f < 3; f++)
+        {
+            CompressedTexture texture;
+            compressor.compress(image.chain, formats[f], texture);
+            texture.bottomUp = true;
+            const std::string ktx2 = "TextureCompressionBenchmark.ktx2", dds = "TextureCompressionBenchmark.dds";
+            CompressedTexture fromKtx2, fromDds;
+            std::string error;
+            bool roundTrip = saveCompressedTexture(ktx2, texture) && loadCompressedTexture(ktx2, fromKtx2, error) &&
+                sameTexture(texture, fromKtx2);
+            // DDS has no row order, it reads back top-down
+            texture.bottomUp = false;
+            roundTrip = roundTrip && saveCompressedTexture(dds, texture) && loadCompressedTexture(dds, fromDds, error) &&
+                sameTexture(texture, fromDds);
+            // KTX2 levelCount at 40; DDS dwMipMapCount at 28, counted only with DDSD_MIPMAPCOUNT in dwFlags
+            roundTrip = roundTrip && rejectsHugeLevelCount(ktx2, 40, 40, 0) && rejectsHugeLevelCount(dds, 28, 8, 0x20000);
+            identical = identical && roundTrip;
+
+            double decodeSeconds = 0.0, copySeconds = 1e9;
+            if (!image.path.empty())
+            {
+                decodeSeconds = 1e9;
+                for (int i = 0; i < repeats; i++)
+                {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    int width, height, channels;
+                    unsigned char* pixels = stbi_load(image.path.c_str(), &width, &height, &channels, 0);
+                    MipChain chain;
+                    builder.build(pixels, width, height, channels, chain);
+                    stbi_image_free(pixels);
+                    decodeSeconds = std::min(decodeSeconds, secondsSince(start));
+                }
+            }
+            std::vector<unsigned char> staging(texture.bytes());
+            for (int i = 0; i < repeats; i++)
+            {
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                const MappedFile file(ktx2);
+                CompressedTexture parsed;
+                if (file.valid() && parseCompressedTexture(file.data(), file.size(), parsed, error))
+                    copyCompressedLevels(file.data(), parsed, staging.data());
+                copySeconds = std::min(copySeconds, secondsSince(start));
+            }
+            std::remove(ktx2.c_str());
+            std::remove(dds.c_str());
+
+            const size_t rgbaBytes = image.chain.pixels.size() / image.chain.channels * 4;
+            char decodeColumn[32] = "-";
+            if (decodeSeconds > 0.0)
+                std::snprintf(decodeColumn, sizeof(decodeColumn), "%.2f", decodeSeconds * 1000.0);
+            std::printf("%20s %6s %16s %16.2f %12.0f %12.0f %10s\n", image.name.c_str(), formatNames[f], decodeColumn,
+                copySeconds * 1000.0, rgbaBytes / 1024.0, texture.bytes() / 1024.0, roundTrip ? "yes" : "NO");
+        }
+    }
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Offline texture compression: every file given is decoded, its mip chain built by MipChainBuilder
+// (sRGB-correct, box filter unless --kaiser) and compressed by BlockCompressor on all cores into a
+// KTX2 file next to it (texture1.jpg -> texture1.ktx2, or .dds with --dds). TextureLoader uploads
+// those with glCompressedTexImage2D, and with setPrecompressed(true) takes them over the images.
+// Rows are flipped like the exercises' stbi_set_flip_vertically_on_load(true) and the file says so
+// (KTXorientation "ru"); --no-flip keeps the image's top-down order.
+// Prints the size against the RGBA8 chain the GL would otherwise keep and the PSNR of level 0.
+// usage: TextureCompressor [--bc1 | --bc3 | --bc7] [--kaiser] [--no-flip] [--dds] [--threads n] files...
+//   without a format: BC1 for images without alpha, BC3 for the others
+// build with CompressedTexture.cpp, MipChain.cpp, CpuFeatures.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp and ThreadPool.cpp
+
+#include <stb_image/stb_image.h>
+#include "CompressedTexture.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char* formatName(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        default: return "BC7";
+        }
+    }
+
+    // of level 0 against the image, over its channels (gray against red)
+    double psnr(const MipChain& image, const CompressedTexture& texture)
+    {
+        MipChain decoded;
+        if (!decompressTexture(texture, decoded))
+            return 0.0;
+        const int channels = image.channels;
+        const size_t texels = static_cast<size_t>(image.levels[0].width) * image.levels[0].height;
+        double sum = 0.0;
+        for (size_t i = 0; i < texels; i++)
+            for (int c = 0; c < channels; c++)
+            {
+                const int slot = (channels == 2 && c == 1) ? 3 : c;
+                const double d = static_cast<double>(image.pixels[i * channels + c]) - decoded.pixels[i * 4 + slot];
+                sum += d * d;
+            }
+        const double mse = sum / (texels * channels);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool formatGiven = false, kaiser = false, flip = true, dds = false;
+    BlockFormat format = BlockFormat::BC1;
+    unsigned threads = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--bc1" || argument == "--bc3" || argument == "--bc7")
+        {
+            format = argument == "--bc1" ? BlockFormat::BC1 : argument == "--bc3" ? BlockFormat::BC3 : BlockFormat::BC7;
+            formatGiven = true;
+        }
+        else if (argument == "--kaiser")
+            kaiser = true;
+        else if (argument == "--no-flip")
+            flip = false;
+        else if (argument == "--dds")
+            dds = true;
+        else if (argument == "--threads" && i + 1 < argc)
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else
+            paths.push_back(argument);
+    }
+    if (paths.empty())
+    {
+        std::printf("usage: TextureCompressor [--bc1 | --bc3 | --bc7] [--kaiser] [--no-flip] [--dds] [--threads n] files...\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    const MipChainBuilder builder(&pool);
+    const BlockCompressor compressor(&pool);
+    stbi_set_flip_vertically_on_load(flip);
+    int failures = 0;
+    for (const std::string& path : paths)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (!pixels)
+        {
+            std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            failures++;
+            continue;
+        }
+        MipChain chain;
+        builder.build(pixels, width, height, channels, chain, kaiser ? MipChainBuilder::Filter::Kaiser : MipChainBuilder::Filter::Box);
+        stbi_image_free(pixels);
+
+        CompressedTexture texture;
+        const BlockFormat chosen = formatGiven ? format : channels == 2 || channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+        compressor.compress(chain, chosen, texture);
+        texture.bottomUp = flip;
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const std::string output = compressedTexturePath(path, dds ? ".dds" : ".ktx2");
+        if (!saveCompressedTexture(output, texture))
+        {
+            std::printf("%s: cannot write %s\n", path.c_str(), output.c_str());
+            failures++;
+            continue;
+        }
+        const size_t rgbaBytes = chain.pixels.size() / channels * 4;
+        std::printf("%s -> %s: %s %dx%d, %zu levels, %.0f KB (RGBA8 %.0f KB, %.1fx smaller), %.0f ms, PSNR %.1f dB\n",
+            path.c_str(), output.c_str(), formatName(chosen), width, height, texture.levels.size(), texture.bytes() / 1024.0,
+            rgbaBytes / 1024.0, static_cast<double>(rgbaBytes) / texture.bytes(), seconds * 1000.0, psnr(chain, texture));
+    }
+    return failures ? 1 : 0;
+}
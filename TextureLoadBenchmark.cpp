@@ -0,0 +1,164 @@
+// Time to first frame and time until every texture is resident for a batch of image files,
+// loaded like Zadanie5/Zadanie8 did (stbi_load + glTexImage2D + glGenerateMipmap on the GL
+// thread before the first frame) against TextureLoader (decoding on workers, uploads in poll()
+// once per frame, placeholders until then).
+// usage: TextureLoadBenchmark [count] [files...]
+//   loads count textures, cycling through the files (texture1.jpg and texture2.jpg by default),
+//   e.g. TextureLoadBenchmark 0 textures/*.jpg loads every file once
+// build with glad.c, TextureLoader.cpp, PixelUploadRing.cpp, GLCapabilities.cpp, CompressedTexture.cpp, DecodeCache.cpp, MipChain.cpp,
+// CpuFeatures.cpp, StbImage.cpp, ScratchArena.cpp, MappedFile.cpp, ThreadPool.cpp and GLFW
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "TextureLoader.h"
+#include "TestImages.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Result
+{
+    double firstFrame;      // seconds from the first load to the end of the first frame
+    double allResident;     // seconds from the first load until every texture was uploaded
+    int frames;             // frames rendered until then
+};
+
+// an empty frame: the exercises' draw calls cost the same either way
+void renderFrame()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+}
+
+Result loadBlocking(const std::vector<std::string>& files)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<GLuint> textures(files.size());
+    glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    stbi_set_flip_vertically_on_load(true);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(files[i].c_str(), &width, &height, &channels, 3);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        if (pixels)
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        stbi_image_free(pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    renderFrame();
+
+    Result result;
+    result.firstFrame = result.allResident = secondsSince(start);
+    result.frames = 1;
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    return result;
+}
+
+Result loadAsync(const std::vector<std::string>& files, unsigned threads, int uploadsPerFrame)
+{
+    TextureLoader loader(threads);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<GLuint> textures;
+    for (const std::string& file : files)
+        textures.push_back(loader.load(file));
+
+    Result result;
+    result.frames = 0;
+    while (loader.pending() > 0)
+    {
+        if (loader.poll(uploadsPerFrame) == 0)
+            std::this_thread::yield();
+        renderFrame();
+        if (result.frames++ == 0)
+            result.firstFrame = secondsSince(start);
+    }
+    result.allResident = secondsSince(start);
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    return result;
+}
+
+void print(const char* method, const Result& result)
+{
+    std::printf("%32s %16.1f %16.1f %8d\n", method, result.firstFrame * 1000.0, result.allResident * 1000.0, result.frames);
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::vector<std::string> sources;
+    for (int i = 2; i < argc; i++)
+        sources.push_back(argv[i]);
+    if (sources.empty())
+    {
+        sources.push_back("texture1.jpg");
+        sources.push_back("texture2.jpg");
+    }
+    if (count <= 0)
+        count = static_cast<int>(sources.size());
+    std::vector<std::string> files;
+    for (int i = 0; i < count; i++)
+        files.push_back(sources[i % sources.size()]);
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(256, 256, "TextureLoadBenchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGL())
+    {
+        std::printf("Failed to initialize GLAD\n");
+        return -1;
+    }
+    std::printf("%s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+    // a hidden window's own pixels may be skipped by the driver, draw into a renderbuffer
+    GLuint framebuffer, colorBuffer;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 256, 256);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%d textures from %d files, %u hardware threads\n", count, static_cast<int>(sources.size()), cores);
+    std::printf("%32s %16s %16s %8s\n", "method", "first frame ms", "all resident ms", "frames");
+
+    // the first pass also warms up the file cache, it is not printed
+    loadBlocking(files);
+    print("blocking, before first frame", loadBlocking(files));
+    print("TextureLoader, 1 worker", loadAsync(files, 1, -1));
+    if (cores > 1)
+    {
+        char name[64];
+        std::snprintf(name, sizeof(name), "TextureLoader, %u workers", cores);
+        print(name, loadAsync(files, cores, -1));
+    }
+    print("TextureLoader, 4 uploads/frame", loadAsync(files, cores, 4));
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,482 @@
+#include "TextureLoader.h"
+#include "GLCapabilities.h"
+#include "MappedFile.h"
+#include "StbImage.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// GL_EXT_texture_compression_s3tc, GL_EXT_texture_sRGB and GL 4.2 / GL_ARB_texture_compression_bptc,
+// not part of the GL 3.3 glad loader
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+
+namespace
+{
+    // 2x2 grey checkerboard shown until the real image arrives
+    const unsigned char placeholder[] = {
+        96, 96, 96,     160, 160, 160,  0, 0,
+        160, 160, 160,  96, 96, 96,     0, 0
+    };
+    // its 1x1 level, so the placeholder is complete without glGenerateMipmap
+    const unsigned char placeholderMip[] = { 128, 128, 128 };
+
+    GLenum formatFor(int channels)
+    {
+        switch (channels)
+        {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 4: return GL_RGBA;
+        default: return GL_RGB;
+        }
+    }
+
+    // BC1 as RGBA, so the punch-through alpha of DXT1 files from other tools survives
+    GLenum compressedFormatFor(const CompressedTexture& texture)
+    {
+        switch (texture.format)
+        {
+        case BlockFormat::BC1: return texture.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return texture.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        default: return texture.srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    bool isCompressedFile(const std::string& path)
+    {
+        const auto endsWith = [&](const char* suffix)
+        {
+            const size_t length = strlen(suffix);
+            return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+        };
+        return endsWith(".ktx2") || endsWith(".dds");
+    }
+}
+
+TextureLoader::TextureLoader(unsigned threads, size_t uploadRingBytes)
+    : head(nullptr), cancelled(false), requested(0), finished(0), uploaded(0), firstFrameSeconds(-1.0),
+      mipmaps(Mipmaps::Gpu), mipFilter(MipChainBuilder::Filter::Box), mipSrgb(true),
+      precompressed(false), decodeCache(NULL)
+{
+    s3tcSupported = hasGLExtension("GL_EXT_texture_compression_s3tc");
+    bptcSupported = hasGLVersion(4, 2) || hasGLExtension("GL_ARB_texture_compression_bptc");
+
+    if (uploadRingBytes > 0)
+        ring.reset(new PixelUploadRing(uploadRingBytes));
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    // a pool of size n has n - 1 workers, the GL thread itself never decodes
+    pool.reset(new ThreadPool(std::max(threads, 1u) + 1));
+    // a single big texture's levels are split across the workers too
+    mipBuilder.reset(new MipChainBuilder(pool.get()));
+}
+
+TextureLoader::~TextureLoader()
+{
+    // the ring's GL objects are left to destroy()
+    stopWorkers();
+
+    Decoded* item = head.exchange(nullptr);
+    while (item)
+    {
+        ready.push_back(item);
+        item = item->next;
+    }
+    for (Decoded* left : ready)
+    {
+        stbi_image_free(left->pixels);
+        delete left;
+    }
+}
+
+GLuint TextureLoader::load(const std::string& path, bool flip)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 1, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholderMip);
+    if (requested == finished)
+    {
+        start = std::chrono::steady_clock::now();
+        firstFrameSeconds = -1.0;
+    }
+    requested++;
+
+    const Mipmaps mode = mipmaps;
+    const MipChainBuilder::Filter filter = mipFilter;
+    const bool srgb = mipSrgb;
+    const bool compressedFirst = precompressed;
+    DecodeCache* const cache = decodeCache;
+    ThreadPool* const workers = pool.get();
+    pool->enqueue([this, texture, path, flip, mode, filter, srgb, compressedFirst, cache, workers]() {
+        if (cancelled)
+            return;
+        Decoded* item = new Decoded();
+        item->texture = texture;
+        item->path = path;
+        item->pixels = NULL;
+        item->staged = false;
+        // the workers are the loader's own threads, their arenas stay on until the threads end
+        setImageScratchArenaForThread(true);
+        // a large JPEG is split across the other workers too; only this worker's decodes see the
+        // setting, and it is gone before the pool is
+        setImageDecodePool(workers);
+        decode(*item, flip, mode, filter, srgb, compressedFirst, cache);
+        setImageDecodePool(NULL);
+        push(item);
+    });
+    return texture;
+}
+
+void TextureLoader::setMipmaps(Mipmaps mode, MipChainBuilder::Filter filter, bool srgb)
+{
+    mipmaps = mode;
+    mipFilter = filter;
+    mipSrgb = srgb;
+}
+
+void TextureLoader::decode(Decoded& item, bool flip, Mipmaps mode, MipChainBuilder::Filter filter, bool srgb, bool compressedFirst,
+    DecodeCache* cache)
+{
+    if (isCompressedFile(item.path))
+    {
+        if (!decodeCompressed(item, item.path, flip))
+            item.error = "cannot open file";
+        return;
+    }
+    if (compressedFirst)
+    {
+        if (decodeCompressed(item, compressedTexturePath(item.path, ".ktx2"), flip) ||
+            decodeCompressed(item, compressedTexturePath(item.path, ".dds"), flip))
+            return;
+    }
+
+    const MappedFile file(item.path);
+    const bool mapped = file.valid() && file.size() <= static_cast<size_t>(INT_MAX);
+    const int length = mapped ? static_cast<int>(file.size()) : 0;
+    uint64_t cacheKey = 0;
+    if (cache && mapped)
+    {
+        DecodeCache::Options options;
+        options.flip = flip;
+        options.mipmaps = mode != Mipmaps::Gpu;
+        options.filter = filter;
+        options.srgb = srgb;
+        cacheKey = DecodeCache::key(file.data(), file.size(), options);
+        if (std::unique_ptr<DecodeCache::Entry> entry = cache->find(cacheKey))
+        {
+            stageCached(item, std::move(entry));
+            return;
+        }
+    }
+    if (mode != Mipmaps::Gpu)
+    {
+        std::unique_ptr<MipChain> chain(new MipChain());
+        stbi_set_flip_vertically_on_load_thread(flip);
+        unsigned char* pixels = mapped ? stbi_load_from_memory(file.data(), length, &item.width, &item.height, &item.channels, 0)
+            : stbi_load(item.path.c_str(), &item.width, &item.height, &item.channels, 0);
+        if (!pixels)
+        {
+            item.error = stbi_failure_reason();
+            return;
+        }
+        mipBuilder->build(pixels, item.width, item.height, item.channels, *chain, filter, srgb);
+        stbi_image_free(pixels);
+        if (cacheKey)
+            cache->store(cacheKey, *chain);
+        stageMips(item, std::move(chain));
+        return;
+    }
+
+    if (mapped && ring && !cacheKey && stbi_info_from_memory(file.data(), length, &item.width, &item.height, &item.channels))
+    {
+        // decoded from the mapped file straight into the ring, flipped on the way; the GL thread only
+        // issues the upload
+        const size_t bytes = static_cast<size_t>(item.width) * item.height * item.channels;
+        unsigned char* target;
+        if (ring->reserve(bytes, item.offset, target))
+        {
+            int width, height, channels;
+            item.staged = true;
+            if (!stbi_load_from_memory_into(file.data(), length, target, bytes, item.width * item.channels, flip,
+                &width, &height, &channels, item.channels))
+                item.error = stbi_failure_reason();
+        }
+    }
+    if (item.error.empty() && !item.staged)
+    {
+        stbi_set_flip_vertically_on_load_thread(flip);
+        // files that cannot be mapped get stb's own reading and error messages
+        item.pixels = mapped ? stbi_load_from_memory(file.data(), length, &item.width, &item.height, &item.channels, 0)
+            : stbi_load(item.path.c_str(), &item.width, &item.height, &item.channels, 0);
+        if (!item.pixels)
+            item.error = stbi_failure_reason();
+        else if (cacheKey)
+            cache->store(cacheKey, item.pixels, item.width, item.height, item.channels);
+    }
+}
+
+bool TextureLoader::decodeCompressed(Decoded& item, const std::string& path, bool flip)
+{
+    const MappedFile file(path);
+    if (!file.valid())
+        return false;
+    std::unique_ptr<CompressedTexture> texture(new CompressedTexture());
+    if (!parseCompressedTexture(file.data(), file.size(), *texture, item.error))
+    {
+        if (path != item.path)
+            item.error = path + ": " + item.error;
+        return true;
+    }
+    item.width = texture->levels[0].width;
+    item.height = texture->levels[0].height;
+    item.channels = 4;
+
+    const bool supported = texture->format == BlockFormat::BC7 ? bptcSupported : s3tcSupported;
+    unsigned char* target;
+    if (supported && texture->bottomUp == flip)
+    {
+        // the blocks are uploaded as they are in the file, a copy is all the worker does
+        if (ring && ring->reserve(texture->bytes(), item.offset, target))
+        {
+            copyCompressedLevels(file.data(), *texture, target);
+            item.staged = true;
+        }
+        else
+        {
+            texture->blocks.resize(texture->bytes());
+            copyCompressedLevels(file.data(), *texture, texture->blocks.data());
+        }
+        item.compressed = std::move(texture);
+        return true;
+    }
+
+    // RGBA levels instead, flipped here when the file's rows go the other way
+    texture->blocks.resize(texture->bytes());
+    copyCompressedLevels(file.data(), *texture, texture->blocks.data());
+    std::unique_ptr<MipChain> chain(new MipChain());
+    if (!decompressTexture(*texture, *chain))
+    {
+        item.error = "BC7 blocks other than mode 6 need GL_ARB_texture_compression_bptc and the file's row order";
+        return true;
+    }
+    if (texture->bottomUp != flip)
+        for (size_t level = 0; level < chain->levels.size(); level++)
+        {
+            const MipChain::Level& size = chain->levels[level];
+            const size_t stride = static_cast<size_t>(size.width) * 4;
+            unsigned char* pixels = chain->pixels.data() + size.offset;
+            for (int y = 0; y < size.height / 2; y++)
+                std::swap_ranges(pixels + stride * y, pixels + stride * (y + 1), pixels + stride * (size.height - 1 - y));
+        }
+    stageMips(item, std::move(chain));
+    return true;
+}
+
+void TextureLoader::stageMips(Decoded& item, std::unique_ptr<MipChain> chain)
+{
+    item.width = chain->levels[0].width;
+    item.height = chain->levels[0].height;
+    item.channels = chain->channels;
+    // the whole chain goes through the ring like one image, only its level table is kept
+    unsigned char* target;
+    if (ring && ring->reserve(chain->pixels.size(), item.offset, target))
+    {
+        std::memcpy(target, chain->pixels.data(), chain->pixels.size());
+        std::vector<unsigned char>().swap(chain->pixels);
+        item.staged = true;
+    }
+    item.mips = std::move(chain);
+}
+
+void TextureLoader::stageCached(Decoded& item, std::unique_ptr<DecodeCache::Entry> entry)
+{
+    item.width = entry->width();
+    item.height = entry->height();
+    item.channels = entry->channels();
+    if (entry->levels().size() > 1)
+    {
+        // the level table only, the pixels stay in the entry or go to the ring
+        item.mips.reset(new MipChain());
+        item.mips->channels = entry->channels();
+        item.mips->levels = entry->levels();
+    }
+    unsigned char* target;
+    if (ring && ring->reserve(entry->bytes(), item.offset, target))
+    {
+        std::memcpy(target, entry->pixels(), entry->bytes());
+        item.staged = true;
+    }
+    else
+        item.cached = std::move(entry);
+}
+
+void TextureLoader::push(Decoded* item)
+{
+    item->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(item->next, item, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+int TextureLoader::poll(int maxUploads)
+{
+    if (ring)
+        ring->retire();
+    if (requested == finished)
+        return 0;
+    if (firstFrameSeconds < 0.0)
+        firstFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the list comes newest first, ready keeps the next one to upload at the back
+    Decoded* item = head.exchange(nullptr, std::memory_order_acquire);
+    if (item)
+    {
+        std::vector<Decoded*> batch;
+        for (; item; item = item->next)
+            batch.push_back(item);
+        ready.insert(ready.begin(), batch.begin(), batch.end());
+    }
+
+    int count = 0;
+    while (!ready.empty() && (maxUploads < 0 || count < maxUploads))
+    {
+        Decoded* next = ready.back();
+        ready.pop_back();
+        if (next->error.empty())
+        {
+            upload(*next);
+            stbi_image_free(next->pixels);
+            uploaded++;
+            count++;
+        }
+        else
+        {
+            // nothing reads the range, the fence only hands it back
+            if (next->staged)
+                ring->submitted(next->offset);
+            std::cout << "Error (TextureLoader): " << next->path << ": " << next->error << std::endl;
+        }
+        finished++;
+        delete next;
+    }
+
+    if (requested == finished)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Textures: first frame after " << firstFrameSeconds * 1000.0 << " ms, " << uploaded
+            << " resident after " << seconds * 1000.0 << " ms" << std::endl;
+        if (decodeCache)
+        {
+            const DecodeCache::Statistics statistics = decodeCache->statistics();
+            std::cout << "Decode cache: " << statistics.hits << " hits, " << statistics.misses << " misses, "
+                << statistics.entries << " entries, " << (statistics.bytes >> 20) << " MB" << std::endl;
+        }
+    }
+    return count;
+}
+
+void TextureLoader::wait()
+{
+    while (pending() > 0)
+    {
+        if (poll() == 0)
+            std::this_thread::yield();
+    }
+}
+
+void TextureLoader::destroy()
+{
+    stopWorkers();
+    if (ring)
+        ring->destroy();
+}
+
+void TextureLoader::stopWorkers()
+{
+    // workers waiting for ring space give up, decodes still running finish before the pool is gone
+    cancelled = true;
+    if (ring)
+        ring->shutdown();
+    pool.reset();
+}
+
+void TextureLoader::upload(const Decoded& item)
+{
+    GLint previous;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glBindTexture(GL_TEXTURE_2D, item.texture);
+    // stb rows are tightly packed, RGB rows are not always a multiple of 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLenum format = formatFor(item.channels);
+    if (item.compressed)
+    {
+        // the file's levels, which may stop before 1x1
+        const CompressedTexture& texture = *item.compressed;
+        if (item.staged)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer());
+        for (size_t level = 0; level < texture.levels.size(); level++)
+        {
+            const CompressedTexture::Level& size = texture.levels[level];
+            const void* data = item.staged ? reinterpret_cast<const void*>(item.offset + size.offset) : texture.level(level);
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), compressedFormatFor(texture), size.width, size.height, 0,
+                static_cast<GLsizei>(size.bytes), data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size()) - 1);
+        if (item.staged)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            ring->submitted(item.offset);
+        }
+    }
+    else if (item.mips)
+    {
+        // every level from the chain, from the ring when it went through there
+        if (item.staged)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer());
+        for (size_t level = 0; level < item.mips->levels.size(); level++)
+        {
+            const MipChain::Level& size = item.mips->levels[level];
+            const void* data = item.staged ? reinterpret_cast<const void*>(item.offset + size.offset) :
+                item.cached ? item.cached->level(level) : item.mips->level(level);
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, size.width, size.height, 0, format, GL_UNSIGNED_BYTE, data);
+        }
+        // complete with exactly these levels, whatever the texture name held before
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(item.mips->levels.size()) - 1);
+        if (item.staged)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            ring->submitted(item.offset);
+        }
+    }
+    else if (item.staged)
+    {
+        // storage first, then the pixels straight from the ring; the fence frees the range
+        glTexImage2D(GL_TEXTURE_2D, 0, format, item.width, item.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, item.width, item.height, format, GL_UNSIGNED_BYTE,
+            reinterpret_cast<const void*>(item.offset));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ring->submitted(item.offset);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, item.width, item.height, 0, format, GL_UNSIGNED_BYTE,
+            item.cached ? item.cached->pixels() : item.pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (!item.mips && !item.compressed)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, previous);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CompressedTexture.h"
+#include "DecodeCache.h"
+#include "MipChain.h"
+#include "PixelUploadRing.h"
+#include "ThreadPool.h"
+
+// Loads image files into GL textures without blocking the GL thread. load() returns a texture
+// name at once, showing a placeholder checkerboard; a worker decodes the file and poll(), once
+// per frame on the GL thread, uploads the result into that same name. Pixels go through a
+// persistently mapped PixelUploadRing when the driver has one. KTX2 and DDS blocks the GL
+// supports are uploaded as they are, mip levels come from glGenerateMipmap or a chain built on
+// the worker (setMipmaps), and a DecodeCache spares decoding files seen before.
+class TextureLoader
+{
+public:
+    enum class Mipmaps
+    {
+        Gpu,        // glGenerateMipmap after the upload
+        Cpu         // MipChainBuilder on the worker
+    };
+
+    // call once GL is loaded; threads == 0 uses std::thread::hardware_concurrency(), there is
+    // always at least one worker; uploadRingBytes == 0 disables the unpack buffer ring
+    explicit TextureLoader(unsigned threads = 0, size_t uploadRingBytes = 32 << 20);
+    // files still queued are skipped, decoded pixels that were never uploaded are freed
+    ~TextureLoader();
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // GL thread; flip matches stbi_set_flip_vertically_on_load(true) of the exercises.
+    // The new texture is left bound to GL_TEXTURE_2D, its parameters may be set straight away.
+    GLuint load(const std::string& path, bool flip = true);
+
+    // how later load() calls get their mip levels; filter and srgb only matter on the CPU
+    void setMipmaps(Mipmaps mode, MipChainBuilder::Filter filter = MipChainBuilder::Filter::Box, bool srgb = true);
+
+    // whether later load() calls of image files look for a compressed file next to them first
+    void setPrecompressed(bool enabled) { precompressed = enabled; }
+
+    // disk cache for later load() calls of image files, NULL for none; not owned, it must outlive
+    // the workers (destroy()). With Cpu mip chains it keeps the whole chain.
+    void setDecodeCache(DecodeCache* cache) { decodeCache = cache; }
+
+    // GL thread: uploads at most maxUploads finished images (all when negative), returns how many.
+    // Files that failed to decode are reported here and keep the placeholder.
+    // Called once per frame, so the first call is taken as the first frame: when the last
+    // pending texture becomes resident, both times (since the first load()) are printed.
+    int poll(int maxUploads = -1);
+    // GL thread: polls until nothing is pending, e.g. so headless frames never show placeholders
+    void wait();
+    // GL thread: stops the workers and deletes the upload ring, call while the context is
+    // still alive; the loader must not be used afterwards
+    void destroy();
+
+    bool streaming() const { return ring && ring->available(); }
+
+    // loads requested and not yet uploaded or failed
+    int pending() const { return requested - finished; }
+    int resident() const { return uploaded; }
+    int failed() const { return finished - uploaded; }
+
+private:
+    // one decoded file on its way to the GL thread, its pixels either in stb's buffer, in a mip
+    // chain, in compressed blocks, in a mapped cache entry or in the ring at offset (staged, the
+    // levels of a chain or of compressed blocks at their offsets from there); an error means it
+    // failed, a staged range is still handed back
+    struct Decoded
+    {
+        Decoded* next;
+        GLuint texture;
+        std::string path;
+        std::string error;
+        int width, height, channels;
+        unsigned char* pixels;
+        bool staged;
+        size_t offset;
+        std::unique_ptr<MipChain> mips;
+        std::unique_ptr<CompressedTexture> compressed;
+        std::unique_ptr<DecodeCache::Entry> cached;     // also holds the pixels of mips when set
+    };
+
+    // workers push with a CAS, the GL thread takes the whole list at once
+    void decode(Decoded& item, bool flip, Mipmaps mode, MipChainBuilder::Filter filter, bool srgb, bool compressedFirst,
+        DecodeCache* cache);
+    // false when there is no file at path
+    bool decodeCompressed(Decoded& item, const std::string& path, bool flip);
+    void stageMips(Decoded& item, std::unique_ptr<MipChain> chain);
+    void stageCached(Decoded& item, std::unique_ptr<DecodeCache::Entry> entry);
+    void push(Decoded* item);
+    void upload(const Decoded& item);
+    void stopWorkers();
+
+    std::atomic<Decoded*> head;
+    std::vector<Decoded*> ready;        // taken from head, oldest last
+    std::atomic<bool> cancelled;
+    int requested, finished, uploaded;
+    std::chrono::steady_clock::time_point start;
+    double firstFrameSeconds;       // negative until the first poll()
+    std::unique_ptr<PixelUploadRing> ring;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<MipChainBuilder> mipBuilder;
+    Mipmaps mipmaps;
+    MipChainBuilder::Filter mipFilter;
+    bool mipSrgb;
+    bool precompressed;
+    DecodeCache* decodeCache;
+    bool s3tcSupported;             // GL_EXT_texture_compression_s3tc: BC1 and BC3
+    bool bptcSupported;             // GL 4.2 or GL_ARB_texture_compression_bptc: BC7
+};
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    thread_local unsigned threadIndex = 0;
+
+    struct ParallelForState
+    {
+        std::atomic<int> next{ 0 };
+        std::atomic<int> finished{ 0 };
+        int count = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    void runItems(ParallelForState& state, const std::function<void(int, unsigned)>& body)
+    {
+        const unsigned self = ThreadPool::currentThreadIndex();
+        int index;
+        while ((index = state.next.fetch_add(1)) < state.count)
+        {
+            body(index, self);
+            if (state.finished.fetch_add(1) + 1 == state.count)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.done.notify_all();
+            }
+        }
+    }
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+    : stopping(false)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    for (unsigned i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsCondition.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+unsigned ThreadPool::currentThreadIndex()
+{
+    return threadIndex;
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobsCondition.notify_one();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int index, unsigned threadIndex)>& body)
+{
+    if (count <= 0)
+        return;
+
+    if (workers.empty() || count == 1)
+    {
+        const unsigned self = currentThreadIndex();
+        for (int i = 0; i < count; i++)
+            body(i, self);
+        return;
+    }
+
+    // helpers that start after all items are taken return without touching body,
+    // so the caller only has to wait for the items themselves
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->count = count;
+    const std::function<void(int, unsigned)>* bodyPtr = &body;
+
+    const size_t helpers = std::min(workers.size(), static_cast<size_t>(count - 1));
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        for (size_t i = 0; i < helpers; i++)
+            jobs.push_back([state, bodyPtr]() { runItems(*state, *bodyPtr); });
+    }
+    jobsCondition.notify_all();
+
+    runItems(*state, body);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->finished.load() == state->count; });
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    threadIndex = index;
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
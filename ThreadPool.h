@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Simple persistent worker pool shared by the CPU-side helpers.
+// The calling thread takes part in parallelFor, so a pool of size 1 has no workers
+// and runs everything inline.
+class ThreadPool
+{
+public:
+    // threads == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads taking part in parallelFor (workers + caller)
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // runs body(index, threadIndex) for every index in [0, count); threadIndex < size()
+    void parallelFor(int count, const std::function<void(int index, unsigned threadIndex)>& body);
+
+    // queues a job on a worker (runs inline when the pool has no workers)
+    void enqueue(std::function<void()> job);
+
+    // index of the calling thread inside its pool, 0 for threads not owned by a pool
+    static unsigned currentThreadIndex();
+
+private:
+    void workerLoop(unsigned index);
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsCondition;
+    bool stopping;
+};
@@ -0,0 +1,152 @@
+// Model matrices per second for translate -> rotate -> scale chains: the per-object glm
+// chain of the exercises against BatchTransform with every kernel on one thread and
+// with the best kernel on all threads. Results are compared with the glm chain.
+// usage: TransformBenchmark [repeats]
+
+#include "BatchTransform.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Objects
+{
+    std::vector<float> translation[3];
+    std::vector<float> rotation[4];
+    std::vector<float> scale[3];
+    std::vector<float> angle;
+    std::vector<glm::vec3> axis;
+
+    TransformBatch batch() const
+    {
+        TransformBatch result;
+        for (int k = 0; k < 3; k++)
+        {
+            result.translation[k] = translation[k].data();
+            result.scale[k] = scale[k].data();
+        }
+        for (int k = 0; k < 4; k++)
+            result.rotation[k] = rotation[k].data();
+        return result;
+    }
+};
+
+Objects makeObjects(int count)
+{
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    Objects objects;
+    for (int i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            objects.translation[k].push_back(unit(random) * 10.0f);
+            objects.scale[k].push_back(1.0f + unit(random) * 0.5f);
+        }
+        const float angle = unit(random) * 3.14159f;
+        const glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 2.0f));
+        const glm::quat q = glm::angleAxis(angle, axis);
+        objects.rotation[0].push_back(q.x);
+        objects.rotation[1].push_back(q.y);
+        objects.rotation[2].push_back(q.z);
+        objects.rotation[3].push_back(q.w);
+        objects.angle.push_back(angle);
+        objects.axis.push_back(axis);
+    }
+    return objects;
+}
+
+// the chain as written in Zadanie6, one object at a time
+void glmChain(const Objects& objects, int count, glm::mat4* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(objects.translation[0][i], objects.translation[1][i], objects.translation[2][i]));
+        model = glm::rotate(model, objects.angle[i], objects.axis[i]);
+        model = glm::scale(model, glm::vec3(objects.scale[0][i], objects.scale[1][i], objects.scale[2][i]));
+        out[i] = model;
+    }
+}
+
+float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    float worst = 0.0f;
+    for (size_t i = 0; i < a.size(); i++)
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                worst = std::max(worst, std::abs(a[i][c][r] - b[i][c][r]));
+    return worst;
+}
+
+template <typename Body>
+double secondsPerRun(int repeats, Body body)
+{
+    body();     // warm up caches and the thread pool
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char** argv)
+{
+    const int repeats = argc > 1 ? std::atoi(argv[1]) : 10;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    const BatchTransform::Kernel kernels[] = {
+        BatchTransform::Kernel::Scalar,
+        BatchTransform::Kernel::SSE2,
+        BatchTransform::Kernel::AVX
+    };
+
+    std::printf("%10s %18s %10s %14s %10s %12s %10s\n", "objects", "method", "threads", "Mmatrices/s", "speedup", "max error", "identical");
+    for (int count : { 1000, 10000, 100000, 1000000 })
+    {
+        const Objects objects = makeObjects(count);
+        const TransformBatch batch = objects.batch();
+        const int runs = std::max(1, repeats * 100000 / count);
+
+        std::vector<glm::mat4> reference(count), scalar(count), result(count);
+        const double chainSeconds = secondsPerRun(runs, [&]() { glmChain(objects, count, reference.data()); });
+        std::printf("%10d %18s %10u %14.2f %10s\n", count, "glm chain", 1u, count / chainSeconds / 1e6, "1.00x");
+
+        BatchTransform transform(1);
+        for (BatchTransform::Kernel kernel : kernels)
+        {
+            if (!BatchTransform::kernelSupported(kernel))
+            {
+                std::printf("%10d %18s %10s\n", count, BatchTransform::kernelName(kernel), "unsupported");
+                continue;
+            }
+            transform.setKernel(kernel);
+            const double seconds = secondsPerRun(runs, [&]() { transform.compose(batch, count, result.data()); });
+            if (kernel == BatchTransform::Kernel::Scalar)
+                scalar = result;
+            const bool identical = std::memcmp(scalar.data(), result.data(), result.size() * sizeof(glm::mat4)) == 0;
+            std::printf("%10d %18s %10u %14.2f %9.2fx %12.2e %10s\n", count, BatchTransform::kernelName(kernel), 1u,
+                count / seconds / 1e6, chainSeconds / seconds, maxDifference(reference, result), identical ? "yes" : "NO");
+        }
+
+        if (cores > 1)
+        {
+            transform.setThreadCount(cores);
+            transform.setKernel(BatchTransform::Kernel::AVX);
+            const double seconds = secondsPerRun(runs, [&]() { transform.compose(batch, count, result.data()); });
+            const bool identical = std::memcmp(scalar.data(), result.data(), result.size() * sizeof(glm::mat4)) == 0;
+            std::printf("%10d %18s %10u %14.2f %9.2fx %12.2e %10s\n", count, BatchTransform::kernelName(transform.kernel()), cores,
+                count / seconds / 1e6, chainSeconds / seconds, maxDifference(reference, result), identical ? "yes" : "NO");
+        }
+    }
+    return 0;
+}
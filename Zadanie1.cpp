@@ -1,5 +1,7 @@
 #include <glad/glad.h>  // musi by doczony jako pierwszy
 #include <GLFW/glfw3.h>
+#include "Headless.h"
+#include "ShaderProgram.h"
 
 #include <iostream>
 
@@ -44,13 +46,15 @@ const GLchar* fragmentShaderSource1 =
 
 
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -74,85 +78,8 @@ int main()
     }
 
     //GLSL - Open GL Shading Language - Shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint vertexShader1 = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader1, 1, &vertexShaderSource1, NULL);
-    glCompileShader(vertexShader1);
-
-    glGetShaderiv(vertexShader1, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(vertexShader1, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader1 = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader1, 1, &fragmentShaderSource1, NULL);
-    glCompileShader(fragmentShader1);
-
-    glGetShaderiv(fragmentShader1, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(fragmentShader1, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    GLuint shaderProgram1 = glCreateProgram();
-    glAttachShader(shaderProgram1, vertexShader1);
-    glAttachShader(shaderProgram1, fragmentShader1);
-    glLinkProgram(shaderProgram1);
-
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    glGetProgramiv(shaderProgram1, GL_LINK_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(shaderProgram1, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDetachShader(shaderProgram1, vertexShader1);
-    glDetachShader(shaderProgram1, fragmentShader1);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(vertexShader1);
-    glDeleteShader(fragmentShader1);
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    GLuint shaderProgram1 = createShaderProgram(vertexShaderSource1, fragmentShaderSource1);
 
     //Green rect
     GLfloat vertices[] = {
@@ -235,10 +162,13 @@ int main()
 
 
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
+
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     // ptla zdarze
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
         // renderowanie
         glClearColor(0.298f, 0.141f, 0.141f, 1.0f);
@@ -253,7 +183,7 @@ int main()
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
         //
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
@@ -268,6 +198,7 @@ int main()
     glDeleteProgram(shaderProgram1);
 
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <glad/glad.h>  // musi by doczony jako pierwszy
 #include <GLFW/glfw3.h>
+#include "Headless.h"
+#include "ShaderProgram.h"
 
 #include <iostream>
 
@@ -29,13 +31,15 @@ const GLchar* fragmentShaderSource =
 
 
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -59,51 +63,7 @@ int main()
     }
 
     //GLSL - Open GL Shading Language - Shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
     //Green rect
     GLfloat vertices[] = {
@@ -153,10 +113,13 @@ int main()
 
 
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
+
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     // ptla zdarze
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
         // renderowanie
         glClearColor(0.298f, 0.141f, 0.141f, 1.0f);
@@ -167,7 +130,7 @@ int main()
         glDrawElements(GL_LINES, 8, GL_UNSIGNED_INT, 0);
 
         //
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
@@ -177,6 +140,7 @@ int main()
     glDeleteProgram(shaderProgram);
 
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
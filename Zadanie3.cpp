@@ -1,8 +1,9 @@
 ﻿#include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "CircleTessellation.h"
+#include "Headless.h"
+#include "ShaderProgram.h"
 #include <iostream>
-#define _USE_MATH_DEFINES
-#include <math.h>
 
 
 const GLchar* vertexShaderSource =
@@ -22,13 +23,15 @@ const GLchar* fragmentShaderSource =
 "}\0";
 
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -53,115 +56,41 @@ int main()
 
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
     GLfloat radius = 0.4f;
     const GLint trianglesNumber = 8;
-    const GLint sidesNumber = trianglesNumber + 2;
-    GLfloat twoPI = 2.0f * M_PI;
-
-    GLfloat vertices[sidesNumber * 3];
-    vertices[0] = 0;
-    vertices[1] = 0;
-    vertices[2] = 0;
-
-    for (int i = 1; i < sidesNumber; i++) {
-        vertices[i * 3] = radius * cos(i * twoPI / trianglesNumber);
-        vertices[(i * 3) + 1] = radius * sin(i * twoPI / trianglesNumber);
-        vertices[(i * 3) + 2] = 0.0f;
-    }
-
-    GLuint indices[trianglesNumber * 3];
-    for (int i = 0; i < trianglesNumber; i++) {
-        indices[i * 3] = 0;
-        indices[(i * 3) + 1] = i + 1;
-        indices[(i * 3) + 2] = i + 2;
-    }
-
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
 
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // center + trianglesNumber ring vertices + the first one again, indices (0, i, i + 1)
+    CircleTessellation circle(trianglesNumber, radius);
+    circle.setSegments(trianglesNumber);
 
-    GLuint EBO;
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-
-    glBindVertexArray(0);
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
 
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     // p�tla zdarze�
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
         // renderowanie
         glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, sidesNumber * 3, GL_UNSIGNED_INT, 0);
+        circle.draw();
         glBindVertexArray(0);
 
         //
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    circle.destroy();
     glDeleteProgram(shaderProgram);
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
@@ -1,10 +1,11 @@
 ﻿#include<iostream>
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
-#include<cmath>
+#include "CircleTessellation.h"
+#include "Headless.h"
+#include "ShaderProgram.h"
 
 
-#define PI 3.14159265f
 
 // Vertex Shader source code
 const char* vertexShaderSource = "#version 330 core\n"
@@ -25,46 +26,11 @@ const char* fragmentShaderSource = "#version 330 core\n"
 
 GLint numberOfTriangles;
 GLuint shaderProgram;
-GLfloat* vertices;
-GLuint* indices;
 
-GLuint VAO, VBO, EBO;
+// every fan from 1 to 180 triangles lives in one vertex buffer, scrolling only picks one
+CircleTessellation* circle;
 
 
-
-static GLfloat* createVertices(GLint numberOfTriangles, GLfloat radius) {
-	GLfloat twoPi = 2.0f * PI;
-	GLfloat* vertices = new GLfloat[(numberOfTriangles+2) * 3];
-
-	vertices[0] = 0.0f;
-	vertices[1] = 0.0f;
-	vertices[2] = 0.0f;
-
-	for (int i = 1; i < numberOfTriangles + 1; i++) {
-		vertices[i * 3] = radius * cos(i * twoPi / numberOfTriangles);
-		vertices[(i * 3) + 1] = radius * sin(i * twoPi / numberOfTriangles);
-		vertices[(i * 3) + 2] = 0.0f;
-	}
-
-	return vertices;
-}
-
-
-GLuint* createIndices(GLint numberOfTriangles) {
-
-	GLuint* indices = new GLuint[numberOfTriangles * 3];
-
-	for (int i = 0; i < numberOfTriangles; i++) {
-		indices[i * 3] = 0;
-		indices[(i * 3) + 1] = i + 1;
-		indices[(i * 3) + 2] = i + 2;
-	}
-
-	indices[(numberOfTriangles - 1) * 3 + 2] = 1;
-
-	return indices;
-}
-
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
 
 	if (yoffset > 0 && numberOfTriangles < 180) {
@@ -76,14 +42,7 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
 
 	printf("Ilosc trojkatow: %d\n", numberOfTriangles);
 
-	vertices = createVertices(numberOfTriangles, 0.75f);
-	indices = createIndices(numberOfTriangles);
-
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * (numberOfTriangles + 1), vertices, GL_DYNAMIC_DRAW);
-
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 3 * numberOfTriangles, indices, GL_DYNAMIC_DRAW);
-
-	glDrawElements(GL_TRIANGLES, numberOfTriangles * 3 + 2, GL_UNSIGNED_INT, 0);
+	circle->setSegments(numberOfTriangles);
 
 }
 
@@ -102,8 +61,9 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
 	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	Headless headless(argc, argv);
 	// Initialize GLFW
 	glfwInit();
 
@@ -112,6 +72,7 @@ int main()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	// GLFW CORE profile
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	headless.windowHints();
 
 	// Create a GLFWwindow object of 800 by 800 pixels
 	GLFWwindow* window = glfwCreateWindow(800, 800, "dynamic kolo", NULL, NULL);
@@ -127,6 +88,9 @@ int main()
 
 	//Load GLAD so it configures OpenGL
 	gladLoadGL();
+	if (!headless.begin(800, 800))
+		return -1;
+
 	// Specify the viewport of OpenGL in the Window
 	// x = 0, y = 0, to x = 800, y = 800
 	glViewport(0, 0, 800, 800);
@@ -139,75 +103,19 @@ int main()
 
 
 
-	// Create Vertex Shader Object and get its reference
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	// Attach Vertex Shader source to the Vertex Shader Object
-	glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-	// Compile the Vertex Shader into machine code
-	glCompileShader(vertexShader);
-
-	// Create Fragment Shader Object and get its reference
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	// Attach Fragment Shader source to the Fragment Shader Object
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-	// Compile the Vertex Shader into machine code
-	glCompileShader(fragmentShader);
-
-	// Create Shader Program Object and get its reference
-	//GLuint shaderProgram = glCreateProgram();
-	shaderProgram = glCreateProgram();
-	// Attach the Vertex and Fragment Shaders to the Shader Program
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	// Wrap-up/Link all the shaders together into the Shader Program
-	glLinkProgram(shaderProgram);
-
-	// Delete the now useless Vertex and Fragment Shader objects
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	// Create the Shader Program Object from the Vertex and Fragment Shader sources
+	shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
 
 	GLfloat radius = 0.75f;
 	numberOfTriangles = 12;
 
-	vertices = createVertices(numberOfTriangles, radius);
-
-	indices = createIndices(numberOfTriangles);
-
-	// Generate the VAO, VBO, and EBO with only 1 object each
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	// Make the VAO the current Vertex Array Object by binding it
-	glBindVertexArray(VAO);
-
-	// Bind the VBO specifying it's a GL_ARRAY_BUFFER
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	// Introduce the vertices into the VBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * (numberOfTriangles + 1), vertices, GL_DYNAMIC_DRAW);
-
-	// Bind the EBO specifying it's a GL_ELEMENT_ARRAY_BUFFER
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	// Introduce the indices into the EBO
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 3 * numberOfTriangles, indices, GL_DYNAMIC_DRAW);
-
-	// Configure the Vertex Attribute so that OpenGL knows how to read the VBO
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-	// Enable the Vertex Attribute so that OpenGL knows to use it
-	glEnableVertexAttribArray(0);
-
-	// Bind both the VBO and VAO to 0 so that we don't accidentally modify the VAO and VBO we created
-	//glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	// Bind the EBO to 0
-	// MAKE SURE TO UNBIND IT AFTER UNBINDING THE VAO, as the EBO is linked in the VAO
-	// This does not apply to the VBO because the VBO is already linked to the VAO during glVertexAttribPointer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	// The VAO, VBO and EBO are created once, sized for the largest circle
+	circle = new CircleTessellation(180, radius);
+	circle->setSegments(numberOfTriangles);
 
 	// Main while loop
-	while (!glfwWindowShouldClose(window))
+	while (headless.running(window))
 	{
 		// Specify the color of the background
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -215,26 +123,20 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT);
 		// Tell OpenGL which Shader Program we want to use
 		glUseProgram(shaderProgram);
-		// Bind the VAO so OpenGL knows to use it
-		glBindVertexArray(VAO);
-		// Draw the triangle using the GL_TRIANGLES primitive
-		glDrawElements(GL_TRIANGLES, numberOfTriangles * 3 + 2, GL_UNSIGNED_INT, 0);
+		// Bind the VAO and draw the current fan using the GL_TRIANGLES primitive
+		circle->draw();
 		// Swap the back buffer with the front buffer
-		glfwSwapBuffers(window);
+		headless.present(window);
 		// Take care of all GLFW events
 		glfwPollEvents();
 
 	}
 
-	delete[] indices;
-
-	delete[] vertices;
-
 	// Delete all the objects we've created
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	circle->destroy();
+	delete circle;
 	glDeleteProgram(shaderProgram);
+	headless.finish();
 	// Delete window before ending the program
 	glfwDestroyWindow(window);
 	// Terminate GLFW before ending the program
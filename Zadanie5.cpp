@@ -1,10 +1,14 @@
 ﻿#include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "Headless.h"
+#include "MeshArena.h"
+#include "ShaderProgram.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image/stb_image.h>
-
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 using namespace std;
 
 
@@ -43,13 +47,15 @@ GLint glDXLocation;
 float fade = 0.05f;
 int option = 3;
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -74,80 +80,27 @@ int main()
 
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
     glDXLocation = glGetUniformLocation(shaderProgram, "textureMix");
 
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // texture
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    GLubyte* tex1 = stbi_load("texture1.jpg", &width, &height, &nrChannels, 0);
-
-    GLuint texture1;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex1);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(tex1);
+    // texture: decoded on worker threads, a placeholder is drawn until textures.poll() uploads it
+    // decoded mip chains kept in decode_cache/, later runs map them instead of decoding
+    DecodeCache decodeCache;
+    TextureLoader textures;
+    // mip levels filtered on the worker, not glGenerateMipmap
+    textures.setMipmaps(TextureLoader::Mipmaps::Cpu);
+    textures.setDecodeCache(&decodeCache);
+    // texture1.ktx2 / texture2.ktx2 from TextureCompressor are taken over the JPEGs when they are there
+    textures.setPrecompressed(true);
+    GLuint texture1 = textures.load("texture1.jpg");
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    int width2, height2, nrChannels2;
-    stbi_set_flip_vertically_on_load(true);
-    GLubyte* tex2 = stbi_load("texture2.jpg", &width2, &height2, &nrChannels2, 0);
-
-    GLuint texture2;
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width2, height2, 0, GL_RGB, GL_UNSIGNED_BYTE, tex2);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(tex2);
+    GLuint texture2 = textures.load("texture2.jpg");
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -179,95 +132,97 @@ int main()
         0, 1, 2
     };
 
-    //VAO EBO VBO for Rectangle
-    GLuint VAO1;
-    glGenVertexArrays(1, &VAO1);
-    glBindVertexArray(VAO1);
-
-    GLuint EBO1;
-    GLuint VBO1;
-    glGenBuffers(1, &VBO1);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO1);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesRec), verticesRec, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &EBO1);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO1);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indicesRec), indicesRec, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
-
-    //VAO EBO VBO for Triangle
-    GLuint VAO2;
-    glGenVertexArrays(1, &VAO2);
-    glBindVertexArray(VAO2);
-
-    GLuint EBO2;
-    GLuint VBO2;
-    glGenBuffers(1, &VBO2);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO2);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verticesTria), verticesTria, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &EBO2);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO2);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indicesTria), indicesTria, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
+    // --atlas 1: both images on one atlas page, texture coordinates moved into their regions,
+    // so the rectangle and the triangle are drawn without switching textures; without both on one
+    // page the textures above are drawn as usual
+    std::unique_ptr<TextureAtlas> atlas;
+    if (std::atoi(headless.option("--atlas", "0").c_str()) != 0)
+    {
+        atlas.reset(new TextureAtlas(64 << 20, 2048));
+        if (atlas->build({ "texture1.jpg", "texture2.jpg" }) == 2 && atlas->region(0).page == atlas->region(1).page)
+        {
+            atlas->remapUVs(0, verticesRec, 4, 8, 6);
+            atlas->remapUVs(1, verticesTria, 3, 8, 6);
+        }
+        else
+        {
+            std::cout << "Error (Zadanie5): texture1.jpg and texture2.jpg are not on one atlas page, drawing without the atlas" << std::endl;
+            atlas->destroy();
+            atlas.reset();
+        }
+    }
+    const bool useAtlas = atlas != nullptr;
+
+    // both shapes in one vertex buffer and one index buffer behind one VAO, drawn with a base vertex
+    MeshArena meshes(8 * sizeof(GLfloat), {
+        { 0, 3, GL_FLOAT, GL_FALSE, 0 },
+        { 1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat) },
+        { 2, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat) } }, 1024, 1024);
+    MeshArena::Mesh rectangle, triangle;
+    meshes.add(verticesRec, 4, indicesRec, 6, rectangle);
+    meshes.add(verticesTria, 3, indicesTria, 3, triangle);
+
+    if (!headless.begin(window_width, window_height))
+        return -1;
 
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     glfwSetKeyCallback(window, keyboardCallback);
     glfwSetScrollCallback(window, scrollCallback);
 
+    // headless frames are compared between runs, they must not depend on decode timing
+    if (headless.enabled())
+    {
+        textures.wait();
+        if (useAtlas)
+        {
+            atlas->use(0);
+            atlas->wait();
+        }
+    }
+
     // petla
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
+        textures.poll();
+        meshes.retire();
+        if (useAtlas)
+            atlas->poll();
+
         // renderowanie
         glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         if (option == 0) {
-            glBindTexture(GL_TEXTURE_2D, texture1);
+            glBindTexture(GL_TEXTURE_2D, useAtlas ? atlas->use(0) : texture1);
             glUseProgram(shaderProgram);
-            glBindVertexArray(VAO1);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            meshes.bind();
+            meshes.draw(rectangle);
             glBindVertexArray(0);
         }
         else if (option == 1) {
-            glBindTexture(GL_TEXTURE_2D, texture2);
+            glBindTexture(GL_TEXTURE_2D, useAtlas ? atlas->use(1) : texture2);
             glUseProgram(shaderProgram);
-            glBindVertexArray(VAO2);
-            glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            meshes.bind();
+            meshes.draw(triangle);
             glBindVertexArray(0);
         }
-        else if (option == 2) {
-            glBindTexture(GL_TEXTURE_2D, texture1);
+        else if (option == 2 && useAtlas) {
+            // one texture and one VAO: both shapes in a single draw call
+            const MeshArena::Mesh* both[] = { &rectangle, &triangle };
+            glBindTexture(GL_TEXTURE_2D, atlas->use(0));
             glUseProgram(shaderProgram);
-            glBindVertexArray(VAO1);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            meshes.bind();
+            meshes.draw(both, 2);
             glBindVertexArray(0);
-
-            glBindTexture(GL_TEXTURE_2D, texture2);
+        }
+        else if (option == 2) {
             glUseProgram(shaderProgram);
-            glBindVertexArray(VAO2);
-            glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            meshes.bind();
+            glBindTexture(GL_TEXTURE_2D, texture1);
+            meshes.draw(rectangle);
+            glBindTexture(GL_TEXTURE_2D, texture2);
+            meshes.draw(triangle);
             glBindVertexArray(0);
         }
         else if (option == 3) {
@@ -275,18 +230,19 @@ int main()
         }
 
         //
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &VAO1);
-    glDeleteBuffers(1, &VBO1);
-    glDeleteBuffers(1, &EBO1);
-    glDeleteVertexArrays(1, &VAO2);
-    glDeleteBuffers(1, &VBO2);
-    glDeleteBuffers(1, &EBO2);
+    meshes.destroy();
+    glDeleteTextures(1, &texture1);
+    glDeleteTextures(1, &texture2);
+    textures.destroy();
+    if (useAtlas)
+        atlas->destroy();
     glDeleteProgram(shaderProgram);
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
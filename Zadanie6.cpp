@@ -1,6 +1,15 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "BatchTransform.h"
+#include "Headless.h"
+#include "ShaderProgram.h"
 #include<cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -20,6 +29,19 @@ const GLchar* vertexShaderSource =
 "    vertexColor = color;\n"
 "}\0";
 
+// --instances: model matrix and color come from the instance VBO (glVertexAttribDivisor)
+const GLchar* instancedVertexShaderSource =
+"#version 330 core\n"
+"layout(location = 0) in vec3 position;\n"
+"layout(location = 1) in mat4 instanceModel;\n"
+"layout(location = 5) in vec3 instanceColor;\n"
+"out vec3 vertexColor;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = instanceModel * vec4(position.x, position.y, position.z, 1.0);\n"
+"    vertexColor = instanceColor;\n"
+"}\0";
+
 const GLchar* fragmentShaderSource =
 "#version 330 core\n"
 "in vec3 vertexColor;\n"
@@ -32,14 +54,85 @@ const GLchar* fragmentShaderSource =
 #define PI 3.141592
 float degrees = 0;
 
+struct Instance
+{
+    glm::mat4 model;
+    glm::vec3 color;
+};
+
+// grid of small spinning triangles covering the window, filled behind the four shapes;
+// positions, sizes and colors are fixed, only the rotation about z changes every frame
+struct InstanceGrid
+{
+    std::vector<float> x, y, zero, one, size;
+    std::vector<float> rotationZ, rotationW;   // quaternion of the rotation about z
+    TransformBatch batch;
+};
+
+void setupGrid(InstanceGrid& grid, Instance* instances, int count)
+{
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    const float cell = 2.0f / side;
+    grid.x.resize(count);
+    grid.y.resize(count);
+    grid.zero.assign(count, 0.0f);
+    grid.one.assign(count, 1.0f);
+    grid.size.assign(count, cell / 0.45f);
+    grid.rotationZ.resize(count);
+    grid.rotationW.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        const float u = (i % side + 0.5f) / side;
+        const float v = (i / side + 0.5f) / side;
+        grid.x[i] = u * 2.0f - 1.0f;
+        grid.y[i] = v * 2.0f - 1.0f;
+        instances[i].color = glm::vec3(0.2f + 0.4f * u, 0.2f + 0.4f * v, 0.5f);
+    }
+
+    const TransformBatch batch = {
+        { grid.x.data(), grid.y.data(), grid.zero.data() },
+        { grid.zero.data(), grid.zero.data(), grid.rotationZ.data(), grid.rotationW.data() },
+        { grid.size.data(), grid.size.data(), grid.one.data() }
+    };
+    grid.batch = batch;
+}
+
+void animateGrid(InstanceGrid& grid, BatchTransform& transform, Instance* instances, int count, float time)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const float angle = time * (1.0f + (i % 7) * 0.3f) + i;
+        grid.rotationZ[i] = std::sin(angle * 0.5f);
+        grid.rotationW[i] = std::cos(angle * 0.5f);
+    }
+    // the matrices go straight into the interleaved instance array
+    transform.compose(grid.batch, count, &instances[0].model, sizeof(Instance));
+}
+
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
+    // Zadanie6 --instances N draws N instances (the four shapes + a grid) in one call; the
+    // instance buffer is at most maxInstances * sizeof(Instance), larger counts are capped
+    const int maxInstances = 1 << 20;
+    const std::string instancesOption = headless.option("--instances", "0");
+    char* instancesEnd = NULL;
+    const long requestedInstances = std::strtol(instancesOption.c_str(), &instancesEnd, 10);
+    if (*instancesEnd != '\0' || instancesEnd == instancesOption.c_str() || requestedInstances < 0)
+    {
+        std::cout << "Error (command line): --instances takes a count of 0 or more, got \"" << instancesOption << "\"" << std::endl;
+        return -1;
+    }
+    const int instanceCount = static_cast<int>(std::min<long>(requestedInstances, maxInstances));
+    if (requestedInstances > maxInstances)
+        std::cout << "--instances " << requestedInstances << " capped to " << maxInstances << std::endl;
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -64,46 +157,7 @@ int main()
 
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
 
 
     // vertex data
@@ -132,18 +186,60 @@ int main()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
     glEnableVertexAttribArray(0);
 
     glBindVertexArray(0);
 
+    // instanced mode: same vertices and indices, plus one Instance per triangle
+    std::vector<Instance> instances(instanceCount);
+    const int shapes = std::min(instanceCount, 4);
+    const int gridCount = instanceCount - shapes;
+    InstanceGrid grid;
+    setupGrid(grid, instances.data(), gridCount);
+    std::unique_ptr<BatchTransform> transform;
+    std::unique_ptr<ShaderProgram> instancedProgram;
+    GLuint instancedVAO = 0, instanceVBO = 0;
+    if (instanceCount > 0)
+    {
+        instancedProgram.reset(new ShaderProgram(instancedVertexShaderSource, fragmentShaderSource));
+        transform.reset(new BatchTransform());
+
+        glGenVertexArrays(1, &instancedVAO);
+        glBindVertexArray(instancedVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), NULL, GL_STREAM_DRAW);
+        // a mat4 attribute takes four locations, one column each
+        for (int column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(1 + column);
+            glVertexAttribDivisor(1 + column, 1);
+        }
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color));
+        glEnableVertexAttribArray(5);
+        glVertexAttribDivisor(5, 1);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
 
 
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
+
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     // ptla zdarze
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
         // renderowanie
         glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
@@ -152,7 +248,7 @@ int main()
 
         // transformations
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3((cos(glfwGetTime()) / 4)-0.3f,0.3f , 0.0f));
+        model = glm::translate(model, glm::vec3((cos(headless.time()) / 4)-0.3f,0.3f , 0.0f));
         glm::mat4 model1 = glm::mat4(1.0f);
         if (degrees < 360) {
             degrees += 0.01;
@@ -166,13 +262,41 @@ int main()
         
         glm::mat4 model2 = glm::mat4(1.0f);
         model2 = glm::translate(model2, glm::vec3(-0.4f, -0.4f, 0.0f));
-        model2 = glm::scale(model2, glm::vec3(cos(glfwGetTime()) + 1.2f, cos(glfwGetTime()) + 1.2f, 1.0f));
+        model2 = glm::scale(model2, glm::vec3(cos(headless.time()) + 1.2f, cos(headless.time()) + 1.2f, 1.0f));
 
         glm::mat4 model3 = glm::mat4(1.0f);
-        model3 = glm::translate(model3, glm::vec3((sin(glfwGetTime()) / 4) + 0.3f, -0.4f, 0.0f));
-        model3 = glm::scale(model3, glm::vec3(sin(glfwGetTime()) + 1.2f, sin(glfwGetTime()) + 1.2f, 1.0f));
+        model3 = glm::translate(model3, glm::vec3((sin(headless.time()) / 4) + 0.3f, -0.4f, 0.0f));
+        model3 = glm::scale(model3, glm::vec3(sin(headless.time()) + 1.2f, sin(headless.time()) + 1.2f, 1.0f));
         model3 = glm::rotate(model3, glm::radians(-degrees), glm::vec3(0.0f, 0.0f, 1.0f));
 
+        if (instanceCount > 0)
+        {
+            // the four shapes are the last instances so they are drawn on top of the grid
+            const glm::mat4 shapeModels[] = { model, model1, model2, model3 };
+            const glm::vec3 shapeColors[] = { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f) };
+            animateGrid(grid, *transform, instances.data(), gridCount, static_cast<float>(headless.time()));
+            for (int i = 0; i < shapes; i++)
+            {
+                instances[gridCount + i].model = shapeModels[i];
+                instances[gridCount + i].color = shapeColors[i];
+            }
+
+            // orphan the old storage so the driver does not wait for the previous frame
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance), instances.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            instancedProgram->use();
+            glBindVertexArray(instancedVAO);
+            glDrawElementsInstanced(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0, instanceCount);
+            glBindVertexArray(0);
+
+            headless.present(window);
+            glfwPollEvents();
+            continue;
+        }
+
         GLint colorLoc = glGetUniformLocation(shaderProgram, "color");
         GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
@@ -183,7 +307,7 @@ int main()
 
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model1));
@@ -191,7 +315,7 @@ int main()
 
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model2));
@@ -199,7 +323,7 @@ int main()
 
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model3));
@@ -207,13 +331,13 @@ int main()
 
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
 
 
         //
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
@@ -221,7 +345,14 @@ int main()
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteProgram(shaderProgram);
+    if (instancedProgram)
+    {
+        glDeleteVertexArrays(1, &instancedVAO);
+        glDeleteBuffers(1, &instanceVBO);
+        glDeleteProgram(instancedProgram->id());
+    }
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
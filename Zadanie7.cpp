@@ -1,5 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "Headless.h"
+#include "ShaderProgram.h"
 
 #include <iostream>
 
@@ -50,13 +52,15 @@ glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
 
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -82,46 +86,10 @@ int main()
 
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    ShaderProgram shaderProgram(vertexShaderSource, fragmentShaderSource);
+    const int modelLoc = shaderProgram.uniform("model");
+    const int viewLoc = shaderProgram.uniform("view");
+    const int projectionLoc = shaderProgram.uniform("projection");
 
     /*
     // vertex data
@@ -209,28 +177,30 @@ int main()
     glBindVertexArray(0);
     glEnable(GL_DEPTH_TEST);
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
+
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     glfwSetKeyCallback(window, keyboardCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
 
     // ptla zdarze
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
         // renderowanie
         glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shaderProgram.use();
 
         glm::mat4 model = glm::mat4(1.0f); 
 
-        GLint modelLoc = glGetUniformLocation(shaderProgram, "model"); 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        shaderProgram.set(modelLoc, model);
 
 
         glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 
-        GLint viewLoc = glGetUniformLocation(shaderProgram, "view"); 
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        shaderProgram.set(viewLoc, view);
 
 
         glm::vec3 cameraFront_new; 
@@ -241,25 +211,24 @@ int main()
 
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
 
-        GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection"); 
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        shaderProgram.set(projectionLoc, projection);
 
-        glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         //
         
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
     }
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteProgram(shaderProgram.id());
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
@@ -1,5 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "Headless.h"
+#include "ShaderProgram.h"
+#include "TextureLoader.h"
 
 #include <iostream>
 
@@ -7,8 +10,6 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image/stb_image.h>
 
 const GLchar* vertexShaderSource =
 "#version 330 core\n"
@@ -66,13 +67,15 @@ float lastTime;
 int frames;
 float actualFPS;
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -98,59 +101,18 @@ int main()
 
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    //texture::
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    GLubyte* tex1 = stbi_load("texture2.jpg", &width, &height, &nrChannels, 0);
-
-    GLuint texture1;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex1);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(tex1);
+    ShaderProgram shaderProgram(vertexShaderSource, fragmentShaderSource);
+    const int modelLoc = shaderProgram.uniform("model");
+    const int viewLoc = shaderProgram.uniform("view");
+    const int projectionLoc = shaderProgram.uniform("projection");
+    //texture:: decoded on a worker thread, a placeholder is drawn until textures.poll() uploads it
+    // decoded mip chains kept in decode_cache/, later runs map them instead of decoding
+    DecodeCache decodeCache;
+    TextureLoader textures;
+    // mip levels filtered on the worker, not glGenerateMipmap
+    textures.setMipmaps(TextureLoader::Mipmaps::Cpu);
+    textures.setDecodeCache(&decodeCache);
+    GLuint texture1 = textures.load("texture2.jpg");
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -246,6 +208,9 @@ glEnableVertexAttribArray(2);
 glBindVertexArray(0);
 glEnable(GL_DEPTH_TEST);
 
+if (!headless.begin(window_width, window_height))
+    return -1;
+
 glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
 glfwSetKeyCallback(window, keyboardCallback);
@@ -253,13 +218,19 @@ glfwSetCursorPosCallback(window, mouseCallback);
 
 
 glfwSetTime(0.0);
-lastTime = glfwGetTime();
+lastTime = headless.time();
+// headless frames are compared between runs, they must not depend on decode timing
+if (headless.enabled())
+    textures.wait();
 // ptla zdarze
-while (!glfwWindowShouldClose(window))
+while (headless.running(window))
 {
+    textures.poll();
+
     // renderowanie
     glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    shaderProgram.use();
     glBindTexture(GL_TEXTURE_2D, texture1);
     deltaMotion += deltaTime;
     glm::mat4 model = glm::mat4(1.0f);
@@ -274,14 +245,12 @@ while (!glfwWindowShouldClose(window))
     model = glm::translate(model, glm::vec3((sin(deltaMotion) * 1.5), 0.0f, 0.0f));
 
 
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    shaderProgram.set(modelLoc, model);
 
 
     glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    shaderProgram.set(viewLoc, view);
 
 
     glm::vec3 cameraFront_new;
@@ -292,25 +261,23 @@ while (!glfwWindowShouldClose(window))
 
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
 
-    GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    shaderProgram.set(projectionLoc, projection);
 
 
-    glUseProgram(shaderProgram);
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 
     //
 
-    glfwSwapBuffers(window);
+    headless.present(window);
     glfwSwapInterval(0);
     glfwPollEvents();
-    float currentTime = glfwGetTime();
+    float currentTime = headless.time();
     deltaTime = currentTime - previousTime;
     previousTime = currentTime;
 
-    currentTime = glfwGetTime();
+    currentTime = headless.time();
     frames++;
     if ((currentTime - lastTime) >= 1.0){
         actualFPS = frames;
@@ -326,8 +293,11 @@ while (!glfwWindowShouldClose(window))
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteTextures(1, &texture1);
+    textures.destroy();
+    glDeleteProgram(shaderProgram.id());
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
@@ -1,6 +1,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-
+#include "CameraBuffer.h"
+#include "Headless.h"
+#include "NormalMatrix.h"
+#include "ShaderProgram.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -16,12 +23,12 @@ const GLchar* vertexShaderSource =
 "out vec3 fragmentPosition;\n"
 "out vec3 Normal;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"uniform mat3 normalMatrix;\n"
+CAMERA_UNIFORM_BLOCK
 "void main()\n"
 "{\n"
 "    fragmentPosition = vec3(model* vec4(position,1.0));\n"
-"    Normal = mat3(transpose(inverse(model))) * normal;\n"
+"    Normal = normalMatrix * normal;\n"
 "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
 "}\0";
 
@@ -29,8 +36,7 @@ const GLchar* vertexShaderLightSource =
 "#version 330 core\n"
 "layout(location = 0) in vec3 position;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+CAMERA_UNIFORM_BLOCK
 "void main()\n"
 "{\n"
 "    gl_Position = projection * view * model * vec4(position, 1.0);\n"
@@ -50,7 +56,7 @@ const GLchar* fragmentShaderSource =
 "in vec3 fragmentPosition;\n"
 "out vec4 fragmentColor;\n"
 "uniform vec3 lightPos;\n"
-"uniform vec3 viewPos;\n"
+CAMERA_UNIFORM_BLOCK
 "uniform float ambientStrength;\n"
 "uniform float specularStrength;\n"
 "uniform float diffuseStrength;\n"
@@ -71,9 +77,71 @@ const GLchar* fragmentShaderSource =
 "    fragmentColor = vec4(result, 1.0);\n"
 "}\0";
 
+// the cube of both draws, also read by the CPU path
+const GLfloat vertices[] = {
+    // vertices coords      // normals 
+    -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+
+    -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
+
+     0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+
+    -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+
+    -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f
+};
+
+const GLuint indices[] = {
+    0,1,2,
+    3,4,5,
+    6,7,8,
+    9,10,11,
+    12,13,14,
+    15,16,17,
+    18,19,20,
+    21,22,23,
+    24,25,26,
+    27,28,29,
+    30,31,32,
+    33,34,35
+};
+
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void TitleWindow(GLFWwindow* window);
+int renderOnCpu(Headless& headless);
 
 float pitch = 0.0f;
 float yaw = -90.0f;
@@ -98,13 +166,18 @@ bool diffuse = true;
 bool spec = true;
 
 
-int main()
+int main(int argc, char** argv)
 {
+    Headless headless(argc, argv);
+    // --software 1: the scene on the CPU (SoftwareRasterizer), without a window or a GL context
+    if (std::atoi(headless.option("--software", "0").c_str()) != 0)
+        return renderOnCpu(headless);
     // inicjalizacja GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    headless.windowHints();
 
 
     // Tworzenie okna
@@ -129,91 +202,18 @@ int main()
     }
 
     // shadery
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    GLint status;
-    GLchar error_message[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    /// <summary>
-    /// </summary>
-    /// <returns></returns>
-    GLuint lightVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(lightVertexShader, 1, &vertexShaderLightSource, NULL);
-    glCompileShader(lightVertexShader);
-
-    glGetShaderiv(lightVertexShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(lightVertexShader, 512, NULL, error_message);
-        std::cout << "Error (Vertex shader): " << error_message << std::endl;
-    }
-
-    GLuint lightFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(lightFragmentShader, 1, &fragmentShaderLightSource, NULL);
-    glCompileShader(lightFragmentShader);
-
-    glGetShaderiv(lightFragmentShader, GL_COMPILE_STATUS, &status);
-    if (!status)
-    {
-        glGetShaderInfoLog(lightFragmentShader, 512, NULL, error_message);
-        std::cout << "Error (Fragment shader): " << error_message << std::endl;
-    }
-
-    GLuint lightShaderProgram = glCreateProgram();
-    glAttachShader(lightShaderProgram, lightVertexShader);
-    glAttachShader(lightShaderProgram, lightFragmentShader);
-    glLinkProgram(lightShaderProgram);
-
-    glGetProgramiv(lightShaderProgram, GL_LINK_STATUS, &status);
-    if (!status)
-    {
-        glGetProgramInfoLog(lightShaderProgram, 512, NULL, error_message);
-        std::cout << "Error (Shader program): " << error_message << std::endl;
-    }
-
-
-    glDetachShader(lightShaderProgram, lightVertexShader);
-    glDetachShader(lightShaderProgram, lightFragmentShader);
-
-
-
-    glDeleteShader(lightVertexShader);
-    glDeleteShader(lightFragmentShader);
+    ShaderProgram shaderProgram(vertexShaderSource, fragmentShaderSource);
+    ShaderProgram lightShaderProgram(vertexShaderLightSource, fragmentShaderLightSource);
+    const int lightPositionLoc = shaderProgram.uniform("lightPos");
+    const int diffuseLoc = shaderProgram.uniform("diffuseStrength");
+    const int ambientLoc = shaderProgram.uniform("ambientStrength");
+    const int specularLoc = shaderProgram.uniform("specularStrength");
+    const int modelLoc = shaderProgram.uniform("model");
+    const int normalMatrixLoc = shaderProgram.uniform("normalMatrix");
+    const int lightModelLoc = lightShaderProgram.uniform("model");
+    shaderProgram.bindUniformBlock("Camera", CameraBuffer::binding);
+    lightShaderProgram.bindUniformBlock("Camera", CameraBuffer::binding);
+    CameraBuffer cameraBuffer;
 
     /*
     // vertex data
@@ -230,68 +230,6 @@ int main()
         0, 3, 1     // triangle 2
     };
     */
-    GLfloat vertices[] = {
-        // vertices coords      // normals 
-        -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-         0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-        -0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-        -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
-
-        -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,    0.0f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,    -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,    -1.0f,  0.0f,  0.0f,
-
-         0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
-
-        -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
-
-        -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f
-    };
-
-
-
-    GLuint indices[] = {
-        0,1,2,
-        3,4,5,
-        6,7,8,
-        9,10,11,
-        12,13,14,
-        15,16,17,
-        18,19,20,
-        21,22,23,
-        24,25,26,
-        27,28,29,
-        30,31,32,
-        33,34,35
-    };
-
     GLuint VAO;
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
@@ -322,47 +260,43 @@ int main()
     glBindVertexArray(0);
     glEnable(GL_DEPTH_TEST);
 
+    if (!headless.begin(window_width, window_height))
+        return -1;
+
     glViewport(0, 0, (GLuint)window_width, (GLuint)window_height);
 
     glfwSetKeyCallback(window, keyboardCallback);
     glfwSetCursorPosCallback(window, mouseCallback);
     glfwSetTime(0.0);
     // ptla zdarze
-    while (!glfwWindowShouldClose(window))
+    while (headless.running(window))
     {
-        glUseProgram(shaderProgram);
+        shaderProgram.use();
         // renderowanie 1 cube
         glClearColor(0.066f, 0.09f, 0.07f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        GLint lightPositionLoc = glGetUniformLocation(shaderProgram, "lightPos");
-        glm::vec3 lightPosition((cos(glfwGetTime()) * 3), 2.0f, (sin(glfwGetTime()) * 3));
-        glUniform3f(lightPositionLoc, lightPosition.x, lightPosition.y, lightPosition.z);
-
+        glm::vec3 lightPosition((cos(headless.time()) * 3), 2.0f, (sin(headless.time()) * 3));
+        shaderProgram.set(lightPositionLoc, lightPosition);
 
-        GLint cameraPositionLoc = glGetUniformLocation(shaderProgram, "viewPos");
-        glUniform3f(cameraPositionLoc, cameraPosition.x, cameraPosition.y, cameraPosition.z);
 
-        GLint diffuseLoc = glGetUniformLocation(shaderProgram, "diffuseStrength");
         if (diffuse) {
-            glUniform1f(diffuseLoc, 1.0f);
+            shaderProgram.set(diffuseLoc, 1.0f);
         }
         else {
-            glUniform1f(diffuseLoc, 0.0f);
+            shaderProgram.set(diffuseLoc, 0.0f);
         }
-        GLint ambientLoc = glGetUniformLocation(shaderProgram, "ambientStrength");
         if (ambient) {
-            glUniform1f(ambientLoc, 0.15f);
+            shaderProgram.set(ambientLoc, 0.15f);
         }
         else {
-            glUniform1f(ambientLoc, 0.0f);
+            shaderProgram.set(ambientLoc, 0.0f);
         }
-        GLint specularLoc = glGetUniformLocation(shaderProgram, "specularStrength");
         if (spec) {
-            glUniform1f(specularLoc, 0.4f);
+            shaderProgram.set(specularLoc, 0.4f);
         }
         else {
-            glUniform1f(specularLoc, 0.0f);
+            shaderProgram.set(specularLoc, 0.0f);
         }
 
 
@@ -370,15 +304,12 @@ int main()
 
         glm::mat4 model = glm::mat4(1.0f);
 
-        GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        shaderProgram.set(modelLoc, model);
+        shaderProgram.set(normalMatrixLoc, normalMatrix(model));
 
 
         glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 
-        GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 
 
         glm::vec3 cameraFront_new;
@@ -389,8 +320,8 @@ int main()
 
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
 
-        GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        // one write for both programs
+        cameraBuffer.update(view, projection, cameraPosition);
 
 
 
@@ -401,19 +332,12 @@ int main()
 
         // renderowanie 2 cube
         
-        glUseProgram(lightShaderProgram);
+        lightShaderProgram.use();
 
         model = glm::mat4(1.0f);
-        modelLoc = glGetUniformLocation(lightShaderProgram, "model");
         model = glm::translate(model, glm::vec3(lightPosition.x, lightPosition.y, lightPosition.z));
         model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-        viewLoc = glGetUniformLocation(lightShaderProgram, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-        projectionLoc = glGetUniformLocation(lightShaderProgram, "projection");
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        lightShaderProgram.set(lightModelLoc, model);
 
         
         glBindVertexArray(VAO);
@@ -425,9 +349,9 @@ int main()
         //model = glm::translate(model, glm::vec3((cos(glfwGetTime()) *2), 1.5f, (sin(glfwGetTime()) *2)));
         //model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
 
-        glfwSwapBuffers(window);
+        headless.present(window);
         glfwPollEvents();
-        float currentTime = glfwGetTime();
+        float currentTime = headless.time();
         deltaTime = currentTime - previousTime;
         previousTime = currentTime;
         TitleWindow(window);
@@ -436,8 +360,11 @@ int main()
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteProgram(shaderProgram.id());
+    glDeleteProgram(lightShaderProgram.id());
+    cameraBuffer.destroy();
 
+    headless.finish();
     glfwTerminate();
     return 0;
 }
@@ -489,3 +416,76 @@ void TitleWindow(GLFWwindow* window) {
     const char* c = s.c_str();
     glfwSetWindowTitle(window, c);
 }
+
+// the same frames as the window loop in headless mode, drawn by SoftwareRasterizer with the two
+// programs above written out as C++; --threads sets the number of cores it shades on
+int renderOnCpu(Headless& headless)
+{
+    SoftwareRasterizer rasterizer(window_width, window_height, static_cast<unsigned>(std::max(0, std::atoi(headless.option("--threads", "0").c_str()))));
+    if (!headless.beginSoftware(window_width, window_height))
+        return -1;
+    const int vertexCount = sizeof(indices) / sizeof(indices[0]);
+
+    while (headless.running(NULL))
+    {
+        rasterizer.clear(0.066f, 0.09f, 0.07f, 1.0f);
+        const float time = static_cast<float>(headless.time());
+        const glm::vec3 lightPosition((cos(time) * 3), 2.0f, (sin(time) * 3));
+        const float diffuseStrength = diffuse ? 1.0f : 0.0f;
+        const float ambientStrength = ambient ? 0.15f : 0.0f;
+        const float specularStrength = spec ? 0.4f : 0.0f;
+
+        glm::vec3 cameraFront_new;
+        cameraFront_new.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+        cameraFront_new.y = sin(glm::radians(pitch));
+        cameraFront_new.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+        cameraFront = glm::normalize(cameraFront_new);
+        const glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+        const glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(window_width) / static_cast<float>(window_height), 0.1f, 100.0f);
+
+        // vertexShaderSource / fragmentShaderSource
+        const glm::mat4 model = glm::mat4(1.0f);
+        const glm::mat3 normals = normalMatrix(model);
+        const glm::mat4 mvp = projection * view * model;
+        rasterizer.drawElements(vertices, 6, indices, vertexCount, 6,
+            [&](const float* vertex, SoftwareRasterizer::VertexOutput& out) {
+                const glm::vec4 position(vertex[0], vertex[1], vertex[2], 1.0f);
+                const glm::vec3 fragmentPosition = glm::vec3(model * position);
+                const glm::vec3 normal = normals * glm::vec3(vertex[3], vertex[4], vertex[5]);
+                out.position = mvp * position;
+                out.varyings[0] = fragmentPosition.x; out.varyings[1] = fragmentPosition.y; out.varyings[2] = fragmentPosition.z;
+                out.varyings[3] = normal.x; out.varyings[4] = normal.y; out.varyings[5] = normal.z;
+            },
+            [&](const float* in) {
+                const glm::vec3 fragmentPosition(in[0], in[1], in[2]);
+                const glm::vec3 objectColor(0.0f, 1.0f, 0.0f);
+                const glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
+                const glm::vec3 ambientColor = ambientStrength * lightColor;
+                const glm::vec3 norm = glm::normalize(glm::vec3(in[3], in[4], in[5]));
+                const glm::vec3 lightDir = glm::normalize(lightPosition - fragmentPosition);
+                const float diff = glm::max(glm::dot(norm, lightDir), 0.0f);
+                const glm::vec3 diffuseColor = diff * lightColor * diffuseStrength;
+                const glm::vec3 viewDir = glm::normalize(cameraPosition - fragmentPosition);
+                const glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+                const float specular = glm::pow(glm::max(glm::dot(viewDir, reflectDir), 0.0f), 64.0f);
+                const glm::vec3 specularColor = specularStrength * specular * lightColor;
+                return glm::vec4((ambientColor + diffuseColor + specularColor) * objectColor, 1.0f);
+            });
+
+        // vertexShaderLightSource / fragmentShaderLightSource
+        glm::mat4 lightModel = glm::translate(glm::mat4(1.0f), lightPosition);
+        lightModel = glm::scale(lightModel, glm::vec3(0.5f, 0.5f, 0.5f));
+        const glm::mat4 lightMvp = projection * view * lightModel;
+        rasterizer.drawElements(vertices, 6, indices, vertexCount, 0,
+            [&](const float* vertex, SoftwareRasterizer::VertexOutput& out) {
+                out.position = lightMvp * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+            },
+            [](const float*) {
+                return glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+            });
+
+        headless.present(reinterpret_cast<const unsigned char*>(rasterizer.colorBuffer()));
+    }
+    headless.finish();
+    return 0;
+}